@@ -0,0 +1,318 @@
+#include "ao_bake.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+
+namespace {
+
+struct ModelClusters {
+    std::vector<unsigned int> clusterOf;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+};
+
+// AO is low frequency, so it is sampled once per (grid cell, facing axis)
+// cluster and shared by the cluster's vertices. Splitting by facing keeps
+// both sides of thin walls apart.
+ModelClusters BuildClusters(const Model& m, int cells) {
+    ModelClusters c;
+    c.clusterOf.resize(VertexCount(m));
+
+    const glm::vec3 lo = m.boundsCenter - glm::vec3(m.boundsRadius);
+    const float cellSize = std::max(2.0f * m.boundsRadius / cells, 1e-6f);
+
+    std::unordered_map<std::uint64_t, unsigned int> lookup;
+    for (size_t v = 0; v < c.clusterOf.size(); ++v) {
+        const glm::vec3 p = VertexPosition(m, v);
+        glm::vec3 n = VertexNormal(m, v);
+        glm::vec3 an = glm::abs(n);
+        int axis = (an.x > an.y && an.x > an.z) ? 0 : (an.y > an.z ? 1 : 2);
+        int facing = axis * 2 + (n[axis] < 0.0f ? 1 : 0);
+
+        glm::ivec3 cell = glm::ivec3((p - lo) / cellSize);
+        std::uint64_t key = ((static_cast<std::uint64_t>(cell.x) * cells + cell.y) * cells + cell.z) * 6 + facing;
+
+        auto it = lookup.find(key);
+        if (it == lookup.end()) {
+            it = lookup.emplace(key, static_cast<unsigned int>(c.positions.size())).first;
+            c.positions.push_back(glm::vec3(0.0f));
+            c.normals.push_back(glm::vec3(0.0f));
+        }
+        c.clusterOf[v] = it->second;
+        c.positions[it->second] += p;
+        c.normals[it->second] += n;
+    }
+
+    std::vector<unsigned int> counts(c.positions.size(), 0);
+    for (unsigned int k : c.clusterOf) counts[k]++;
+    for (size_t k = 0; k < c.positions.size(); ++k) {
+        c.positions[k] /= static_cast<float>(counts[k]);
+        float len = glm::length(c.normals[k]);
+        c.normals[k] = (len > 1e-6f) ? c.normals[k] / len : glm::vec3(0, 1, 0);
+    }
+    return c;
+}
+
+std::uint32_t Hash(std::uint32_t x) {
+    x ^= x >> 16; x *= 0x7feb352dU;
+    x ^= x >> 15; x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+float Random01(std::uint32_t& state) {
+    state = Hash(state + 0x9e3779b9U);
+    return static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+}
+
+std::uint64_t MakeKey(const std::vector<AoBakeInstance>& instances, const std::vector<TriangleBvh::Triangle>& ground,
+    std::uint64_t seed, const AoBakeSettings& s) {
+    std::uint64_t h = 1469598103934665603ULL;
+    auto Mix = [&](std::uint64_t v) {
+        for (int i = 0; i < 8; ++i) {
+            h ^= (v >> (i * 8)) & 0xFF;
+            h *= 1099511628211ULL;
+        }
+        };
+    auto MixFloats = [&](const float* v, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            std::uint32_t bits;
+            std::memcpy(&bits, &v[i], sizeof(bits));
+            Mix(bits);
+        }
+        };
+
+    Mix(seed);
+    Mix(static_cast<std::uint64_t>(s.samples));
+    Mix(static_cast<std::uint64_t>(s.clusterCells));
+    Mix(static_cast<std::uint64_t>(s.maxDistance * 1000.0f));
+    Mix(ground.size());
+    for (const auto& t : ground) {
+        MixFloats(&t.a.x, 3);
+        MixFloats(&t.b.x, 3);
+        MixFloats(&t.c.x, 3);
+    }
+    for (const auto& inst : instances) {
+        Mix(VertexCount(*inst.model));
+        Mix(inst.model->indices.size());
+        MixFloats(&inst.transform[0][0], 16);
+    }
+    return h;
+}
+
+}
+
+std::shared_ptr<AoBakeResult> BakeVertexAo(JobPool& jobs, const std::vector<AoBakeInstance>& instances,
+    const std::vector<TriangleBvh::Triangle>& ground, const AoBakeSettings& settings, const std::atomic<bool>* cancel) {
+    auto result = std::make_shared<AoBakeResult>();
+
+    std::unordered_map<const Model*, ModelClusters> clusters;
+    for (const auto& inst : instances) {
+        if (!clusters.count(inst.model))
+            clusters.emplace(inst.model, BuildClusters(*inst.model, settings.clusterCells));
+    }
+
+    // Occluders use each instance's coarsest LOD plus the ground triangles.
+    const bool groundPlane = ground.empty();
+    std::vector<TriangleBvh::Triangle> tris(ground);
+    for (const auto& inst : instances) {
+        const Model& m = *inst.model;
+        for (const SubMesh& sm : GetLodSubMeshes(m, static_cast<int>(m.lods.size()))) {
+            for (unsigned int i = 0; i + 2 < sm.indexCount; i += 3) {
+                TriangleBvh::Triangle t;
+                t.a = glm::vec3(inst.transform * glm::vec4(VertexPosition(m, m.indices[sm.indexOffset + i + 0]), 1.0f));
+                t.b = glm::vec3(inst.transform * glm::vec4(VertexPosition(m, m.indices[sm.indexOffset + i + 1]), 1.0f));
+                t.c = glm::vec3(inst.transform * glm::vec4(VertexPosition(m, m.indices[sm.indexOffset + i + 2]), 1.0f));
+                tris.push_back(t);
+            }
+        }
+    }
+
+    TriangleBvh bvh;
+    bvh.Build(std::move(tris));
+
+    std::vector<size_t> clusterBase(instances.size() + 1, 0);
+    for (size_t i = 0; i < instances.size(); ++i)
+        clusterBase[i + 1] = clusterBase[i] + clusters[instances[i].model].positions.size();
+
+    std::vector<float> clusterAo(clusterBase.back(), 1.0f);
+    size_t sliceBase = 0;
+
+    const JobPool::RangeFn Trace = [&](int first, int last) {
+        const size_t begin = sliceBase + static_cast<size_t>(first);
+        const size_t end = sliceBase + static_cast<size_t>(last);
+
+        size_t inst = std::upper_bound(clusterBase.begin(), clusterBase.end(), begin) - clusterBase.begin() - 1;
+        for (size_t k = begin; k < end; ++k) {
+            while (k >= clusterBase[inst + 1]) ++inst;
+
+            const AoBakeInstance& bi = instances[inst];
+            const ModelClusters& mc = clusters.at(bi.model);
+            const size_t local = k - clusterBase[inst];
+
+            const glm::mat3 linear(bi.transform);
+            const float scale = glm::length(linear[0]);
+            const float bias = 0.07f * bi.model->boundsRadius * scale;
+
+            glm::vec3 n = glm::normalize(glm::transpose(glm::inverse(linear)) * mc.normals[local]);
+            glm::vec3 p = glm::vec3(bi.transform * glm::vec4(mc.positions[local], 1.0f)) + n * bias;
+
+            glm::vec3 t = glm::normalize(glm::cross(std::abs(n.y) < 0.99f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0), n));
+            glm::vec3 b = glm::cross(n, t);
+
+            std::uint32_t rng = Hash(static_cast<std::uint32_t>(k) * 2654435761U);
+            int hits = 0;
+            for (int s = 0; s < settings.samples; ++s) {
+                float u1 = Random01(rng);
+                float u2 = Random01(rng);
+                float r = std::sqrt(u1);
+                float phi = 6.2831853f * u2;
+                glm::vec3 dir = t * (r * std::cos(phi)) + b * (r * std::sin(phi)) + n * std::sqrt(1.0f - u1);
+
+                bool occluded = groundPlane && dir.y < 0.0f && -p.y / dir.y < settings.maxDistance;
+                if (!occluded)
+                    occluded = bvh.Occluded(p, dir, 1e-3f, settings.maxDistance);
+                if (occluded) ++hits;
+            }
+
+            clusterAo[k] = 1.0f - static_cast<float>(hits) / settings.samples;
+        }
+        };
+
+    // A slice is a few milliseconds of rays, so a frame's own ParallelFor
+    // waits at most that long behind the bake.
+    const size_t slice = static_cast<size_t>(jobs.ThreadCount()) * 64;
+    for (sliceBase = 0; sliceBase < clusterAo.size(); sliceBase += slice) {
+        if (cancel && *cancel) return nullptr;
+        jobs.ParallelFor(static_cast<int>(std::min(slice, clusterAo.size() - sliceBase)), Trace);
+    }
+
+    result->offsets.resize(instances.size());
+    size_t total = 0;
+    for (size_t i = 0; i < instances.size(); ++i) {
+        result->offsets[i] = static_cast<unsigned int>(total);
+        total += VertexCount(*instances[i].model);
+    }
+
+    result->values.resize(total);
+    for (size_t i = 0; i < instances.size(); ++i) {
+        const ModelClusters& mc = clusters.at(instances[i].model);
+        std::uint8_t* out = result->values.data() + result->offsets[i];
+        for (size_t v = 0; v < mc.clusterOf.size(); ++v)
+            out[v] = static_cast<std::uint8_t>(clusterAo[clusterBase[i] + mc.clusterOf[v]] * 255.0f + 0.5f);
+    }
+
+    return result;
+}
+
+// Bumped when the vertex order of loaded meshes changes, since values are
+// stored per vertex index.
+static const char kAoMagic[4] = { 'A', 'O', 'B', '2' };
+
+bool SaveAoCache(const std::string& path, std::uint64_t key, const AoBakeResult& result) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    std::uint32_t count = static_cast<std::uint32_t>(result.offsets.size());
+    std::uint64_t size = result.values.size();
+
+    file.write(kAoMagic, 4);
+    file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    file.write(reinterpret_cast<const char*>(result.offsets.data()), count * sizeof(unsigned int));
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    file.write(reinterpret_cast<const char*>(result.values.data()), size);
+    return static_cast<bool>(file);
+}
+
+std::shared_ptr<AoBakeResult> LoadAoCache(const std::string& path, std::uint64_t key, const std::vector<AoBakeInstance>& instances) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return nullptr;
+
+    char magic[4];
+    std::uint64_t fileKey = 0;
+    std::uint32_t count = 0;
+    file.read(magic, 4);
+    file.read(reinterpret_cast<char*>(&fileKey), sizeof(fileKey));
+    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!file || !std::equal(magic, magic + 4, kAoMagic) || fileKey != key || count != instances.size())
+        return nullptr;
+
+    auto result = std::make_shared<AoBakeResult>();
+    result->offsets.resize(count);
+    file.read(reinterpret_cast<char*>(result->offsets.data()), count * sizeof(unsigned int));
+
+    std::uint64_t size = 0;
+    file.read(reinterpret_cast<char*>(&size), sizeof(size));
+
+    size_t expected = 0;
+    for (const auto& inst : instances) expected += VertexCount(*inst.model);
+    if (!file || size != expected) return nullptr;
+
+    result->values.resize(size);
+    file.read(reinterpret_cast<char*>(result->values.data()), size);
+    if (!file) return nullptr;
+    return result;
+}
+
+AoBaker::~AoBaker() {
+    Stop();
+}
+
+void AoBaker::Stop() {
+    m_cancel = true;
+    if (m_thread.joinable()) m_thread.join();
+    m_cancel = false;
+    m_done = false;
+    m_result.reset();
+}
+
+void AoBaker::Start(JobPool& jobs, std::vector<AoBakeInstance> instances, std::vector<TriangleBvh::Triangle> ground,
+    std::uint64_t sceneSeed, const std::string& cacheDir) {
+    Stop();
+
+    m_thread = std::thread([this, &jobs, instances = std::move(instances), ground = std::move(ground), sceneSeed, cacheDir] {
+        const std::uint64_t key = MakeKey(instances, ground, sceneSeed, settings);
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "ao_%016llx.bin", static_cast<unsigned long long>(key));
+        const std::string path = cacheDir + "/" + name;
+
+        auto result = LoadAoCache(path, key, instances);
+        if (result) {
+            std::cout << "AO: loaded " << path << "\n";
+        }
+        else {
+            auto start = std::chrono::steady_clock::now();
+            result = BakeVertexAo(jobs, instances, ground, settings, &m_cancel);
+            if (!result) return;
+            float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "AO: baked " << result->values.size() << " vertices in " << seconds << " s\n";
+
+            std::error_code ec;
+            std::filesystem::create_directories(cacheDir, ec);
+            if (!SaveAoCache(path, key, *result))
+                std::cerr << "AO: could not write cache " << path << "\n";
+        }
+
+        m_result = result;
+        m_done = true;
+        });
+}
+
+bool AoBaker::Poll(std::shared_ptr<AoBakeResult>& out) {
+    if (!m_done) return false;
+
+    m_thread.join();
+    m_done = false;
+    out = std::move(m_result);
+    return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bvh.h"
+#include "job_pool.h"
+#include "model.h"
+
+struct AoBakeInstance {
+    const Model* model = nullptr;
+    glm::mat4 transform{ 1.0f };
+};
+
+struct AoBakeSettings {
+    int samples = 24;
+    float maxDistance = 3.5f;
+    int clusterCells = 48;
+};
+
+// Per-vertex AO for every instance, concatenated; 255 means unoccluded.
+struct AoBakeResult {
+    std::vector<unsigned int> offsets;
+    std::vector<std::uint8_t> values;
+};
+
+// ground holds extra occluder triangles (terrain); without it the ground is
+// the plane y = 0. Rays are traced on jobs in short ParallelFor slices so
+// other users of the pool are never held up for long. Returns nullptr if
+// cancel is raised before the bake ends.
+std::shared_ptr<AoBakeResult> BakeVertexAo(JobPool& jobs, const std::vector<AoBakeInstance>& instances,
+    const std::vector<TriangleBvh::Triangle>& ground, const AoBakeSettings& settings, const std::atomic<bool>* cancel = nullptr);
+
+bool SaveAoCache(const std::string& path, std::uint64_t key, const AoBakeResult& result);
+std::shared_ptr<AoBakeResult> LoadAoCache(const std::string& path, std::uint64_t key, const std::vector<AoBakeInstance>& instances);
+
+// Runs cache lookup + bake on a background thread so the scene is playable
+// (with flat ambient) while it works; the rays go to the shared pool. The
+// cache key covers the instance transforms and the ground, so moving a
+// house or reshaping the terrain never reuses a stale bake. Stop the baker
+// before the pool.
+class AoBaker {
+public:
+    ~AoBaker();
+
+    void Start(JobPool& jobs, std::vector<AoBakeInstance> instances, std::vector<TriangleBvh::Triangle> ground,
+        std::uint64_t sceneSeed, const std::string& cacheDir = "cache");
+    void Stop();
+    bool Poll(std::shared_ptr<AoBakeResult>& out);
+    bool Busy() const { return m_thread.joinable(); }
+
+    AoBakeSettings settings;
+
+private:
+    std::thread m_thread;
+    std::atomic<bool> m_done{ false };
+    std::atomic<bool> m_cancel{ false };
+    std::shared_ptr<AoBakeResult> m_result;
+};
@@ -0,0 +1,240 @@
+#include "asset_tasks.h"
+
+#include <SFML/Graphics.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+#include "cooked_assets.h"
+#include "mesh_codec.h"
+#include "model.h"
+#include "texture_codec.h"
+#include "upload_thread.h"
+
+AsyncExecutor::~AsyncExecutor() {
+    Stop();
+}
+
+void AsyncExecutor::Start(unsigned int workers) {
+    Stop();
+
+    m_renderThread = std::this_thread::get_id();
+    m_stop = false;
+    for (unsigned int i = 0; i < std::max(workers, 1u); ++i)
+        m_workers.emplace_back(&AsyncExecutor::WorkerMain, this);
+}
+
+void AsyncExecutor::Stop() {
+    if (!m_workers.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (auto& t : m_workers) t.join();
+        m_workers.clear();
+    }
+
+    // With the workers gone, anything still queued (or queued by what
+    // runs now) finishes here so no coroutine frame is left suspended.
+    for (;;) {
+        std::coroutine_handle<> h;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::deque<std::coroutine_handle<>>& q = m_renderQueue.empty() ? m_workQueue : m_renderQueue;
+            if (q.empty()) break;
+            h = q.front();
+            q.pop_front();
+        }
+        h.resume();
+    }
+}
+
+void AsyncExecutor::Post(std::coroutine_handle<> h, bool render) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        (render ? m_renderQueue : m_workQueue).push_back(h);
+    }
+    if (!render) m_cv.notify_one();
+}
+
+int AsyncExecutor::PollRender() {
+    std::deque<std::coroutine_handle<>> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ready.swap(m_renderQueue);
+    }
+
+    for (auto h : ready) h.resume();
+    return static_cast<int>(ready.size());
+}
+
+void AsyncExecutor::WorkerMain() {
+    for (;;) {
+        std::coroutine_handle<> h;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [&] { return m_stop || !m_workQueue.empty(); });
+            if (m_workQueue.empty()) return;
+            h = m_workQueue.front();
+            m_workQueue.pop_front();
+        }
+        h.resume();
+    }
+}
+
+namespace {
+
+// Always resumes on the render thread. Whichever of await_suspend and
+// publish finishes second continues the coroutine, so an immediate publish
+// can't resume it twice. Publish normally runs on the render thread after
+// the fence; if it won the race (or ran inline because the uploader had
+// stopped) and the awaiting thread is a worker, the coroutine is handed
+// to the render queue instead of continuing there.
+struct UploadAwaiter {
+    AsyncExecutor* executor;
+    UploadThread* uploader;
+    std::function<bool()> job;
+    bool ok{ false };
+    std::atomic<bool> handedOff{ false };
+    std::coroutine_handle<> waiting{};
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> h) {
+        waiting = h;
+        uploader->Enqueue(std::move(job), [this](bool result) {
+            ok = result;
+            if (handedOff.exchange(true)) waiting.resume();
+            });
+        if (!handedOff.exchange(true)) return true;
+        if (executor->OnRenderThreadNow()) return false;
+        executor->OnRenderThread().await_suspend(h);
+        return true;
+    }
+    bool await_resume() const noexcept { return ok; }
+};
+
+// Keeps progress counts balanced on every exit path.
+struct ProgressScope {
+    LoadProgress* progress;
+    bool ok{ false };
+
+    explicit ProgressScope(LoadProgress* p) : progress(p) { if (progress) progress->started++; }
+    ~ProgressScope() {
+        if (!progress) return;
+        if (!ok) progress->failed++;
+        progress->finished++;
+    }
+};
+
+}
+
+Task<bool> UploadAsync(AssetContext ctx, std::function<bool()> job) {
+    if (!ctx.uploader || !ctx.uploader->Running()) {
+        co_await ctx.executor->OnRenderThread();
+        co_return job();
+    }
+    co_return co_await UploadAwaiter{ ctx.executor, ctx.uploader, std::move(job) };
+}
+
+Task<GLuint> LoadTextureAsync(AssetContext ctx, std::string path) {
+    ProgressScope scope(ctx.progress);
+
+    co_await ctx.executor->OnWorker();
+    if (ctx.cancel.Cancelled()) co_return 0;
+
+    GLuint tex = 0;
+
+    // A cooked texture is already mipped and block compressed; the source
+    // image is only decoded when there is none or the driver lacks S3TC.
+    const std::string cookedPath = CookedPath(path, ".atex");
+    auto cooked = std::make_shared<CookedTexture>();
+    if (FileExists(cookedPath) && LoadCookedTexture(cookedPath, *cooked)) {
+        const bool ok = co_await UploadAsync(ctx, [cooked, &tex] {
+            tex = CreateTextureFromCooked(*cooked);
+            return tex != 0;
+            });
+        if (ok) {
+            std::cout << "Loaded texture: " << cookedPath << "\n";
+            scope.ok = true;
+            co_return tex;
+        }
+    }
+    cooked.reset();
+
+    auto image = std::make_shared<sf::Image>();
+    if (!FileExists(path) || !image->loadFromFile(path)) co_return 0;
+
+    const bool ok = co_await UploadAsync(ctx, [image, &tex] {
+        tex = CreateTextureFromImage(*image);
+        return tex != 0;
+        });
+    if (!ok) co_return 0;
+
+    std::cout << "Loaded texture: " << path << "\n";
+    scope.ok = true;
+    co_return tex;
+}
+
+Task<bool> LoadModelAsync(AssetContext ctx, std::string path, Model& model, MeshStream& stream) {
+    ProgressScope scope(ctx.progress);
+
+    co_await ctx.executor->OnWorker();
+    if (ctx.cancel.Cancelled()) co_return false;
+    if (!stream.Open(path, model)) co_return false;
+
+    // LOD sub-meshes mirror the base ones index for index.
+    std::unordered_map<std::string, GLuint> loaded;
+    for (size_t i = 0; i < model.texturePaths.size() && i < model.subMeshes.size(); ++i) {
+        const std::string& file = model.texturePaths[i];
+        if (file.empty()) continue;
+
+        auto it = loaded.find(file);
+        if (it == loaded.end()) {
+            GLuint tex = co_await LoadTextureAsync(ctx, file);
+            it = loaded.emplace(file, tex).first;
+        }
+
+        model.subMeshes[i].texture = it->second;
+        for (MeshLod& lod : model.lods)
+            if (i < lod.subMeshes.size()) lod.subMeshes[i].texture = it->second;
+    }
+
+    if (ctx.cancel.Cancelled()) co_return false;
+    const bool ok = co_await UploadAsync(ctx, [&model] { return UploadModelBuffers(model); });
+    scope.ok = ok;
+    co_return ok;
+}
+
+Task<bool> RefineModelAsync(AssetContext ctx, MeshStream& stream, Model& model) {
+    ProgressScope scope(ctx.progress);
+
+    co_await ctx.executor->OnWorker();
+    if (ctx.cancel.Cancelled()) co_return false;
+
+    auto full = std::make_shared<Model>();
+    if (!stream.Finish(*full)) co_return false;
+
+    if (ctx.cancel.Cancelled()) co_return false;
+    if (!co_await UploadAsync(ctx, [full] { return UploadModelBuffers(*full); })) co_return false;
+    co_await ctx.executor->OnRenderThread();
+
+    // Textures were resolved against the coarse sub-meshes, which mirror
+    // the full ones index for index.
+    for (size_t i = 0; i < full->subMeshes.size() && i < model.subMeshes.size(); ++i) {
+        const GLuint tex = model.subMeshes[i].texture;
+        full->subMeshes[i].texture = tex;
+        for (MeshLod& lod : full->lods)
+            if (i < lod.subMeshes.size()) lod.subMeshes[i].texture = tex;
+    }
+
+    if (model.vbo) glDeleteBuffers(1, &model.vbo);
+    if (model.ebo) glDeleteBuffers(1, &model.ebo);
+    if (model.vao) glDeleteVertexArrays(1, &model.vao);
+
+    full->name = model.name;
+    model = std::move(*full);
+    scope.ok = true;
+    co_return true;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "async_task.h"
+
+struct Model;
+class MeshStream;
+class UploadThread;
+
+// Shared flag; copies observe the same cancellation.
+class CancelToken {
+public:
+    CancelToken() : m_flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void Cancel() { m_flag->store(true); }
+    bool Cancelled() const { return m_flag->load(); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_flag;
+};
+
+struct LoadProgress {
+    std::atomic<int> started{ 0 };
+    std::atomic<int> finished{ 0 };
+    std::atomic<int> failed{ 0 };
+
+    bool Idle() const { return finished.load() == started.load(); }
+};
+
+// Where coroutines resume: a few worker threads for file I/O and parsing,
+// and a queue the render thread drains once per frame (the only place
+// that may touch VAOs or scene state). GPU uploads go through the
+// UploadThread and come back on the render thread via UploadAsync.
+class AsyncExecutor {
+public:
+    AsyncExecutor() = default;
+    ~AsyncExecutor();
+
+    AsyncExecutor(const AsyncExecutor&) = delete;
+    AsyncExecutor& operator=(const AsyncExecutor&) = delete;
+
+    // Call from the render thread.
+    void Start(unsigned int workers = 2);
+    // Lets queued work run to completion (cancelled loads bail out early),
+    // then drains the render queue on the calling thread.
+    void Stop();
+
+    int PollRender();
+    bool OnRenderThreadNow() const { return std::this_thread::get_id() == m_renderThread; }
+
+    struct Hop {
+        AsyncExecutor* executor;
+        bool render;
+
+        bool await_ready() const noexcept { return render && executor->OnRenderThreadNow(); }
+        void await_suspend(std::coroutine_handle<> h) const { executor->Post(h, render); }
+        void await_resume() const noexcept {}
+    };
+
+    Hop OnWorker() { return { this, false }; }
+    Hop OnRenderThread() { return { this, true }; }
+
+private:
+    void Post(std::coroutine_handle<> h, bool render);
+    void WorkerMain();
+
+    std::vector<std::thread> m_workers;
+    std::thread::id m_renderThread;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::coroutine_handle<>> m_workQueue;
+    std::deque<std::coroutine_handle<>> m_renderQueue;
+    bool m_stop{ false };
+};
+
+// Everything an asset coroutine needs; cheap to copy into each frame.
+struct AssetContext {
+    AsyncExecutor* executor{ nullptr };
+    UploadThread* uploader{ nullptr };
+    CancelToken cancel;
+    LoadProgress* progress{ nullptr };
+};
+
+// Runs job with a GL context (the upload thread's, or the render
+// thread's if there is no shared context) and resumes on the render
+// thread once the GPU has consumed it.
+Task<bool> UploadAsync(AssetContext ctx, std::function<bool()> job);
+
+// Decodes on a worker and uploads; on success resumes on the render
+// thread. 0 on failure or cancellation.
+Task<GLuint> LoadTextureAsync(AssetContext ctx, std::string path);
+
+// model -> materials -> textures -> GPU buffers. The mesh is opened
+// through `stream` on a worker (possibly just its coarsest level, see
+// MeshStream), each distinct material texture loads in turn, and the
+// vertex data is uploaded last. On success resumes on the render thread,
+// where the caller still creates the VAO (SetupModelVertexArray).
+Task<bool> LoadModelAsync(AssetContext ctx, std::string path, Model& model, MeshStream& stream);
+
+// Decodes and uploads the rest of a streaming model, then on the render
+// thread swaps it in place of the coarse one, keeping its textures and
+// freeing the old buffers. The caller recreates the VAO straight after,
+// in the same frame. On failure the coarse model stays as it is.
+Task<bool> RefineModelAsync(AssetContext ctx, MeshStream& stream, Model& model);
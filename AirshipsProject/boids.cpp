@@ -0,0 +1,292 @@
+#include "boids.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include "job_pool.h"
+#include "shader_utils.h"
+#include "terrain.h"
+
+BirdFlocks::~BirdFlocks() {
+    Shutdown();
+}
+
+bool BirdFlocks::InitializeGL(const glm::vec3& lightDir, const glm::vec3& ambient, const glm::vec3& diffuse) {
+    m_program = CreateShaderProgramFromFiles("boids.vert", "boids.frag");
+    if (!m_program || m_program == static_cast<GLuint>(-1)) {
+        std::cerr << "Birds: shaders failed, birds disabled\n";
+        m_program = 0;
+        return false;
+    }
+
+    m_uView = glGetUniformLocation(m_program, "u_view");
+    m_uProj = glGetUniformLocation(m_program, "u_projection");
+    m_uTime = glGetUniformLocation(m_program, "u_time");
+    m_uSize = glGetUniformLocation(m_program, "u_size");
+
+    glUseProgram(m_program);
+    glUniform3fv(glGetUniformLocation(m_program, "u_dirLight.direction"), 1, glm::value_ptr(lightDir));
+    glUniform3fv(glGetUniformLocation(m_program, "u_dirLight.ambient"), 1, glm::value_ptr(ambient));
+    glUniform3fv(glGetUniformLocation(m_program, "u_dirLight.diffuse"), 1, glm::value_ptr(diffuse));
+    glUseProgram(0);
+
+    // The bird shape comes from gl_VertexID; only per-instance data is fed.
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_instanceBuffer);
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec4), (void*)0);
+    glVertexAttribDivisor(0, 1);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec4), (void*)sizeof(glm::vec4));
+    glVertexAttribDivisor(1, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_bufferBirds = 0;
+    m_instancesDirty = true;
+    return true;
+}
+
+void BirdFlocks::Shutdown() {
+    if (m_program) glDeleteProgram(m_program);
+    if (m_vao) glDeleteVertexArrays(1, &m_vao);
+    if (m_instanceBuffer) glDeleteBuffers(1, &m_instanceBuffer);
+    m_program = m_vao = m_instanceBuffer = 0;
+    m_bufferBirds = 0;
+}
+
+void BirdFlocks::Reset(int count, const std::vector<glm::vec3>& anchors, const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::uint64_t seed) {
+    m_anchors = anchors;
+    if (m_anchors.empty()) m_anchors.push_back((boundsMin + boundsMax) * 0.5f);
+    m_count = std::max(count, 0);
+
+    m_min = boundsMin;
+    m_max = boundsMax;
+    m_invCell = 1.0f / neighbourRadius;
+    m_dims = glm::max(glm::ivec3(glm::ceil((m_max - m_min) * m_invCell)), glm::ivec3(1));
+
+    const size_t n = static_cast<size_t>(m_count);
+    for (auto* v : { &m_px, &m_py, &m_pz, &m_vx, &m_vy, &m_vz, &m_phase, &m_sx, &m_sy, &m_sz, &m_svx, &m_svy, &m_svz, &m_sphase })
+        v->assign(n, 0.0f);
+    m_flock.assign(n, 0);
+    m_sflock.assign(n, 0);
+    m_cellOf.assign(n, 0);
+    m_cellStart.assign(static_cast<size_t>(m_dims.x) * m_dims.y * m_dims.z + 1, 0);
+    m_cellCursor.assign(m_cellStart.size(), 0);
+    m_instances.assign(n * 2, glm::vec4(0.0f));
+
+    std::mt19937 rng(static_cast<std::uint32_t>(seed ^ (seed >> 32)) ^ 0xb1d5u);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> phase(0.0f, 6.2831853f);
+    for (int i = 0; i < m_count; ++i) {
+        const size_t flock = static_cast<size_t>(i) % m_anchors.size();
+        const glm::vec3 p = glm::clamp(m_anchors[flock] + glm::vec3(unit(rng), unit(rng) * 0.3f, unit(rng)) * orbitRadius, m_min, m_max);
+        const glm::vec3 v = glm::vec3(unit(rng), unit(rng) * 0.2f, unit(rng)) * minSpeed;
+
+        m_px[i] = p.x; m_py[i] = p.y; m_pz[i] = p.z;
+        m_vx[i] = v.x; m_vy[i] = v.y; m_vz[i] = v.z;
+        m_phase[i] = phase(rng);
+        m_flock[i] = static_cast<std::uint16_t>(flock);
+
+        m_instances[i * 2] = glm::vec4(p, m_phase[i]);
+        m_instances[i * 2 + 1] = glm::vec4(v, 0.0f);
+    }
+
+    m_accumulator = 0.0f;
+    m_instancesDirty = true;
+}
+
+void BirdFlocks::SetAnchors(const std::vector<glm::vec3>& anchors) {
+    for (size_t i = 0; i < m_anchors.size() && i < anchors.size(); ++i)
+        m_anchors[i] = anchors[i];
+}
+
+void BirdFlocks::SetObstacles(const std::vector<glm::vec4>& obstacles) {
+    m_obstacles = obstacles;
+}
+
+int BirdFlocks::CellIndex(float x, float y, float z) const {
+    const int cx = glm::clamp(static_cast<int>((x - m_min.x) * m_invCell), 0, m_dims.x - 1);
+    const int cy = glm::clamp(static_cast<int>((y - m_min.y) * m_invCell), 0, m_dims.y - 1);
+    const int cz = glm::clamp(static_cast<int>((z - m_min.z) * m_invCell), 0, m_dims.z - 1);
+    return (cz * m_dims.y + cy) * m_dims.x + cx;
+}
+
+void BirdFlocks::Update(JobPool& pool, float dt) {
+    if (m_count == 0) return;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    m_accumulator = std::min(m_accumulator + dt, fixedStep * maxSubsteps);
+    while (m_accumulator >= fixedStep) {
+        Step(pool, fixedStep);
+        m_accumulator -= fixedStep;
+    }
+
+    m_lastUpdateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void BirdFlocks::Step(JobPool& pool, float h) {
+    BuildGrid(pool);
+    pool.ParallelFor(m_count, [&](int begin, int end) { UpdateRange(begin, end, h); });
+    m_instancesDirty = true;
+}
+
+// Counting sort by cell: bin indices in parallel, histogram and prefix sum
+// serially (one pass over birds plus one over cells), then scatter the
+// state into the snapshot arrays in cell order.
+void BirdFlocks::BuildGrid(JobPool& pool) {
+    pool.ParallelFor(m_count, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+            m_cellOf[i] = CellIndex(m_px[i], m_py[i], m_pz[i]);
+        });
+
+    std::fill(m_cellStart.begin(), m_cellStart.end(), 0);
+    for (int i = 0; i < m_count; ++i) m_cellStart[m_cellOf[i] + 1]++;
+    for (size_t c = 1; c < m_cellStart.size(); ++c) m_cellStart[c] += m_cellStart[c - 1];
+    std::copy(m_cellStart.begin(), m_cellStart.end(), m_cellCursor.begin());
+
+    for (int i = 0; i < m_count; ++i) {
+        const int dst = m_cellCursor[m_cellOf[i]]++;
+        m_sx[dst] = m_px[i]; m_sy[dst] = m_py[i]; m_sz[dst] = m_pz[i];
+        m_svx[dst] = m_vx[i]; m_svy[dst] = m_vy[i]; m_svz[dst] = m_vz[i];
+        m_sphase[dst] = m_phase[i];
+        m_sflock[dst] = m_flock[i];
+    }
+}
+
+void BirdFlocks::UpdateRange(int begin, int end, float h) {
+    const float r2 = neighbourRadius * neighbourRadius;
+    const float sep2 = separationRadius * separationRadius;
+    const glm::vec3 inner = m_min + glm::vec3(avoidDistance);
+    const glm::vec3 outer = m_max - glm::vec3(avoidDistance);
+
+    for (int i = begin; i < end; ++i) {
+        const glm::vec3 p(m_sx[i], m_sy[i], m_sz[i]);
+        const glm::vec3 v(m_svx[i], m_svy[i], m_svz[i]);
+
+        const int cx = glm::clamp(static_cast<int>((p.x - m_min.x) * m_invCell), 0, m_dims.x - 1);
+        const int cy = glm::clamp(static_cast<int>((p.y - m_min.y) * m_invCell), 0, m_dims.y - 1);
+        const int cz = glm::clamp(static_cast<int>((p.z - m_min.z) * m_invCell), 0, m_dims.z - 1);
+        const int x0 = std::max(cx - 1, 0);
+        const int x1 = std::min(cx + 1, m_dims.x - 1);
+
+        float sepX = 0.0f, sepY = 0.0f, sepZ = 0.0f;
+        float aliX = 0.0f, aliY = 0.0f, aliZ = 0.0f;
+        float cohX = 0.0f, cohY = 0.0f, cohZ = 0.0f;
+        int neighbours = 0;
+
+        // Cells along x are adjacent in the sorted arrays, so each y/z row
+        // of the 3x3x3 block is one contiguous run. The neighbour cap keeps
+        // dense clumps from going quadratic.
+        for (int z = std::max(cz - 1, 0); z <= std::min(cz + 1, m_dims.z - 1) && neighbours < maxNeighbours; ++z) {
+            for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, m_dims.y - 1) && neighbours < maxNeighbours; ++y) {
+                const int row = (z * m_dims.y + y) * m_dims.x;
+                const int jEnd = m_cellStart[row + x1 + 1];
+                for (int j = m_cellStart[row + x0]; j < jEnd; ++j) {
+                    if (j == i) continue;
+
+                    const float dx = m_sx[j] - p.x;
+                    const float dy = m_sy[j] - p.y;
+                    const float dz = m_sz[j] - p.z;
+                    const float d2 = dx * dx + dy * dy + dz * dz;
+                    if (d2 > r2) continue;
+
+                    if (d2 < sep2) {
+                        const float w = 1.0f / std::max(d2, 1e-3f);
+                        sepX -= dx * w; sepY -= dy * w; sepZ -= dz * w;
+                    }
+                    aliX += m_svx[j]; aliY += m_svy[j]; aliZ += m_svz[j];
+                    cohX += dx; cohY += dy; cohZ += dz;
+                    if (++neighbours >= maxNeighbours) break;
+                }
+            }
+        }
+
+        glm::vec3 accel(0.0f);
+        if (neighbours > 0) {
+            const float inv = 1.0f / static_cast<float>(neighbours);
+            accel += glm::vec3(sepX, sepY, sepZ) * separationWeight;
+            accel += (glm::vec3(aliX, aliY, aliZ) * inv - v) * alignmentWeight;
+            accel += glm::vec3(cohX, cohY, cohZ) * (inv * cohesionWeight);
+        }
+
+        // Circle the flock's anchor: pull toward the orbit radius and push
+        // along the tangent so flocks wheel instead of collapsing onto it.
+        const glm::vec3 toAnchor = m_anchors[m_sflock[i]] - p;
+        const float anchorDist = glm::length(toAnchor);
+        if (anchorDist > 1e-3f) {
+            const glm::vec3 dir = toAnchor / anchorDist;
+            accel += dir * ((anchorDist - orbitRadius) * homeWeight);
+            const glm::vec3 tangent(-dir.z, 0.0f, dir.x);
+            accel += tangent * orbitWeight * ((m_sflock[i] & 1) ? 1.0f : -1.0f);
+        }
+
+        for (const glm::vec4& o : m_obstacles) {
+            const glm::vec3 away = p - glm::vec3(o);
+            const float dist = glm::length(away);
+            const float gap = dist - o.w;
+            if (gap >= avoidDistance || dist < 1e-4f) continue;
+
+            const float t = 1.0f - std::max(gap, 0.0f) / avoidDistance;
+            accel += away * (avoidWeight * t * t / dist);
+        }
+
+        const float ground = m_terrain ? m_terrain->HeightAt(p.x, p.z) : 0.0f;
+        if (p.y < ground + minAltitude)
+            accel.y += (ground + minAltitude - p.y) * avoidWeight * 0.5f;
+
+        // Soft walls inside the grid bounds.
+        accel += (glm::max(inner - p, glm::vec3(0.0f)) - glm::max(p - outer, glm::vec3(0.0f))) * (avoidWeight * 0.25f);
+
+        const float a2 = glm::dot(accel, accel);
+        if (a2 > maxAccel * maxAccel) accel *= maxAccel / std::sqrt(a2);
+
+        glm::vec3 nv = v + accel * h;
+        const float speed = glm::length(nv);
+        if (speed > maxSpeed) nv *= maxSpeed / speed;
+        else if (speed < minSpeed) nv = (speed > 1e-4f ? nv / speed : glm::vec3(1.0f, 0.0f, 0.0f)) * minSpeed;
+
+        const glm::vec3 np = glm::clamp(p + (nv + wind) * h, m_min, m_max);
+
+        m_px[i] = np.x; m_py[i] = np.y; m_pz[i] = np.z;
+        m_vx[i] = nv.x; m_vy[i] = nv.y; m_vz[i] = nv.z;
+        m_phase[i] = m_sphase[i];
+        m_flock[i] = m_sflock[i];
+
+        m_instances[static_cast<size_t>(i) * 2] = glm::vec4(np, m_phase[i]);
+        m_instances[static_cast<size_t>(i) * 2 + 1] = glm::vec4(nv, 0.0f);
+    }
+}
+
+void BirdFlocks::Draw(const glm::mat4& view, const glm::mat4& proj, float time) {
+    if (!m_program || m_count == 0) return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    if (m_instancesDirty) {
+        // Orphan and refill so the driver never waits on last frame's draw.
+        const GLsizeiptr bytes = static_cast<GLsizeiptr>(m_instances.size() * sizeof(glm::vec4));
+        glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, m_instances.data());
+        m_bufferBirds = static_cast<size_t>(m_count);
+        m_instancesDirty = false;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glUseProgram(m_program);
+    glUniformMatrix4fv(m_uView, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(m_uProj, 1, GL_FALSE, glm::value_ptr(proj));
+    glUniform1f(m_uTime, time);
+    glUniform1f(m_uSize, size);
+
+    glBindVertexArray(m_vao);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(m_bufferBirds));
+    glBindVertexArray(0);
+}
@@ -0,0 +1,26 @@
+#version 330 core
+
+struct DirLight {
+    vec3 direction;
+    vec3 ambient;
+    vec3 diffuse;
+};
+
+uniform DirLight u_dirLight;
+
+in vec3 v_normal;
+in float v_shade;
+
+out vec4 FragColor;
+
+void main()
+{
+    vec3 N = normalize(v_normal);
+    if (!gl_FrontFacing) N = -N;
+
+    vec3 L = normalize(-u_dirLight.direction);
+    float diff = max(dot(N, L), 0.0) * 0.7 + 0.3;
+
+    vec3 albedo = vec3(0.18, 0.17, 0.16) * v_shade;
+    FragColor = vec4(albedo * (u_dirLight.ambient + u_dirLight.diffuse * diff), 1.0);
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class JobPool;
+class Terrain;
+
+// Ambient bird flocks. Each bird belongs to a flock that circles an anchor
+// (a cloud or balloon), steers by separation/alignment/cohesion against
+// nearby birds and avoids sphere obstacles, the terrain and the play-area
+// bounds.
+//
+// State is kept as structure-of-arrays. Every tick the birds are counting-
+// sorted into a uniform grid with the cell size of the neighbour radius and
+// the arrays are reordered in cell order, so a neighbour query scans nine
+// contiguous runs (one per y/z row of the 3x3x3 block). The update itself
+// runs across the JobPool and writes the instance buffer as it goes.
+class BirdFlocks {
+public:
+    float neighbourRadius{ 2.5f };
+    float separationRadius{ 0.9f };
+    int maxNeighbours{ 12 };
+
+    float separationWeight{ 6.0f };
+    float alignmentWeight{ 1.2f };
+    float cohesionWeight{ 0.8f };
+    float homeWeight{ 1.0f };
+    float orbitWeight{ 2.0f };
+    float orbitRadius{ 9.0f };
+    float avoidWeight{ 30.0f };
+    float avoidDistance{ 4.0f };
+    float minAltitude{ 4.0f };
+
+    float minSpeed{ 4.0f };
+    float maxSpeed{ 9.0f };
+    float maxAccel{ 25.0f };
+
+    float fixedStep{ 1.0f / 60.0f };
+    int maxSubsteps{ 2 };
+    float size{ 1.0f };
+    glm::vec3 wind{ 0.0f };
+
+    BirdFlocks() = default;
+    ~BirdFlocks();
+
+    BirdFlocks(const BirdFlocks&) = delete;
+    BirdFlocks& operator=(const BirdFlocks&) = delete;
+
+    bool InitializeGL(const glm::vec3& lightDir, const glm::vec3& ambient, const glm::vec3& diffuse);
+    void Shutdown();
+
+    // Scatters count birds around the anchors; flock = bird % anchor count.
+    void Reset(int count, const std::vector<glm::vec3>& anchors, const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::uint64_t seed);
+
+    // Per frame. Anchor count must match the one given to Reset.
+    void SetAnchors(const std::vector<glm::vec3>& anchors);
+    // xyz centre, w radius.
+    void SetObstacles(const std::vector<glm::vec4>& obstacles);
+    void SetTerrain(const Terrain* terrain) { m_terrain = terrain; }
+
+    void Update(JobPool& pool, float dt);
+    void Draw(const glm::mat4& view, const glm::mat4& proj, float time);
+
+    int Count() const { return m_count; }
+    float LastUpdateMs() const { return m_lastUpdateMs; }
+
+private:
+    void Step(JobPool& pool, float h);
+    void BuildGrid(JobPool& pool);
+    void UpdateRange(int begin, int end, float h);
+    int CellIndex(float x, float y, float z) const;
+
+    int m_count{ 0 };
+    glm::vec3 m_min{ 0.0f };
+    glm::vec3 m_max{ 0.0f };
+    glm::ivec3 m_dims{ 0 };
+    float m_invCell{ 1.0f };
+
+    // Current bird state. BuildGrid scatters it in cell order into the
+    // m_s* snapshot, which the update reads while writing back here.
+    std::vector<float> m_px, m_py, m_pz;
+    std::vector<float> m_vx, m_vy, m_vz;
+    std::vector<float> m_phase;
+    std::vector<std::uint16_t> m_flock;
+
+    std::vector<float> m_sx, m_sy, m_sz;
+    std::vector<float> m_svx, m_svy, m_svz;
+    std::vector<float> m_sphase;
+    std::vector<std::uint16_t> m_sflock;
+
+    std::vector<int> m_cellOf;
+    std::vector<int> m_cellStart;   // dims.x * dims.y * dims.z + 1 entries
+    std::vector<int> m_cellCursor;
+
+    std::vector<glm::vec3> m_anchors;
+    std::vector<glm::vec4> m_obstacles;
+    const Terrain* m_terrain{ nullptr };
+
+    // Two vec4 per bird: position + wing phase, velocity.
+    std::vector<glm::vec4> m_instances;
+    bool m_instancesDirty{ false };
+
+    float m_accumulator{ 0.0f };
+    float m_lastUpdateMs{ 0.0f };
+
+    GLuint m_program{ 0 };
+    GLuint m_vao{ 0 };
+    GLuint m_instanceBuffer{ 0 };
+    size_t m_bufferBirds{ 0 };
+    int m_uView{ -1 }, m_uProj{ -1 }, m_uTime{ -1 }, m_uSize{ -1 };
+};
@@ -0,0 +1,44 @@
+#version 330 core
+
+// Two wing triangles built from gl_VertexID, oriented along the velocity.
+// Wingtips flap on a per-bird phase, faster when the bird climbs.
+
+layout(location = 0) in vec4 a_positionPhase;
+layout(location = 1) in vec4 a_velocity;
+
+uniform mat4 u_view;
+uniform mat4 u_projection;
+uniform float u_time;
+uniform float u_size;
+
+out vec3 v_normal;
+out float v_shade;
+
+void main()
+{
+    vec3 vel = a_velocity.xyz;
+    float speed = max(length(vel), 1e-4);
+    vec3 forward = vel / speed;
+    vec3 right = cross(forward, vec3(0.0, 1.0, 0.0));
+    right = dot(right, right) > 1e-6 ? normalize(right) : vec3(1.0, 0.0, 0.0);
+    vec3 up = cross(right, forward);
+
+    float climb = clamp(forward.y * 2.0, 0.0, 1.0);
+    float flap = sin(u_time * (10.0 + 6.0 * climb) + a_positionPhase.w);
+
+    int wing = gl_VertexID / 3;
+    int corner = gl_VertexID - wing * 3;
+    float side = wing == 0 ? -1.0 : 1.0;
+
+    vec3 local;
+    if (corner == 0) local = forward * 0.25;
+    else if (corner == 1) local = -forward * 0.2;
+    else local = right * (side * 0.35) + up * (flap * 0.18) - forward * 0.05;
+
+    vec3 pos = a_positionPhase.xyz + local * u_size;
+
+    v_normal = normalize(up - right * (side * flap * 0.5));
+    v_shade = corner == 2 ? 0.7 : 1.0;
+
+    gl_Position = u_projection * u_view * vec4(pos, 1.0);
+}
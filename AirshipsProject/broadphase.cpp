@@ -0,0 +1,93 @@
+#include "broadphase.h"
+
+#include <algorithm>
+#include <cmath>
+
+void SpatialHashGrid::Clear() {
+    m_cells.clear();
+    m_proxies.clear();
+    m_free.clear();
+    m_visited.clear();
+    m_stamp = 0;
+}
+
+glm::ivec3 SpatialHashGrid::CellOf(const glm::vec3& p) const {
+    return glm::ivec3(glm::floor(p / m_cellSize));
+}
+
+std::uint64_t SpatialHashGrid::Key(int x, int y, int z) {
+    // 21 bits per axis covers +-1M cells, far beyond the play area.
+    auto Bits = [](int v) { return static_cast<std::uint64_t>(v & 0x1fffff); };
+    return Bits(x) | (Bits(y) << 21) | (Bits(z) << 42);
+}
+
+void SpatialHashGrid::Bin(int proxy) {
+    Proxy& p = m_proxies[proxy];
+    for (int z = p.lo.z; z <= p.hi.z; ++z)
+        for (int y = p.lo.y; y <= p.hi.y; ++y)
+            for (int x = p.lo.x; x <= p.hi.x; ++x)
+                m_cells[Key(x, y, z)].push_back(proxy);
+}
+
+void SpatialHashGrid::Unbin(int proxy) {
+    const Proxy& p = m_proxies[proxy];
+    for (int z = p.lo.z; z <= p.hi.z; ++z) {
+        for (int y = p.lo.y; y <= p.hi.y; ++y) {
+            for (int x = p.lo.x; x <= p.hi.x; ++x) {
+                auto it = m_cells.find(Key(x, y, z));
+                if (it == m_cells.end()) continue;
+
+                std::vector<int>& cell = it->second;
+                auto pos = std::find(cell.begin(), cell.end(), proxy);
+                if (pos != cell.end()) {
+                    *pos = cell.back();
+                    cell.pop_back();
+                }
+                if (cell.empty()) m_cells.erase(it);
+            }
+        }
+    }
+}
+
+int SpatialHashGrid::Insert(const Aabb& box, std::uint32_t tag) {
+    int proxy;
+    if (!m_free.empty()) {
+        proxy = m_free.back();
+        m_free.pop_back();
+    }
+    else {
+        proxy = static_cast<int>(m_proxies.size());
+        m_proxies.emplace_back();
+    }
+
+    Proxy& p = m_proxies[proxy];
+    p.box = box;
+    p.lo = CellOf(box.min);
+    p.hi = CellOf(box.max);
+    p.tag = tag;
+    p.alive = true;
+    Bin(proxy);
+    return proxy;
+}
+
+void SpatialHashGrid::Move(int proxy, const Aabb& box) {
+    Proxy& p = m_proxies[proxy];
+    p.box = box;
+
+    const glm::ivec3 lo = CellOf(box.min);
+    const glm::ivec3 hi = CellOf(box.max);
+    if (lo == p.lo && hi == p.hi) return;
+
+    Unbin(proxy);
+    p.lo = lo;
+    p.hi = hi;
+    Bin(proxy);
+}
+
+void SpatialHashGrid::Remove(int proxy) {
+    if (proxy < 0 || proxy >= static_cast<int>(m_proxies.size()) || !m_proxies[proxy].alive) return;
+
+    Unbin(proxy);
+    m_proxies[proxy].alive = false;
+    m_free.push_back(proxy);
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct Aabb {
+    glm::vec3 min{ 0.0f };
+    glm::vec3 max{ 0.0f };
+};
+
+inline bool Overlaps(const Aabb& a, const Aabb& b) {
+    return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+        a.min.y <= b.max.y && a.max.y >= b.min.y &&
+        a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+// What a proxy stands for; the tag packs the kind with an index into the
+// owner's array so queries can be filtered without extra lookups.
+enum class ProxyKind : std::uint32_t {
+    House = 1,
+    Decoration = 2,
+    Package = 3,
+};
+
+inline std::uint32_t MakeProxyTag(ProxyKind kind, int index) {
+    return (static_cast<std::uint32_t>(kind) << 24) | (static_cast<std::uint32_t>(index) & 0xffffffu);
+}
+inline ProxyKind ProxyKindOf(std::uint32_t tag) { return static_cast<ProxyKind>(tag >> 24); }
+inline int ProxyIndexOf(std::uint32_t tag) { return static_cast<int>(tag & 0xffffffu); }
+
+// Uniform hash grid over world-space AABBs, shared by every system that
+// needs "what is near this box". Static and sleeping proxies are binned
+// once; Move only re-bins when the covered cell range changes.
+class SpatialHashGrid {
+public:
+    explicit SpatialHashGrid(float cellSize = 2.0f) : m_cellSize(cellSize) {}
+
+    void Clear();
+
+    int Insert(const Aabb& box, std::uint32_t tag);
+    void Move(int proxy, const Aabb& box);
+    void Remove(int proxy);
+
+    const Aabb& Bounds(int proxy) const { return m_proxies[proxy].box; }
+    std::uint32_t Tag(int proxy) const { return m_proxies[proxy].tag; }
+    int ProxyCapacity() const { return static_cast<int>(m_proxies.size()); }
+
+    // Calls fn(proxy, tag) once for each proxy whose box overlaps the query.
+    // Not reentrant: fn must not query the grid again.
+    template <class Fn>
+    void Query(const Aabb& box, Fn&& fn) const;
+
+private:
+    struct Proxy {
+        Aabb box;
+        glm::ivec3 lo{ 0 };
+        glm::ivec3 hi{ -1 };
+        std::uint32_t tag{ 0 };
+        bool alive{ false };
+    };
+
+    glm::ivec3 CellOf(const glm::vec3& p) const;
+    static std::uint64_t Key(int x, int y, int z);
+    void Bin(int proxy);
+    void Unbin(int proxy);
+
+    float m_cellSize;
+    std::unordered_map<std::uint64_t, std::vector<int>> m_cells;
+    std::vector<Proxy> m_proxies;
+    std::vector<int> m_free;
+
+    mutable std::vector<std::uint32_t> m_visited;
+    mutable std::uint32_t m_stamp{ 0 };
+};
+
+template <class Fn>
+void SpatialHashGrid::Query(const Aabb& box, Fn&& fn) const {
+    if (m_visited.size() < m_proxies.size()) m_visited.resize(m_proxies.size(), 0);
+    if (++m_stamp == 0) {
+        std::fill(m_visited.begin(), m_visited.end(), 0u);
+        m_stamp = 1;
+    }
+
+    const glm::ivec3 lo = CellOf(box.min);
+    const glm::ivec3 hi = CellOf(box.max);
+    for (int z = lo.z; z <= hi.z; ++z) {
+        for (int y = lo.y; y <= hi.y; ++y) {
+            for (int x = lo.x; x <= hi.x; ++x) {
+                auto it = m_cells.find(Key(x, y, z));
+                if (it == m_cells.end()) continue;
+
+                for (int proxy : it->second) {
+                    if (m_visited[proxy] == m_stamp) continue;
+                    m_visited[proxy] = m_stamp;
+                    if (Overlaps(box, m_proxies[proxy].box)) fn(proxy, m_proxies[proxy].tag);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,151 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+static const unsigned int kLeafSize = 4;
+
+void TriangleBvh::Build(std::vector<Triangle> triangles) {
+    m_triangles = std::move(triangles);
+    m_nodes.clear();
+    m_centroids.resize(m_triangles.size());
+
+    for (size_t i = 0; i < m_triangles.size(); ++i) {
+        const Triangle& t = m_triangles[i];
+        m_centroids[i] = (t.a + t.b + t.c) / 3.0f;
+    }
+
+    if (m_triangles.empty()) return;
+
+    m_nodes.reserve(2 * m_triangles.size() / kLeafSize + 1);
+    BuildNode(0, static_cast<unsigned int>(m_triangles.size()));
+    std::vector<glm::vec3>().swap(m_centroids);
+}
+
+// Median split on the longest centroid axis; triangles are reordered in
+// place so each leaf owns a contiguous range.
+unsigned int TriangleBvh::BuildNode(unsigned int first, unsigned int count) {
+    unsigned int index = static_cast<unsigned int>(m_nodes.size());
+    m_nodes.push_back({});
+
+    glm::vec3 bmin(1e30f), bmax(-1e30f), cmin(1e30f), cmax(-1e30f);
+    for (unsigned int i = first; i < first + count; ++i) {
+        const Triangle& t = m_triangles[i];
+        bmin = glm::min(bmin, glm::min(t.a, glm::min(t.b, t.c)));
+        bmax = glm::max(bmax, glm::max(t.a, glm::max(t.b, t.c)));
+        cmin = glm::min(cmin, m_centroids[i]);
+        cmax = glm::max(cmax, m_centroids[i]);
+    }
+    m_nodes[index].bmin = bmin;
+    m_nodes[index].bmax = bmax;
+
+    glm::vec3 extent = cmax - cmin;
+    if (count <= kLeafSize || std::max(extent.x, std::max(extent.y, extent.z)) <= 0.0f) {
+        m_nodes[index].leftOrFirst = first;
+        m_nodes[index].count = count;
+        return index;
+    }
+
+    int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+    unsigned int half = count / 2;
+
+    std::vector<unsigned int> order(count);
+    std::iota(order.begin(), order.end(), first);
+    std::nth_element(order.begin(), order.begin() + half, order.end(), [&](unsigned int a, unsigned int b) {
+        return m_centroids[a][axis] < m_centroids[b][axis];
+        });
+
+    std::vector<Triangle> tris(count);
+    std::vector<glm::vec3> cents(count);
+    for (unsigned int i = 0; i < count; ++i) {
+        tris[i] = m_triangles[order[i]];
+        cents[i] = m_centroids[order[i]];
+    }
+    std::copy(tris.begin(), tris.end(), m_triangles.begin() + first);
+    std::copy(cents.begin(), cents.end(), m_centroids.begin() + first);
+
+    BuildNode(first, half);
+    unsigned int right = BuildNode(first + half, count - half);
+
+    m_nodes[index].leftOrFirst = right;
+    m_nodes[index].count = 0;
+    return index;
+}
+
+static bool RayBox(const glm::vec3& origin, const glm::vec3& invDir, const glm::vec3& bmin, const glm::vec3& bmax, float tMin, float tMax) {
+    glm::vec3 t0 = (bmin - origin) * invDir;
+    glm::vec3 t1 = (bmax - origin) * invDir;
+    glm::vec3 lo = glm::min(t0, t1);
+    glm::vec3 hi = glm::max(t0, t1);
+    float enter = std::max(std::max(lo.x, lo.y), std::max(lo.z, tMin));
+    float exit = std::min(std::min(hi.x, hi.y), std::min(hi.z, tMax));
+    return enter <= exit;
+}
+
+static bool RayTriangle(const glm::vec3& origin, const glm::vec3& dir, const TriangleBvh::Triangle& tri, float tMin, float tMax, float& t) {
+    glm::vec3 e1 = tri.b - tri.a;
+    glm::vec3 e2 = tri.c - tri.a;
+    glm::vec3 p = glm::cross(dir, e2);
+    float det = glm::dot(e1, p);
+    if (std::abs(det) < 1e-10f) return false;
+
+    float inv = 1.0f / det;
+    glm::vec3 s = origin - tri.a;
+    float u = glm::dot(s, p) * inv;
+    if (u < 0.0f || u > 1.0f) return false;
+
+    glm::vec3 q = glm::cross(s, e1);
+    float v = glm::dot(dir, q) * inv;
+    if (v < 0.0f || u + v > 1.0f) return false;
+
+    t = glm::dot(e2, q) * inv;
+    return t > tMin && t < tMax;
+}
+
+template <bool AnyHit>
+bool TriangleBvh::Traverse(const glm::vec3& origin, const glm::vec3& dir, float tMin, float& tMax) const {
+    if (m_nodes.empty()) return false;
+
+    const glm::vec3 invDir(
+        1.0f / (std::abs(dir.x) > 1e-12f ? dir.x : 1e-12f),
+        1.0f / (std::abs(dir.y) > 1e-12f ? dir.y : 1e-12f),
+        1.0f / (std::abs(dir.z) > 1e-12f ? dir.z : 1e-12f));
+
+    unsigned int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    bool hit = false;
+
+    while (top > 0) {
+        const Node& node = m_nodes[stack[--top]];
+        if (!RayBox(origin, invDir, node.bmin, node.bmax, tMin, tMax)) continue;
+
+        if (node.count > 0) {
+            for (unsigned int i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i) {
+                float t;
+                if (RayTriangle(origin, dir, m_triangles[i], tMin, tMax, t)) {
+                    if (AnyHit) return true;
+                    tMax = t;
+                    hit = true;
+                }
+            }
+        }
+        else if (top + 2 <= 64) {
+            stack[top++] = node.leftOrFirst;
+            stack[top++] = static_cast<unsigned int>(&node - m_nodes.data()) + 1;
+        }
+    }
+    return hit;
+}
+
+bool TriangleBvh::Occluded(const glm::vec3& origin, const glm::vec3& dir, float tMin, float tMax) const {
+    return Traverse<true>(origin, dir, tMin, tMax);
+}
+
+bool TriangleBvh::Intersect(const glm::vec3& origin, const glm::vec3& dir, float tMin, float& tHit) const {
+    float tMax = 1e30f;
+    if (!Traverse<false>(origin, dir, tMin, tMax)) return false;
+    tHit = tMax;
+    return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Static triangle BVH for ray queries on the CPU (baking, picking).
+// Built once; queries are const and safe from any number of threads.
+class TriangleBvh {
+public:
+    struct Triangle {
+        glm::vec3 a, b, c;
+    };
+
+    void Build(std::vector<Triangle> triangles);
+    bool Empty() const { return m_nodes.empty(); }
+    size_t TriangleCount() const { return m_triangles.size(); }
+
+    bool Occluded(const glm::vec3& origin, const glm::vec3& dir, float tMin, float tMax) const;
+    bool Intersect(const glm::vec3& origin, const glm::vec3& dir, float tMin, float& tHit) const;
+
+private:
+    struct Node {
+        glm::vec3 bmin;
+        unsigned int leftOrFirst;
+        glm::vec3 bmax;
+        unsigned int count;
+    };
+
+    unsigned int BuildNode(unsigned int first, unsigned int count);
+    template <bool AnyHit>
+    bool Traverse(const glm::vec3& origin, const glm::vec3& dir, float tMin, float& tMax) const;
+
+    std::vector<Node> m_nodes;
+    std::vector<Triangle> m_triangles;
+    std::vector<glm::vec3> m_centroids;
+};
@@ -0,0 +1,126 @@
+#include "cooked_assets.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char kPackMagic[4] = { 'A', 'P', 'A', 'K' };
+const std::uint32_t kPackVersion = 1;
+
+std::uint64_t Mix(std::uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+template <class T>
+void Put(std::ofstream& file, const T& v) {
+    file.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <class T>
+bool Get(std::ifstream& file, T& v) {
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&v), sizeof(T)));
+}
+
+}
+
+std::string CookedPath(const std::string& sourcePath, const std::string& extension) {
+    std::string path = sourcePath;
+    while (path.rfind("./", 0) == 0) path.erase(0, 2);
+    std::replace(path.begin(), path.end(), '\\', '/');
+    return std::string(kCookedDir) + "/" + path + extension;
+}
+
+std::uint64_t HashBytes(const void* data, size_t size, std::uint64_t seed) {
+    const std::uint8_t* p = static_cast<const std::uint8_t*>(data);
+    std::uint64_t h = Mix(seed ^ (size * 0x9E3779B97F4A7C15ull));
+
+    // Four independent lanes keep the multiplies pipelined.
+    std::uint64_t lane[4] = { h, h ^ 0x1234567ull, h ^ 0x89ABCDEFull, h ^ 0x5555ull };
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int k = 0; k < 4; ++k) {
+            std::uint64_t v;
+            std::memcpy(&v, p + i + k * 8, 8);
+            lane[k] = (lane[k] ^ v) * 0x9FB21C651E98DF25ull;
+            lane[k] ^= lane[k] >> 29;
+        }
+    }
+    for (int k = 0; k < 4; ++k) h = Mix(h ^ lane[k]);
+    for (; i < size; ++i) h = (h ^ p[i]) * 0x100000001B3ull;
+    return Mix(h);
+}
+
+bool WriteAssetPack(const std::string& path, const std::vector<AssetPackEntry>& entries) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    file.write(kPackMagic, 4);
+    Put(file, kPackVersion);
+    Put(file, static_cast<std::uint32_t>(entries.size()));
+    for (const AssetPackEntry& e : entries) {
+        Put(file, static_cast<std::uint32_t>(e.name.size()));
+        file.write(e.name.data(), static_cast<std::streamsize>(e.name.size()));
+        Put(file, static_cast<std::uint64_t>(e.data.size()));
+        Put(file, HashBytes(e.data.data(), e.data.size()));
+        file.write(e.data.data(), static_cast<std::streamsize>(e.data.size()));
+    }
+    return static_cast<bool>(file);
+}
+
+bool AssetPack::Open(const std::string& path) {
+    m_entries.clear();
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    char magic[4];
+    std::uint32_t version = 0;
+    std::uint32_t count = 0;
+    file.read(magic, 4);
+    if (!file || !std::equal(magic, magic + 4, kPackMagic) || !Get(file, version) || version != kPackVersion || !Get(file, count))
+        return false;
+
+    for (std::uint32_t i = 0; i < count; ++i) {
+        std::uint32_t nameLength = 0;
+        std::uint64_t size = 0;
+        std::uint64_t hash = 0;
+        if (!Get(file, nameLength) || nameLength > 4096) return false;
+
+        std::string name(nameLength, '\0');
+        file.read(name.data(), nameLength);
+        if (!Get(file, size) || !Get(file, hash) || size > (1ull << 31)) return false;
+
+        std::string data(static_cast<size_t>(size), '\0');
+        if (!file.read(data.data(), static_cast<std::streamsize>(size))) return false;
+
+        if (HashBytes(data.data(), data.size()) != hash) {
+            std::cerr << "Pack: " << path << " entry " << name << " is corrupt, skipping\n";
+            continue;
+        }
+        m_entries[name] = std::move(data);
+    }
+    return true;
+}
+
+const std::string* AssetPack::Find(const std::string& name) const {
+    auto it = m_entries.find(name);
+    return it == m_entries.end() ? nullptr : &it->second;
+}
+
+const AssetPack& ShaderPack() {
+    static const AssetPack pack = [] {
+        AssetPack p;
+        if (p.Open(std::string(kCookedDir) + "/shaders.pack"))
+            std::cout << "Shader bundle: " << p.Size() << " sources\n";
+        return p;
+    }();
+    return pack;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Output of the offline cooker (--cook). Every cooked file sits under
+// kCookedDir at its source path plus a format extension, for example
+// cooked/models/house.obj.amsh, and the runtime looks there first.
+constexpr const char* kCookedDir = "cooked";
+
+std::string CookedPath(const std::string& sourcePath, const std::string& extension);
+
+// 64-bit content hash; fast, not cryptographic.
+std::uint64_t HashBytes(const void* data, size_t size, std::uint64_t seed = 0);
+
+struct AssetPackEntry {
+    std::string name;
+    std::string data;
+};
+
+bool WriteAssetPack(const std::string& path, const std::vector<AssetPackEntry>& entries);
+
+// Read-only archive of named blobs, held in memory whole; used for the
+// shader source bundle. Entries whose hash doesn't match are dropped.
+class AssetPack {
+public:
+    bool Open(const std::string& path);
+
+    const std::string* Find(const std::string& name) const;
+    size_t Size() const { return m_entries.size(); }
+
+private:
+    std::unordered_map<std::string, std::string> m_entries;
+};
+
+// The cooked shader bundle, opened on first use; empty if there is none.
+const AssetPack& ShaderPack();
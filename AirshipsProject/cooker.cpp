@@ -0,0 +1,313 @@
+#include "cooker.h"
+
+#include <SFML/Graphics.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cooked_assets.h"
+#include "job_pool.h"
+#include "mesh_codec.h"
+#include "model.h"
+#include "texture_codec.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+// Hashed into every job: bump when a cooking step or output format changes
+// so everything re-cooks.
+const char kCookerVersion[] = "cooker 1; amsh 2; atex 1; apak 1";
+
+enum class CookKind { Mesh, Texture, ShaderPack };
+
+enum class CookResult { Failed, UpToDate, Cooked };
+
+struct CookJob {
+    CookKind kind{ CookKind::Mesh };
+    std::vector<std::string> inputs; // primary source first
+    std::string output;
+    std::uintmax_t cost{ 0 };        // input bytes, for scheduling
+    std::uint64_t hash{ 0 };
+    CookResult result{ CookResult::Failed };
+};
+
+double SecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::string Lower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+bool ReadWholeFile(const std::string& path, std::string& out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    out = buffer.str();
+    return static_cast<bool>(file) || file.eof();
+}
+
+bool HashInputs(CookJob& job) {
+    std::uint64_t h = HashBytes(kCookerVersion, sizeof(kCookerVersion) - 1, static_cast<std::uint64_t>(job.kind));
+    std::string data;
+    for (const std::string& in : job.inputs) {
+        if (!ReadWholeFile(in, data)) return false;
+        // Names count too: a renamed shader is a different pack entry.
+        h = HashBytes(in.data(), in.size(), h);
+        h = HashBytes(data.data(), data.size(), h);
+    }
+    job.hash = h;
+    return true;
+}
+
+bool CookMesh(const CookJob& job, const std::string& out) {
+    Model model;
+    return ImportObjMesh(job.inputs[0], model) && SaveMeshFile(out, model);
+}
+
+bool CookImage(const CookJob& job, const std::string& out) {
+    sf::Image image;
+    if (!image.loadFromFile(job.inputs[0])) return false;
+
+    // Block compression smears normal maps; keep those exact.
+    const bool lossless = Lower(job.inputs[0]).find("_normal") != std::string::npos;
+    CookedTexture tex;
+    CookTexture(image, lossless, tex);
+    return SaveCookedTexture(out, tex);
+}
+
+bool CookShaderPack(const CookJob& job, const std::string& out) {
+    std::vector<AssetPackEntry> entries;
+    for (const std::string& in : job.inputs) {
+        AssetPackEntry e;
+        e.name = fs::path(in).filename().string();
+        if (!ReadWholeFile(in, e.data)) return false;
+        entries.push_back(std::move(e));
+    }
+    return WriteAssetPack(out, entries);
+}
+
+void AddInput(CookJob& job, const std::string& path) {
+    std::error_code ec;
+    const std::uintmax_t size = fs::file_size(path, ec);
+    job.inputs.push_back(path);
+    job.cost += ec ? 0 : size;
+}
+
+std::vector<CookJob> CollectJobs() {
+    std::vector<CookJob> jobs;
+    std::error_code ec;
+
+    std::vector<fs::path> models;
+    for (const fs::directory_entry& entry : fs::directory_iterator("models", ec))
+        if (entry.is_regular_file()) models.push_back(entry.path());
+    std::sort(models.begin(), models.end());
+
+    for (const fs::path& p : models) {
+        const std::string ext = Lower(p.extension().string());
+        const std::string source = "models/" + p.filename().string();
+
+        CookJob job;
+        if (ext == ".obj") {
+            job.kind = CookKind::Mesh;
+            job.output = CookedPath(source, ".amsh");
+            AddInput(job, source);
+            // Materials decide the texture names stored in the mesh.
+            fs::path mtl = p;
+            mtl.replace_extension(".mtl");
+            if (fs::exists(mtl, ec)) AddInput(job, "models/" + mtl.filename().string());
+        }
+        else if (ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".tga") {
+            job.kind = CookKind::Texture;
+            job.output = CookedPath(source, ".atex");
+            AddInput(job, source);
+        }
+        else {
+            continue;
+        }
+        jobs.push_back(std::move(job));
+    }
+
+    std::vector<std::string> shaders;
+    for (const fs::directory_entry& entry : fs::directory_iterator(".", ec)) {
+        const std::string ext = Lower(entry.path().extension().string());
+        if (entry.is_regular_file() && (ext == ".vert" || ext == ".frag" || ext == ".comp" || ext == ".geom"))
+            shaders.push_back(entry.path().filename().string());
+    }
+    std::sort(shaders.begin(), shaders.end());
+
+    if (!shaders.empty()) {
+        CookJob job;
+        job.kind = CookKind::ShaderPack;
+        job.output = std::string(kCookedDir) + "/shaders.pack";
+        for (const std::string& s : shaders) AddInput(job, s);
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
+
+// One "hash output" pair per line, sorted so the file diffs cleanly.
+std::map<std::string, std::uint64_t> LoadCookDb(const std::string& path) {
+    std::map<std::string, std::uint64_t> db;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        const size_t space = line.find(' ');
+        if (space == std::string::npos) continue;
+        db[line.substr(space + 1)] = std::strtoull(line.substr(0, space).c_str(), nullptr, 16);
+    }
+    return db;
+}
+
+bool SaveCookDb(const std::string& path, const std::map<std::string, std::uint64_t>& db) {
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream file(tmp);
+        if (!file) return false;
+        for (const auto& [output, hash] : db) {
+            char hex[17];
+            std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+            file << hex << ' ' << output << '\n';
+        }
+        if (!file) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    return !ec;
+}
+
+void RunJob(CookJob& job, const std::map<std::string, std::uint64_t>& db, bool force, std::mutex& logMutex) {
+    auto Log = [&](const std::string& line) {
+        std::lock_guard<std::mutex> lock(logMutex);
+        std::cout << line << "\n";
+        };
+
+    if (!HashInputs(job)) {
+        Log("  FAILED " + job.output + " (cannot read inputs)");
+        return;
+    }
+
+    std::error_code ec;
+    auto it = db.find(job.output);
+    if (!force && it != db.end() && it->second == job.hash && fs::exists(job.output, ec)) {
+        job.result = CookResult::UpToDate;
+        return;
+    }
+
+    // Written aside and renamed, so an interrupted cook never leaves a
+    // truncated file the game would pick up.
+    const Clock::time_point start = Clock::now();
+    const std::string tmp = job.output + ".tmp";
+    fs::create_directories(fs::path(job.output).parent_path(), ec);
+
+    bool ok = false;
+    switch (job.kind) {
+    case CookKind::Mesh: ok = CookMesh(job, tmp); break;
+    case CookKind::Texture: ok = CookImage(job, tmp); break;
+    case CookKind::ShaderPack: ok = CookShaderPack(job, tmp); break;
+    }
+    if (ok) {
+        fs::rename(tmp, job.output, ec);
+        ok = !ec;
+    }
+    if (!ok) {
+        fs::remove(tmp, ec);
+        Log("  FAILED " + job.output);
+        return;
+    }
+
+    job.result = CookResult::Cooked;
+    char line[512];
+    std::snprintf(line, sizeof(line), "  cooked %s (%.2f s)", job.output.c_str(), SecondsSince(start));
+    Log(line);
+}
+
+}
+
+int RunCooker(int argc, char** argv) {
+    bool force = false;
+    unsigned int threads = 0;
+    for (int i = 0; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--force") {
+            force = true;
+        }
+        else if (arg == "--jobs" && i + 1 < argc) {
+            threads = static_cast<unsigned int>(std::max(std::atoi(argv[++i]), 1));
+        }
+        else {
+            std::cerr << "usage: --cook [--force] [--jobs N]\n";
+            return 2;
+        }
+    }
+
+    const Clock::time_point start = Clock::now();
+    std::vector<CookJob> jobs = CollectJobs();
+    if (jobs.empty()) {
+        std::cerr << "Cook: nothing to cook (run from the game's working directory)\n";
+        return 1;
+    }
+
+    std::error_code ec;
+    fs::create_directories(kCookedDir, ec);
+    const std::string dbPath = std::string(kCookedDir) + "/cook.db";
+    std::map<std::string, std::uint64_t> db = LoadCookDb(dbPath);
+
+    // Largest first, so one huge mesh doesn't start last and run alone.
+    std::stable_sort(jobs.begin(), jobs.end(), [](const CookJob& a, const CookJob& b) { return a.cost > b.cost; });
+
+    JobPool pool;
+    pool.Start(threads);
+    std::atomic<size_t> next{ 0 };
+    std::mutex logMutex;
+    pool.ParallelFor(static_cast<int>(pool.ThreadCount()), [&](int, int) {
+        for (size_t i = next++; i < jobs.size(); i = next++)
+            RunJob(jobs[i], db, force, logMutex);
+        });
+    const unsigned int threadCount = pool.ThreadCount();
+    pool.Stop();
+
+    int cooked = 0;
+    int upToDate = 0;
+    int failed = 0;
+    std::map<std::string, std::uint64_t> newDb;
+    for (const CookJob& job : jobs) {
+        if (job.result == CookResult::Failed) {
+            ++failed;
+            continue;
+        }
+        (job.result == CookResult::Cooked ? cooked : upToDate)++;
+        newDb[job.output] = job.hash;
+    }
+
+    // Sources that went away take their outputs with them.
+    int removed = 0;
+    for (const auto& [output, hash] : db) {
+        const bool stillBuilt = std::any_of(jobs.begin(), jobs.end(), [&](const CookJob& j) { return j.output == output; });
+        if (!stillBuilt && output.rfind(kCookedDir, 0) == 0 && fs::remove(output, ec)) ++removed;
+    }
+
+    if (!SaveCookDb(dbPath, newDb))
+        std::cerr << "Cook: could not write " << dbPath << "\n";
+
+    std::printf("Cook: %d cooked, %d up to date, %d failed, %d removed in %.2f s on %u threads\n",
+        cooked, upToDate, failed, removed, SecondsSince(start), threadCount);
+    return failed ? 1 : 0;
+}
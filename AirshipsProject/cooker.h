@@ -0,0 +1,16 @@
+#pragma once
+
+// Offline asset cooker, run as `AirshipsProject --cook [--force] [--jobs N]`
+// from the game's working directory. Headless: it creates no window or GL
+// context, so it also runs on build machines.
+//
+// Writes, under kCookedDir (cooked_assets.h):
+//   models/*.obj     -> .amsh   progressive mesh with LODs (mesh_codec.h)
+//   models/ images   -> .atex   mip chain, BC1/BC3 (texture_codec.h)
+//   shader sources   -> shaders.pack
+//
+// Assets cook in parallel, largest first. cook.db keeps a hash of each
+// output's inputs (their contents plus the cooker and format versions),
+// and outputs whose hash hasn't changed are skipped. Outputs whose source
+// is gone are deleted. Returns the process exit code.
+int RunCooker(int argc, char** argv);
@@ -0,0 +1,95 @@
+#include "culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+Frustum Frustum::FromViewProj(const glm::mat4& m) {
+    auto Row = [&](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+
+    Frustum f;
+    f.planes[0] = Row(3) + Row(0);
+    f.planes[1] = Row(3) - Row(0);
+    f.planes[2] = Row(3) + Row(1);
+    f.planes[3] = Row(3) - Row(1);
+    f.planes[4] = Row(3) + Row(2);
+    f.planes[5] = Row(3) - Row(2);
+
+    for (auto& p : f.planes) {
+        float len = glm::length(glm::vec3(p));
+        if (len > 0.0f) p /= len;
+    }
+    return f;
+}
+
+bool Frustum::Intersects(const BoundingSphere& s) const {
+    for (const auto& p : planes) {
+        if (glm::dot(glm::vec3(p), s.center) + p.w < -s.radius)
+            return false;
+    }
+    return true;
+}
+
+// The inner frustum clipped to the slab is convex, and its corners are the
+// slab-clipped ends of the frustum's 12 edges; outer is convex too, so
+// testing those ends is enough.
+bool FrustumCoversView(const Frustum& outer, const glm::mat4& innerViewProj, float minY, float maxY) {
+    const glm::mat4 inv = glm::inverse(innerViewProj);
+    glm::vec3 corners[8];
+    for (int i = 0; i < 8; ++i) {
+        const glm::vec4 ndc((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f, 1.0f);
+        const glm::vec4 p = inv * ndc;
+        corners[i] = glm::vec3(p) / p.w;
+    }
+
+    auto Inside = [&](const glm::vec3& p) {
+        const float tolerance = 1e-3f * std::max(1.0f, glm::length(p));
+        for (const auto& plane : outer.planes) {
+            if (glm::dot(glm::vec3(plane), p) + plane.w < -tolerance)
+                return false;
+        }
+        return true;
+        };
+
+    for (int a = 0; a < 8; ++a) {
+        for (int bit = 1; bit < 8; bit <<= 1) {
+            if (a & bit) continue;
+            const glm::vec3 p0 = corners[a];
+            const glm::vec3 p1 = corners[a | bit];
+
+            float t0 = 0.0f, t1 = 1.0f;
+            const float dy = p1.y - p0.y;
+            if (std::abs(dy) < 1e-6f) {
+                if (p0.y < minY || p0.y > maxY) continue;
+            }
+            else {
+                float ta = (minY - p0.y) / dy;
+                float tb = (maxY - p0.y) / dy;
+                if (ta > tb) std::swap(ta, tb);
+                t0 = std::max(t0, ta);
+                t1 = std::min(t1, tb);
+                if (t0 > t1) continue;
+            }
+
+            if (!Inside(p0 + (p1 - p0) * t0) || !Inside(p0 + (p1 - p0) * t1))
+                return false;
+        }
+    }
+    return true;
+}
+
+BoundingSphere ComputeWorldSphere(const Model& model, const glm::mat4& modelMatrix, const glm::vec3& scale, float padding) {
+    BoundingSphere s;
+    s.center = glm::vec3(modelMatrix * glm::vec4(model.boundsCenter, 1.0f));
+    float maxScale = std::max(std::abs(scale.x), std::max(std::abs(scale.y), std::abs(scale.z)));
+    s.radius = model.boundsRadius * maxScale + padding;
+    return s;
+}
+
+int SelectLod(const Model& model, float distance, float worldRadius) {
+    int lod = 0;
+    for (size_t i = 0; i < model.lods.size(); ++i) {
+        if (distance > model.lods[i].distanceFactor * worldRadius)
+            lod = static_cast<int>(i) + 1;
+    }
+    return lod;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include "model.h"
+
+struct BoundingSphere {
+    glm::vec3 center{ 0.0f };
+    float radius{ 0.0f };
+};
+
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum FromViewProj(const glm::mat4& viewProj);
+    bool Intersects(const BoundingSphere& s) const;
+};
+
+// True when the part of the inner view between heights minY and maxY lies
+// inside outer, i.e. everything the inner camera can see in that slab the
+// outer one can too.
+bool FrustumCoversView(const Frustum& outer, const glm::mat4& innerViewProj, float minY, float maxY);
+
+BoundingSphere ComputeWorldSphere(const Model& model, const glm::mat4& modelMatrix, const glm::vec3& scale, float padding = 0.0f);
+int SelectLod(const Model& model, float distance, float worldRadius);
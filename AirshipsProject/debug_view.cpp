@@ -0,0 +1,146 @@
+#include "debug_view.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "gl_debug.h"
+#include "shader_utils.h"
+
+namespace {
+const int kStatsGroup = 16;
+}
+
+DebugView::~DebugView() {
+    Shutdown();
+}
+
+bool DebugView::Initialize() {
+    m_resolveProgram = CreateShaderProgramFromFiles("debug_view.vert", "debug_view.frag");
+    m_statsProgram = CreateComputeProgramFromFile("debug_stats.comp");
+    for (GLuint* program : { &m_resolveProgram, &m_statsProgram }) {
+        if (*program && *program != static_cast<GLuint>(-1)) continue;
+        std::cerr << "Debug view: shaders failed, debug views disabled\n";
+        *program = 0;
+        Shutdown();
+        return false;
+    }
+
+    m_uMode = glGetUniformLocation(m_resolveProgram, "u_mode");
+    m_uStatsSize = glGetUniformLocation(m_statsProgram, "u_size");
+    glUseProgram(m_resolveProgram);
+    glUniform1i(glGetUniformLocation(m_resolveProgram, "u_value"), 0);
+    glUseProgram(m_statsProgram);
+    glUniform1i(glGetUniformLocation(m_statsProgram, "u_value"), 0);
+    glUseProgram(0);
+
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_partials);
+    LabelGlObject(GL_BUFFER, m_partials, "debug view partial sums");
+    return true;
+}
+
+void DebugView::Shutdown() {
+    if (m_fence) glDeleteSync(m_fence);
+    if (m_partials) glDeleteBuffers(1, &m_partials);
+    if (m_vao) glDeleteVertexArrays(1, &m_vao);
+    if (m_resolveProgram) glDeleteProgram(m_resolveProgram);
+    if (m_statsProgram) glDeleteProgram(m_statsProgram);
+    m_fence = nullptr;
+    m_partials = m_vao = m_resolveProgram = m_statsProgram = 0;
+    m_partialsCapacity = 0;
+}
+
+void DebugView::Cycle() {
+    const int next = (static_cast<int>(mode) + 1) % static_cast<int>(DebugViewMode::Count);
+    mode = static_cast<DebugViewMode>(next);
+}
+
+const char* DebugView::Name(DebugViewMode mode) {
+    switch (mode) {
+    case DebugViewMode::Overdraw: return "overdraw";
+    case DebugViewMode::TriangleDensity: return "triangles/pixel";
+    case DebugViewMode::Lod: return "LOD";
+    case DebugViewMode::MipLevel: return "mip level";
+    default: return "off";
+    }
+}
+
+float DebugView::DrawValue(int lod, int triangles, float screenPixels) const {
+    if (mode == DebugViewMode::TriangleDensity)
+        return triangles / std::max(screenPixels, 1.0f);
+    if (mode == DebugViewMode::Lod)
+        return static_cast<float>(lod);
+    return 0.0f;
+}
+
+void DebugView::BeginScene() const {
+    if (mode != DebugViewMode::Overdraw) return;
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+}
+
+void DebugView::Resolve(GLuint valueTexture, int width, int height) {
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, valueTexture);
+
+    glUseProgram(m_resolveProgram);
+    glUniform1i(m_uMode, static_cast<int>(mode));
+    glBindVertexArray(m_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+
+    // One reduction in flight at a time.
+    if (m_fence) return;
+
+    const int groupsX = (width + kStatsGroup - 1) / kStatsGroup;
+    const int groupsY = (height + kStatsGroup - 1) / kStatsGroup;
+    const GLsizeiptr bytes = static_cast<GLsizeiptr>(groupsX) * groupsY * sizeof(glm::vec4);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_partials);
+    if (bytes > m_partialsCapacity) {
+        m_partialsCapacity = bytes;
+        glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glUseProgram(m_statsProgram);
+    glUniform2i(m_uStatsSize, width, height);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_partials);
+    glDispatchCompute(static_cast<GLuint>(groupsX), static_cast<GLuint>(groupsY), 1);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_pendingGroups = groupsX * groupsY;
+    m_pendingPixels = width * height;
+    m_pendingMode = mode;
+}
+
+bool DebugView::PollStats(float& outMean, float& outMax, float& outCoverage) {
+    if (!m_fence) return false;
+    if (glClientWaitSync(m_fence, 0, 0) == GL_TIMEOUT_EXPIRED) return false;
+    glDeleteSync(m_fence);
+    m_fence = nullptr;
+    if (m_pendingMode != mode) return false;
+
+    // x: sum of values, y: covered pixels, z: max value.
+    m_readback.resize(m_pendingGroups);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_partials);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(m_readback.size() * sizeof(glm::vec4)), m_readback.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    double sum = 0.0, covered = 0.0;
+    float maxValue = 0.0f;
+    for (const glm::vec4& p : m_readback) {
+        sum += p.x;
+        covered += p.y;
+        maxValue = std::max(maxValue, p.z);
+    }
+    outMean = covered > 0.0 ? static_cast<float>(sum / covered) : 0.0f;
+    outMax = maxValue;
+    outCoverage = m_pendingPixels > 0 ? static_cast<float>(covered / m_pendingPixels) : 0.0f;
+    return true;
+}
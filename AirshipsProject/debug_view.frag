@@ -0,0 +1,42 @@
+#version 330 core
+
+// Maps the debug value (r) of covered pixels (g > 0) through a colour ramp.
+// Modes match DebugViewMode.
+
+in vec2 v_uv;
+
+uniform sampler2D u_value;
+uniform int u_mode;
+
+out vec4 FragColor;
+
+// Blue, cyan, green, yellow, red, then white for anything past the range.
+vec3 Ramp(float t)
+{
+    const vec3 stops[6] = vec3[6](
+        vec3(0.05, 0.10, 0.55), vec3(0.0, 0.65, 0.9), vec3(0.1, 0.8, 0.2),
+        vec3(0.95, 0.9, 0.1), vec3(0.9, 0.15, 0.1), vec3(1.0));
+    float x = clamp(t, 0.0, 1.0) * 5.0;
+    int i = min(int(x), 4);
+    return mix(stops[i], stops[i + 1], x - float(i));
+}
+
+void main()
+{
+    vec2 v = texture(u_value, v_uv).rg;
+    if (v.g <= 0.0) {
+        FragColor = vec4(vec3(0.08), 1.0);
+        return;
+    }
+
+    float t;
+    if (u_mode == 1)
+        t = (v.r - 1.0) / 8.0;                  // 1..9 fragments
+    else if (u_mode == 2)
+        t = (log2(max(v.r, 1e-6)) + 8.0) / 9.0; // 1/256..2 triangles per pixel
+    else if (u_mode == 3)
+        t = v.r / 4.0;                          // LOD 0..4
+    else
+        t = v.r / 8.0;                          // mip 0..8
+    FragColor = vec4(Ramp(t), 1.0);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+enum class DebugViewMode { Off = 0, Overdraw, TriangleDensity, Lod, MipLevel, Count };
+
+// Runtime-selectable visualisations of what game.frag draws.
+//
+// While a mode is active the scene is drawn into an RG32F target instead of
+// the window: game.frag writes (value, 1) through u_debugView instead of
+// shading, so switching modes never recompiles anything. Overdraw adds 1
+// per shaded fragment with ONE/ONE blending (GL cannot blend integer
+// targets; float sums stay exact far beyond any real count). Triangle
+// density (triangles per covered pixel of the instance) and LOD come from
+// the CPU per draw in u_debugValue; the mip level is derived from UV
+// derivatives in the shader. Terrain, grass and birds lay down depth only.
+//
+// Resolve maps the value through a colour ramp onto the window and reduces
+// it to a mean and max over covered pixels on the GPU; the partial sums are
+// read back once their fence has passed, so the numbers trail by a frame or
+// two but never stall.
+class DebugView {
+public:
+    DebugViewMode mode{ DebugViewMode::Off };
+
+    DebugView() = default;
+    ~DebugView();
+
+    DebugView(const DebugView&) = delete;
+    DebugView& operator=(const DebugView&) = delete;
+
+    bool Initialize();
+    void Shutdown();
+    bool Ready() const { return m_resolveProgram != 0; }
+    bool Active() const { return Ready() && mode != DebugViewMode::Off; }
+
+    void Cycle();
+    static const char* Name(DebugViewMode mode);
+
+    // game.frag's u_debugView and u_debugValue for one draw.
+    int ShaderMode() const { return Active() ? static_cast<int>(mode) : 0; }
+    float DrawValue(int lod, int triangles, float screenPixels) const;
+
+    // Blending for the scene draws; Resolve turns it off again.
+    void BeginScene() const;
+    void BeginDepthOnly() const { glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE); }
+    void EndDepthOnly() const { glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE); }
+
+    // Draws the ramp into the bound framebuffer and starts a reduction.
+    void Resolve(GLuint valueTexture, int width, int height);
+    // True once new numbers for the current mode arrived.
+    bool PollStats(float& outMean, float& outMax, float& outCoverage);
+
+private:
+    GLuint m_resolveProgram{ 0 };
+    GLuint m_statsProgram{ 0 };
+    GLuint m_vao{ 0 };
+    GLuint m_partials{ 0 };
+    GLsizeiptr m_partialsCapacity{ 0 };
+
+    GLsync m_fence{ nullptr };
+    int m_pendingGroups{ 0 };
+    int m_pendingPixels{ 0 };
+    DebugViewMode m_pendingMode{ DebugViewMode::Off };
+    std::vector<glm::vec4> m_readback;
+
+    int m_uMode{ -1 };
+    int m_uStatsSize{ -1 };
+};
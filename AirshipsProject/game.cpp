@@ -6,28 +6,78 @@
 #include <glm/common.hpp>
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <random>
 #include <vector>
 
+#include "gl_debug.h"
+#include "gl_resources.h"
+#include "mesh_codec.h"
 #include "shader_utils.h"
 
+static void LabelModel(const Model& model, const std::string& path) {
+    if (!g_glDebugEnabled) return;
+    LabelGlObject(GL_VERTEX_ARRAY, model.vao, path);
+    LabelGlObject(GL_BUFFER, model.vbo, path + " vertices");
+    LabelGlObject(GL_BUFFER, model.ebo, path + " indices");
+}
+
 static float WrapDeg(float deg) {
     deg = glm::mod(deg, 360.0f);
     if (deg < 0.0f) deg += 360.0f;
     return deg;
 }
 
+static const glm::vec4 kMinimapHouseColor{ 0.95f, 0.55f, 0.2f, 1.0f };
+static const glm::vec4 kMinimapDeliveredColor{ 0.45f, 0.95f, 0.45f, 1.0f };
+
 Game::Game(sf::RenderWindow& window)
     : m_window(window) {
-    std::random_device rd;
-    m_rng = std::mt19937(rd());
+    // AIRSHIP_SCENE_SEED replays a layout, which also reuses its AO cache.
+    if (const char* env = std::getenv("AIRSHIP_SCENE_SEED")) {
+        m_sceneSeed = std::strtoull(env, nullptr, 10);
+    }
+    else {
+        std::random_device rd;
+        m_sceneSeed = (static_cast<std::uint64_t>(rd()) << 32) | rd();
+    }
+    std::cout << "Scene seed: " << m_sceneSeed << "\n";
 }
 
 Game::~Game() {
+    m_wind.Stop();
+    m_aoBaker.Stop();
+    m_jobs.Stop();
+    m_loadCancel.Cancel();
+    m_assets.Stop();
+    m_uploader.Stop();
+    m_latency.Shutdown();
+    m_pip.Shutdown();
+    m_graph.Shutdown();
+    m_gpuCuller.Shutdown();
+    m_shadows.Shutdown();
+    m_sky.Shutdown();
+    m_hud.Shutdown();
+    m_debugView.Shutdown();
+    m_minimap.Shutdown();
+    m_particles.Shutdown();
+    m_grass.Shutdown();
+    m_birds.Shutdown();
+    m_terrain.Shutdown();
+    m_staticBatcher.Destroy();
+
+    if (m_aoTexture) glDeleteTextures(1, &m_aoTexture);
+    if (m_aoBuffer) glDeleteBuffers(1, &m_aoBuffer);
+
     if (m_program) glDeleteProgram(m_program);
+    if (m_instancedProgram) glDeleteProgram(m_instancedProgram);
 
     auto DestroyIf = [](Model& m) {
         if (m.vao || m.vbo || m.ebo) DestroyModelGL(m);
@@ -40,31 +90,32 @@ Game::~Game() {
     DestroyIf(m_decor2Model);
     DestroyIf(m_cloudModel);
     DestroyIf(m_balloonModel);
-    DestroyIf(m_fieldModel);
     DestroyIf(m_packageModel);
 
+    if (m_fieldTex && m_fieldTex != m_whiteTex) glDeleteTextures(1, &m_fieldTex);
     if (m_whiteTex) glDeleteTextures(1, &m_whiteTex);
     if (m_defaultNormalTex) glDeleteTextures(1, &m_defaultNormalTex);
     if (m_airshipNormalTex) glDeleteTextures(1, &m_airshipNormalTex);
 }
 
 unsigned int Game::Create1x1TextureRGBA(unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
-    unsigned int tex = 0;
     unsigned char px[4] = { r, g, b, a };
-    glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, px);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    return tex;
+    TextureLevel level;
+    level.width = 1;
+    level.height = 1;
+    level.data = px;
+    return CreateTexture2D(GL_RGBA8, &level, 1, false);
 }
 
 void Game::EnsureTextures(Model& model, unsigned int fallbackTex) {
     for (auto& sm : model.subMeshes) {
         if (sm.texture == 0) sm.texture = fallbackTex;
     }
+    for (auto& lod : model.lods) {
+        for (auto& sm : lod.subMeshes) {
+            if (sm.texture == 0) sm.texture = fallbackTex;
+        }
+    }
 }
 
 bool Game::Initialize() {
@@ -100,9 +151,18 @@ bool Game::Initialize() {
     m_uSwayStrength = glGetUniformLocation(m_program, "u_swayStrength");
     m_uEmissionStrength = glGetUniformLocation(m_program, "u_emissionStrength");
     m_uTint = glGetUniformLocation(m_program, "u_tint");
+    m_uWind = glGetUniformLocation(m_program, "u_wind");
+    m_uAoBase = glGetUniformLocation(m_program, "u_aoBase");
+    m_uStaticBatch = glGetUniformLocation(m_program, "u_staticBatch");
+    m_uDebugView = glGetUniformLocation(m_program, "u_debugView");
+    m_uDebugValue = glGetUniformLocation(m_program, "u_debugValue");
 
     glUniform1i(m_uDiffuseSampler, 0);
     glUniform1i(m_uNormalSampler, 1);
+    glUniform1i(glGetUniformLocation(m_program, "u_aoBuffer"), 2);
+    glUniform1i(m_uAoBase, -1);
+    glUniform1i(m_uStaticBatch, 0);
+    glUniform1i(m_uDebugView, 0);
 
     glUniform3fv(m_uDirDir, 1, glm::value_ptr(m_dirLight.direction));
     glUniform3fv(m_uDirAmbient, 1, glm::value_ptr(m_dirLight.ambient));
@@ -110,6 +170,68 @@ bool Game::Initialize() {
     glUniform3fv(m_uDirSpecular, 1, glm::value_ptr(m_dirLight.specular));
     glUniform1f(m_uDirIntensity, m_dirLight.intensity);
 
+    if (m_gpuCuller.Initialize()) {
+        m_instancedProgram = CreateShaderProgramFromFiles("game.vert", "game.frag", "#define INSTANCED");
+        if (m_instancedProgram) {
+            auto Loc = [&](const char* name) { return glGetUniformLocation(m_instancedProgram, name); };
+
+            glUseProgram(m_instancedProgram);
+            m_uInstView = Loc("u_view");
+            m_uInstProj = Loc("u_projection");
+            m_uInstViewPos = Loc("u_viewPos");
+            m_uInstTime = Loc("u_time");
+            m_uInstWind = Loc("u_wind");
+
+            glUniform1i(Loc("u_diffuse"), 0);
+            glUniform1i(Loc("u_normalMap"), 1);
+            glUniform1i(Loc("u_aoBuffer"), 2);
+            ApplyLightUniforms(m_instancedProgram);
+            glUseProgram(m_program);
+
+            m_gpuCulling = true;
+        }
+        else {
+            m_gpuCuller.Shutdown();
+        }
+    }
+
+    // Generous height range: clouds and balloons drift well above the field.
+    if (m_shadows.Initialize()) {
+        const float span = m_fieldHalfSize * 1.25f;
+        m_shadows.SetSceneBounds(glm::vec3(-span, -10.0f, -span), glm::vec3(span, 60.0f, span));
+    }
+
+    m_particles.Initialize();
+    m_latency.ConfigureFromEnvironment();
+    m_pip.ConfigureFromEnvironment();
+
+    if (m_hud.Initialize()) {
+        m_hud.AddPanel(glm::vec2(12.0f), glm::vec2(236.0f, 82.0f), glm::vec4(0.05f, 0.07f, 0.1f, 0.55f));
+        m_hudDeliveredText = m_hud.AddText(glm::vec2(24.0f, 24.0f), 2.0f, glm::vec4(1.0f, 0.9f, 0.55f, 1.0f));
+        m_hudPackagesText = m_hud.AddText(glm::vec2(24.0f, 46.0f), 2.0f, glm::vec4(0.9f, 0.95f, 1.0f, 1.0f));
+        m_hudSpeedText = m_hud.AddText(glm::vec2(24.0f, 68.0f), 2.0f, glm::vec4(0.9f, 0.95f, 1.0f, 1.0f));
+        m_hudDebugText = m_hud.AddText(glm::vec2(24.0f, 106.0f), 2.0f, glm::vec4(1.0f, 1.0f, 0.6f, 1.0f));
+    }
+    m_debugView.Initialize();
+    m_minimap.Initialize();
+
+    m_jobs.Start();
+    const float windSpan = m_fieldHalfSize * 1.25f;
+    m_wind.Start(m_jobs, glm::vec3(-windSpan, 0.0f, -windSpan), glm::vec3(windSpan, 32.0f, windSpan));
+    m_sky.Initialize(m_jobs);
+
+    if (m_terrain.InitializeGL()) {
+        glUseProgram(m_terrain.Program());
+        ApplyLightUniforms(m_terrain.Program());
+        glUseProgram(m_program);
+    }
+    m_grass.Initialize(m_fieldHalfSize, m_dirLight.direction, m_dirLight.ambient, m_dirLight.diffuse);
+    m_birds.InitializeGL(m_dirLight.direction, m_dirLight.ambient, m_dirLight.diffuse);
+
+    m_uploader.Start();
+    m_assets.Start();
+
+    RegisterSimSystems();
     LoadAll();
     CreateProceduralMeshes();
     GenerateScene();
@@ -117,33 +239,58 @@ bool Game::Initialize() {
     return true;
 }
 
-void Game::LoadAll() {
-    auto Load = [&](const char* path, Model& m) {
-        if (!LoadOBJModel(path, m)) {
-            std::cerr << "Model load failed: " << path << "\n";
-            return false;
-        }
-        EnsureTextures(m, m_whiteTex);
-        if (!InitializeModelGL(m)) {
-            std::cerr << "Model GL init failed: " << path << "\n";
-            return false;
-        }
-        return true;
-        };
+AssetContext Game::Assets() {
+    AssetContext ctx;
+    ctx.executor = &m_assets;
+    ctx.uploader = &m_uploader;
+    ctx.cancel = m_loadCancel;
+    ctx.progress = &m_loadProgress;
+    return ctx;
+}
 
-    Load("models/airship.obj", m_airshipModel);
-    Load("models/tree.obj", m_treeModel);
-    Load("models/house.obj", m_houseModel);
-    Load("models/decor1.obj", m_decor1Model);
-    Load("models/decor2.obj", m_decor2Model);
-    Load("models/cloud.obj", m_cloudModel);
-    Load("models/balloon.obj", m_balloonModel);
+// The model is placed and drawn as soon as its coarsest level is in; the
+// rest streams in afterwards and replaces it within one frame.
+Task<void> Game::LoadModelTask(std::string path, Model& model) {
+    MeshStream stream;
+    if (!co_await LoadModelAsync(Assets(), path, model, stream)) {
+        if (!m_loadCancel.Cancelled()) std::cerr << "Model load failed: " << path << "\n";
+        co_return;
+    }
 
-    m_airshipNormalTex = LoadTextureFromFile("models/airship_normal.jpg");
-    if (m_airshipNormalTex == 0) {
-        m_airshipNormalTex = m_defaultNormalTex;
-        std::cerr << "Warning: airship normal map not found, using default normal.\n";
+    co_await m_assets.OnRenderThread();
+    EnsureTextures(model, m_whiteTex);
+    SetupModelVertexArray(model);
+    LabelModel(model, path);
+    OnModelReady(model);
+
+    if (!stream.Pending()) co_return;
+    if (!co_await RefineModelAsync(Assets(), stream, model)) {
+        if (m_loadCancel.Cancelled()) co_return;
+        std::cerr << "Model refinement failed, keeping the coarse mesh: " << path << "\n";
+        model.streaming = false;
     }
+    else {
+        SetupModelVertexArray(model);
+        LabelModel(model, path);
+    }
+    OnModelRefined(model);
+}
+
+// Each model loads as its own task, so parsing, texture decodes and
+// uploads of different models overlap.
+void Game::LoadAll() {
+    for (auto [path, model] : {
+        std::pair<const char*, Model*>{ "models/airship.obj", &m_airshipModel },
+        { "models/tree.obj", &m_treeModel },
+        { "models/house.obj", &m_houseModel },
+        { "models/decor1.obj", &m_decor1Model },
+        { "models/decor2.obj", &m_decor2Model },
+        { "models/cloud.obj", &m_cloudModel },
+        { "models/balloon.obj", &m_balloonModel } })
+        Spawn(LoadModelTask(path, *model));
+
+    m_airshipNormalTex = m_defaultNormalTex;
+    StreamTexture("models/airship_normal.jpg", m_airshipNormalTex);
 
     m_airship.model = &m_airshipModel;
     m_airship.position = m_airshipPos;
@@ -161,43 +308,10 @@ void Game::LoadAll() {
 }
 
 void Game::CreateProceduralMeshes() {
-    m_fieldModel.vertices = {
-        {-m_fieldHalfSize, 0.0f, -m_fieldHalfSize},
-        { m_fieldHalfSize, 0.0f, -m_fieldHalfSize},
-        { m_fieldHalfSize, 0.0f,  m_fieldHalfSize},
-        {-m_fieldHalfSize, 0.0f,  m_fieldHalfSize},
-    };
-    m_fieldModel.texCoords = {
-        {0.0f, 0.0f},
-        {50.0f, 0.0f},
-        {50.0f, 50.0f},
-        {0.0f, 50.0f},
-    };
-    m_fieldModel.normals = {
-        {0.0f, 1.0f, 0.0f},
-        {0.0f, 1.0f, 0.0f},
-        {0.0f, 1.0f, 0.0f},
-        {0.0f, 1.0f, 0.0f},
-    };
-    m_fieldModel.indices = { 0, 1, 2, 2, 3, 0 };
-    ComputeTangents(m_fieldModel);
-
-    SubMesh sm{};
-    sm.indexOffset = 0;
-    sm.indexCount = static_cast<unsigned int>(m_fieldModel.indices.size());
-    sm.texture = LoadTextureFromFile("models/field.jpg");
-    if (sm.texture == 0) sm.texture = m_whiteTex;
-    m_fieldModel.subMeshes = { sm };
+    m_fieldTex = m_whiteTex;
+    StreamTexture("models/field.jpg", m_fieldTex);
 
-    if (!InitializeModelGL(m_fieldModel)) {
-        std::cerr << "Failed to init field mesh\n";
-    }
-
-    m_field.model = &m_fieldModel;
-    m_field.position = { 0.0f, 0.0f, 0.0f };
-    m_field.scale = { 1.0f, 1.0f, 1.0f };
-
-    const float s = 0.35f;
+    const float s = m_packageHalfSize;
     struct V { glm::vec3 p; glm::vec2 uv; glm::vec3 n; };
     std::vector<V> v;
     std::vector<unsigned int> idx;
@@ -232,22 +346,229 @@ void Game::CreateProceduralMeshes() {
     }
 
     ComputeTangents(m_packageModel);
+    ComputeBounds(m_packageModel);
 
     SubMesh psm{};
     psm.indexOffset = 0;
     psm.indexCount = static_cast<unsigned int>(m_packageModel.indices.size());
-    psm.texture = LoadTextureFromFile("models/package.jpg");
-    if (psm.texture == 0) psm.texture = m_whiteTex;
+    psm.texture = m_whiteTex;
     m_packageModel.subMeshes = { psm };
+    StreamTexture("models/package.jpg", m_packageModel.subMeshes[0].texture);
 
     if (!InitializeModelGL(m_packageModel)) {
         std::cerr << "Failed to init package mesh\n";
     }
 }
 
+Task<void> Game::StreamTextureTask(std::string path, unsigned int& target) {
+    const GLuint tex = co_await LoadTextureAsync(Assets(), path);
+    if (!tex) {
+        if (!m_loadCancel.Cancelled()) std::cerr << "Warning: texture not found, keeping fallback: " << path << "\n";
+        co_return;
+    }
+
+    co_await m_assets.OnRenderThread();
+    target = tex;
+}
+
+void Game::StreamTexture(const std::string& path, unsigned int& target) {
+    Spawn(StreamTextureTask(path, target));
+}
+
+void Game::OnModelReady(Model& model) {
+    if (&model == &m_houseModel || &model == &m_decor1Model || &model == &m_decor2Model)
+        m_staticBatchesDirty = true;
+    if (m_staticBatchesDirty || &model == &m_treeModel)
+        m_shadows.InvalidateStatic();
+
+    for (size_t i = 0; i < m_houses.size(); ++i) {
+        RenderInstance& inst = m_houses[i].inst;
+        if (inst.model != &model) continue;
+        SnapToGround(inst);
+        m_physics.AddStaticBox(MakeModelMatrix(inst), model.boundsMin, model.boundsMax, MakeProxyTag(ProxyKind::House, static_cast<int>(i)));
+        if (m_gpuCuller.Ready())
+            inst.gpuHandle = m_gpuCuller.AddInstance(model, MakeGpuInstance(inst));
+    }
+    for (size_t i = 0; i < m_decorations.size(); ++i) {
+        RenderInstance& d = m_decorations[i];
+        if (d.model != &model) continue;
+        SnapToGround(d);
+        m_physics.AddStaticBox(MakeModelMatrix(d), model.boundsMin, model.boundsMax, MakeProxyTag(ProxyKind::Decoration, static_cast<int>(i)));
+        if (m_gpuCuller.Ready())
+            d.gpuHandle = m_gpuCuller.AddInstance(model, MakeGpuInstance(d));
+    }
+}
+
+// Bounds come from the whole mesh from the start, so placement and
+// physics stay; only what depends on the exact geometry is redone.
+void Game::OnModelRefined(Model& model) {
+    if (&model == &m_houseModel || &model == &m_decor1Model || &model == &m_decor2Model)
+        m_staticBatchesDirty = true;
+    if (m_staticBatchesDirty || &model == &m_treeModel)
+        m_shadows.InvalidateStatic();
+    if (m_gpuCuller.Ready())
+        m_gpuCuller.RefreshModel(model);
+}
+
+RenderInstance* Game::StaticInstanceByTag(int tag) {
+    if (tag < 0) return nullptr;
+    if (tag < static_cast<int>(m_houses.size())) return &m_houses[tag].inst;
+    tag -= static_cast<int>(m_houses.size());
+    if (tag < static_cast<int>(m_decorations.size())) return &m_decorations[tag];
+    return nullptr;
+}
+
+StaticBatchSource Game::MakeStaticBatchSource(const RenderInstance& inst, int tag) const {
+    StaticBatchSource src;
+    src.model = inst.model;
+    src.transform = MakeModelMatrix(inst);
+    src.scale = inst.scale;
+    src.swayStrength = inst.swayStrength;
+    src.tag = tag;
+    if (m_ao && inst.aoBase >= 0) src.ao = m_ao->values.data() + inst.aoBase;
+    return src;
+}
+
+void Game::GatherStaticBatchSources(std::vector<StaticBatchSource>& out) const {
+    auto Add = [&](const RenderInstance& inst, int tag) {
+        if (inst.model && inst.model->vao) out.push_back(MakeStaticBatchSource(inst, tag));
+        };
+
+    // Delivered houses carry a tint the merged vertex format cannot hold,
+    // so they leave the batch and are drawn on their own.
+    for (size_t i = 0; i < m_houses.size(); ++i) {
+        if (!m_houses[i].delivered) Add(m_houses[i].inst, static_cast<int>(i));
+    }
+    for (size_t i = 0; i < m_decorations.size(); ++i) {
+        Add(m_decorations[i], static_cast<int>(m_houses.size() + i));
+    }
+}
+
+void Game::RebuildStaticBatches() {
+    m_staticBatchChanges.clear();
+    std::vector<StaticBatchSource> sources;
+    GatherStaticBatchSources(sources);
+
+    // The job holds its own reference so a re-bake cannot free the AO
+    // bytes the sources point into.
+    auto set = std::make_shared<std::shared_ptr<StaticBatchSet>>();
+    m_uploader.Enqueue(
+        [this, set, sources, ao = m_ao] {
+            *set = m_staticBatcher.BuildSet(sources);
+            return StaticBatcher::UploadSet(**set);
+        },
+        [this, set](bool ok) {
+            if (!ok) {
+                std::cerr << "Static batch upload failed\n";
+                return;
+            }
+            m_staticBatcher.Publish(*set);
+        });
+}
+
+// Rebuilds only the cells the delivered houses sat in. Uploads publish in
+// order, so this lands after any full rebuild already queued.
+void Game::RebuildStaticBatchCells() {
+    const StaticBatchSet& current = *m_staticBatcher.Current();
+    std::vector<int> changed;
+    changed.swap(m_staticBatchChanges);
+
+    std::vector<glm::ivec2> coords;
+    for (int house : changed) {
+        const RenderInstance& inst = m_houses[house].inst;
+        if (!inst.model || !inst.model->vao) continue;
+        const glm::ivec2 coord = m_staticBatcher.CellOf(MakeStaticBatchSource(inst, house));
+        if (std::find(coords.begin(), coords.end(), coord) == coords.end()) coords.push_back(coord);
+    }
+    if (coords.empty()) return;
+
+    std::vector<StaticBatchSource> sources;
+    GatherStaticBatchSources(sources);
+
+    auto cells = std::make_shared<std::vector<StaticBatchCell>>();
+    m_uploader.Enqueue(
+        [this, cells, sources, coords, includeLod0 = current.includeLod0, lodCount = current.lodCount, ao = m_ao] {
+            bool ok = true;
+            for (const glm::ivec2& coord : coords) {
+                cells->push_back(m_staticBatcher.BuildCell(sources, coord, includeLod0, lodCount));
+                ok = StaticBatcher::UploadCell(cells->back()) && ok;
+            }
+            return ok;
+        },
+        [this, cells, changed](bool ok) {
+            if (!ok) {
+                std::cerr << "Static batch upload failed\n";
+                for (StaticBatchCell& cell : *cells) StaticBatcher::DestroyCell(cell);
+                m_staticBatchesDirty = true;
+                return;
+            }
+            for (StaticBatchCell& cell : *cells) m_staticBatcher.PublishCell(std::move(cell), changed);
+        });
+}
+
+void Game::StartAoBake() {
+    std::vector<AoBakeInstance> instances;
+    for (auto& h : m_houses) instances.push_back({ h.inst.model, MakeModelMatrix(h.inst) });
+    for (auto& d : m_decorations) instances.push_back({ d.model, MakeModelMatrix(d) });
+
+    m_aoBaker.Start(m_jobs, std::move(instances), m_terrain.BuildTriangles(4), m_sceneSeed);
+}
+
+void Game::ApplyAo(std::shared_ptr<AoBakeResult> ao) {
+    const size_t staticCount = m_houses.size() + m_decorations.size();
+    if (!ao || ao->offsets.size() != staticCount) return;
+
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    if (ao->values.size() > static_cast<size_t>(maxTexels)) {
+        std::cerr << "AO: " << ao->values.size() << " vertices exceed the texture buffer limit (" << maxTexels << ")\n";
+        return;
+    }
+
+    if (!m_aoBuffer) glGenBuffers(1, &m_aoBuffer);
+    if (!m_aoTexture) glGenTextures(1, &m_aoTexture);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, m_aoBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, ao->values.size(), ao->values.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_BUFFER, m_aoTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R8, m_aoBuffer);
+    glActiveTexture(GL_TEXTURE0);
+
+    m_ao = std::move(ao);
+    for (size_t i = 0; i < staticCount; ++i) {
+        RenderInstance* inst = StaticInstanceByTag(static_cast<int>(i));
+        inst->aoBase = static_cast<int>(m_ao->offsets[i]);
+        if (inst->gpuHandle >= 0)
+            m_gpuCuller.UpdateInstance(inst->gpuHandle, MakeGpuInstance(*inst));
+    }
+    m_staticBatchesDirty = true;
+}
+
 void Game::GenerateScene() {
     std::uniform_real_distribution<float> posDist(-m_fieldHalfSize * 0.85f, m_fieldHalfSize * 0.85f);
 
+    std::seed_seq seq{ static_cast<std::uint32_t>(m_sceneSeed), static_cast<std::uint32_t>(m_sceneSeed >> 32) };
+    m_rng.seed(seq);
+
+    m_terrain.Generate(m_fieldHalfSize, m_sceneSeed);
+    m_grass.SetTerrain(&m_terrain);
+    m_particles.SetTerrain(&m_terrain);
+    m_wind.Reset(&m_terrain, m_sceneSeed);
+
+    m_gpuCuller.Clear();
+    m_physics.Clear();
+    m_broadphase.Clear();
+    m_physics.SetScene(&m_broadphase, &m_terrain);
+    m_packages.clear();
+    m_nextRecycle = 0;
+    m_scheduler.Resize(m_simPackageSync, 0);
+    m_scheduler.ClearJobs();
+    m_ao.reset();
+    m_aoPending = true;
+
     auto FarFromCenter = [&](glm::vec3 p) {
         return glm::length(glm::vec2(p.x, p.z)) > 10.0f;
         };
@@ -291,6 +612,14 @@ void Game::GenerateScene() {
         m_decorations.push_back(d);
     }
 
+    // Static map content; its tiles render once here and again only where
+    // a house changes colour.
+    m_minimap.SetWorld(&m_terrain, m_fieldHalfSize);
+    for (const auto& h : m_houses)
+        m_minimap.AddFeature(glm::vec2(h.inst.position.x, h.inst.position.z), h.radius, kMinimapHouseColor, MinimapShape::Square);
+    for (const auto& d : m_decorations)
+        m_minimap.AddFeature(glm::vec2(d.position.x, d.position.z), 1.0f, glm::vec4(0.2f, 0.3f, 0.15f, 1.0f), MinimapShape::Disc);
+
     std::uniform_real_distribution<float> cloudDist(-m_fieldHalfSize, m_fieldHalfSize);
     std::uniform_real_distribution<float> phaseDist(0.0f, 1000.0f);
 
@@ -307,6 +636,7 @@ void Game::GenerateScene() {
         c.inst.position = c.basePosition;
         c.inst.scale = { 2.5f, 2.5f, 2.5f };
         c.inst.tint = { 0.95f, 0.95f, 1.0f };
+        c.simPosition = c.basePosition;
         m_clouds.push_back(c);
     }
 
@@ -319,24 +649,70 @@ void Game::GenerateScene() {
         b.inst.model = &m_balloonModel;
         b.inst.position = b.basePosition;
         b.inst.scale = { 1.2f, 1.2f, 1.2f };
+        b.simPosition = b.basePosition;
         m_balloons.push_back(b);
     }
 
-    m_packages.assign(40, Package{});
-    for (auto& p : m_packages) {
-        p.inst.model = &m_packageModel;
-        p.inst.scale = { 1.0f, 1.0f, 1.0f };
-        p.inst.tint = { 1.0f, 1.0f, 1.0f };
+    // Fresh scheduler slots are due at once, so nothing starts stale.
+    m_scheduler.Resize(m_simClouds, 0);
+    m_scheduler.Resize(m_simBalloons, 0);
+    m_scheduler.Resize(m_simClouds, static_cast<int>(m_clouds.size()));
+    for (size_t i = 0; i < m_clouds.size(); ++i)
+        m_scheduler.SetBounds(m_simClouds, static_cast<int>(i), m_clouds[i].simPosition, 6.0f);
+    m_scheduler.Resize(m_simBalloons, static_cast<int>(m_balloons.size()));
+    for (size_t i = 0; i < m_balloons.size(); ++i)
+        m_scheduler.SetBounds(m_simBalloons, static_cast<int>(i), m_balloons[i].simPosition, 3.0f);
+
+    BuildParticleEmitters();
+    ResetBirds();
+
+    // Models that finished loading before the scene existed never saw
+    // these instances; register them now.
+    for (Model* m : { &m_houseModel, &m_decor1Model, &m_decor2Model }) {
+        if (m->vao) OnModelReady(*m);
     }
 }
 
+// Budgets add up to roughly a million slots; rates are set so each
+// emitter runs close to full at steady state.
+void Game::BuildParticleEmitters() {
+    m_particles.ClearEmitters();
+
+    m_airshipEmitter = m_particles.AddEmitter(ParticleKind::Smoke, 80000, 26000.0f);
+    for (auto& c : m_clouds) c.emitter = m_particles.AddEmitter(ParticleKind::Rain, 48000, 15000.0f);
+    m_trailEmitters.clear();
+    for (int i = 0; i < 40; ++i) m_trailEmitters.push_back(m_particles.AddEmitter(ParticleKind::Trail, 5000, 5000.0f));
+    m_trailOwners.assign(m_trailEmitters.size(), -1);
+    m_nextTrail = 0;
+
+    m_particles.Build();
+}
+
+// One flock per cloud and balloon.
+void Game::GatherBirdAnchors(std::vector<glm::vec3>& out) const {
+    out.clear();
+    for (const auto& c : m_clouds) out.push_back(c.inst.position);
+    for (const auto& b : m_balloons) out.push_back(b.inst.position);
+}
+
+void Game::ResetBirds() {
+    const float span = m_fieldHalfSize * 1.25f;
+    GatherBirdAnchors(m_birdAnchors);
+    m_birds.SetTerrain(&m_terrain);
+    m_birds.Reset(m_birdCount, m_birdAnchors, glm::vec3(-span, 0.0f, -span), glm::vec3(span, 40.0f, span), m_sceneSeed);
+}
+
 void Game::Run() {
     sf::Clock clock;
     while (m_window.isOpen()) {
         float dt = clock.restart().asSeconds();
         dt = glm::clamp(dt, 0.0f, 0.05f);
 
+        m_latency.BeginFrame();
+        GlDebugNextFrame();
         HandleEvents();
+        m_uploader.Poll();
+        m_assets.PollRender();
         Update(dt);
         Render();
     }
@@ -350,12 +726,14 @@ void Game::HandleEvents() {
         }
 
         if (const auto* wheel = ev->getIf<sf::Event::MouseWheelScrolled>()) {
+            m_latency.MarkInput();
             m_fovDeg -= wheel->delta * 3.0f;
             m_fovDeg = glm::clamp(m_fovDeg, 25.0f, 150.0f);
         }
 
         if (const auto* key = ev->getIf<sf::Event::KeyPressed>()) {
             const auto code = key->code;
+            m_latency.MarkInput();
 
             if (code == sf::Keyboard::Key::Escape)
                 m_window.close();
@@ -363,14 +741,122 @@ void Game::HandleEvents() {
             if (code == sf::Keyboard::Key::C)
                 m_aimMode = !m_aimMode;
 
+            if (code == sf::Keyboard::Key::I) {
+                m_pip.enabled = !m_pip.enabled;
+                std::cout << "Picture-in-picture: " << (m_pip.enabled ? "on" : "off") << " (every " << m_pip.interval << " frames at "
+                    << m_pip.resolution << "x; " << m_pip.Renders() << " renders, " << m_pip.CullReuses() << " reused the main culling)\n";
+            }
+
             if (code == sf::Keyboard::Key::Space)
-                SpawnPackage();
+                SpawnPackage(m_airshipPos + glm::vec3(0.0f, -2.0f, 0.0f), glm::vec3(0.0f));
+
+            if (code == sf::Keyboard::Key::K)
+                DropPackageBurst(1000);
+
+            if (code == sf::Keyboard::Key::G && m_gpuCuller.Ready()) {
+                m_gpuCulling = !m_gpuCulling;
+                m_gpuCuller.InvalidateHiZ();
+                std::cout << "Culling: " << (m_gpuCulling ? "GPU" : "CPU") << "\n";
+            }
+
+            if (code == sf::Keyboard::Key::B) {
+                m_staticBatching = !m_staticBatching;
+                std::cout << "Static batching: " << (m_staticBatching ? "on" : "off") << "\n";
+            }
+
+            if (code == sf::Keyboard::Key::T) {
+                m_grassEnabled = !m_grassEnabled;
+                std::cout << "Grass: " << (m_grassEnabled ? "on" : "off") << "\n";
+            }
+
+            if (code == sf::Keyboard::Key::R) {
+                m_rain = !m_rain;
+                std::cout << "Rain: " << (m_rain ? "on" : "off") << "\n";
+            }
+
+            if (code == sf::Keyboard::Key::P && m_particles.GpuAvailable()) {
+                m_particles.SetUseGpu(!m_particles.UsingGpu());
+                std::cout << "Particle simulation: " << (m_particles.UsingGpu() ? "GPU" : "CPU") << "\n";
+            }
+
+            if (code == sf::Keyboard::Key::F) {
+                m_birdCount = (m_birdCount == 0) ? 3000 : (m_birdCount < 50000 ? 50000 : 0);
+                ResetBirds();
+                std::cout << "Birds: " << m_birdCount << " on " << m_jobs.ThreadCount() << " threads\n";
+            }
+
+            if (code == sf::Keyboard::Key::U) {
+                PrintSimStats();
+                m_graph.PrintStats();
+            }
+
+            if (code == sf::Keyboard::Key::M && m_minimap.Ready()) {
+                m_minimapEnabled = !m_minimapEnabled;
+                std::cout << "Minimap: " << (m_minimapEnabled ? "on" : "off") << " (" << m_minimap.TileRenders() << " tile renders so far)\n";
+            }
+
+            // The debug views skip the Hi-Z pass, so it is rebuilt afterwards.
+            if (code == sf::Keyboard::Key::O && m_debugView.Ready()) {
+                m_debugView.Cycle();
+                m_gpuCuller.InvalidateHiZ();
+                m_hud.SetText(m_hudDebugText, "");
+                std::cout << "Debug view: " << DebugView::Name(m_debugView.mode) << "\n";
+            }
+
+            if (code == sf::Keyboard::Key::L && m_shadows.Ready()) {
+                m_shadowsEnabled = !m_shadowsEnabled;
+                std::cout << "Shadows: " << (m_shadowsEnabled ? "on" : "off") << " (" << m_shadows.StaticRenders()
+                    << " static cascade renders so far, " << m_shadows.LastDynamicCasters() << " moving casters last frame)\n";
+            }
+
+            if (code == sf::Keyboard::Key::LBracket || code == sf::Keyboard::Key::RBracket) {
+                const int step = (code == sf::Keyboard::Key::LBracket) ? -1 : 1;
+                m_latency.maxFramesInFlight = glm::clamp(m_latency.maxFramesInFlight + step, 0, 4);
+                std::cout << "Max frames in flight: " << m_latency.maxFramesInFlight
+                    << (m_latency.maxFramesInFlight == 0 ? " (driver)" : "") << "\n";
+            }
+
+            if (code == sf::Keyboard::Key::Y && m_sky.Ready()) {
+                m_skyEnabled = !m_skyEnabled;
+                std::cout << "Sky: " << (m_skyEnabled ? "on" : "off") << " (" << m_sky.LutUpdates() << " LUT updates so far)\n";
+            }
+
+            if (code == sf::Keyboard::Key::H) {
+                m_gpuCuller.useHiZ = !m_gpuCuller.useHiZ;
+                m_gpuCuller.InvalidateHiZ();
+                std::cout << "Hi-Z occlusion: " << (m_gpuCuller.useHiZ ? "on" : "off") << "\n";
+            }
+
+            if (code == sf::Keyboard::Key::V && m_gpuCulling) {
+                int cpuVisible = 0;
+                for (const auto& h : m_houses)
+                    if (h.inst.model && m_frustum.Intersects(ComputeWorldSphere(*h.inst.model, MakeModelMatrix(h.inst), h.inst.scale, h.inst.swayStrength))) ++cpuVisible;
+                for (const auto& d : m_decorations)
+                    if (d.model && m_frustum.Intersects(ComputeWorldSphere(*d.model, MakeModelMatrix(d), d.scale, d.swayStrength))) ++cpuVisible;
+                std::cout << "Visible instances (incl. packages): GPU " << m_gpuCuller.ReadVisibleCount()
+                    << " / CPU frustum " << cpuVisible << " of " << m_gpuCuller.InstanceCount() << "\n";
+            }
         }
     }
 }
 
 void Game::Update(float dt) {
     m_time += dt;
+    m_wind.Update(dt);
+
+    // Steering is polled rather than evented, so for latency a key counts
+    // as input on the frame it goes down.
+    if (m_latency.enabled) {
+        static const sf::Keyboard::Key steering[] = {
+            sf::Keyboard::Key::A, sf::Keyboard::Key::D, sf::Keyboard::Key::W,
+            sf::Keyboard::Key::S, sf::Keyboard::Key::Q, sf::Keyboard::Key::E,
+        };
+        unsigned int held = 0;
+        for (size_t i = 0; i < std::size(steering); ++i)
+            if (sf::Keyboard::isKeyPressed(steering[i])) held |= 1u << i;
+        if (held & ~m_steeringHeld) m_latency.MarkInput();
+        m_steeringHeld = held;
+    }
 
     float turnInput = 0.0f;
     if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::A)) turnInput -= 1.0f;
@@ -407,6 +893,7 @@ void Game::Update(float dt) {
         vel = glm::normalize(vel) * m_airshipSpeed;
 
     m_airshipPos += vel * dt;
+    m_airshipGroundSpeed = glm::length(vel);
     m_airshipPos.x = glm::clamp(m_airshipPos.x, -m_fieldHalfSize * 0.9f, m_fieldHalfSize * 0.9f);
     m_airshipPos.z = glm::clamp(m_airshipPos.z, -m_fieldHalfSize * 0.9f, m_fieldHalfSize * 0.9f);
 
@@ -420,81 +907,271 @@ void Game::Update(float dt) {
         m_airshipRollDeg
     };
 
-    for (auto& c : m_clouds) {
-        float t = m_time * c.speed + c.phase;
-        c.inst.position = c.basePosition + glm::vec3(
-            std::sin(t) * c.amplitude,
-            std::sin(t * 0.6f) * 0.8f,
-            std::cos(t * 0.9f) * c.amplitude
-        );
+    // Wind drag only touches awake bodies, so settled packages stay free.
+    const float drag = 0.4f;
+    for (int b : m_physics.AwakeBodies()) {
+        RigidBody& body = m_physics.Body(b);
+        body.linearVelocity += (m_wind.Sample(body.position) - body.linearVelocity) * (drag * dt);
+    }
+    m_physics.Step(dt);
+    ResolvePackageCollisions();
+
+    m_scheduler.Run(dt, m_airshipPos, m_frustum);
+
+    // Objects the scheduler skipped this frame coast on their last velocity.
+    for (size_t i = 0; i < m_clouds.size(); ++i) {
+        Cloud& c = m_clouds[i];
+        c.inst.position = c.simPosition + c.velocity * m_scheduler.Staleness(m_simClouds, static_cast<int>(i));
 
         float flash = std::sin(m_time * 6.5f + c.phase * 0.25f);
         c.inst.emissionStrength = (flash > 0.98f) ? 6.0f : 0.0f;
     }
+    for (size_t i = 0; i < m_balloons.size(); ++i) {
+        Balloon& b = m_balloons[i];
+        b.inst.position = b.simPosition + b.velocity * m_scheduler.Staleness(m_simBalloons, static_cast<int>(i));
+    }
 
-    for (auto& b : m_balloons) {
-        float t = m_time * 0.7f + b.phase;
-        b.inst.position = b.basePosition + glm::vec3(
-            std::sin(t) * 1.4f,
-            std::sin(t * 1.2f) * 0.6f,
-            std::cos(t * 0.8f) * 1.4f
-        );
+    // Birds dodge the airship and balloons; clouds are only anchors.
+    GatherBirdAnchors(m_birdAnchors);
+    m_birds.SetAnchors(m_birdAnchors);
+    m_birdObstacles.clear();
+    m_birdObstacles.push_back(glm::vec4(m_airship.position, std::max(m_airshipModel.boundsRadius * m_airship.scale.x, 3.0f)));
+    for (const auto& b : m_balloons)
+        m_birdObstacles.push_back(glm::vec4(b.inst.position, std::max(m_balloonModel.boundsRadius * b.inst.scale.x, 1.5f)));
+    m_birds.SetObstacles(m_birdObstacles);
+    m_birds.wind = m_wind.Sample(glm::vec3(0.0f, 20.0f, 0.0f)) * 0.5f;
+    m_birds.Update(m_jobs, dt);
+
+    m_particles.SetEmitter(m_airshipEmitter, m_airshipPos - forward * 4.0f + glm::vec3(0.0f, 0.5f, 0.0f), vel, true);
+    for (auto& c : m_clouds) m_particles.SetEmitter(c.emitter, c.inst.position, glm::vec3(0.0f), m_rain);
+    for (size_t i = 0; i < m_trailEmitters.size(); ++i) {
+        const int owner = m_trailOwners[i];
+        const RigidBody* body = owner >= 0 ? &m_physics.Body(m_packages[owner].body) : nullptr;
+        const bool falling = body && body->awake && glm::dot(body->linearVelocity, body->linearVelocity) > 1.0f;
+        m_particles.SetEmitter(m_trailEmitters[i], body ? body->position : glm::vec3(0.0f), body ? body->linearVelocity : glm::vec3(0.0f), falling);
     }
+    m_particles.wind = m_wind.Sample(m_airshipPos);
+    m_particles.Update(dt);
 
-    for (auto& p : m_packages) {
-        if (!p.active) continue;
-        p.velocity += glm::vec3(0.0f, -9.81f, 0.0f) * dt;
-        p.inst.position += p.velocity * dt;
+    const bool staticModelsComplete = ModelComplete(m_houseModel) && ModelComplete(m_decor1Model) && ModelComplete(m_decor2Model);
+    if (m_staticBatchesDirty && staticModelsComplete) {
+        m_staticBatchesDirty = false;
+        RebuildStaticBatches();
+    }
+    else if (!m_staticBatchChanges.empty() && m_staticBatcher.Current()) {
+        RebuildStaticBatchCells();
+    }
 
-        if (p.inst.position.y <= 0.0f) {
-            p.inst.position.y = 0.0f;
-            p.active = false;
-        }
+    if (m_aoPending && staticModelsComplete) {
+        m_aoPending = false;
+        StartAoBake();
     }
 
-    ResolvePackageCollisions();
+    std::shared_ptr<AoBakeResult> ao;
+    if (m_aoBaker.Poll(ao)) ApplyAo(std::move(ao));
 
     int delivered = 0;
     for (const auto& h : m_houses) if (h.delivered) ++delivered;
+
+    const int packagesLeft = std::max(0, m_maxPackages - static_cast<int>(m_packages.size()));
+    const int speed = static_cast<int>(std::lround(m_airshipGroundSpeed));
+    if (delivered != m_hudDelivered) {
+        m_hudDelivered = delivered;
+        m_hud.SetText(m_hudDeliveredText, "Delivered " + std::to_string(delivered) + "/" + std::to_string(m_houses.size()));
+    }
+    if (packagesLeft != m_hudPackages) {
+        m_hudPackages = packagesLeft;
+        m_hud.SetText(m_hudPackagesText, "Packages " + std::to_string(packagesLeft));
+    }
+    if (speed != m_hudSpeed) {
+        m_hudSpeed = speed;
+        m_hud.SetText(m_hudSpeedText, "Speed " + std::to_string(speed));
+    }
+
+    float debugMean = 0.0f, debugMax = 0.0f, debugCoverage = 0.0f;
+    if (m_debugView.PollStats(debugMean, debugMax, debugCoverage)) {
+        char line[64];
+        std::snprintf(line, sizeof(line), "%s mean %.2f max %.1f", DebugView::Name(m_debugView.mode), debugMean, debugMax);
+        m_hud.SetText(m_hudDebugText, line);
+    }
+
+    m_minimap.ClearMarkers();
+    for (const auto& c : m_clouds)
+        m_minimap.AddMarker(glm::vec2(c.inst.position.x, c.inst.position.z), 4.0f, glm::vec2(0.0f, 1.0f), glm::vec4(0.9f, 0.9f, 0.95f, 0.35f), MinimapShape::Disc);
+    for (const auto& b : m_balloons)
+        m_minimap.AddMarker(glm::vec2(b.inst.position.x, b.inst.position.z), 1.5f, glm::vec2(0.0f, 1.0f), glm::vec4(0.9f, 0.3f, 0.35f, 1.0f), MinimapShape::Disc);
+    m_minimap.AddMarker(glm::vec2(m_airshipPos.x, m_airshipPos.z), 4.0f, glm::vec2(forward.x, forward.z), glm::vec4(1.0f), MinimapShape::Arrow);
+
+    const int loaded = m_loadProgress.finished.load();
+    if (!m_loadReported && loaded != m_loadShown) {
+        m_loadShown = loaded;
+        std::cout << "Assets: " << loaded << "/" << m_loadProgress.started.load() << "\n";
+        if (m_loadProgress.Idle()) {
+            m_loadReported = true;
+            std::cout << "Assets loaded in " << m_time << " s (" << m_loadProgress.failed.load() << " failed)\n";
+        }
+    }
 }
 
-void Game::SpawnPackage() {
-    for (auto& p : m_packages) {
-        if (p.active) continue;
-        p.active = true;
+void Game::SpawnPackage(const glm::vec3& position, const glm::vec3& velocity) {
+    const glm::quat upright(1.0f, 0.0f, 0.0f, 0.0f);
+    int index;
 
-        p.inst.position = m_airshipPos + glm::vec3(0.0f, -2.0f, 0.0f);
-        p.velocity = glm::vec3(0.0f, 0.0f, 0.0f);
-        p.inst.rotationDeg = { 0.0f, 0.0f, 0.0f };
-        p.inst.swayStrength = 0.0f;
-        p.inst.emissionStrength = 0.0f;
-        p.inst.useNormalMap = false;
-        p.inst.tint = { 1.0f, 1.0f, 1.0f };
-        return;
+    if (static_cast<int>(m_packages.size()) < m_maxPackages) {
+        index = static_cast<int>(m_packages.size());
+
+        Package p;
+        p.inst.model = &m_packageModel;
+        p.inst.position = position;
+        p.body = m_physics.AddBox(position, upright, glm::vec3(m_packageHalfSize), 1.0f, MakeProxyTag(ProxyKind::Package, index));
+        m_physics.Body(p.body).linearVelocity = velocity;
+        if (m_gpuCuller.Ready())
+            p.inst.gpuHandle = m_gpuCuller.AddInstance(m_packageModel, MakeGpuInstance(p.inst));
+        m_packages.push_back(p);
+
+        m_scheduler.Resize(m_simPackageSync, index + 1);
+        m_scheduler.SetActive(m_simPackageSync, index, false);
+    }
+    else {
+        // At the cap the oldest package is picked up and dropped again.
+        index = static_cast<int>(m_nextRecycle);
+        m_nextRecycle = (m_nextRecycle + 1) % m_packages.size();
+
+        Package& p = m_packages[index];
+        m_physics.ResetBody(p.body, position, upright, velocity);
+        p.inst.position = position;
+        p.inst.rotationDeg = glm::vec3(0.0f);
+        if (p.inst.gpuHandle >= 0)
+            m_gpuCuller.UpdateInstance(p.inst.gpuHandle, MakeGpuInstance(p.inst));
+    }
+
+    if (!m_trailOwners.empty()) {
+        m_trailOwners[m_nextTrail] = index;
+        m_nextTrail = (m_nextTrail + 1) % m_trailOwners.size();
     }
 }
 
-void Game::ResolvePackageCollisions() {
-    for (auto& p : m_packages) {
-        if (!p.active) continue;
-
-        for (auto& h : m_houses) {
-            if (h.delivered) continue;
-
-            float dx = p.inst.position.x - h.inst.position.x;
-            float dz = p.inst.position.z - h.inst.position.z;
-            float dist2 = dx * dx + dz * dz;
-            if (dist2 <= h.radius * h.radius && p.inst.position.y <= 1.5f) {
-                h.delivered = true;
-                h.inst.tint = { 0.7f, 1.0f, 0.7f };
-                p.active = false;
+// Spawning thousands of bodies and culler instances at once would hitch,
+// so the burst is a sliced job that drops what fits in each frame.
+void Game::DropPackageBurst(int count) {
+    m_scheduler.AddJob("package burst", [this, left = count](float budgetMs) mutable {
+        const auto start = std::chrono::steady_clock::now();
+        std::uniform_real_distribution<float> xz(-m_fieldHalfSize * 0.9f, m_fieldHalfSize * 0.9f);
+        std::uniform_real_distribution<float> height(12.0f, 30.0f);
+
+        while (left > 0) {
+            SpawnPackage({ xz(m_rng), height(m_rng), xz(m_rng) }, glm::vec3(0.0f));
+            if (--left % 16 == 0 &&
+                std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMs)
                 break;
-            }
         }
+
+        if (left > 0) return false;
+        std::cout << "Packages: " << m_packages.size() << " (" << m_physics.AwakeBodies().size() << " awake)\n";
+        return true;
+        });
+}
+
+// Copies bodies that moved back into their render instances and delivers
+// to any house a package touched during the step. Culler uploads go
+// through the scheduler, so distant packages refresh less often.
+void Game::ResolvePackageCollisions() {
+    for (int b : m_physics.MovedBodies()) {
+        const RigidBody& body = m_physics.Body(b);
+        const int index = ProxyIndexOf(body.tag);
+        Package& p = m_packages[index];
+        p.inst.position = body.position;
+        p.inst.rotationDeg = EulerXYZDegrees(body.orientation);
+        if (p.inst.gpuHandle >= 0) {
+            m_scheduler.SetBounds(m_simPackageSync, index, body.position, m_packageHalfSize * 1.8f);
+            m_scheduler.SetActive(m_simPackageSync, index, true);
+        }
+
+        if (!body.touchedTag || ProxyKindOf(body.touchedTag) != ProxyKind::House) continue;
+
+        TargetHouse& h = m_houses[ProxyIndexOf(body.touchedTag)];
+        if (h.delivered) continue;
+        h.delivered = true;
+        h.inst.tint = { 0.7f, 1.0f, 0.7f };
+        m_minimap.SetFeatureColor(ProxyIndexOf(body.touchedTag), kMinimapDeliveredColor);
+        if (h.inst.gpuHandle >= 0)
+            m_gpuCuller.UpdateInstance(h.inst.gpuHandle, MakeGpuInstance(h.inst));
+        // Without a published set there is no cell to patch.
+        if (m_staticBatcher.Current()) m_staticBatchChanges.push_back(ProxyIndexOf(body.touchedTag));
+        else m_staticBatchesDirty = true;
+    }
+}
+
+void Game::RegisterSimSystems() {
+    m_simClouds = m_scheduler.AddSystem("clouds", 0.3f, [this](int i, float dt) { UpdateCloud(m_clouds[i], dt); });
+    m_simBalloons = m_scheduler.AddSystem("balloons", 0.3f, [this](int i, float dt) { UpdateBalloon(m_balloons[i], dt); });
+    m_simPackageSync = m_scheduler.AddSystem("package sync", 1.0f, [this](int i, float) {
+        const Package& p = m_packages[i];
+        m_gpuCuller.UpdateInstance(p.inst.gpuHandle, MakeGpuInstance(p.inst));
+        m_scheduler.SetActive(m_simPackageSync, i, false);
+        });
+}
+
+// Clouds drift with the wind and wrap at the edges so the sky never
+// empties; the wobble rides on top. dt covers every frame since the
+// cloud last ran.
+void Game::UpdateCloud(Cloud& c, float dt) {
+    const float cloudSpan = m_fieldHalfSize * 1.2f;
+    auto Wrap = [&](float v) {
+        if (v > cloudSpan) return v - 2.0f * cloudSpan;
+        if (v < -cloudSpan) return v + 2.0f * cloudSpan;
+        return v;
+        };
+
+    const glm::vec3 wind = m_wind.Sample(c.basePosition);
+    c.basePosition.x = Wrap(c.basePosition.x + wind.x * dt);
+    c.basePosition.z = Wrap(c.basePosition.z + wind.z * dt);
+
+    float t = m_time * c.speed + c.phase;
+    c.simPosition = c.basePosition + glm::vec3(
+        std::sin(t) * c.amplitude,
+        std::sin(t * 0.6f) * 0.8f,
+        std::cos(t * 0.9f) * c.amplitude
+    );
+    c.velocity = glm::vec3(wind.x, 0.0f, wind.z) + c.speed * glm::vec3(
+        std::cos(t) * c.amplitude,
+        std::cos(t * 0.6f) * 0.48f,
+        -std::sin(t * 0.9f) * 0.9f * c.amplitude
+    );
+
+    m_scheduler.SetBounds(m_simClouds, static_cast<int>(&c - m_clouds.data()), c.simPosition, 6.0f);
+}
+
+// Balloons are tethered: they lean downwind rather than drift away.
+void Game::UpdateBalloon(Balloon& b, float dt) {
+    const glm::vec3 wind = m_wind.Sample(b.basePosition);
+    b.drift += (glm::vec3(wind.x, 0.0f, wind.z) * 0.5f - b.drift) * (1.0f - std::exp(-0.8f * dt));
+
+    float t = m_time * 0.7f + b.phase;
+    b.simPosition = b.basePosition + b.drift + glm::vec3(
+        std::sin(t) * 1.4f,
+        std::sin(t * 1.2f) * 0.6f,
+        std::cos(t * 0.8f) * 1.4f
+    );
+    b.velocity = 0.7f * glm::vec3(
+        std::cos(t) * 1.4f,
+        std::cos(t * 1.2f) * 0.72f,
+        -std::sin(t * 0.8f) * 1.12f
+    );
+
+    m_scheduler.SetBounds(m_simBalloons, static_cast<int>(&b - m_balloons.data()), b.simPosition, 3.0f);
+}
+
+void Game::PrintSimStats() const {
+    std::cout << "Sim scheduler: " << m_scheduler.LastTotalMs() << " ms, " << m_scheduler.PendingJobs() << " sliced jobs pending\n";
+    for (int s = 0; s < m_scheduler.SystemCount(); ++s) {
+        const SimSystemStats& st = m_scheduler.Stats(s);
+        std::cout << "  " << m_scheduler.Name(s) << ": " << st.updated << "/" << st.due << " due of " << st.objects
+            << ", " << st.deferred << " deferred, max lag " << st.maxLagFrames << " frames, " << st.ms << " ms\n";
     }
 }
 
-void Game::UpdateCamera(glm::mat4& outView, glm::vec3& outViewPos) {
+void Game::UpdateCamera(bool aim, glm::mat4& outView, glm::vec3& outViewPos) {
     const float yawRad = glm::radians(m_cameraYawDeg);
 
     const glm::vec3 up(0.0f, 1.0f, 0.0f);
@@ -505,7 +1182,7 @@ void Game::UpdateCamera(glm::mat4& outView, glm::vec3& outViewPos) {
     glm::vec3 camPos;
     glm::vec3 camTarget;
 
-    if (!m_aimMode) {
+    if (!aim) {
         camPos = m_airshipPos - forward * m_cameraDist + glm::vec3(0.0f, m_cameraHeight, 0.0f);
         camTarget = m_airshipPos + forward * 6.0f + glm::vec3(0.0f, -1.5f, 0.0f);
     }
@@ -532,66 +1209,531 @@ glm::mat4 Game::MakeModelMatrix(const RenderInstance& inst) const {
     return m;
 }
 
+GpuInstance Game::MakeGpuInstance(const RenderInstance& inst) const {
+    GpuInstance g;
+    g.model = MakeModelMatrix(inst);
+
+    BoundingSphere s = ComputeWorldSphere(*inst.model, g.model, inst.scale, inst.swayStrength);
+    g.sphere = glm::vec4(s.center, s.radius);
+    g.params = glm::vec4(inst.swayStrength, inst.emissionStrength, inst.useNormalMap ? 1.0f : 0.0f, 0.0f);
+
+    // The AO base rides in params.w as raw int bits (floatBitsToInt in game.vert).
+    std::memcpy(&g.params.w, &inst.aoBase, sizeof(int));
+    g.tint = glm::vec4(inst.tint, 1.0f);
+    return g;
+}
+
 void Game::DrawInstance(const RenderInstance& inst) {
-    if (!inst.model) return;
+    if (!inst.model || !inst.model->vao) return;
 
     glm::mat4 modelM = MakeModelMatrix(inst);
+
+    BoundingSphere sphere = ComputeWorldSphere(*inst.model, modelM, inst.scale, inst.swayStrength);
+    if (!m_frustum.Intersects(sphere)) return;
+    if (m_recordVisible) m_pipVisible.push_back(VisibleInstance{ &inst, modelM, sphere });
+    DrawInstanceAt(inst, modelM, sphere, SelectLod(*inst.model, glm::distance(sphere.center, m_viewPos), sphere.radius));
+}
+
+void Game::DrawInstanceAt(const RenderInstance& inst, const glm::mat4& modelM, const BoundingSphere& sphere, int lod) {
+    if (m_debugView.Active()) {
+        // Coverage is the bounding sphere's projected disc, so density
+        // reads low for thin meshes.
+        int triangles = 0;
+        for (const SubMesh& sm : GetLodSubMeshes(*inst.model, lod)) triangles += static_cast<int>(sm.indexCount / 3);
+        const float distance = std::max(glm::distance(sphere.center, m_viewPos), sphere.radius);
+        const float radiusPx = sphere.radius * m_pixelsPerUnit / distance;
+        glUniform1f(m_uDebugValue, m_debugView.DrawValue(lod, triangles, 3.14159265f * radiusPx * radiusPx));
+    }
+
     glm::mat3 normalM = glm::transpose(glm::inverse(glm::mat3(modelM)));
 
     glUniformMatrix4fv(m_uModel, 1, GL_FALSE, glm::value_ptr(modelM));
     glUniformMatrix3fv(m_uNormalMatrix, 1, GL_FALSE, glm::value_ptr(normalM));
 
     glUniform1f(m_uSwayStrength, inst.swayStrength);
+    if (inst.swayStrength > 0.0f) {
+        const glm::vec3 wind = m_wind.Sample(inst.position + glm::vec3(0.0f, 2.0f, 0.0f));
+        glUniform3fv(m_uWind, 1, glm::value_ptr(wind));
+    }
     glUniform1f(m_uEmissionStrength, inst.emissionStrength);
     glUniform3fv(m_uTint, 1, glm::value_ptr(inst.tint));
 
     glUniform1i(m_uUseNormalMap, inst.useNormalMap ? 1 : 0);
+    glUniform1i(m_uAoBase, inst.aoBase);
 
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, inst.useNormalMap ? m_airshipNormalTex : m_defaultNormalTex);
     glActiveTexture(GL_TEXTURE0);
 
-    DrawModel(*inst.model);
+    DrawModel(*inst.model, lod);
 }
 
-void Game::Render() {
-    int w = (int)m_window.getSize().x;
-    int h = (int)m_window.getSize().y;
+void Game::DrawStaticInstances() {
+    const bool debug = m_debugView.Active();
+    if (!m_gpuCulling && !debug && m_staticBatching && m_staticBatcher.Current()) {
+        DrawStaticBatches();
+        return;
+    }
 
-    glViewport(0, 0, w, h);
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (!m_gpuCulling || debug) {
+        for (auto& hInst : m_houses) DrawInstance(hInst.inst);
+        for (auto& d : m_decorations) DrawInstance(d);
+        return;
+    }
+
+    glUseProgram(m_instancedProgram);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_defaultNormalTex);
+    glActiveTexture(GL_TEXTURE0);
+
+    m_gpuCuller.Draw();
 
     glUseProgram(m_program);
+}
+
+void Game::DrawStaticBatches() {
+    const StaticBatchSet& set = *m_staticBatcher.Current();
+
+    const glm::mat4 identity4(1.0f);
+    const glm::mat3 identity3(1.0f);
+    const glm::vec3 white(1.0f);
+
+    glUniformMatrix4fv(m_uModel, 1, GL_FALSE, glm::value_ptr(identity4));
+    glUniformMatrix3fv(m_uNormalMatrix, 1, GL_FALSE, glm::value_ptr(identity3));
+    glUniform1f(m_uEmissionStrength, 0.0f);
+    glUniform3fv(m_uTint, 1, glm::value_ptr(white));
+    glUniform1i(m_uUseNormalMap, 0);
+    glUniform3fv(m_uWind, 1, glm::value_ptr(m_groundWind));
+    glUniform1i(m_uStaticBatch, 1);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_defaultNormalTex);
+    glActiveTexture(GL_TEXTURE0);
+
+    std::vector<int> individual;
+
+    for (const StaticBatchCell& cell : set.cells) {
+        if (!m_frustum.Intersects(cell.bounds)) continue;
+
+        int lod = m_staticBatcher.SelectCellLod(cell, m_viewPos);
+        if (lod == 0 && !cell.hasLod0) {
+            individual.insert(individual.end(), cell.tags.begin(), cell.tags.end());
+            continue;
+        }
+
+        glUniform1i(m_uAoBase, cell.aoTexture ? 0 : -1);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_BUFFER, cell.aoTexture);
+        glActiveTexture(GL_TEXTURE0);
+        glBindVertexArray(cell.vao);
+
+        for (const StaticBatch& batch : cell.batches) {
+            const StaticBatchRange& range = batch.lods[lod];
+            if (range.indexCount == 0) continue;
+
+            glUniform1f(m_uSwayStrength, batch.swayStrength);
+            glBindTexture(GL_TEXTURE_2D, batch.texture);
+            glDrawElements(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+                (void*)(range.indexOffset * sizeof(unsigned int)));
+        }
+    }
+    glBindVertexArray(0);
+    glUniform1i(m_uStaticBatch, 0);
+
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_BUFFER, m_aoTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    const int staticCount = static_cast<int>(m_houses.size() + m_decorations.size());
+    for (int tag = 0; tag < staticCount; ++tag) {
+        if (tag >= static_cast<int>(set.batched.size()) || !set.batched[tag])
+            individual.push_back(tag);
+    }
+
+    for (int tag : individual) {
+        if (const RenderInstance* inst = StaticInstanceByTag(tag)) DrawInstance(*inst);
+    }
+}
+
+// The static list is only gathered when a cached cascade has to be
+// redrawn; moving casters are drawn every frame.
+void Game::RenderShadows(const glm::mat4& view, float aspect) {
+    m_shadows.Update(view, glm::radians(m_fovDeg), aspect, 0.1f, m_dirLight.direction);
+
+    auto Add = [&](const RenderInstance& inst) {
+        if (!inst.model || !inst.model->vao) return;
+        ShadowCaster c;
+        c.model = inst.model;
+        c.transform = MakeModelMatrix(inst);
+        c.sphere = ComputeWorldSphere(*inst.model, c.transform, inst.scale, inst.swayStrength);
+        m_shadowCasters.push_back(c);
+        };
+
+    if (m_shadows.StaticDirty()) {
+        GlDebugGroup staticGroup("static");
+        m_shadowCasters.clear();
+        for (const auto& h : m_houses) Add(h.inst);
+        for (const auto& d : m_decorations) Add(d);
+        Add(m_tree);
+        m_shadows.RenderStatic(m_shadowCasters);
+    }
+
+    GlDebugGroup dynamicGroup("dynamic");
+    m_shadowCasters.clear();
+    Add(m_airship);
+    for (const auto& c : m_clouds) Add(c.inst);
+    for (const auto& b : m_balloons) Add(b.inst);
+    for (const auto& p : m_packages) Add(p.inst);
+    m_shadows.RenderDynamic(m_shadowCasters);
+}
+
+void Game::Render() {
+    int w = (int)m_window.getSize().x;
+    int h = (int)m_window.getSize().y;
+    const float aspect = (float)w / (float)h;
 
     glm::mat4 view(1.0f);
     glm::vec3 viewPos(0.0f);
-    UpdateCamera(view, viewPos);
+    UpdateCamera(m_aimMode, view, viewPos);
+
+    glm::mat4 proj = glm::perspective(glm::radians(m_fovDeg), aspect, 0.1f, 300.0f);
+
+    const glm::mat4 viewProj = proj * view;
+    m_frustum = Frustum::FromViewProj(viewProj);
+    m_viewPos = viewPos;
+
+    // Debug views draw the game.frag geometry one instance at a time, into
+    // their own target, so the GPU-culled path and its Hi-Z sit them out.
+    const bool debugView = m_debugView.Active();
+    const bool gpuDraw = m_gpuCulling && !debugView;
+    m_pixelsPerUnit = proj[1][1] * h * 0.5f;
+
+    // The PiP can replay the main view's culling when the main frustum
+    // covers everything it sees between the ground and the clouds.
+    const bool pipDue = m_pip.NextFrame() && !debugView;
+    glm::mat4 pipView(1.0f), pipProj(1.0f);
+    glm::vec3 pipPos(0.0f);
+    bool pipReuse = false;
+    m_pipVisible.clear();
+    if (pipDue) {
+        UpdateCamera(!m_aimMode, pipView, pipPos);
+        pipProj = glm::perspective(glm::radians(m_fovDeg), aspect, 0.1f, 300.0f);
+        pipReuse = FrustumCoversView(m_frustum, pipProj * pipView, -10.0f, 60.0f);
+    }
+
+    const glm::vec3 groundProbe(viewPos.x, m_terrain.HeightAt(viewPos.x, viewPos.z) + 2.0f, viewPos.z);
+    m_groundWind = m_wind.Sample(groundProbe);
+    m_grass.wind = m_groundWind;
+
+    const bool shadows = m_shadowsEnabled && m_shadows.Ready();
+    const bool sky = m_skyEnabled && m_sky.Ready();
+    const glm::vec3 sunDir = -glm::normalize(m_dirLight.direction);
+    m_shadows.BindTextures();
+    m_sky.BindTextures();
+    const unsigned int litPrograms[] = { m_instancedProgram, m_terrain.Program(), m_program };
+    for (unsigned int program : litPrograms) {
+        if (!program) continue;
+        glUseProgram(program);
+        m_shadows.ApplyUniforms(program, false);
+        m_sky.ApplyUniforms(program, sky);
+    }
 
-    glm::mat4 proj = glm::perspective(glm::radians(m_fovDeg), (float)w / (float)h, 0.1f, 300.0f);
+    glUseProgram(m_program);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_BUFFER, m_aoTexture);
+    glActiveTexture(GL_TEXTURE0);
 
     glUniformMatrix4fv(m_uView, 1, GL_FALSE, glm::value_ptr(view));
     glUniformMatrix4fv(m_uProj, 1, GL_FALSE, glm::value_ptr(proj));
     glUniform3fv(m_uViewPos, 1, glm::value_ptr(viewPos));
     glUniform1f(m_uTime, m_time);
+    glUniform1i(m_uDebugView, m_debugView.ShaderMode());
+
+    m_graph.Reset();
+    const RgResource color = m_graph.ImportBackbuffer("backbuffer", GL_COLOR_BUFFER_BIT, w, h, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    const RgResource depth = m_graph.ImportBackbuffer("depth", GL_DEPTH_BUFFER_BIT, w, h);
+    const RgResource shadowMaps = m_graph.Import("shadow maps");
+    const RgResource visible = m_graph.Import("visible instances");
+    const RgResource hiz = m_graph.Import("hi-z");
+    const RgResource skyLuts = m_graph.Import("sky luts");
+    const RgResource minimapTiles = m_graph.Import("minimap tiles");
+    const RgResource pipImage = m_graph.Import("pip view");
+
+    RgResource sceneColor = color;
+    RgResource sceneDepth = depth;
+    if (debugView) {
+        sceneColor = m_graph.CreateTexture("debug value", RgTextureDesc{ w, h, GL_RG32F });
+        sceneDepth = m_graph.CreateTexture("debug depth", RgTextureDesc{ w, h, GL_DEPTH24_STENCIL8 });
+    }
 
-    DrawInstance(m_field);
+    auto DrawsScene = [&](RenderGraph::Builder& b) {
+        b.Write(sceneColor);
+        b.Write(sceneDepth);
+        if (shadows) b.Read(shadowMaps);
+        if (sky) b.Read(skyLuts);
+        };
 
-    for (auto& hInst : m_houses) DrawInstance(hInst.inst);
-    for (auto& d : m_decorations) DrawInstance(d);
-    DrawInstance(m_tree);
+    // The cascades are fitted inside the pass, so their matrices are only
+    // uploaded once it has run.
+    if (shadows) {
+        m_graph.AddPass("shadows", [&](RenderGraph::Builder& b) { b.Write(shadowMaps); }, [&] {
+            RenderShadows(view, aspect);
+            for (unsigned int program : litPrograms) {
+                if (!program) continue;
+                glUseProgram(program);
+                m_shadows.ApplyUniforms(program, true);
+            }
+            glUseProgram(m_program);
+            });
+    }
+
+    // Likewise the sun direction and LUT validity change inside this pass.
+    if (sky && m_sky.NeedsUpdate(sunDir)) {
+        m_graph.AddPass("sky luts", [&](RenderGraph::Builder& b) { b.Write(skyLuts); }, [&] {
+            m_sky.UpdateLuts(sunDir);
+            for (unsigned int program : litPrograms) {
+                if (!program) continue;
+                glUseProgram(program);
+                m_sky.ApplyUniforms(program, true);
+            }
+            glUseProgram(m_program);
+            });
+    }
+
+    // Culling tests against last frame's Hi-Z, so it doesn't read this
+    // frame's "hi-z" (which would put it after the scene).
+    if (gpuDraw) {
+        m_graph.AddPass("cull", [&](RenderGraph::Builder& b) { b.Write(visible); }, [&] {
+            m_gpuCuller.Cull(viewProj, viewPos);
+
+            glUseProgram(m_instancedProgram);
+            glUniformMatrix4fv(m_uInstView, 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(m_uInstProj, 1, GL_FALSE, glm::value_ptr(proj));
+            glUniform3fv(m_uInstViewPos, 1, glm::value_ptr(viewPos));
+            glUniform1f(m_uInstTime, m_time);
+            glUniform3fv(m_uInstWind, 1, glm::value_ptr(m_groundWind));
+            glUseProgram(m_program);
+            });
+    }
+
+    // In a debug view the other scene shaders only lay down depth.
+    m_graph.AddPass("terrain", DrawsScene, [&] {
+        if (debugView) {
+            m_debugView.BeginScene();
+            m_debugView.BeginDepthOnly();
+        }
+        m_terrain.Draw(view, proj, m_frustum, viewPos, m_fieldTex);
+        if (debugView) m_debugView.EndDepthOnly();
+        glUseProgram(m_program);
+        });
+
+    if (m_grassEnabled) {
+        m_graph.AddPass("grass", DrawsScene, [&] {
+            if (debugView) m_debugView.BeginDepthOnly();
+            m_grass.Draw(view, proj, m_frustum, viewPos, m_time);
+            if (debugView) m_debugView.EndDepthOnly();
+            glUseProgram(m_program);
+            });
+    }
+
+    m_graph.AddPass("static", [&](RenderGraph::Builder& b) {
+        DrawsScene(b);
+        if (gpuDraw) b.Read(visible);
+        }, [&] {
+        DrawStaticInstances();
+        DrawInstance(m_tree);
+        });
+
+    m_graph.AddPass("clouds+balloons", DrawsScene, [&] {
+        m_recordVisible = pipReuse;
+        for (auto& c : m_clouds) DrawInstance(c.inst);
+        for (auto& b : m_balloons) DrawInstance(b.inst);
+        m_recordVisible = false;
+        });
+
+    m_graph.AddPass("birds", DrawsScene, [&] {
+        if (debugView) m_debugView.BeginDepthOnly();
+        m_birds.Draw(view, proj, m_time);
+        if (debugView) m_debugView.EndDepthOnly();
+        glUseProgram(m_program);
+        });
+
+    // With GPU culling packages are culler instances drawn with the statics.
+    if (!gpuDraw) {
+        m_graph.AddPass("packages", DrawsScene, [&] {
+            m_recordVisible = pipReuse;
+            for (auto& p : m_packages) DrawInstance(p.inst);
+            m_recordVisible = false;
+            });
+    }
+
+    m_graph.AddPass("airship", DrawsScene, [&] {
+        m_recordVisible = pipReuse;
+        DrawInstance(m_airship);
+        m_recordVisible = false;
+        });
+
+    if (debugView) {
+        m_graph.AddPass("debug view", [&](RenderGraph::Builder& b) {
+            b.Write(color);
+            b.Read(sceneColor);
+            b.Read(sceneDepth);
+            }, [&] {
+            m_debugView.Resolve(m_graph.Texture(sceneColor), w, h);
+            glUseProgram(m_program);
+            });
+    }
+
+    // After the opaque scene, so only uncovered pixels pay for the sky.
+    if (sky && !debugView) {
+        m_graph.AddPass("sky", [&](RenderGraph::Builder& b) {
+            b.Write(color);
+            b.Read(depth);
+            b.Read(skyLuts);
+            }, [&] {
+            m_sky.Draw(view, proj, viewPos);
+            glUseProgram(m_program);
+            });
+    }
+
+    if (!debugView) {
+        m_graph.AddPass("particles", [&](RenderGraph::Builder& b) {
+            b.Write(color);
+            b.Read(depth);
+            }, [&] {
+            m_particles.Draw(view, proj);
+            glUseProgram(m_program);
+            });
+    }
+
+    // Reads "visible instances": it either replays them or re-culls them for
+    // its own camera, so it also writes them and runs after the main view's
+    // readers.
+    if (pipDue) {
+        m_graph.AddPass("pip", [&](RenderGraph::Builder& b) {
+            b.Write(pipImage);
+            if (m_gpuCulling) {
+                b.Read(visible);
+                b.Write(visible);
+            }
+            if (shadows) b.Read(shadowMaps);
+            if (sky) b.Read(skyLuts);
+            }, [&] {
+            if (m_pip.Begin(w, h)) {
+                RenderPip(pipView, pipProj, pipPos, pipReuse, sky);
+                m_pip.End(pipReuse);
+            }
+            glUseProgram(m_program);
+            glUniformMatrix4fv(m_uView, 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(m_uProj, 1, GL_FALSE, glm::value_ptr(proj));
+            glUniform3fv(m_uViewPos, 1, glm::value_ptr(viewPos));
+            });
+    }
 
-    for (auto& c : m_clouds) DrawInstance(c.inst);
-    for (auto& b : m_balloons) DrawInstance(b.inst);
+    if (m_pip.enabled) {
+        m_graph.AddPass("pip composite", [&](RenderGraph::Builder& b) {
+            b.Write(color);
+            b.Read(pipImage);
+            }, [&] { m_pip.Composite(w, h); });
+    }
 
-    for (auto& p : m_packages) if (p.active) DrawInstance(p.inst);
+    if (m_hud.Ready()) {
+        m_graph.AddPass("hud", [&](RenderGraph::Builder& b) { b.Write(color); }, [&] {
+            m_hud.Draw(w, h);
+            glUseProgram(m_program);
+            });
+    }
 
-    DrawInstance(m_airship);
+    if (m_minimapEnabled && m_minimap.Ready()) {
+        if (m_minimap.DirtyTiles() > 0)
+            m_graph.AddPass("minimap tiles", [&](RenderGraph::Builder& b) { b.Write(minimapTiles); }, [&] { m_minimap.UpdateTiles(); });
+        m_graph.AddPass("minimap", [&](RenderGraph::Builder& b) {
+            b.Write(color);
+            b.Read(minimapTiles);
+            }, [&] {
+            m_minimap.Draw(w, h);
+            glUseProgram(m_program);
+            });
+    }
+
+    RgResource depthCopy = kRgNone;
+    if (gpuDraw && m_gpuCuller.WantsHiZ()) {
+        m_graph.AddPass("hiz", [&](RenderGraph::Builder& b) {
+            depthCopy = b.Create("depth copy", RgTextureDesc{ w, h, GL_DEPTH24_STENCIL8, false });
+            b.Read(depth);
+            b.Write(hiz);
+            }, [&] { m_gpuCuller.BuildHiZ(w, h, viewProj, m_graph.Texture(depthCopy)); });
+    }
+
+    m_graph.Execute();
 
     m_window.display();
+    m_latency.AfterDisplay();
+}
+
+// Draws the secondary camera into the PiP target at its reduced size. With
+// reuse the moving objects come from what the main view recorded and the
+// culler's output is drawn as is (unless Hi-Z shaped it for the main view);
+// otherwise everything is culled again for this camera.
+void Game::RenderPip(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& viewPos, bool reuse, bool sky) {
+    const Frustum mainFrustum = m_frustum;
+    const glm::vec3 mainViewPos = m_viewPos;
+    m_frustum = Frustum::FromViewProj(proj * view);
+    m_viewPos = viewPos;
+
+    glUseProgram(m_program);
+    glUniformMatrix4fv(m_uView, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(m_uProj, 1, GL_FALSE, glm::value_ptr(proj));
+    glUniform3fv(m_uViewPos, 1, glm::value_ptr(viewPos));
+
+    m_terrain.Draw(view, proj, m_frustum, viewPos, m_fieldTex);
+    glUseProgram(m_program);
+
+    if (m_gpuCulling) {
+        if (!reuse || m_gpuCuller.LastCullOccluded())
+            m_gpuCuller.Cull(proj * view, viewPos, false);
+        glUseProgram(m_instancedProgram);
+        glUniformMatrix4fv(m_uInstView, 1, GL_FALSE, glm::value_ptr(view));
+        glUniformMatrix4fv(m_uInstProj, 1, GL_FALSE, glm::value_ptr(proj));
+        glUniform3fv(m_uInstViewPos, 1, glm::value_ptr(viewPos));
+        glUseProgram(m_program);
+    }
+    DrawStaticInstances();
+    DrawInstance(m_tree);
+
+    if (reuse) {
+        for (const VisibleInstance& v : m_pipVisible) {
+            if (!m_frustum.Intersects(v.sphere)) continue;
+            DrawInstanceAt(*v.inst, v.model, v.sphere, SelectLod(*v.inst->model, glm::distance(v.sphere.center, viewPos), v.sphere.radius));
+        }
+    }
+    else {
+        for (auto& c : m_clouds) DrawInstance(c.inst);
+        for (auto& b : m_balloons) DrawInstance(b.inst);
+        if (!m_gpuCulling)
+            for (auto& p : m_packages) DrawInstance(p.inst);
+        DrawInstance(m_airship);
+    }
+
+    if (sky) m_sky.Draw(view, proj, viewPos);
+
+    m_frustum = mainFrustum;
+    m_viewPos = mainViewPos;
 }
 
+// Rests the model on the lowest terrain under its footprint so no corner
+// floats on a slope.
 void Game::SnapToGround(RenderInstance& inst) {
-    if (!inst.model) return;
-    inst.position.y += (-inst.model->minY) * inst.scale.y + 0.01f;
+    if (!inst.model || !inst.model->vao) return;
+    const float ground = m_terrain.MinHeightAround(inst.position.x, inst.position.z, inst.model->boundsRadius * inst.scale.x * 0.5f);
+    inst.position.y = ground + (-inst.model->minY) * inst.scale.y + 0.01f;
+}
+
+void Game::ApplyLightUniforms(unsigned int program) {
+    auto Loc = [&](const char* name) { return glGetUniformLocation(program, name); };
+    glUniform3fv(Loc("u_dirLight.direction"), 1, glm::value_ptr(m_dirLight.direction));
+    glUniform3fv(Loc("u_dirLight.ambient"), 1, glm::value_ptr(m_dirLight.ambient));
+    glUniform3fv(Loc("u_dirLight.diffuse"), 1, glm::value_ptr(m_dirLight.diffuse));
+    glUniform3fv(Loc("u_dirLight.specular"), 1, glm::value_ptr(m_dirLight.specular));
+    glUniform1f(Loc("u_dirLight.intensity"), m_dirLight.intensity);
 }
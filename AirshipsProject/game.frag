@@ -19,21 +19,133 @@ uniform bool u_useNormalMap;
 uniform float u_emissionStrength;
 uniform vec3 u_tint;
 
+// Sun shadow cascades (shadows.h): a cached static layer and a per-frame
+// layer of moving casters, both depth compared in hardware.
+const int kShadowCascades = 3;
+uniform bool u_shadowsEnabled;
+uniform sampler2DArrayShadow u_shadowStatic;
+uniform sampler2DArrayShadow u_shadowDynamic;
+uniform mat4 u_shadowMatrix[kShadowCascades];
+uniform float u_shadowTexel[kShadowCascades];
+
+// Aerial perspective (sky.h): haze between the camera and the surface from
+// a (azimuth from the sun, elevation, sqrt distance) table.
+uniform bool u_skyEnabled;
+uniform sampler3D u_aerialLut;
+uniform vec3 u_sunDir;
+uniform float u_aerialDistance;
+uniform float u_skyExposure;
+
+// Debug views (debug_view.h): 0 shades normally, otherwise the output is
+// (value, 1) for the RG32F debug target.
+uniform int u_debugView;
+uniform float u_debugValue;
+
 in VS_OUT {
     vec2 uv;
     vec3 worldPos;
     vec3 normal;
     mat3 TBN;
+    float ao;
+#ifdef INSTANCED
+    flat vec3 tint;
+    flat float emission;
+    flat float useNormalMap;
+#endif
 } fs_in;
 
 out vec4 FragColor;
 
+float ShadowLayer(sampler2DArrayShadow layer, vec3 coord, float cascade)
+{
+    // Four bilinear compares: a 3x3 texel footprint, softly weighted.
+    vec2 texel = 1.0 / vec2(textureSize(layer, 0).xy);
+    float lit = 0.0;
+    lit += texture(layer, vec4(coord.xy + vec2(-0.5, -0.5) * texel, cascade, coord.z));
+    lit += texture(layer, vec4(coord.xy + vec2( 0.5, -0.5) * texel, cascade, coord.z));
+    lit += texture(layer, vec4(coord.xy + vec2(-0.5,  0.5) * texel, cascade, coord.z));
+    lit += texture(layer, vec4(coord.xy + vec2( 0.5,  0.5) * texel, cascade, coord.z));
+    return lit * 0.25;
+}
+
+float SunVisibility(vec3 worldPos, vec3 N, vec3 L)
+{
+    if (!u_shadowsEnabled)
+        return 1.0;
+
+    // Cascades nest, so the first one containing the point is the sharpest.
+    // The normal offset grows at grazing angles, where acne shows first.
+    float grazing = 1.0 - max(dot(N, L), 0.0);
+    for (int i = 0; i < kShadowCascades; ++i) {
+        vec3 p = worldPos + N * u_shadowTexel[i] * (1.0 + 2.0 * grazing);
+        vec3 coord = (u_shadowMatrix[i] * vec4(p, 1.0)).xyz * 0.5 + 0.5;
+        if (any(lessThan(coord.xy, vec2(0.01))) || any(greaterThan(coord.xy, vec2(0.99))))
+            continue;
+
+        coord.z = min(coord.z, 1.0);
+        float cascade = float(i);
+        return min(ShadowLayer(u_shadowStatic, coord, cascade), ShadowLayer(u_shadowDynamic, coord, cascade));
+    }
+    return 1.0;
+}
+
+vec3 ApplyAerialPerspective(vec3 color, vec3 worldPos)
+{
+    if (!u_skyEnabled)
+        return color;
+
+    vec3 toPoint = worldPos - u_viewPos;
+    float dist = length(toPoint);
+    if (dist < 1e-3)
+        return color;
+    vec3 dir = toPoint / dist;
+
+    const float PI = 3.14159265;
+    vec2 h = dir.xz;
+    vec2 s = u_sunDir.xz;
+    float cosAzimuth = (dot(h, h) > 1e-8 && dot(s, s) > 1e-8) ? dot(normalize(h), normalize(s)) : 1.0;
+    float elevation = asin(clamp(dir.y, -1.0, 1.0));
+    float l = sign(elevation) * sqrt(abs(elevation) / (0.5 * PI));
+
+    vec3 uvw = vec3(acos(clamp(cosAzimuth, -1.0, 1.0)) / PI, 0.5 + 0.5 * l, sqrt(clamp(dist / u_aerialDistance, 0.0, 1.0)));
+    vec4 ap = texture(u_aerialLut, uvw);
+    return color * ap.a + (vec3(1.0) - exp(-ap.rgb * u_skyExposure));
+}
+
+float DebugValue()
+{
+    if (u_debugView == 1)
+        return 1.0;
+    if (u_debugView == 4) {
+        vec2 texels = fs_in.uv * vec2(textureSize(u_diffuse, 0));
+        vec2 dx = dFdx(texels);
+        vec2 dy = dFdy(texels);
+        return max(0.0, 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)));
+    }
+    return u_debugValue;
+}
+
 void main()
 {
-    vec3 albedo = texture(u_diffuse, fs_in.uv).rgb * u_tint;
+    if (u_debugView != 0) {
+        FragColor = vec4(DebugValue(), 1.0, 0.0, 1.0);
+        return;
+    }
+
+#ifdef INSTANCED
+    vec3 tint = fs_in.tint;
+    float emissionStrength = fs_in.emission;
+    bool useNormalMap = fs_in.useNormalMap > 0.5;
+#else
+    vec3 tint = u_tint;
+    float emissionStrength = u_emissionStrength;
+    bool useNormalMap = u_useNormalMap;
+#endif
+
+    vec3 albedo = texture(u_diffuse, fs_in.uv).rgb * tint;
 
     vec3 N = normalize(fs_in.normal);
-    if (u_useNormalMap) {
+    if (useNormalMap) {
         vec3 nTex = texture(u_normalMap, fs_in.uv).rgb;
         nTex = nTex * 2.0 - 1.0;
         N = normalize(fs_in.TBN * nTex);
@@ -42,22 +154,25 @@ void main()
     vec3 V = normalize(u_viewPos - fs_in.worldPos);
     vec3 L = normalize(-u_dirLight.direction);
 
-    float diff = max(dot(N, L), 0.0);
+    float sun = SunVisibility(fs_in.worldPos, normalize(fs_in.normal), L);
+    float diff = max(dot(N, L), 0.0) * sun;
 
     vec3 H = normalize(L + V);
     float specPow = 32.0;
     float spec = pow(max(dot(N, H), 0.0), specPow) * diff * 0.25;
 
-    vec3 ambient = u_dirLight.ambient * albedo;
+    vec3 ambient = u_dirLight.ambient * albedo * fs_in.ao;
     vec3 diffuse = u_dirLight.diffuse * diff * albedo;
     vec3 specular = u_dirLight.specular * spec;
 
     vec3 color = (ambient + diffuse + specular) * u_dirLight.intensity;
 
-    if (u_emissionStrength > 0.0) {
+    if (emissionStrength > 0.0) {
         vec3 lightning = vec3(0.75, 0.85, 1.0);
-        color += lightning * u_emissionStrength;
+        color += lightning * emissionStrength;
     }
 
+    color = ApplyAerialPerspective(color, fs_in.worldPos);
+
     FragColor = vec4(color, 1.0);
 }
@@ -1,13 +1,38 @@
-#pragma once
+﻿#pragma once
 
 #include <SFML/Graphics.hpp>
 #include <glm/glm.hpp>
 
+#include <cstdint>
+#include <memory>
 #include <random>
 #include <string>
 #include <vector>
 
+#include "ao_bake.h"
+#include "asset_tasks.h"
+#include "boids.h"
+#include "broadphase.h"
+#include "culling.h"
+#include "debug_view.h"
+#include "gpu_culling.h"
+#include "grass.h"
+#include "hud.h"
+#include "job_pool.h"
+#include "latency.h"
+#include "minimap.h"
 #include "model.h"
+#include "particles.h"
+#include "physics.h"
+#include "pip_view.h"
+#include "render_graph.h"
+#include "shadows.h"
+#include "sim_scheduler.h"
+#include "sky.h"
+#include "static_batch.h"
+#include "terrain.h"
+#include "upload_thread.h"
+#include "wind.h"
 
 struct DirectionalLight {
     glm::vec3 direction{ -0.25f, -1.0f, -0.35f };
@@ -29,6 +54,9 @@ struct RenderInstance {
 
     bool useNormalMap{ false };
     glm::vec3 tint{ 1.0f, 1.0f, 1.0f };
+
+    int gpuHandle{ -1 };
+    int aoBase{ -1 };
 };
 
 struct TargetHouse {
@@ -43,18 +71,33 @@ struct Cloud {
     float phase{ 0.0f };
     float speed{ 0.35f };
     float amplitude{ 5.0f };
+    int emitter{ -1 };
+
+    // Last scheduled result; inst.position extrapolates from it.
+    glm::vec3 simPosition{ 0.0f };
+    glm::vec3 velocity{ 0.0f };
 };
 
 struct Balloon {
     RenderInstance inst;
     glm::vec3 basePosition{ 0.0f };
+    glm::vec3 drift{ 0.0f };
     float phase{ 0.0f };
+
+    glm::vec3 simPosition{ 0.0f };
+    glm::vec3 velocity{ 0.0f };
 };
 
 struct Package {
     RenderInstance inst;
-    glm::vec3 velocity{ 0.0f };
-    bool active{ false };
+    int body{ -1 };
+};
+
+// What the main view drew, kept for a second camera to reuse.
+struct VisibleInstance {
+    const RenderInstance* inst = nullptr;
+    glm::mat4 model{ 1.0f };
+    BoundingSphere sphere{};
 };
 
 class Game {
@@ -67,27 +110,65 @@ private:
     void LoadAll();
     void CreateProceduralMeshes();
     void GenerateScene();
+    void StreamTexture(const std::string& path, unsigned int& target);
+    Task<void> LoadModelTask(std::string path, Model& model);
+    Task<void> StreamTextureTask(std::string path, unsigned int& target);
+    AssetContext Assets();
+    void OnModelReady(Model& model);
+    void OnModelRefined(Model& model);
 
     void HandleEvents();
     void Update(float dt);
     void Render();
 
-    void SpawnPackage();
+    void SpawnPackage(const glm::vec3& position, const glm::vec3& velocity);
+    void DropPackageBurst(int count);
     void ResolvePackageCollisions();
 
-    void UpdateCamera(glm::mat4& outView, glm::vec3& outViewPos);
+    void RegisterSimSystems();
+    void UpdateCloud(Cloud& c, float dt);
+    void UpdateBalloon(Balloon& b, float dt);
+    void PrintSimStats() const;
+
+    void UpdateCamera(bool aim, glm::mat4& outView, glm::vec3& outViewPos);
     glm::mat4 MakeModelMatrix(const RenderInstance& inst) const;
+    GpuInstance MakeGpuInstance(const RenderInstance& inst) const;
     void DrawInstance(const RenderInstance& inst);
+    void DrawInstanceAt(const RenderInstance& inst, const glm::mat4& modelM, const BoundingSphere& sphere, int lod);
+    void DrawStaticInstances();
+    void DrawStaticBatches();
+    void RenderShadows(const glm::mat4& view, float aspect);
+    void RenderPip(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& viewPos, bool reuse, bool sky);
+    StaticBatchSource MakeStaticBatchSource(const RenderInstance& inst, int tag) const;
+    void GatherStaticBatchSources(std::vector<StaticBatchSource>& out) const;
+    void RebuildStaticBatches();
+    void RebuildStaticBatchCells();
+    void BuildParticleEmitters();
+    void ResetBirds();
+    void GatherBirdAnchors(std::vector<glm::vec3>& out) const;
+    RenderInstance* StaticInstanceByTag(int tag);
+    void StartAoBake();
+    void ApplyAo(std::shared_ptr<AoBakeResult> ao);
 
     unsigned int Create1x1TextureRGBA(unsigned char r, unsigned char g, unsigned char b, unsigned char a);
     void EnsureTextures(Model& model, unsigned int fallbackTex);
     void SnapToGround(RenderInstance& inst);
+    void ApplyLightUniforms(unsigned int program);
 
 private:
     sf::RenderWindow& m_window;
     std::mt19937 m_rng{ std::random_device{}() };
+    std::uint64_t m_sceneSeed{ 0 };
+
+    UploadThread m_uploader;
+    AsyncExecutor m_assets;
+    CancelToken m_loadCancel;
+    LoadProgress m_loadProgress;
+    int m_loadShown{ 0 };
+    bool m_loadReported{ false };
 
     unsigned int m_program{ 0 };
+    unsigned int m_instancedProgram{ 0 };
 
     int m_uModel{ -1 }, m_uView{ -1 }, m_uProj{ -1 }, m_uNormalMatrix{ -1 };
     int m_uViewPos{ -1 }, m_uTime{ -1 };
@@ -95,24 +176,106 @@ private:
     int m_uDirDir{ -1 }, m_uDirAmbient{ -1 }, m_uDirDiffuse{ -1 }, m_uDirSpecular{ -1 }, m_uDirIntensity{ -1 };
 
     int m_uDiffuseSampler{ -1 }, m_uNormalSampler{ -1 }, m_uUseNormalMap{ -1 };
-    int m_uSwayStrength{ -1 }, m_uEmissionStrength{ -1 }, m_uTint{ -1 };
+    int m_uSwayStrength{ -1 }, m_uEmissionStrength{ -1 }, m_uTint{ -1 }, m_uWind{ -1 };
+    int m_uAoBase{ -1 }, m_uStaticBatch{ -1 };
+    int m_uDebugView{ -1 }, m_uDebugValue{ -1 };
+
+    int m_uInstView{ -1 }, m_uInstProj{ -1 }, m_uInstViewPos{ -1 }, m_uInstTime{ -1 }, m_uInstWind{ -1 };
+
+    GpuCuller m_gpuCuller;
+    bool m_gpuCulling{ false };
+
+    StaticBatcher m_staticBatcher;
+    bool m_staticBatching{ false };
+    bool m_staticBatchesDirty{ false };
+    // Houses delivered since the last publish; only their cells rebuild.
+    std::vector<int> m_staticBatchChanges;
+
+    AoBaker m_aoBaker;
+    std::shared_ptr<AoBakeResult> m_ao;
+    unsigned int m_aoBuffer{ 0 };
+    unsigned int m_aoTexture{ 0 };
+    bool m_aoPending{ false };
+
+    ShadowCascades m_shadows;
+    std::vector<ShadowCaster> m_shadowCasters;
+    bool m_shadowsEnabled{ true };
+
+    Sky m_sky;
+    bool m_skyEnabled{ true };
+
+    RenderGraph m_graph;
+    LatencyMonitor m_latency;
+    unsigned int m_steeringHeld{ 0 };
+
+    GrassField m_grass;
+    Terrain m_terrain;
+    JobPool m_jobs;
+    WindField m_wind;
+    glm::vec3 m_groundWind{ 0.0f };
+    bool m_grassEnabled{ true };
+
+    BirdFlocks m_birds;
+    int m_birdCount{ 3000 };
+    std::vector<glm::vec3> m_birdAnchors;
+    std::vector<glm::vec4> m_birdObstacles;
+
+    ParticleSystem m_particles;
+    int m_airshipEmitter{ -1 };
+    bool m_rain{ true };
+
+    // The HUD only re-tessellates when one of the shown numbers changes.
+    HudRenderer m_hud;
+    int m_hudDelivered{ -1 }, m_hudPackages{ -1 }, m_hudSpeed{ -1 };
+    int m_hudDeliveredText{ -1 }, m_hudPackagesText{ -1 }, m_hudSpeedText{ -1 };
+    float m_airshipGroundSpeed{ 0.0f };
+
+    // While a debug view is on, every game.frag draw goes through
+    // DrawInstance so it can carry its LOD and triangle density.
+    DebugView m_debugView;
+    float m_pixelsPerUnit{ 0.0f };
+    int m_hudDebugText{ -1 };
+
+    // Feature i is house i; decorations follow the houses.
+    Minimap m_minimap;
+    bool m_minimapEnabled{ true };
+
+    Frustum m_frustum{};
+    glm::vec3 m_viewPos{ 0.0f };
 
     unsigned int m_whiteTex{ 0 };
+    unsigned int m_fieldTex{ 0 };
     unsigned int m_defaultNormalTex{ 0 };
     unsigned int m_airshipNormalTex{ 0 };
 
     DirectionalLight m_dirLight{};
 
     Model m_airshipModel, m_treeModel, m_houseModel, m_decor1Model, m_decor2Model, m_cloudModel, m_balloonModel;
-    Model m_fieldModel, m_packageModel;
+    Model m_packageModel;
 
-    RenderInstance m_airship, m_tree, m_field;
+    RenderInstance m_airship, m_tree;
 
     std::vector<TargetHouse> m_houses;
     std::vector<RenderInstance> m_decorations;
     std::vector<Cloud> m_clouds;
     std::vector<Balloon> m_balloons;
     std::vector<Package> m_packages;
+    size_t m_nextRecycle{ 0 };
+    int m_maxPackages{ 50000 };
+    float m_packageHalfSize{ 0.35f };
+
+    SimScheduler m_scheduler;
+    int m_simClouds{ -1 };
+    int m_simBalloons{ -1 };
+    int m_simPackageSync{ -1 };
+
+    SpatialHashGrid m_broadphase;
+    RigidBodyWorld m_physics;
+
+    // Trail emitters follow the most recently dropped packages.
+    std::vector<int> m_trailEmitters;
+    std::vector<int> m_trailOwners;
+    size_t m_nextTrail{ 0 };
 
     float m_time{ 0.0f };
 
@@ -131,6 +294,12 @@ private:
 
     bool m_aimMode{ false };
 
+    // Shows the camera m_aimMode isn't using. On frames it refreshes, the
+    // moving objects the main view drew are recorded for it to reuse.
+    PipView m_pip;
+    bool m_recordVisible{ false };
+    std::vector<VisibleInstance> m_pipVisible;
+
     float m_airshipYawModelOffsetDeg{ 180.0f };
     float m_airshipRollDeg{ 0.0f };
 };
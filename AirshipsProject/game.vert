@@ -6,6 +6,16 @@ layout(location = 2) in vec3 aNormal;
 layout(location = 3) in vec3 aTangent;
 layout(location = 4) in vec3 aBitangent;
 
+#ifdef INSTANCED
+layout(location = 5) in mat4 aInstanceModel;
+layout(location = 9) in vec4 aInstanceParams;
+layout(location = 10) in vec4 aInstanceTint;
+#else
+// Static batches are pre-transformed, so sway reads the object-space
+// height and instance scale from here instead (see static_batch.h).
+layout(location = 11) in vec2 aBatchSway;
+#endif
+
 uniform mat4 u_model;
 uniform mat4 u_view;
 uniform mat4 u_projection;
@@ -13,33 +23,75 @@ uniform mat3 u_normalMatrix;
 
 uniform float u_time;
 uniform float u_swayStrength;
+uniform bool u_staticBatch;
+uniform vec3 u_wind;
+
+// Baked per-vertex AO; a negative base means the draw has none.
+uniform samplerBuffer u_aoBuffer;
+uniform int u_aoBase;
 
 out VS_OUT {
     vec2 uv;
     vec3 worldPos;
     vec3 normal;
     mat3 TBN;
+    float ao;
+#ifdef INSTANCED
+    flat vec3 tint;
+    flat float emission;
+    flat float useNormalMap;
+#endif
 } vs_out;
 
 void main()
 {
+#ifdef INSTANCED
+    mat4 model = aInstanceModel;
+    mat3 normalMatrix = transpose(inverse(mat3(aInstanceModel)));
+    float swayStrength = aInstanceParams.x;
+    int aoBase = floatBitsToInt(aInstanceParams.w);
+
+    vs_out.tint = aInstanceTint.rgb;
+    vs_out.emission = aInstanceParams.y;
+    vs_out.useNormalMap = aInstanceParams.z;
+#else
+    mat4 model = u_model;
+    mat3 normalMatrix = u_normalMatrix;
+    float swayStrength = u_swayStrength;
+    int aoBase = u_aoBase;
+#endif
+
+    vs_out.ao = (aoBase >= 0) ? texelFetch(u_aoBuffer, aoBase + gl_VertexID).r : 1.0;
+
     vec3 pos = aPos;
+    float swayY = aPos.y;
+    float swayScale = 1.0;
+#ifndef INSTANCED
+    if (u_staticBatch)
+    {
+        swayY = aBatchSway.x;
+        swayScale = aBatchSway.y;
+    }
+#endif
 
-    if (u_swayStrength > 0.0001)
+    float weight = clamp(abs(swayY), 0.0, 1.0);
+    if (swayStrength > 0.0001)
     {
-        float weight = clamp(abs(aPos.y), 0.0, 1.0);
-        float s1 = sin(u_time * 1.6 + aPos.y * 2.2);
-        float s2 = cos(u_time * 1.2 + aPos.y * 1.7);
-        pos.x += s1 * u_swayStrength * weight;
-        pos.z += s2 * u_swayStrength * 0.7 * weight;
+        float gust = 1.0 + length(u_wind.xz) * 0.15;
+        float s1 = sin(u_time * 1.6 + swayY * 2.2);
+        float s2 = cos(u_time * 1.2 + swayY * 1.7);
+        pos.x += s1 * swayStrength * gust * weight * swayScale;
+        pos.z += s2 * swayStrength * 0.7 * gust * weight * swayScale;
     }
 
-    vec4 world = u_model * vec4(pos, 1.0);
+    vec4 world = model * vec4(pos, 1.0);
+    // Lean downwind in world space; the flutter above stays in model space.
+    world.xz += u_wind.xz * (swayStrength * 0.5 * weight);
     vs_out.worldPos = world.xyz;
     vs_out.uv = aUV;
 
-    vec3 N = normalize(u_normalMatrix * aNormal);
-    vec3 T = normalize(u_normalMatrix * aTangent);
+    vec3 N = normalize(normalMatrix * aNormal);
+    vec3 T = normalize(normalMatrix * aTangent);
 
     T = normalize(T - N * dot(N, T));
     vec3 B = normalize(cross(N, T));
@@ -0,0 +1,179 @@
+#include "gl_debug.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct MessageKey {
+    GLenum source;
+    GLenum type;
+    GLuint id;
+    std::string group;
+
+    bool operator<(const MessageKey& o) const {
+        return std::tie(source, type, id, group) < std::tie(o.source, o.type, o.id, o.group);
+    }
+};
+
+struct MessageStats {
+    std::string text;
+    unsigned long long count{ 0 };
+    unsigned long long firstFrame{ 0 };
+    unsigned long long lastFrame{ 0 };
+    double firstTime{ 0.0 };
+};
+
+struct DebugState {
+    std::mutex mutex;
+    bool active{ false };
+    std::map<MessageKey, MessageStats> messages;
+    std::vector<const char*> groups;
+    unsigned long long frame{ 0 };
+    Clock::time_point start{ Clock::now() };
+};
+
+// The upload context's callback can still fire after ShutdownGlDebug, so
+// it checks active rather than the state going away.
+DebugState g_state;
+
+const char* TypeName(GLenum type) {
+    switch (type) {
+    case GL_DEBUG_TYPE_PERFORMANCE: return "perf";
+    case GL_DEBUG_TYPE_ERROR: return "error";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined";
+    default: return "other";
+    }
+}
+
+std::string GroupPath(const std::vector<const char*>& groups) {
+    std::string path;
+    for (const char* g : groups) {
+        if (!path.empty()) path += '/';
+        path += g;
+    }
+    return path.empty() ? "-" : path;
+}
+
+// Synchronous output runs this inside the offending call, so the group
+// stack is the one the call was made under. Other contexts pass their name
+// instead; groups are only pushed on the render thread.
+void GLAPIENTRY OnDebugMessage(GLenum source, GLenum type, GLuint id, GLenum, GLsizei length, const GLchar* message, const void* user) {
+    DebugState& s = g_state;
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (!s.active) return;
+
+    MessageKey key{ source, type, id, user ? static_cast<const char*>(user) : GroupPath(s.groups) };
+    MessageStats& stats = s.messages[key];
+    if (stats.count++ > 0) {
+        stats.lastFrame = s.frame;
+        return;
+    }
+
+    stats.text.assign(message, length >= 0 ? static_cast<size_t>(length) : std::strlen(message));
+    stats.firstFrame = stats.lastFrame = s.frame;
+    stats.firstTime = std::chrono::duration<double>(Clock::now() - s.start).count();
+    std::printf("[gl %s] frame %llu, %.2f s, %s: %s\n", TypeName(type), s.frame, stats.firstTime, key.group.c_str(), stats.text.c_str());
+}
+
+// Only what points at a slow or broken path; notifications and our own
+// group markers stay off.
+void EnableOutput(const void* user) {
+    glEnable(GL_DEBUG_OUTPUT);
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    glDebugMessageCallback(OnDebugMessage, user);
+
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+    for (GLenum type : { GL_DEBUG_TYPE_PERFORMANCE, GL_DEBUG_TYPE_ERROR, GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR })
+        glDebugMessageControl(GL_DONT_CARE, type, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+}
+
+}
+
+bool GlDebugRequested(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i)
+        if (std::strcmp(argv[i], "--gl-debug") == 0) return true;
+    const char* env = std::getenv("AIRSHIP_GL_DEBUG");
+    return env && std::strcmp(env, "0") != 0;
+}
+
+bool InitGlDebug() {
+    if (!GLEW_KHR_debug && !GLEW_VERSION_4_3) {
+        std::cerr << "GL debug: KHR_debug not available\n";
+        return false;
+    }
+
+    GLint flags = 0;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    if (!(flags & GL_CONTEXT_FLAG_DEBUG_BIT))
+        std::cout << "GL debug: no debug context, the driver may report less\n";
+
+    {
+        std::lock_guard<std::mutex> lock(g_state.mutex);
+        g_state.active = true;
+        g_state.start = Clock::now();
+    }
+    EnableOutput(nullptr);
+
+    g_glDebugEnabled = true;
+    std::cout << "GL debug: capturing performance warnings and errors\n";
+    return true;
+}
+
+void ShutdownGlDebug() {
+    if (!g_glDebugEnabled) return;
+
+    glDebugMessageCallback(nullptr, nullptr);
+    glDisable(GL_DEBUG_OUTPUT);
+    g_glDebugEnabled = false;
+
+    std::lock_guard<std::mutex> lock(g_state.mutex);
+    g_state.active = false;
+
+    std::vector<std::pair<MessageKey, MessageStats>> sorted(g_state.messages.begin(), g_state.messages.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second.count > b.second.count; });
+
+    std::printf("GL debug: %zu distinct messages over %llu frames\n", sorted.size(), g_state.frame);
+    for (const auto& [key, stats] : sorted) {
+        std::printf("  %8llu x [%s] frames %llu-%llu, %s: %s\n", stats.count, TypeName(key.type),
+            stats.firstFrame, stats.lastFrame, key.group.c_str(), stats.text.c_str());
+    }
+}
+
+void AttachGlDebugContext(const char* name) {
+    if (g_glDebugEnabled) EnableOutput(name);
+}
+
+void GlDebugNextFrame() {
+    if (!g_glDebugEnabled) return;
+    std::lock_guard<std::mutex> lock(g_state.mutex);
+    g_state.frame++;
+}
+
+void LabelGlObject(GLenum identifier, GLuint name, const std::string& label) {
+    if (!g_glDebugEnabled || !name) return;
+    glObjectLabel(identifier, name, static_cast<GLsizei>(label.size()), label.c_str());
+}
+
+void GlDebugGroup::Push(const char* name) {
+    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+    std::lock_guard<std::mutex> lock(g_state.mutex);
+    g_state.groups.push_back(name);
+    m_pushed = true;
+}
+
+void GlDebugGroup::Pop() {
+    glPopDebugGroup();
+    std::lock_guard<std::mutex> lock(g_state.mutex);
+    if (!g_state.groups.empty()) g_state.groups.pop_back();
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <string>
+
+// Driver message capture through KHR_debug, opted into with --gl-debug or
+// AIRSHIP_GL_DEBUG=1 (main.cpp then asks for a debug context). Performance
+// warnings, errors and undefined-behaviour reports are logged once each
+// with the frame, time and the debug-group path they were raised under,
+// repeats are only counted, and ShutdownGlDebug prints the totals.
+//
+// When off, groups and labels are a single branch on g_glDebugEnabled and
+// the driver runs without debug output.
+inline bool g_glDebugEnabled = false;
+
+bool GlDebugRequested(int argc, char** argv);
+// Needs the context current and GLEW initialized.
+bool InitGlDebug();
+void ShutdownGlDebug();
+// For other shared contexts (the upload thread); their messages are
+// grouped under the given name.
+void AttachGlDebugContext(const char* name);
+
+void GlDebugNextFrame();
+void LabelGlObject(GLenum identifier, GLuint name, const std::string& label);
+
+// glPushDebugGroup for the lifetime of the scope; the name must outlive it
+// (string literals).
+class GlDebugGroup {
+public:
+    explicit GlDebugGroup(const char* name) {
+        if (g_glDebugEnabled) Push(name);
+    }
+    ~GlDebugGroup() {
+        if (m_pushed) Pop();
+    }
+
+    GlDebugGroup(const GlDebugGroup&) = delete;
+    GlDebugGroup& operator=(const GlDebugGroup&) = delete;
+
+private:
+    void Push(const char* name);
+    void Pop();
+
+    bool m_pushed{ false };
+};
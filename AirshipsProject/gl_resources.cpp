@@ -0,0 +1,166 @@
+#include "gl_resources.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+bool g_dsa = false;
+
+GLsizei MipCount(GLsizei width, GLsizei height) {
+    GLsizei levels = 1;
+    for (GLsizei size = std::max(width, height); size > 1; size >>= 1) ++levels;
+    return levels;
+}
+
+// Client format and type for an uninitialised glTexImage2D; the 3.3 path
+// has no glTexStorage2D (4.2).
+void ClientFormat(GLenum internalFormat, GLenum& format, GLenum& type) {
+    switch (internalFormat) {
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+        format = GL_DEPTH_COMPONENT; type = GL_UNSIGNED_INT; return;
+    case GL_DEPTH_COMPONENT32F:
+        format = GL_DEPTH_COMPONENT; type = GL_FLOAT; return;
+    case GL_DEPTH24_STENCIL8:
+        format = GL_DEPTH_STENCIL; type = GL_UNSIGNED_INT_24_8; return;
+    case GL_DEPTH32F_STENCIL8:
+        format = GL_DEPTH_STENCIL; type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV; return;
+    case GL_R8:
+        format = GL_RED; type = GL_UNSIGNED_BYTE; return;
+    case GL_R16F:
+    case GL_R32F:
+        format = GL_RED; type = GL_FLOAT; return;
+    case GL_RG8:
+        format = GL_RG; type = GL_UNSIGNED_BYTE; return;
+    case GL_RG16F:
+    case GL_RG32F:
+        format = GL_RG; type = GL_FLOAT; return;
+    case GL_RGBA16F:
+    case GL_RGBA32F:
+        format = GL_RGBA; type = GL_FLOAT; return;
+    default:
+        format = GL_RGBA; type = GL_UNSIGNED_BYTE; return;
+    }
+}
+
+}
+
+void SelectGlBackend() {
+    const char* off = std::getenv("AIRSHIP_GL_NO_DSA");
+    g_dsa = GLEW_VERSION_4_5 && !(off && std::strcmp(off, "0") != 0);
+    std::cout << "GL resources: " << (g_dsa ? "direct state access, immutable storage (4.5)" : "bind-to-edit (3.3)") << "\n";
+}
+
+bool UsingDsa() {
+    return g_dsa;
+}
+
+GLuint CreateStaticBuffer(GLsizeiptr size, const void* data) {
+    GLuint buffer = 0;
+    if (g_dsa) {
+        // Zero-sized immutable storage is an error; keep a placeholder byte.
+        glCreateBuffers(1, &buffer);
+        glNamedBufferStorage(buffer, std::max<GLsizeiptr>(size, 1), size > 0 ? data : nullptr, 0);
+        return buffer;
+    }
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return buffer;
+}
+
+GLuint CreateTexture2D(GLenum internalFormat, const TextureLevel* levels, int levelCount, bool generateMips) {
+    if (levelCount <= 0) return 0;
+
+    const bool mipmapped = generateMips || levelCount > 1;
+    const GLint minFilter = mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+    GLuint tex = 0;
+
+    if (g_dsa) {
+        const GLsizei storageLevels = generateMips ? MipCount(levels[0].width, levels[0].height) : levelCount;
+        glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+        glTextureStorage2D(tex, storageLevels, internalFormat, levels[0].width, levels[0].height);
+
+        for (int i = 0; i < levelCount; ++i) {
+            const TextureLevel& l = levels[i];
+            if (l.compressedSize > 0)
+                glCompressedTextureSubImage2D(tex, i, 0, 0, l.width, l.height, internalFormat, l.compressedSize, l.data);
+            else
+                glTextureSubImage2D(tex, i, 0, 0, l.width, l.height, GL_RGBA, GL_UNSIGNED_BYTE, l.data);
+        }
+        if (generateMips) glGenerateTextureMipmap(tex);
+
+        glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, minFilter);
+        glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(tex, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTextureParameteri(tex, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        return tex;
+    }
+
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+
+    for (int i = 0; i < levelCount; ++i) {
+        const TextureLevel& l = levels[i];
+        if (l.compressedSize > 0)
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, internalFormat, l.width, l.height, 0, l.compressedSize, l.data);
+        else
+            glTexImage2D(GL_TEXTURE_2D, i, internalFormat, l.width, l.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, l.data);
+    }
+    if (generateMips)
+        glGenerateMipmap(GL_TEXTURE_2D);
+    else
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    return tex;
+}
+
+GLuint CreateRenderTexture(GLenum internalFormat, GLsizei width, GLsizei height) {
+    GLuint tex = 0;
+    if (g_dsa) {
+        glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+        glTextureStorage2D(tex, 1, internalFormat, width, height);
+        glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTextureParameteri(tex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(tex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return tex;
+    }
+
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    GLenum format, type;
+    ClientFormat(internalFormat, format, type);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return tex;
+}
+
+GLuint CreateBufferTexture(GLenum internalFormat, GLuint buffer) {
+    GLuint tex = 0;
+    if (g_dsa) {
+        glCreateTextures(GL_TEXTURE_BUFFER, 1, &tex);
+        glTextureBuffer(tex, internalFormat, buffer);
+        return tex;
+    }
+
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_BUFFER, tex);
+    glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    return tex;
+}
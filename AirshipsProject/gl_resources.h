@@ -0,0 +1,34 @@
+#pragma once
+#include <GL/glew.h>
+
+// Creation of buffers, textures and vertex arrays. On GL 4.5 objects are
+// edited by name (direct state access) into immutable storage, so creating
+// one, on the render thread or the upload context, leaves every binding
+// alone. On 3.3 the bind-to-edit calls are kept: buffers go through
+// GL_ARRAY_BUFFER (no VAO needed) and textures through the active unit.
+//
+// SelectGlBackend picks once, after glewInit; AIRSHIP_GL_NO_DSA=1 forces
+// the 3.3 path on a 4.5 driver for comparison.
+void SelectGlBackend();
+bool UsingDsa();
+
+struct TextureLevel {
+    GLsizei width = 0;
+    GLsizei height = 0;
+    const void* data = nullptr;
+    GLsizei compressedSize = 0; // 0 for uncompressed RGBA8 pixels
+};
+
+// Contents are fixed at creation; with DSA the storage is immutable, so
+// the buffer must be recreated rather than re-specified.
+GLuint CreateStaticBuffer(GLsizeiptr size, const void* data);
+
+// internalFormat is GL_RGBA8 or a compressed format matching the levels.
+// With generateMips only levels[0] is given and the chain is built on the
+// GPU. Sampling is trilinear when mipmapped, linear otherwise, and repeats.
+GLuint CreateTexture2D(GLenum internalFormat, const TextureLevel* levels, int levelCount, bool generateMips);
+
+// Single-level render target (color or depth), nearest sampling, clamped.
+GLuint CreateRenderTexture(GLenum internalFormat, GLsizei width, GLsizei height);
+
+GLuint CreateBufferTexture(GLenum internalFormat, GLuint buffer);
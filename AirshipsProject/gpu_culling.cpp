@@ -0,0 +1,386 @@
+#include "gpu_culling.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+#include "culling.h"
+#include "shader_utils.h"
+
+static const GLuint kHiZTextureUnit = 7;
+
+// A depth blit needs identical formats on both sides. Compared through
+// attachment queries rather than glGetError, which would have to drain
+// every earlier error and stalls some drivers.
+static bool DepthBlitCompatible() {
+    GLint src[3] = {}, dst[3] = {};
+    glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, GL_DEPTH, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &src[0]);
+    glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, GL_STENCIL, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &src[1]);
+    glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, GL_DEPTH, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &src[2]);
+    glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &dst[0]);
+    glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &dst[1]);
+    glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &dst[2]);
+    return src[0] == dst[0] && src[1] == dst[1] && src[2] == dst[2];
+}
+
+GpuCuller::~GpuCuller() {
+    Shutdown();
+}
+
+bool GpuCuller::Initialize() {
+    if (!GLEW_VERSION_4_3) {
+        std::cout << "GPU culling: GL 4.3 not available, using CPU culling\n";
+        return false;
+    }
+
+    m_cullProgram = CreateComputeProgramFromFile("cull.comp");
+    m_finalizeProgram = CreateComputeProgramFromFile("cull.comp", "#define FINALIZE");
+    m_hizCopyProgram = CreateComputeProgramFromFile("hiz.comp", "#define HIZ_COPY");
+    m_hizReduceProgram = CreateComputeProgramFromFile("hiz.comp");
+
+    if (!m_cullProgram || !m_finalizeProgram || !m_hizCopyProgram || !m_hizReduceProgram) {
+        std::cerr << "GPU culling: compute shaders failed, using CPU culling\n";
+        Shutdown();
+        return false;
+    }
+
+    m_uInstanceCount = glGetUniformLocation(m_cullProgram, "u_instanceCount");
+    m_uPlanes = glGetUniformLocation(m_cullProgram, "u_planes");
+    m_uViewPos = glGetUniformLocation(m_cullProgram, "u_viewPos");
+    m_uUseHiZ = glGetUniformLocation(m_cullProgram, "u_useHiZ");
+    m_uPrevViewProj = glGetUniformLocation(m_cullProgram, "u_prevViewProj");
+    m_uHiZ = glGetUniformLocation(m_cullProgram, "u_hiz");
+    m_uHiZMips = glGetUniformLocation(m_cullProgram, "u_hizMips");
+    m_uCommandCount = glGetUniformLocation(m_finalizeProgram, "u_commandCount");
+
+    GLuint* buffers[] = { &m_instanceBuffer, &m_groupBuffer, &m_outBuffer,
+        &m_counterBuffer, &m_commandBuffer, &m_commandCounterBuffer };
+    for (GLuint* b : buffers) glGenBuffers(1, b);
+
+    std::cout << "GPU culling enabled (compute + multi-draw indirect)\n";
+    return true;
+}
+
+void GpuCuller::Shutdown() {
+    GLuint* programs[] = { &m_cullProgram, &m_finalizeProgram, &m_hizCopyProgram, &m_hizReduceProgram };
+    for (GLuint* p : programs) {
+        if (*p) glDeleteProgram(*p);
+        *p = 0;
+    }
+
+    GLuint* buffers[] = { &m_instanceBuffer, &m_groupBuffer, &m_outBuffer,
+        &m_counterBuffer, &m_commandBuffer, &m_commandCounterBuffer };
+    for (GLuint* b : buffers) {
+        if (*b) glDeleteBuffers(1, b);
+        *b = 0;
+    }
+
+    DestroyHiZ();
+    m_groups.clear();
+    m_instances.clear();
+    m_uploadedInstances = m_instanceCapacity = m_outCapacity = 0;
+}
+
+void GpuCuller::Clear() {
+    m_groups.clear();
+    m_instances.clear();
+    m_uploadedInstances = 0;
+    m_layoutDirty = true;
+}
+
+int GpuCuller::FindOrAddGroup(Model& model) {
+    for (size_t i = 0; i < m_groups.size(); ++i) {
+        if (m_groups[i].model == &model) return static_cast<int>(i);
+    }
+
+    Group g;
+    g.model = &model;
+    g.lodCount = static_cast<unsigned int>(std::min<size_t>(model.lods.size() + 1, kMaxLods));
+    g.subMeshCount = static_cast<unsigned int>(model.subMeshes.size());
+    m_groups.push_back(g);
+    return static_cast<int>(m_groups.size()) - 1;
+}
+
+int GpuCuller::AddInstance(Model& model, const GpuInstance& data) {
+    int group = FindOrAddGroup(model);
+    m_groups[group].instanceCount++;
+
+    GpuInstance inst = data;
+    inst.meta.x = static_cast<unsigned int>(group);
+    m_instances.push_back(inst);
+
+    m_layoutDirty = true;
+    return static_cast<int>(m_instances.size()) - 1;
+}
+
+void GpuCuller::RefreshModel(Model& model) {
+    for (Group& g : m_groups) {
+        if (g.model != &model) continue;
+        g.lodCount = static_cast<unsigned int>(std::min<size_t>(model.lods.size() + 1, kMaxLods));
+        g.subMeshCount = static_cast<unsigned int>(model.subMeshes.size());
+        m_layoutDirty = true;
+    }
+}
+
+void GpuCuller::UpdateInstance(int handle, const GpuInstance& data) {
+    if (handle < 0 || handle >= static_cast<int>(m_instances.size())) return;
+
+    GpuInstance& inst = m_instances[handle];
+    unsigned int group = inst.meta.x;
+    inst = data;
+    inst.meta.x = group;
+
+    // Not on the GPU yet; the next rebuild uploads it with the rest.
+    if (static_cast<size_t>(handle) >= m_uploadedInstances) return;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, handle * sizeof(GpuInstance), sizeof(GpuInstance), &inst);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuCuller::RebuildLayout() {
+    std::vector<GroupGpu> groupData;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<GLuint> commandCounters;
+
+    unsigned int outBase = 0;
+    unsigned int counterBase = 0;
+
+    for (Group& g : m_groups) {
+        GroupGpu gd{};
+        gd.info = glm::uvec4(g.lodCount, outBase, g.instanceCount, counterBase);
+        for (unsigned int l = 0; l + 1 < g.lodCount; ++l)
+            gd.lodFactors[l] = g.model->lods[l].distanceFactor;
+        groupData.push_back(gd);
+
+        // Commands are grouped per submesh so each texture is one
+        // multi-draw covering every LOD of that submesh.
+        g.firstCommand = static_cast<unsigned int>(commands.size());
+        for (unsigned int s = 0; s < g.subMeshCount; ++s) {
+            for (unsigned int l = 0; l < g.lodCount; ++l) {
+                const SubMesh& sm = GetLodSubMeshes(*g.model, static_cast<int>(l))[s];
+                commands.push_back({ sm.indexCount, 0, sm.indexOffset, 0, outBase + l * g.instanceCount });
+                commandCounters.push_back(counterBase + l);
+            }
+        }
+
+        outBase += g.lodCount * g.instanceCount;
+        counterBase += g.lodCount;
+    }
+
+    m_commandCount = static_cast<unsigned int>(commands.size());
+    m_counterCount = counterBase;
+
+    auto Upload = [](GLuint buffer, GLsizeiptr size, const void* data) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<GLsizeiptr>(size, 16), data, GL_DYNAMIC_DRAW);
+        };
+
+    auto Grow = [](size_t& capacity, size_t needed) {
+        if (needed <= capacity) return false;
+        capacity = std::max<size_t>({ needed, capacity * 2, 256 });
+        return true;
+        };
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+    if (Grow(m_instanceCapacity, m_instances.size())) {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, m_instanceCapacity * sizeof(GpuInstance), nullptr, GL_DYNAMIC_DRAW);
+        m_uploadedInstances = 0;
+    }
+    if (m_instances.size() > m_uploadedInstances) {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, m_uploadedInstances * sizeof(GpuInstance),
+            (m_instances.size() - m_uploadedInstances) * sizeof(GpuInstance), m_instances.data() + m_uploadedInstances);
+    }
+    m_uploadedInstances = m_instances.size();
+
+    if (Grow(m_outCapacity, outBase))
+        Upload(m_outBuffer, m_outCapacity * sizeof(GpuInstanceOut), nullptr);
+
+    Upload(m_groupBuffer, groupData.size() * sizeof(GroupGpu), groupData.data());
+    Upload(m_counterBuffer, m_counterCount * sizeof(GLuint), nullptr);
+    Upload(m_commandBuffer, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+    Upload(m_commandCounterBuffer, commandCounters.size() * sizeof(GLuint), commandCounters.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // The compacted output doubles as the per-instance vertex stream;
+    // baseInstance in each command selects the (model, LOD) range.
+    for (const Group& g : m_groups) {
+        glBindVertexArray(g.model->vao);
+        glBindBuffer(GL_ARRAY_BUFFER, m_outBuffer);
+
+        const GLsizei stride = sizeof(GpuInstanceOut);
+        for (int c = 0; c < 4; ++c) {
+            glVertexAttribPointer(5 + c, 4, GL_FLOAT, GL_FALSE, stride, (void*)(c * sizeof(glm::vec4)));
+            glEnableVertexAttribArray(5 + c);
+            glVertexAttribDivisor(5 + c, 1);
+        }
+
+        glVertexAttribPointer(9, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(GpuInstanceOut, params));
+        glEnableVertexAttribArray(9);
+        glVertexAttribDivisor(9, 1);
+
+        glVertexAttribPointer(10, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(GpuInstanceOut, tint));
+        glEnableVertexAttribArray(10);
+        glVertexAttribDivisor(10, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_layoutDirty = false;
+}
+
+void GpuCuller::Cull(const glm::mat4& viewProj, const glm::vec3& viewPos, bool occlusion) {
+    if (!Ready()) return;
+    if (m_layoutDirty) RebuildLayout();
+    if (m_instances.empty()) return;
+
+    const GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_counterBuffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_instanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_groupBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_outBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_counterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, m_commandCounterBuffer);
+
+    Frustum frustum = Frustum::FromViewProj(viewProj);
+
+    glUseProgram(m_cullProgram);
+    glUniform1ui(m_uInstanceCount, static_cast<GLuint>(m_instances.size()));
+    glUniform4fv(m_uPlanes, 6, glm::value_ptr(frustum.planes[0]));
+    glUniform3fv(m_uViewPos, 1, glm::value_ptr(viewPos));
+
+    const bool hiz = occlusion && useHiZ && m_hizValid;
+    m_lastCullOccluded = hiz;
+    glUniform1i(m_uUseHiZ, hiz ? 1 : 0);
+    if (hiz) {
+        glUniformMatrix4fv(m_uPrevViewProj, 1, GL_FALSE, glm::value_ptr(m_prevViewProj));
+        glUniform1i(m_uHiZ, kHiZTextureUnit);
+        glUniform1i(m_uHiZMips, m_hizMips);
+        glActiveTexture(GL_TEXTURE0 + kHiZTextureUnit);
+        glBindTexture(GL_TEXTURE_2D, m_hizTex);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    glDispatchCompute((static_cast<GLuint>(m_instances.size()) + 63) / 64, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUseProgram(m_finalizeProgram);
+    glUniform1ui(m_uCommandCount, m_commandCount);
+    glDispatchCompute((m_commandCount + 63) / 64, 1, 1);
+
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+void GpuCuller::Draw() {
+    if (!Ready() || m_instances.empty()) return;
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+
+    for (const Group& g : m_groups) {
+        glBindVertexArray(g.model->vao);
+        for (unsigned int s = 0; s < g.subMeshCount; ++s) {
+            const size_t first = g.firstCommand + s * g.lodCount;
+            glBindTexture(GL_TEXTURE_2D, g.model->subMeshes[s].texture);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                (void*)(first * sizeof(DrawElementsIndirectCommand)),
+                static_cast<GLsizei>(g.lodCount), 0);
+        }
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+bool GpuCuller::EnsureHiZ(int width, int height) {
+    if (m_hizTex && width == m_hizWidth && height == m_hizHeight) return false;
+
+    DestroyHiZ();
+    m_hizWidth = width;
+    m_hizHeight = height;
+    m_hizMips = 1 + static_cast<int>(std::floor(std::log2(static_cast<float>(std::max(width, height)))));
+
+    glGenTextures(1, &m_hizTex);
+    glBindTexture(GL_TEXTURE_2D, m_hizTex);
+    glTexStorage2D(GL_TEXTURE_2D, m_hizMips, GL_R32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+void GpuCuller::DestroyHiZ() {
+    if (m_hizTex) glDeleteTextures(1, &m_hizTex);
+    m_hizTex = 0;
+    m_hizWidth = m_hizHeight = m_hizMips = 0;
+    m_hizValid = false;
+}
+
+void GpuCuller::BuildHiZ(int width, int height, const glm::mat4& viewProj, GLuint depthCopy) {
+    if (!WantsHiZ() || !depthCopy || width <= 0 || height <= 0) {
+        m_hizValid = false;
+        return;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    // A depth format mismatch with the window makes the blit fail; occlusion
+    // against garbage would hide visible objects, so drop Hi-Z instead. The
+    // depth copy is recreated with the pyramid, so checking then suffices.
+    if (EnsureHiZ(width, height) && !DepthBlitCompatible()) {
+        std::cerr << "GPU culling: window depth format cannot be blitted, Hi-Z occlusion disabled\n";
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        DestroyHiZ();
+        m_hizBroken = true;
+        return;
+    }
+
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    glUseProgram(m_hizCopyProgram);
+    glActiveTexture(GL_TEXTURE0 + kHiZTextureUnit);
+    glBindTexture(GL_TEXTURE_2D, depthCopy);
+    glUniform1i(glGetUniformLocation(m_hizCopyProgram, "u_depth"), kHiZTextureUnit);
+    glBindImageTexture(1, m_hizTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
+
+    glUseProgram(m_hizReduceProgram);
+    int w = width, h = height;
+    for (int level = 1; level < m_hizMips; ++level) {
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        glBindImageTexture(0, m_hizTex, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(1, m_hizTex, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((w + 7) / 8, (h + 7) / 8, 1);
+    }
+
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    m_prevViewProj = viewProj;
+    m_hizValid = true;
+}
+
+int GpuCuller::ReadVisibleCount() const {
+    if (!Ready() || m_counterCount == 0) return 0;
+
+    std::vector<GLuint> counters(m_counterCount);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_counterBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, counters.size() * sizeof(GLuint), counters.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    int total = 0;
+    for (GLuint c : counters) total += static_cast<int>(c);
+    return total;
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "model.h"
+
+// Layouts mirror the std430 structs in cull.comp.
+struct GpuInstance {
+    glm::mat4 model{ 1.0f };
+    glm::vec4 sphere{ 0.0f };
+    glm::vec4 params{ 0.0f };
+    glm::vec4 tint{ 1.0f };
+    glm::uvec4 meta{ 0u };
+};
+
+struct GpuInstanceOut {
+    glm::mat4 model;
+    glm::vec4 params;
+    glm::vec4 tint;
+};
+
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLuint baseVertex;
+    GLuint baseInstance;
+};
+
+// GL 4.3 path: instance spheres live in an SSBO, a compute pass tests them
+// against the frustum and last frame's Hi-Z pyramid, picks a LOD and appends
+// survivors to per-(model, LOD) ranges consumed by glMultiDrawElementsIndirect.
+class GpuCuller {
+public:
+    static constexpr int kMaxLods = 4;
+
+    GpuCuller() = default;
+    ~GpuCuller();
+
+    GpuCuller(const GpuCuller&) = delete;
+    GpuCuller& operator=(const GpuCuller&) = delete;
+
+    bool Initialize();
+    void Shutdown();
+    bool Ready() const { return m_cullProgram != 0; }
+
+    void Clear();
+    int AddInstance(Model& model, const GpuInstance& data);
+    // Re-reads a model's LODs, sub-meshes and VAO after its geometry was
+    // replaced (a streamed mesh reaching full detail).
+    void RefreshModel(Model& model);
+    void UpdateInstance(int handle, const GpuInstance& data);
+
+    // Without occlusion only the frustum is tested: the Hi-Z pyramid is
+    // the main view's, so other cameras must pass false.
+    void Cull(const glm::mat4& viewProj, const glm::vec3& viewPos, bool occlusion = true);
+    bool LastCullOccluded() const { return m_lastCullOccluded; }
+    void Draw();
+    // depthCopy is a depth-stencil texture the size of the window, bound as
+    // the draw framebuffer's depth (the render graph's "hiz" pass does that);
+    // the window depth is blitted into it and reduced.
+    bool WantsHiZ() const { return Ready() && useHiZ && !m_hizBroken; }
+    void BuildHiZ(int width, int height, const glm::mat4& viewProj, GLuint depthCopy);
+    void InvalidateHiZ() { m_hizValid = false; }
+
+    int ReadVisibleCount() const;
+    int InstanceCount() const { return static_cast<int>(m_instances.size()); }
+
+    bool useHiZ{ true };
+
+private:
+    struct GroupGpu {
+        glm::uvec4 info;
+        glm::vec4 lodFactors;
+    };
+
+    struct Group {
+        Model* model = nullptr;
+        unsigned int instanceCount = 0;
+        unsigned int lodCount = 1;
+        unsigned int subMeshCount = 0;
+        unsigned int firstCommand = 0;
+    };
+
+    int FindOrAddGroup(Model& model);
+    void RebuildLayout();
+    // True when the pyramid was (re)created, i.e. the size changed.
+    bool EnsureHiZ(int width, int height);
+    void DestroyHiZ();
+
+    std::vector<Group> m_groups;
+    std::vector<GpuInstance> m_instances;
+    // Adding instances only marks the layout dirty; the next Cull rebuilds
+    // it once, uploading just the instances added since the last rebuild.
+    // The instance and output buffers grow by doubling so a burst of
+    // packages does not reallocate them every frame.
+    bool m_layoutDirty{ false };
+    size_t m_uploadedInstances{ 0 };
+    size_t m_instanceCapacity{ 0 };
+    size_t m_outCapacity{ 0 };
+
+    unsigned int m_commandCount{ 0 };
+    unsigned int m_counterCount{ 0 };
+
+    GLuint m_cullProgram{ 0 };
+    GLuint m_finalizeProgram{ 0 };
+    GLuint m_hizCopyProgram{ 0 };
+    GLuint m_hizReduceProgram{ 0 };
+
+    GLuint m_instanceBuffer{ 0 };
+    GLuint m_groupBuffer{ 0 };
+    GLuint m_outBuffer{ 0 };
+    GLuint m_counterBuffer{ 0 };
+    GLuint m_commandBuffer{ 0 };
+    GLuint m_commandCounterBuffer{ 0 };
+
+    GLuint m_hizTex{ 0 };
+    int m_hizWidth{ 0 }, m_hizHeight{ 0 }, m_hizMips{ 0 };
+    bool m_hizValid{ false };
+    bool m_hizBroken{ false };
+    bool m_lastCullOccluded{ false };
+    glm::mat4 m_prevViewProj{ 1.0f };
+
+    int m_uInstanceCount{ -1 }, m_uPlanes{ -1 }, m_uViewPos{ -1 };
+    int m_uUseHiZ{ -1 }, m_uPrevViewProj{ -1 }, m_uHiZ{ -1 }, m_uHiZMips{ -1 };
+    int m_uCommandCount{ -1 };
+};
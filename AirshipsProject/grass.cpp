@@ -0,0 +1,155 @@
+﻿#include "grass.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "shader_utils.h"
+#include "terrain.h"
+
+static const GLuint kHeightmapTextureUnit = 3;
+
+GrassField::~GrassField() {
+    Shutdown();
+}
+
+bool GrassField::Initialize(float fieldHalfSize, const glm::vec3& lightDir, const glm::vec3& ambient, const glm::vec3& diffuse) {
+    m_program = CreateShaderProgramFromFiles("grass.vert", "grass.frag");
+    if (!m_program || m_program == static_cast<GLuint>(-1)) {
+        std::cerr << "Grass: shaders failed, grass disabled\n";
+        m_program = 0;
+        return false;
+    }
+
+    m_uView = glGetUniformLocation(m_program, "u_view");
+    m_uProj = glGetUniformLocation(m_program, "u_projection");
+    m_uTime = glGetUniformLocation(m_program, "u_time");
+    m_uViewPos = glGetUniformLocation(m_program, "u_viewPos");
+    m_uTiles = glGetUniformLocation(m_program, "u_tiles");
+    m_uBladesPerTile = glGetUniformLocation(m_program, "u_bladesPerTile");
+    m_uFullBlades = glGetUniformLocation(m_program, "u_fullBlades");
+    m_uTileSize = glGetUniformLocation(m_program, "u_tileSize");
+    m_uFade = glGetUniformLocation(m_program, "u_fade");
+    m_uSwayStrength = glGetUniformLocation(m_program, "u_swayStrength");
+    m_uTerrain = glGetUniformLocation(m_program, "u_terrain");
+    m_uWind = glGetUniformLocation(m_program, "u_wind");
+
+    glUseProgram(m_program);
+    glUniform3fv(glGetUniformLocation(m_program, "u_dirLight.direction"), 1, glm::value_ptr(lightDir));
+    glUniform3fv(glGetUniformLocation(m_program, "u_dirLight.ambient"), 1, glm::value_ptr(ambient));
+    glUniform3fv(glGetUniformLocation(m_program, "u_dirLight.diffuse"), 1, glm::value_ptr(diffuse));
+    glUniform1i(glGetUniformLocation(m_program, "u_heightmap"), kHeightmapTextureUnit);
+    glUseProgram(0);
+
+    // Core profile needs a VAO bound even for attributeless draws.
+    glGenVertexArrays(1, &m_vao);
+
+    m_tilesPerSide = std::max(1, static_cast<int>(std::ceil(2.0f * fieldHalfSize / tileSize)));
+    m_origin = -0.5f * m_tilesPerSide * tileSize;
+    m_tileHeights.assign(static_cast<size_t>(m_tilesPerSide) * m_tilesPerSide, glm::vec2(0.0f));
+
+    std::cout << "Grass: " << m_tilesPerSide * m_tilesPerSide << " tiles, up to "
+        << m_tilesPerSide * m_tilesPerSide * bladesPerTile << " blades\n";
+    return true;
+}
+
+void GrassField::Shutdown() {
+    if (m_program) glDeleteProgram(m_program);
+    if (m_vao) glDeleteVertexArrays(1, &m_vao);
+    m_program = m_vao = 0;
+}
+
+void GrassField::SetTerrain(const Terrain* terrain) {
+    m_terrain = terrain;
+
+    for (int tz = 0; tz < m_tilesPerSide; ++tz) {
+        for (int tx = 0; tx < m_tilesPerSide; ++tx) {
+            glm::vec2& range = m_tileHeights[static_cast<size_t>(tz) * m_tilesPerSide + tx];
+            range = glm::vec2(0.0f);
+            if (!terrain) continue;
+
+            const glm::vec2 lo(m_origin + tx * tileSize, m_origin + tz * tileSize);
+            terrain->HeightRange(lo, lo + glm::vec2(tileSize), range.x, range.y);
+        }
+    }
+}
+
+void GrassField::Draw(const glm::mat4& view, const glm::mat4& proj, const Frustum& frustum, const glm::vec3& viewPos, float time) {
+    m_lastDrawCalls = 0;
+    m_lastBlades = 0;
+    if (!m_program) return;
+
+    for (auto& band : m_bandTiles) band.clear();
+
+    const float maxHeight = 0.8f;
+    for (int tz = 0; tz < m_tilesPerSide; ++tz) {
+        for (int tx = 0; tx < m_tilesPerSide; ++tx) {
+            const glm::vec2 lo(m_origin + tx * tileSize, m_origin + tz * tileSize);
+            const glm::vec2 hi = lo + glm::vec2(tileSize);
+            const glm::vec2 heights = m_tileHeights[static_cast<size_t>(tz) * m_tilesPerSide + tx];
+            const float yLo = heights.x;
+            const float yHi = heights.y + maxHeight;
+
+            BoundingSphere sphere;
+            sphere.center = glm::vec3((lo.x + hi.x) * 0.5f, (yLo + yHi) * 0.5f, (lo.y + hi.y) * 0.5f);
+            sphere.radius = glm::length(glm::vec3(tileSize * 0.5f, (yHi - yLo) * 0.5f, tileSize * 0.5f)) + swayStrength * (1.0f + glm::length(wind));
+            if (!frustum.Intersects(sphere)) continue;
+
+            // Same falloff as grass.vert, at the tile's nearest point, so the
+            // band always has at least as many blades as the shader keeps.
+            glm::vec3 nearest(glm::clamp(viewPos.x, lo.x, hi.x), glm::clamp(viewPos.y, yLo, yHi), glm::clamp(viewPos.z, lo.y, hi.y));
+            float d = glm::distance(nearest, viewPos);
+            float density = glm::mix(1.0f, 0.25f, glm::smoothstep(0.0f, fadeStart, d)) * (1.0f - glm::smoothstep(fadeStart, fadeEnd, d));
+            if (density <= 0.0f) continue;
+
+            int band = 0;
+            for (int b = kBands - 1; b > 0; --b) {
+                if ((bladesPerTile >> b) >= density * bladesPerTile) {
+                    band = b;
+                    break;
+                }
+            }
+
+            float seed = static_cast<float>(tz * m_tilesPerSide + tx + 1);
+            m_bandTiles[band].push_back(glm::vec4(lo.x, lo.y, seed, 0.0f));
+        }
+    }
+
+    glUseProgram(m_program);
+    glUniformMatrix4fv(m_uView, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(m_uProj, 1, GL_FALSE, glm::value_ptr(proj));
+    glUniform3fv(m_uViewPos, 1, glm::value_ptr(viewPos));
+    glUniform1f(m_uTime, time);
+    glUniform1f(m_uSwayStrength, swayStrength);
+    glUniform3fv(m_uWind, 1, glm::value_ptr(wind));
+    glUniform1f(m_uTileSize, tileSize);
+    glUniform2f(m_uFade, fadeStart, fadeEnd);
+    glUniform1i(m_uFullBlades, bladesPerTile);
+
+    if (m_terrain) {
+        glUniform4fv(m_uTerrain, 1, glm::value_ptr(m_terrain->HeightmapParams()));
+        m_terrain->BindHeightmap(kHeightmapTextureUnit);
+    }
+    else {
+        glUniform4f(m_uTerrain, 0.0f, 0.0f, 0.0f, 0.0f);
+    }
+
+    glBindVertexArray(m_vao);
+    for (int b = 0; b < kBands; ++b) {
+        const std::vector<glm::vec4>& tiles = m_bandTiles[b];
+        const int blades = bladesPerTile >> b;
+        glUniform1i(m_uBladesPerTile, blades);
+
+        for (size_t first = 0; first < tiles.size(); first += kTilesPerDraw) {
+            GLsizei n = static_cast<GLsizei>(std::min<size_t>(kTilesPerDraw, tiles.size() - first));
+            glUniform4fv(m_uTiles, n, glm::value_ptr(tiles[first]));
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 7, n * blades);
+
+            m_lastDrawCalls++;
+            m_lastBlades += n * blades;
+        }
+    }
+    glBindVertexArray(0);
+}
@@ -0,0 +1,30 @@
+#version 330 core
+
+struct DirLight {
+    vec3 direction;
+    vec3 ambient;
+    vec3 diffuse;
+};
+
+uniform DirLight u_dirLight;
+
+in vec3 v_color;
+in vec3 v_normal;
+in float v_height;
+
+out vec4 FragColor;
+
+void main()
+{
+    vec3 N = normalize(v_normal);
+    if (!gl_FrontFacing) N = -N;
+
+    vec3 L = normalize(-u_dirLight.direction);
+    float diff = max(dot(N, L), 0.0) * 0.6 + 0.4;
+
+    // Cheap self-shadowing toward the root.
+    float occlusion = 0.55 + 0.45 * v_height;
+
+    vec3 color = v_color * (u_dirLight.ambient + u_dirLight.diffuse * diff) * occlusion;
+    FragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,60 @@
+﻿#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "culling.h"
+
+class Terrain;
+
+// Grass and small clutter over the field, generated entirely in grass.vert.
+// The CPU only culls whole tiles and picks a density band per tile; blade
+// placement comes from a hash of the tile coordinate and instance index.
+class GrassField {
+public:
+    static constexpr int kTilesPerDraw = 128;
+    static constexpr int kBands = 3;
+
+    float tileSize{ 8.0f };
+    int bladesPerTile{ 2048 };
+    float fadeStart{ 35.0f };
+    float fadeEnd{ 70.0f };
+    float swayStrength{ 0.12f };
+    glm::vec3 wind{ 0.0f };
+
+    GrassField() = default;
+    ~GrassField();
+
+    GrassField(const GrassField&) = delete;
+    GrassField& operator=(const GrassField&) = delete;
+
+    bool Initialize(float fieldHalfSize, const glm::vec3& lightDir, const glm::vec3& ambient, const glm::vec3& diffuse);
+    void Shutdown();
+    bool Ready() const { return m_program != 0; }
+
+    void SetTerrain(const Terrain* terrain);
+
+    void Draw(const glm::mat4& view, const glm::mat4& proj, const Frustum& frustum, const glm::vec3& viewPos, float time);
+
+    int LastDrawCalls() const { return m_lastDrawCalls; }
+    int LastBladeCount() const { return m_lastBlades; }
+
+private:
+    GLuint m_program{ 0 };
+    GLuint m_vao{ 0 };
+
+    int m_tilesPerSide{ 0 };
+    float m_origin{ 0.0f };
+
+    const Terrain* m_terrain{ nullptr };
+    std::vector<glm::vec2> m_tileHeights;
+
+    std::vector<glm::vec4> m_bandTiles[kBands];
+    int m_lastDrawCalls{ 0 };
+    int m_lastBlades{ 0 };
+
+    int m_uView{ -1 }, m_uProj{ -1 }, m_uTime{ -1 }, m_uViewPos{ -1 };
+    int m_uTiles{ -1 }, m_uBladesPerTile{ -1 }, m_uTileSize{ -1 };
+    int m_uFade{ -1 }, m_uSwayStrength{ -1 }, m_uFullBlades{ -1 }, m_uTerrain{ -1 }, m_uWind{ -1 };
+};
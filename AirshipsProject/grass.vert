@@ -0,0 +1,109 @@
+#version 330 core
+
+// Attributeless: blade shape comes from gl_VertexID (a 7-vertex strip),
+// placement from a hash of the tile seed and gl_InstanceID.
+
+uniform mat4 u_view;
+uniform mat4 u_projection;
+uniform vec3 u_viewPos;
+uniform float u_time;
+uniform float u_swayStrength;
+uniform vec3 u_wind;
+
+uniform vec4 u_tiles[128];          // origin x, origin z, seed, unused
+uniform int u_bladesPerTile;        // instances per tile in this draw
+uniform int u_fullBlades;           // blades per tile at full density
+uniform float u_tileSize;
+uniform vec2 u_fade;                // thinning starts, grass gone
+
+uniform sampler2D u_heightmap;
+uniform vec4 u_terrain;             // origin x, origin z, size, texels; size 0 = flat
+
+out vec3 v_color;
+out vec3 v_normal;
+out float v_height;
+
+uint Hash(uint x)
+{
+    x ^= x >> 16; x *= 0x7feb352du;
+    x ^= x >> 15; x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+float Rand(inout uint state)
+{
+    state = Hash(state + 0x9e3779b9u);
+    return float(state >> 8) * (1.0 / 16777216.0);
+}
+
+float GroundHeight(vec2 xz)
+{
+    if (u_terrain.z <= 0.0) return 0.0;
+    vec2 uv = clamp((xz - u_terrain.xy) / u_terrain.z, 0.0, 1.0);
+    uv = (uv * (u_terrain.w - 1.0) + 0.5) / u_terrain.w;
+    return texture(u_heightmap, uv).r;
+}
+
+void main()
+{
+    int tile = gl_InstanceID / u_bladesPerTile;
+    int blade = gl_InstanceID - tile * u_bladesPerTile;
+    vec4 t = u_tiles[tile];
+
+    uint state = Hash(uint(t.z) * 0x9e3779b9u ^ uint(blade));
+    vec3 root = vec3(t.x + Rand(state) * u_tileSize, 0.0, t.y + Rand(state) * u_tileSize);
+    root.y = GroundHeight(root.xz);
+
+    float dist = distance(root, u_viewPos);
+    float density = mix(1.0, 0.25, smoothstep(0.0, u_fade.x, dist)) * (1.0 - smoothstep(u_fade.x, u_fade.y, dist));
+    float rank = (float(blade) + 0.5) / float(u_fullBlades);
+    if (rank >= density) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        v_color = vec3(0.0);
+        v_normal = vec3(0.0, 1.0, 0.0);
+        v_height = 0.0;
+        return;
+    }
+
+    float height = 0.35 + 0.45 * Rand(state);
+    float width = 0.05 + 0.03 * Rand(state);
+    float angle = Rand(state) * 6.2831853;
+    float lean = Rand(state) * 0.25;
+    float kind = Rand(state);
+
+    vec3 side = vec3(cos(angle), 0.0, sin(angle));
+    vec3 facing = vec3(-side.z, 0.0, side.x);
+
+    float h = float(gl_VertexID >> 1) / 3.0;
+    float s = float(gl_VertexID & 1) * 2.0 - 1.0;
+
+    vec3 pos = root + side * (s * width * (1.0 - h)) + vec3(0.0, h * height, 0.0);
+    pos += facing * (lean * h * h * height);
+
+    // Same sway as game.vert, phased by position so gusts roll across the field.
+    if (u_swayStrength > 0.0001) {
+        float weight = h * h;
+        float s1 = sin(u_time * 1.6 + root.x * 0.35 + pos.y * 2.2);
+        float s2 = cos(u_time * 1.2 + root.z * 0.35 + pos.y * 1.7);
+        float gust = 1.0 + length(u_wind.xz) * 0.15;
+        pos.x += (s1 * gust + u_wind.x * 0.5) * u_swayStrength * weight;
+        pos.z += (s2 * 0.7 * gust + u_wind.z * 0.5) * u_swayStrength * weight;
+    }
+
+    vec3 base = mix(vec3(0.16, 0.32, 0.08), vec3(0.34, 0.52, 0.14), Rand(state));
+    vec3 tip = base * 1.6;
+
+    // A few percent of instances are flowers: coloured tips on a short stem.
+    if (kind > 0.97) {
+        float f = Rand(state);
+        tip = (f < 0.4) ? vec3(0.95, 0.85, 0.2) : (f < 0.7) ? vec3(0.95, 0.95, 0.9) : vec3(0.6, 0.35, 0.85);
+        tip = mix(base, tip, step(0.6, h));
+    }
+
+    v_color = mix(base, tip, h);
+    v_normal = normalize(facing + vec3(0.0, 0.6, 0.0));
+    v_height = h;
+
+    gl_Position = u_projection * u_view * vec4(pos, 1.0);
+}
@@ -0,0 +1,260 @@
+#include "hud.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <iostream>
+
+#include "gl_debug.h"
+#include "shader_utils.h"
+
+namespace {
+
+// Printable ASCII from 32 to 127 in a 16x6 grid of 6x8 cells: the glyph in
+// the top-left 5x7, a blank column and row against bleeding. Cell 127 is
+// solid and backs the panels.
+const int kFirstChar = 32;
+const int kCellW = 6, kCellH = 8;
+const int kColumns = 16, kRows = 6;
+const int kAtlasW = kColumns * kCellW, kAtlasH = kRows * kCellH;
+const int kSolidChar = 127;
+const int kGlyphW = 5, kGlyphH = 7;
+
+struct GlyphBits {
+    char c;
+    std::uint8_t rows[kGlyphH]; // top row first, bit 4 is the left pixel
+};
+
+const GlyphBits kFont[] = {
+    { '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+    { '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+    { '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+    { '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+    { '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+    { '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+    { '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+    { '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+    { '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+    { 'A', { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 } },
+    { 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+    { 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+    { 'D', { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C } },
+    { 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+    { 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+    { 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } },
+    { 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+    { 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+    { 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+    { 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+    { 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+    { 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+    { 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+    { 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+    { 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } },
+    { 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+    { 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+    { 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+    { 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+    { 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+    { 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } },
+    { 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+    { 'Y', { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 } },
+    { 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } },
+    { '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+    { ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } },
+    { '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+    { ',', { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 } },
+    { '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+    { '+', { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 } },
+    { '%', { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 } },
+    { '(', { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 } },
+    { ')', { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 } },
+    { '?', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 } },
+};
+
+std::uint32_t PackColor(const glm::vec4& c) {
+    auto Byte = [](float v) { return static_cast<std::uint32_t>(glm::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); };
+    return Byte(c.x) | (Byte(c.y) << 8) | (Byte(c.z) << 16) | (Byte(c.w) << 24);
+}
+
+glm::vec2 CellOrigin(int ch) {
+    const int index = ch - kFirstChar;
+    return glm::vec2((index % kColumns) * kCellW, (index / kColumns) * kCellH);
+}
+
+}
+
+HudRenderer::~HudRenderer() {
+    Shutdown();
+}
+
+bool HudRenderer::Initialize() {
+    m_program = CreateShaderProgramFromFiles("hud.vert", "hud.frag");
+    if (!m_program || m_program == static_cast<GLuint>(-1)) {
+        std::cerr << "HUD: shaders failed, HUD disabled\n";
+        m_program = 0;
+        return false;
+    }
+    m_uScreen = glGetUniformLocation(m_program, "u_screen");
+    glUseProgram(m_program);
+    glUniform1i(glGetUniformLocation(m_program, "u_atlas"), 0);
+    glUseProgram(0);
+
+    BuildAtlas();
+
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_vbo);
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, pos));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    LabelGlObject(GL_BUFFER, m_vbo, "hud vertices");
+
+    m_dirty = true;
+    return true;
+}
+
+void HudRenderer::Shutdown() {
+    if (m_vbo) glDeleteBuffers(1, &m_vbo);
+    if (m_vao) glDeleteVertexArrays(1, &m_vao);
+    if (m_atlas) glDeleteTextures(1, &m_atlas);
+    if (m_program) glDeleteProgram(m_program);
+    m_vbo = m_vao = m_atlas = m_program = 0;
+    m_capacity = 0;
+    m_vertexCount = 0;
+}
+
+void HudRenderer::BuildAtlas() {
+    std::vector<std::uint8_t> pixels(static_cast<size_t>(kAtlasW) * kAtlasH, 0);
+
+    for (const GlyphBits& g : kFont) {
+        const glm::vec2 origin = CellOrigin(g.c);
+        for (int y = 0; y < kGlyphH; ++y)
+            for (int x = 0; x < kGlyphW; ++x)
+                if (g.rows[y] & (0x10 >> x))
+                    pixels[static_cast<size_t>(origin.y + y) * kAtlasW + static_cast<size_t>(origin.x + x)] = 255;
+    }
+
+    const glm::vec2 solid = CellOrigin(kSolidChar);
+    for (int y = 0; y < kCellH; ++y)
+        for (int x = 0; x < kCellW; ++x)
+            pixels[static_cast<size_t>(solid.y + y) * kAtlasW + static_cast<size_t>(solid.x + x)] = 255;
+
+    glGenTextures(1, &m_atlas);
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, kAtlasW, kAtlasH, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    LabelGlObject(GL_TEXTURE, m_atlas, "hud glyph atlas");
+}
+
+int HudRenderer::AddPanel(const glm::vec2& pos, const glm::vec2& size, const glm::vec4& color) {
+    Item item;
+    item.pos = pos;
+    item.size = size;
+    item.color = PackColor(color);
+    m_items.push_back(item);
+    m_dirty = true;
+    return static_cast<int>(m_items.size()) - 1;
+}
+
+int HudRenderer::AddText(const glm::vec2& pos, float scale, const glm::vec4& color) {
+    Item item;
+    item.text = true;
+    item.pos = pos;
+    item.scale = scale;
+    item.color = PackColor(color);
+    m_items.push_back(item);
+    m_dirty = true;
+    return static_cast<int>(m_items.size()) - 1;
+}
+
+void HudRenderer::SetText(int item, const std::string& text) {
+    if (item < 0 || item >= static_cast<int>(m_items.size())) return;
+    Item& it = m_items[item];
+    if (it.value == text) return;
+    it.value = text;
+    m_dirty = true;
+}
+
+void HudRenderer::AddQuad(const glm::vec2& p0, const glm::vec2& p1, const glm::vec2& uv0, const glm::vec2& uv1, std::uint32_t color) {
+    const Vertex a{ p0, uv0, color };
+    const Vertex b{ { p1.x, p0.y }, { uv1.x, uv0.y }, color };
+    const Vertex c{ p1, uv1, color };
+    const Vertex d{ { p0.x, p1.y }, { uv0.x, uv1.y }, color };
+    m_vertices.insert(m_vertices.end(), { a, b, c, a, c, d });
+}
+
+void HudRenderer::Rebuild() {
+    m_vertices.clear();
+    const glm::vec2 texel(1.0f / kAtlasW, 1.0f / kAtlasH);
+
+    // Panels first so text lands on top within the one draw.
+    for (const Item& it : m_items) {
+        if (it.text) continue;
+        const glm::vec2 cell = CellOrigin(kSolidChar) + glm::vec2(kCellW, kCellH) * 0.5f;
+        AddQuad(it.pos, it.pos + it.size, cell * texel, cell * texel, it.color);
+    }
+
+    for (const Item& it : m_items) {
+        if (!it.text) continue;
+        glm::vec2 pen = it.pos;
+        for (char raw : it.value) {
+            const int ch = std::toupper(static_cast<unsigned char>(raw));
+            if (ch != ' ' && ch >= kFirstChar && ch < kSolidChar) {
+                const glm::vec2 origin = CellOrigin(ch);
+                AddQuad(pen, pen + glm::vec2(kGlyphW, kGlyphH) * it.scale,
+                    origin * texel, (origin + glm::vec2(kGlyphW, kGlyphH)) * texel, it.color);
+            }
+            pen.x += kCellW * it.scale;
+        }
+    }
+
+    m_vertexCount = static_cast<GLsizei>(m_vertices.size());
+    const GLsizeiptr bytes = static_cast<GLsizeiptr>(m_vertices.size() * sizeof(Vertex));
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    // Orphan so the upload never waits on the previous frame's draw.
+    m_capacity = std::max<GLsizeiptr>({ m_capacity, bytes, 4096 });
+    glBufferData(GL_ARRAY_BUFFER, m_capacity, nullptr, GL_DYNAMIC_DRAW);
+    if (bytes > 0) glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, m_vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_dirty = false;
+    m_rebuilds++;
+}
+
+void HudRenderer::Draw(int width, int height) {
+    if (!Ready() || m_items.empty()) return;
+    if (m_dirty) Rebuild();
+    if (m_vertexCount == 0) return;
+
+    glUseProgram(m_program);
+    glUniform2f(m_uScreen, static_cast<float>(width), static_cast<float>(height));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glBindVertexArray(m_vao);
+    glDrawArrays(GL_TRIANGLES, 0, m_vertexCount);
+    glBindVertexArray(0);
+
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+}
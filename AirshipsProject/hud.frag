@@ -0,0 +1,15 @@
+#version 330 core
+
+// The atlas is coverage only; panels sample its solid cell.
+
+in vec2 v_uv;
+in vec4 v_color;
+
+uniform sampler2D u_atlas;
+
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(v_color.rgb, v_color.a * texture(u_atlas, v_uv).r);
+}
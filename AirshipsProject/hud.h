@@ -0,0 +1,74 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Screen-space overlay: panels and text in one vertex buffer, one program,
+// one texture and one draw per frame.
+//
+// Text comes from a 5x7 bitmap font baked into an atlas at startup (no
+// font file needed); panels sample its solid cell, so both share the draw.
+// Items are registered once and only their strings change; the vertex
+// buffer is re-tessellated and uploaded only when a string actually
+// differs from what is shown. Everything is plain GL on the game's
+// program/VAO, never sf::RenderWindow::draw, so SFML does not push, reset
+// and pop its 2D state around the overlay.
+class HudRenderer {
+public:
+    HudRenderer() = default;
+    ~HudRenderer();
+
+    HudRenderer(const HudRenderer&) = delete;
+    HudRenderer& operator=(const HudRenderer&) = delete;
+
+    bool Initialize();
+    void Shutdown();
+    bool Ready() const { return m_program != 0; }
+
+    // Positions are pixels from the top-left corner; scale multiplies the
+    // 5x7 glyphs (integer scales stay crisp).
+    int AddPanel(const glm::vec2& pos, const glm::vec2& size, const glm::vec4& color);
+    int AddText(const glm::vec2& pos, float scale, const glm::vec4& color);
+    void SetText(int item, const std::string& text);
+
+    void Draw(int width, int height);
+
+    int Rebuilds() const { return m_rebuilds; }
+
+private:
+    struct Vertex {
+        glm::vec2 pos;
+        glm::vec2 uv;
+        std::uint32_t color;
+    };
+
+    struct Item {
+        bool text{ false };
+        glm::vec2 pos{ 0.0f };
+        glm::vec2 size{ 0.0f };
+        float scale{ 1.0f };
+        std::uint32_t color{ 0xffffffffu };
+        std::string value;
+    };
+
+    void BuildAtlas();
+    void Rebuild();
+    void AddQuad(const glm::vec2& p0, const glm::vec2& p1, const glm::vec2& uv0, const glm::vec2& uv1, std::uint32_t color);
+
+    std::vector<Item> m_items;
+    std::vector<Vertex> m_vertices;
+    bool m_dirty{ true };
+    int m_rebuilds{ 0 };
+
+    GLuint m_program{ 0 };
+    GLuint m_atlas{ 0 };
+    GLuint m_vao{ 0 };
+    GLuint m_vbo{ 0 };
+    GLsizeiptr m_capacity{ 0 };
+    GLsizei m_vertexCount{ 0 };
+
+    int m_uScreen{ -1 };
+};
@@ -0,0 +1,20 @@
+#version 330 core
+
+// HUD quads in pixels from the top-left corner.
+
+layout(location = 0) in vec2 aPos;
+layout(location = 1) in vec2 aUv;
+layout(location = 2) in vec4 aColor;
+
+uniform vec2 u_screen;
+
+out vec2 v_uv;
+out vec4 v_color;
+
+void main()
+{
+    vec2 ndc = aPos / u_screen * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+    v_uv = aUv;
+    v_color = aColor;
+}
@@ -0,0 +1,75 @@
+#include "job_pool.h"
+
+#include <algorithm>
+
+JobPool::~JobPool() {
+    Stop();
+}
+
+void JobPool::Start(unsigned int threads) {
+    Stop();
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    m_stop = false;
+    for (unsigned int i = 0; i + 1 < threads; ++i)
+        m_workers.emplace_back(&JobPool::WorkerMain, this, i, m_generation);
+}
+
+void JobPool::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& t : m_workers) t.join();
+    m_workers.clear();
+}
+
+void JobPool::RunChunk(unsigned int index) {
+    const int chunks = static_cast<int>(ThreadCount());
+    const int begin = static_cast<int>(static_cast<long long>(m_count) * index / chunks);
+    const int end = static_cast<int>(static_cast<long long>(m_count) * (index + 1) / chunks);
+    if (begin < end) (*m_job)(begin, end);
+}
+
+void JobPool::ParallelFor(int count, const RangeFn& fn) {
+    if (count <= 0) return;
+
+    std::lock_guard<std::mutex> call(m_callMutex);
+    if (m_workers.empty()) {
+        fn(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &fn;
+        m_count = count;
+        m_pending = static_cast<unsigned int>(m_workers.size());
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    RunChunk(static_cast<unsigned int>(m_workers.size()));
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished.wait(lock, [&] { return m_pending == 0; });
+    m_job = nullptr;
+}
+
+void JobPool::WorkerMain(unsigned int index, unsigned int generation) {
+    unsigned int seen = generation;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop) return;
+            seen = m_generation;
+        }
+
+        RunChunk(index);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_pending == 0) m_finished.notify_one();
+    }
+}
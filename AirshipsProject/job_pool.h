@@ -0,0 +1,45 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads for data-parallel loops. ParallelFor splits a
+// range into one contiguous chunk per thread (the caller runs the last one)
+// and returns when every chunk is done. Calls from different threads are
+// serialized, so simulation systems can share one pool.
+class JobPool {
+public:
+    using RangeFn = std::function<void(int begin, int end)>;
+
+    JobPool() = default;
+    ~JobPool();
+
+    JobPool(const JobPool&) = delete;
+    JobPool& operator=(const JobPool&) = delete;
+
+    // threads = 0 uses one worker per hardware thread, minus the caller.
+    void Start(unsigned int threads = 0);
+    void Stop();
+
+    void ParallelFor(int count, const RangeFn& fn);
+
+    unsigned int ThreadCount() const { return static_cast<unsigned int>(m_workers.size()) + 1; }
+
+private:
+    void WorkerMain(unsigned int index, unsigned int generation);
+    void RunChunk(unsigned int index);
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_callMutex;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_finished;
+    const RangeFn* m_job{ nullptr };
+    int m_count{ 0 };
+    unsigned int m_generation{ 0 };
+    unsigned int m_pending{ 0 };
+    bool m_stop{ false };
+};
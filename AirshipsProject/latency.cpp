@@ -0,0 +1,134 @@
+#include "latency.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+float Ms(LatencyMonitor::Clock::duration d) {
+    return std::chrono::duration<float, std::milli>(d).count();
+}
+
+void PrintDistribution(const char* label, std::vector<float>& samples) {
+    if (samples.empty()) return;
+    std::sort(samples.begin(), samples.end());
+    auto At = [&](float q) { return samples[static_cast<size_t>(q * (samples.size() - 1) + 0.5f)]; };
+    std::printf("  %-18s min %6.1f  p50 %6.1f  p90 %6.1f  p99 %6.1f  max %6.1f ms\n",
+        label, samples.front(), At(0.5f), At(0.9f), At(0.99f), samples.back());
+}
+
+}
+
+void LatencyMonitor::ConfigureFromEnvironment() {
+    if (const char* env = std::getenv("AIRSHIP_LATENCY"))
+        enabled = std::strcmp(env, "0") != 0;
+    if (const char* env = std::getenv("AIRSHIP_FRAMES_IN_FLIGHT"))
+        maxFramesInFlight = std::max(0, std::atoi(env));
+
+    if (enabled)
+        std::printf("Latency: measuring, max frames in flight %d (0 = driver)\n", maxFramesInFlight);
+}
+
+void LatencyMonitor::Shutdown() {
+    if (enabled && (!m_toDisplayMs.empty() || m_frames > 0)) Report();
+
+    for (Frame& f : m_inFlight) {
+        glDeleteSync(f.fence);
+        m_freeQueries.push_back(f.query);
+    }
+    m_inFlight.clear();
+    if (!m_freeQueries.empty()) glDeleteQueries(static_cast<GLsizei>(m_freeQueries.size()), m_freeQueries.data());
+    m_freeQueries.clear();
+}
+
+void LatencyMonitor::Calibrate() {
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    m_calibCpu = Clock::now();
+    m_calibGpu = gpuNow;
+    m_calibrated = true;
+}
+
+void LatencyMonitor::Retire(Frame& f) {
+    m_frames++;
+    if (f.hasInput) {
+        GLuint64 gpuDone = 0;
+        glGetQueryObjectui64v(f.query, GL_QUERY_RESULT, &gpuDone);
+        const Clock::time_point done = m_calibCpu + std::chrono::nanoseconds(static_cast<GLint64>(gpuDone) - m_calibGpu);
+
+        m_toDisplayMs.push_back(Ms(f.display - f.input));
+        m_toGpuMs.push_back(Ms(done - f.input));
+    }
+    glDeleteSync(f.fence);
+    m_freeQueries.push_back(f.query);
+}
+
+void LatencyMonitor::BeginFrame() {
+    if (!Active()) return;
+
+    while (!m_inFlight.empty() && glClientWaitSync(m_inFlight.front().fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+        Retire(m_inFlight.front());
+        m_inFlight.pop_front();
+    }
+
+    // Blocking here, before input is sampled, is what shortens the queue:
+    // the frame about to be built starts from fresher input.
+    if (maxFramesInFlight > 0) {
+        while (static_cast<int>(m_inFlight.size()) >= maxFramesInFlight) {
+            glClientWaitSync(m_inFlight.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+            Retire(m_inFlight.front());
+            m_inFlight.pop_front();
+        }
+    }
+
+    if (enabled && std::chrono::duration<float>(Clock::now() - m_windowStart).count() >= reportInterval)
+        Report();
+}
+
+void LatencyMonitor::MarkInput() {
+    if (!enabled || m_pendingInput) return;
+    m_pendingInput = true;
+    m_firstInput = Clock::now();
+}
+
+void LatencyMonitor::AfterDisplay() {
+    if (!Active()) return;
+    if (!m_calibrated) Calibrate();
+
+    Frame f;
+    f.display = Clock::now();
+    f.hasInput = m_pendingInput;
+    f.input = m_firstInput;
+    m_pendingInput = false;
+
+    if (m_freeQueries.empty()) {
+        GLuint q = 0;
+        glGenQueries(1, &q);
+        m_freeQueries.push_back(q);
+    }
+    f.query = m_freeQueries.back();
+    m_freeQueries.pop_back();
+
+    glQueryCounter(f.query, GL_TIMESTAMP);
+    f.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    m_inFlight.push_back(f);
+}
+
+void LatencyMonitor::Report() {
+    const float seconds = std::chrono::duration<float>(Clock::now() - m_windowStart).count();
+    std::printf("Latency: %zu inputs over %d frames (%.1f fps), max frames in flight %d\n",
+        m_toDisplayMs.size(), m_frames, seconds > 0.0f ? m_frames / seconds : 0.0f, maxFramesInFlight);
+    PrintDistribution("input -> display", m_toDisplayMs);
+    PrintDistribution("input -> GPU done", m_toGpuMs);
+
+    m_toDisplayMs.clear();
+    m_toGpuMs.clear();
+    m_frames = 0;
+    m_windowStart = Clock::now();
+
+    // GPU and CPU clocks drift apart slowly; re-pair them once per window.
+    if (m_calibrated) Calibrate();
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <chrono>
+#include <deque>
+#include <vector>
+
+// Input-to-photon measurement and frame queue limiting.
+//
+// Inputs are stamped when the game first sees them (event poll or a key
+// going down in the keyboard sampling) and belong to the frame being built.
+// After that frame's display() a fence and a GPU timestamp follow it; once
+// the fence signals, input -> display (CPU side) and input -> GPU done are
+// recorded. Scanout adds up to one refresh on top, which the GL can't see.
+//
+// maxFramesInFlight > 0 blocks at the start of a frame until no more than
+// that many earlier frames are still queued on the GPU. Fewer frames in
+// flight trade throughput for latency; 0 leaves queueing to the driver.
+class LatencyMonitor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    bool enabled{ false };
+    int maxFramesInFlight{ 0 };
+    float reportInterval{ 5.0f };
+
+    // AIRSHIP_LATENCY=1 enables measuring, AIRSHIP_FRAMES_IN_FLIGHT=N limits
+    // the queue.
+    void ConfigureFromEnvironment();
+    // Prints the last window and frees fences and queries; needs the context.
+    void Shutdown();
+
+    void BeginFrame();
+    void MarkInput();
+    void AfterDisplay();
+    void Report();
+
+private:
+    struct Frame {
+        GLsync fence{ nullptr };
+        GLuint query{ 0 };
+        bool hasInput{ false };
+        Clock::time_point input{};
+        Clock::time_point display{};
+    };
+
+    bool Active() const { return enabled || maxFramesInFlight > 0; }
+    void Retire(Frame& f);
+    void Calibrate();
+
+    std::deque<Frame> m_inFlight;
+    std::vector<GLuint> m_freeQueries;
+
+    bool m_pendingInput{ false };
+    Clock::time_point m_firstInput{};
+
+    // GPU timestamps are mapped onto the CPU clock through one paired sample.
+    Clock::time_point m_calibCpu{};
+    GLint64 m_calibGpu{ 0 };
+    bool m_calibrated{ false };
+
+    std::vector<float> m_toDisplayMs;
+    std::vector<float> m_toGpuMs;
+    int m_frames{ 0 };
+    Clock::time_point m_windowStart{ Clock::now() };
+};
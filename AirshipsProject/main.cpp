@@ -2,17 +2,33 @@
 
 #include <SFML/Graphics.hpp>
 #include <iostream>
+#include <string>
 
+#include "cooker.h"
 #include "game.h"
+#include "gl_debug.h"
+#include "gl_resources.h"
+#include "mesh_tool.h"
 
-int main()
+int main(int argc, char** argv)
 {
+    if (argc > 1 && std::string(argv[1]) == "--mesh")
+        return RunMeshTool(argc - 2, argv + 2);
+    if (argc > 1 && std::string(argv[1]) == "--cook")
+        return RunCooker(argc - 2, argv + 2);
+
     sf::ContextSettings settings;
     settings.depthBits = 24;
     settings.stencilBits = 8;
-    settings.majorVersion = 3;
+    // 4.3 enables compute-based culling; SFML falls back to the best
+    // context the driver offers and the game keeps its 3.3 path then.
+    settings.majorVersion = 4;
     settings.minorVersion = 3;
 
+    const bool glDebug = GlDebugRequested(argc, argv);
+    if (glDebug)
+        settings.attributeFlags |= sf::ContextSettings::Debug;
+
     sf::RenderWindow window(
         sf::VideoMode::getDesktopMode(),
         "Delivery Airship",
@@ -30,10 +46,14 @@ int main()
         std::cerr << "Failed to initialize GLEW\n";
         return -1;
     }
+    SelectGlBackend();
+    if (glDebug)
+        InitGlDebug();
 
     Game game(window);
     if (!game.Initialize())
         return -1;
 
     game.Run();
+    ShutdownGlDebug();
 }
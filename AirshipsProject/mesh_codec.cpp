@@ -0,0 +1,1023 @@
+#include "mesh_codec.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "cooked_assets.h"
+#include "model.h"
+
+namespace {
+
+const char kMeshMagic[4] = { 'A', 'M', 'S', 'H' };
+const std::uint32_t kMeshVersion = 2;
+
+const std::uint32_t kHasTangents = 1u << 0;
+
+struct MeshFileHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t sourceStamp;
+    std::uint32_t vertexCount;
+    std::uint32_t indexCount;     // including the LOD ranges
+    std::uint32_t baseIndexCount; // LOD 0 only (Model::indexCount)
+    std::uint32_t flags;
+    std::uint32_t chunkCount;
+    std::uint32_t previewBytes;   // header + meta + first chunk
+    float posMin[3];
+    float posMax[3];
+    float uvMin[2];
+    float uvMax[2];
+    float boundsCenter[3];        // of the decoded positions
+    float boundsRadius;
+};
+
+// Chunks follow the meta stream coarsest level first. Each one adds the
+// vertices its level is the first to use and that level's index range;
+// together they cover every vertex in order and the index buffer back to
+// front (GenerateLods appends coarser levels after LOD 0).
+struct ChunkHeader {
+    std::uint32_t vertexBegin;
+    std::uint32_t vertexEnd;
+    std::uint32_t indexBegin;
+    std::uint32_t indexEnd;
+};
+
+// One per stream, followed by packedSize bytes.
+struct StreamHeader {
+    std::uint32_t method; // 0 stored, 1 LZ
+    std::uint32_t rawSize;
+    std::uint32_t packedSize;
+};
+
+// ---------------------------------------------------------------------------
+// LZ stage: LZ4-style sequences of [token][literal run][offset][match],
+// greedy parsing over a 64K window. No entropy coder on top; the byte
+// planes below leave long zero runs that matches alone collapse.
+
+const size_t kMinMatch = 4;
+const size_t kHashBits = 16;
+const size_t kMaxOffset = 0xFFFF;
+// The tail is always literals so the decoder never reads a match there.
+const size_t kLastLiterals = 8;
+
+std::uint32_t Read32(const std::uint8_t* p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+std::uint32_t HashOf(std::uint32_t v) {
+    return (v * 2654435761u) >> (32 - kHashBits);
+}
+
+void PutLength(std::vector<std::uint8_t>& out, size_t len) {
+    while (len >= 255) {
+        out.push_back(255);
+        len -= 255;
+    }
+    out.push_back(static_cast<std::uint8_t>(len));
+}
+
+bool GetLength(const std::uint8_t*& ip, const std::uint8_t* end, size_t& len) {
+    for (;;) {
+        if (ip >= end) return false;
+        const std::uint8_t b = *ip++;
+        len += b;
+        if (b != 255) return true;
+    }
+}
+
+void EmitSequence(std::vector<std::uint8_t>& out, const std::uint8_t* literals, size_t literalCount, size_t offset, size_t matchLen) {
+    const size_t m = matchLen ? matchLen - kMinMatch : 0;
+    const std::uint8_t token = static_cast<std::uint8_t>((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(m, 15));
+    out.push_back(token);
+    if (literalCount >= 15) PutLength(out, literalCount - 15);
+    out.insert(out.end(), literals, literals + literalCount);
+    if (!matchLen) return;
+
+    out.push_back(static_cast<std::uint8_t>(offset & 0xFF));
+    out.push_back(static_cast<std::uint8_t>(offset >> 8));
+    if (m >= 15) PutLength(out, m - 15);
+}
+
+// ---------------------------------------------------------------------------
+// Vertex transforms.
+
+std::uint16_t ZigZag16(std::uint16_t d) {
+    const std::int16_t s = static_cast<std::int16_t>(d);
+    return static_cast<std::uint16_t>((static_cast<std::uint16_t>(s) << 1) ^ static_cast<std::uint16_t>(s >> 15));
+}
+
+std::uint16_t UnZigZag16(std::uint16_t z) {
+    return static_cast<std::uint16_t>((z >> 1) ^ (0u - (z & 1u)));
+}
+
+std::uint32_t ZigZag32(std::int32_t v) {
+    return (static_cast<std::uint32_t>(v) << 1) ^ static_cast<std::uint32_t>(v >> 31);
+}
+
+std::int32_t UnZigZag32(std::uint32_t z) {
+    return static_cast<std::int32_t>((z >> 1) ^ (0u - (z & 1u)));
+}
+
+std::uint16_t Quantize(float v, float lo, float extent) {
+    if (extent <= 0.0f) return 0;
+    const float t = std::clamp((v - lo) / extent, 0.0f, 1.0f);
+    return static_cast<std::uint16_t>(t * 65535.0f + 0.5f);
+}
+
+// Octahedral map of a direction onto two 16-bit values. Zero vectors land
+// on +Z, which ComputeTangents would have produced anyway.
+void EncodeOct(const glm::vec3& v, std::uint16_t out[2]) {
+    const float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+    float x = 0.0f;
+    float y = 0.0f;
+    if (l1 > 0.0f) {
+        x = v.x / l1;
+        y = v.y / l1;
+        if (v.z < 0.0f) {
+            const float ox = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            const float oy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = ox;
+            y = oy;
+        }
+    }
+    out[0] = Quantize(x, -1.0f, 2.0f);
+    out[1] = Quantize(y, -1.0f, 2.0f);
+}
+
+// Writes the direction with unit L1 norm, not unit length: the vertex
+// shader normalizes it anyway and VertexNormal does for CPU readers, so the
+// decoder skips a square root per vertex.
+void DecodeOct(std::uint16_t qx, std::uint16_t qy, float* out) {
+    float x = qx * (2.0f / 65535.0f) - 1.0f;
+    float y = qy * (2.0f / 65535.0f) - 1.0f;
+    const float z = 1.0f - std::abs(x) - std::abs(y);
+    if (z < 0.0f) {
+        const float ox = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float oy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = ox;
+        y = oy;
+    }
+    out[0] = x;
+    out[1] = y;
+    out[2] = z;
+}
+
+// count * components 16-bit values, delta coded per component against the
+// previous vertex, zigzagged and written as a low-byte plane then a
+// high-byte plane.
+std::vector<std::uint8_t> PackDeltaPlanes(const std::vector<std::uint16_t>& values, size_t components) {
+    const size_t n = values.size();
+    std::vector<std::uint8_t> planes(n * 2);
+    for (size_t i = 0; i < n; ++i) {
+        const std::uint16_t prev = i >= components ? values[i - components] : 0;
+        const std::uint16_t z = ZigZag16(static_cast<std::uint16_t>(values[i] - prev));
+        planes[i] = static_cast<std::uint8_t>(z & 0xFF);
+        planes[n + i] = static_cast<std::uint8_t>(z >> 8);
+    }
+    return planes;
+}
+
+// Undoes PackDeltaPlanes, handing each vertex's N values to emit(v, q) as
+// they come, so callers write them to their final place in one pass.
+template <size_t N, class Emit>
+void UnpackDeltaPlanes(const std::vector<std::uint8_t>& planes, size_t count, Emit&& emit) {
+    const std::uint8_t* low = planes.data();
+    const std::uint8_t* high = low + count * N;
+    std::uint16_t run[N] = {};
+    for (size_t v = 0, i = 0; v < count; ++v) {
+        for (size_t c = 0; c < N; ++c, ++i)
+            run[c] = static_cast<std::uint16_t>(run[c] + UnZigZag16(static_cast<std::uint16_t>(low[i] | (high[i] << 8))));
+        emit(v, run);
+    }
+}
+
+// Index codec. Each triangle gets a control byte: 0..2 if it shares edge k
+// of the previous triangle (in reverse, as consistently wound neighbours
+// do), in which case it is rotated to start with that edge and only the
+// third index is coded; 3 if it stands alone and all three are coded.
+// Indices are coded relative to the next never-seen vertex (starting at
+// the chunk's first vertex), so in first-use order a new vertex costs a
+// zero.
+struct IndexStreams {
+    std::vector<std::uint8_t> control;
+    std::vector<std::uint32_t> codes;
+};
+
+IndexStreams EncodeIndices(const unsigned int* indices, size_t count, std::uint32_t firstVertex) {
+    IndexStreams s;
+    s.control.reserve(count / 3);
+    s.codes.reserve(count / 3 + 8);
+
+    std::uint32_t next = firstVertex;
+    auto Code = [&](std::uint32_t idx) {
+        s.codes.push_back(ZigZag32(static_cast<std::int32_t>(next - idx)));
+        if (idx >= next) next = idx + 1;
+        };
+
+    std::uint32_t prev[3] = { 0, 0, 0 };
+    bool havePrev = false;
+    for (size_t t = 0; t + 2 < count; t += 3) {
+        const std::uint32_t tri[3] = { indices[t], indices[t + 1], indices[t + 2] };
+
+        int edge = 3;
+        int rotation = 0;
+        if (havePrev) {
+            for (int k = 0; k < 3 && edge == 3; ++k) {
+                const std::uint32_t a = prev[(k + 1) % 3];
+                const std::uint32_t b = prev[k];
+                for (int r = 0; r < 3; ++r) {
+                    if (tri[r] == a && tri[(r + 1) % 3] == b) {
+                        edge = k;
+                        rotation = r;
+                        break;
+                    }
+                }
+            }
+        }
+
+        s.control.push_back(static_cast<std::uint8_t>(edge));
+        if (edge == 3) {
+            Code(tri[0]);
+            Code(tri[1]);
+            Code(tri[2]);
+            std::copy(tri, tri + 3, prev);
+        }
+        else {
+            // Cyclic rotation keeps the winding.
+            prev[0] = tri[rotation];
+            prev[1] = tri[(rotation + 1) % 3];
+            prev[2] = tri[(rotation + 2) % 3];
+            Code(prev[2]);
+        }
+        havePrev = true;
+    }
+    return s;
+}
+
+// Writes control.size() * 3 indices, all below vertexLimit.
+bool DecodeIndices(const std::vector<std::uint8_t>& control, const std::vector<std::uint32_t>& codes, std::uint32_t firstVertex,
+    std::uint32_t vertexLimit, unsigned int* out) {
+    std::uint32_t next = firstVertex;
+    size_t c = 0;
+    bool ok = true;
+    auto Read = [&]() {
+        if (c >= codes.size()) {
+            ok = false;
+            return 0u;
+        }
+        const std::uint32_t idx = next - static_cast<std::uint32_t>(UnZigZag32(codes[c++]));
+        if (idx >= vertexLimit) {
+            ok = false;
+            return 0u;
+        }
+        if (idx >= next) next = idx + 1;
+        return idx;
+        };
+
+    std::uint32_t prev[3] = { 0, 0, 0 };
+    for (size_t t = 0; t < control.size() && ok; ++t) {
+        const std::uint8_t edge = control[t];
+        if (edge == 3) {
+            prev[0] = Read();
+            prev[1] = Read();
+            prev[2] = Read();
+        }
+        else if (edge < 3 && t > 0) {
+            const std::uint32_t a = prev[(edge + 1) % 3];
+            const std::uint32_t b = prev[edge];
+            prev[0] = a;
+            prev[1] = b;
+            prev[2] = Read();
+        }
+        else {
+            ok = false;
+        }
+        out[t * 3 + 0] = prev[0];
+        out[t * 3 + 1] = prev[1];
+        out[t * 3 + 2] = prev[2];
+    }
+
+    return ok && c == codes.size();
+}
+
+std::vector<std::uint8_t> Pack32Planes(const std::vector<std::uint32_t>& values) {
+    const size_t n = values.size();
+    std::vector<std::uint8_t> planes(n * 4);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t b = 0; b < 4; ++b)
+            planes[b * n + i] = static_cast<std::uint8_t>(values[i] >> (8 * b));
+    return planes;
+}
+
+std::vector<std::uint32_t> Unpack32Planes(const std::vector<std::uint8_t>& planes) {
+    const size_t n = planes.size() / 4;
+    std::vector<std::uint32_t> values(n);
+    for (size_t i = 0; i < n; ++i)
+        values[i] = planes[i] | (planes[n + i] << 8) | (planes[2 * n + i] << 16) | (static_cast<std::uint32_t>(planes[3 * n + i]) << 24);
+    return values;
+}
+
+// ---------------------------------------------------------------------------
+// Container I/O.
+
+struct ByteWriter {
+    std::vector<std::uint8_t>& out;
+
+    void Bytes(const void* p, size_t n) {
+        const std::uint8_t* b = static_cast<const std::uint8_t*>(p);
+        out.insert(out.end(), b, b + n);
+    }
+    template <class T>
+    void Value(const T& v) { Bytes(&v, sizeof(T)); }
+};
+
+struct ByteReader {
+    const std::uint8_t* p;
+    const std::uint8_t* end;
+    bool ok{ true };
+
+    bool Bytes(void* dst, size_t n) {
+        if (!ok || static_cast<size_t>(end - p) < n) return ok = false;
+        std::memcpy(dst, p, n);
+        p += n;
+        return true;
+    }
+    template <class T>
+    T Value() {
+        T v{};
+        Bytes(&v, sizeof(T));
+        return v;
+    }
+};
+
+void WriteStream(ByteWriter& w, const std::vector<std::uint8_t>& raw) {
+    std::vector<std::uint8_t> packed;
+    LzCompress(raw.data(), raw.size(), packed);
+
+    StreamHeader h{};
+    h.rawSize = static_cast<std::uint32_t>(raw.size());
+    const bool useLz = packed.size() < raw.size();
+    h.method = useLz ? 1 : 0;
+    h.packedSize = static_cast<std::uint32_t>(useLz ? packed.size() : raw.size());
+    w.Value(h);
+    w.Bytes(useLz ? packed.data() : raw.data(), h.packedSize);
+}
+
+bool ReadStream(ByteReader& r, std::vector<std::uint8_t>& raw) {
+    const StreamHeader h = r.Value<StreamHeader>();
+    if (!r.ok || h.method > 1 || static_cast<size_t>(r.end - r.p) < h.packedSize) return false;
+
+    raw.resize(h.rawSize);
+    const std::uint8_t* packed = r.p;
+    r.p += h.packedSize;
+    if (h.method == 1)
+        return LzDecompress(packed, h.packedSize, raw.data(), raw.size());
+    if (h.packedSize != h.rawSize) return false;
+    if (h.rawSize) std::memcpy(raw.data(), packed, h.rawSize);
+    return true;
+}
+
+std::string FileNameOf(const std::string& path) {
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+std::string DirectoryOf(const std::string& path) {
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+bool ReadFileBytes(const std::string& path, std::vector<std::uint8_t>& data) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+
+    const std::streamsize size = file.tellg();
+    if (size <= 0) return false;
+    data.resize(static_cast<size_t>(size));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), size);
+    return static_cast<bool>(file);
+}
+
+bool ReadFilePrefix(const std::string& path, size_t size, std::vector<std::uint8_t>& data) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    data.resize(size);
+    file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(size));
+    return static_cast<bool>(file);
+}
+
+// Index ranges of LOD 0 and each coarser level, or one range over the whole
+// buffer if the LODs aren't laid out the way GenerateLods appends them.
+struct IndexRange {
+    std::uint32_t begin;
+    std::uint32_t end;
+};
+
+std::vector<IndexRange> LevelRanges(const Model& model) {
+    const std::uint32_t total = static_cast<std::uint32_t>(model.indices.size());
+    const std::vector<IndexRange> whole{ { 0, total } };
+    if (model.indexCount < 0 || static_cast<std::uint32_t>(model.indexCount) > total) return whole;
+
+    std::vector<IndexRange> ranges{ { 0, static_cast<std::uint32_t>(model.indexCount) } };
+    std::uint32_t cursor = ranges[0].end;
+    for (const MeshLod& lod : model.lods) {
+        const std::uint32_t begin = cursor;
+        for (const SubMesh& sm : lod.subMeshes) {
+            if (sm.indexOffset != cursor) return whole;
+            cursor += sm.indexCount;
+        }
+        ranges.push_back({ begin, cursor });
+    }
+    return cursor == total ? ranges : whole;
+}
+
+struct PositionDequantizer {
+    glm::vec3 lo;
+    glm::vec3 scale;
+
+    explicit PositionDequantizer(const MeshFileHeader& h) {
+        for (int c = 0; c < 3; ++c) {
+            lo[c] = h.posMin[c];
+            scale[c] = (h.posMax[c] - h.posMin[c]) / 65535.0f;
+        }
+    }
+    glm::vec3 operator()(const std::uint16_t* q) const {
+        return lo + scale * glm::vec3(q[0], q[1], q[2]);
+    }
+};
+
+void WriteChunk(ByteWriter& w, const Model& model, const MeshFileHeader& h, const ChunkHeader& chunk) {
+    w.Value(chunk);
+
+    const size_t first = chunk.vertexBegin;
+    const size_t count = chunk.vertexEnd - chunk.vertexBegin;
+
+    std::vector<std::uint16_t> q(count * 3);
+    for (size_t v = 0; v < count; ++v)
+        for (int c = 0; c < 3; ++c)
+            q[v * 3 + c] = Quantize(model.vertices[first + v][c], h.posMin[c], h.posMax[c] - h.posMin[c]);
+    WriteStream(w, PackDeltaPlanes(q, 3));
+
+    q.resize(count * 2);
+    for (size_t v = 0; v < count; ++v)
+        for (int c = 0; c < 2; ++c)
+            q[v * 2 + c] = Quantize(model.texCoords[first + v][c], h.uvMin[c], h.uvMax[c] - h.uvMin[c]);
+    WriteStream(w, PackDeltaPlanes(q, 2));
+
+    auto WriteDirections = [&](const std::vector<glm::vec3>& dirs) {
+        for (size_t v = 0; v < count; ++v) EncodeOct(dirs[first + v], &q[v * 2]);
+        WriteStream(w, PackDeltaPlanes(q, 2));
+        };
+    WriteDirections(model.normals);
+    if (h.flags & kHasTangents) {
+        WriteDirections(model.tangents);
+        WriteDirections(model.bitangents);
+    }
+
+    const IndexStreams indices = EncodeIndices(model.indices.data() + chunk.indexBegin, chunk.indexEnd - chunk.indexBegin, chunk.vertexBegin);
+    WriteStream(w, indices.control);
+    WriteStream(w, Pack32Planes(indices.codes));
+}
+
+// Offsets into the upload layout (kVertexFloats per vertex).
+const size_t kUvOffset = 3;
+const size_t kNormalOffset = 5;
+const size_t kTangentOffset = 8;
+const size_t kBitangentOffset = 11;
+
+// Decodes the chunk's vertices straight into the interleaved upload layout
+// (vertexOut points at vertex 0, already sized) and its indices into
+// indexOut. Each stream is one pass from the LZ output to its final slots.
+bool ReadChunk(ByteReader& r, const MeshFileHeader& h, const ChunkHeader& chunk, float* vertexOut, unsigned int* indexOut) {
+    const size_t count = chunk.vertexEnd - chunk.vertexBegin;
+    float* const out = vertexOut + static_cast<size_t>(chunk.vertexBegin) * kVertexFloats;
+    std::vector<std::uint8_t> raw;
+
+    if (!ReadStream(r, raw) || raw.size() != count * 6) return false;
+    const PositionDequantizer dequantize(h);
+    UnpackDeltaPlanes<3>(raw, count, [&](size_t v, const std::uint16_t* q) {
+        float* d = out + v * kVertexFloats;
+        for (int c = 0; c < 3; ++c) d[c] = dequantize.lo[c] + dequantize.scale[c] * q[c];
+        });
+
+    if (!ReadStream(r, raw) || raw.size() != count * 4) return false;
+    const float uvLo[2] = { h.uvMin[0], h.uvMin[1] };
+    const float uvScale[2] = { (h.uvMax[0] - h.uvMin[0]) / 65535.0f, (h.uvMax[1] - h.uvMin[1]) / 65535.0f };
+    UnpackDeltaPlanes<2>(raw, count, [&](size_t v, const std::uint16_t* q) {
+        float* d = out + v * kVertexFloats + kUvOffset;
+        d[0] = uvLo[0] + uvScale[0] * q[0];
+        d[1] = uvLo[1] + uvScale[1] * q[1];
+        });
+
+    auto ReadDirections = [&](size_t offset) {
+        if (!ReadStream(r, raw) || raw.size() != count * 4) return false;
+        UnpackDeltaPlanes<2>(raw, count, [&](size_t v, const std::uint16_t* q) {
+            DecodeOct(q[0], q[1], out + v * kVertexFloats + offset);
+            });
+        return true;
+        };
+    if (!ReadDirections(kNormalOffset)) return false;
+    if (h.flags & kHasTangents) {
+        if (!ReadDirections(kTangentOffset) || !ReadDirections(kBitangentOffset)) return false;
+    }
+    else {
+        // The defaults BuildInterleavedVertices uses for missing streams.
+        for (size_t v = 0; v < count; ++v) {
+            float* d = out + v * kVertexFloats;
+            d[kTangentOffset] = 1.0f;
+            d[kBitangentOffset + 1] = 1.0f;
+        }
+    }
+
+    std::vector<std::uint8_t> control;
+    if (!ReadStream(r, control) || control.size() * 3 != chunk.indexEnd - chunk.indexBegin) return false;
+    if (!ReadStream(r, raw) || raw.size() % 4 != 0) return false;
+    return DecodeIndices(control, Unpack32Planes(raw), chunk.vertexBegin, chunk.vertexEnd, indexOut);
+}
+
+// Chunks must tile the vertices front to back and the indices back to front.
+bool ChunkFollows(const ChunkHeader& c, const MeshFileHeader& h, std::uint32_t vertexBegin, std::uint32_t indexEnd) {
+    return c.vertexBegin == vertexBegin && c.vertexEnd >= c.vertexBegin && c.vertexEnd <= h.vertexCount &&
+        c.indexEnd == indexEnd && c.indexBegin <= c.indexEnd && (c.indexEnd - c.indexBegin) % 3 == 0;
+}
+
+struct MeshMeta {
+    std::vector<SubMesh> subMeshes;
+    std::vector<MeshLod> lods;
+    std::vector<std::string> textureNames;
+};
+
+void WriteMeta(ByteWriter& w, const Model& model) {
+    std::vector<std::uint8_t> meta;
+    ByteWriter m{ meta };
+    auto WriteSubMeshes = [&](const std::vector<SubMesh>& subs) {
+        m.Value(static_cast<std::uint32_t>(subs.size()));
+        for (const SubMesh& s : subs) {
+            m.Value(static_cast<std::uint32_t>(s.indexOffset));
+            m.Value(static_cast<std::uint32_t>(s.indexCount));
+        }
+        };
+    WriteSubMeshes(model.subMeshes);
+    m.Value(static_cast<std::uint32_t>(model.lods.size()));
+    for (const MeshLod& lod : model.lods) {
+        m.Value(lod.distanceFactor);
+        WriteSubMeshes(lod.subMeshes);
+    }
+    m.Value(static_cast<std::uint32_t>(model.texturePaths.size()));
+    for (const std::string& path : model.texturePaths) {
+        const std::string name = path.empty() ? std::string() : FileNameOf(path);
+        m.Value(static_cast<std::uint32_t>(name.size()));
+        m.Bytes(name.data(), name.size());
+    }
+    WriteStream(w, meta);
+}
+
+bool ReadMeta(ByteReader& r, const MeshFileHeader& h, MeshMeta& meta) {
+    std::vector<std::uint8_t> raw;
+    if (!ReadStream(r, raw)) return false;
+
+    ByteReader m{ raw.data(), raw.data() + raw.size() };
+    auto ReadSubMeshes = [&](std::vector<SubMesh>& subs) {
+        const std::uint32_t count = m.Value<std::uint32_t>();
+        if (!m.ok || count > raw.size()) return false;
+        subs.resize(count);
+        for (SubMesh& s : subs) {
+            s.indexOffset = m.Value<std::uint32_t>();
+            s.indexCount = m.Value<std::uint32_t>();
+            s.texture = 0;
+            if (static_cast<std::uint64_t>(s.indexOffset) + s.indexCount > h.indexCount) return false;
+        }
+        return m.ok;
+        };
+    if (!ReadSubMeshes(meta.subMeshes)) return false;
+
+    const std::uint32_t lodCount = m.Value<std::uint32_t>();
+    if (!m.ok || lodCount > raw.size()) return false;
+    meta.lods.resize(lodCount);
+    for (MeshLod& lod : meta.lods) {
+        lod.distanceFactor = m.Value<float>();
+        if (!ReadSubMeshes(lod.subMeshes)) return false;
+    }
+
+    const std::uint32_t textureCount = m.Value<std::uint32_t>();
+    if (!m.ok || textureCount > raw.size()) return false;
+    meta.textureNames.resize(textureCount);
+    for (std::string& name : meta.textureNames) {
+        const std::uint32_t len = m.Value<std::uint32_t>();
+        if (!m.ok || len > raw.size()) return false;
+        name.assign(len, '\0');
+        if (!m.Bytes(name.data(), len)) return false;
+    }
+    return true;
+}
+
+bool ReadHeader(ByteReader& r, MeshFileHeader& h, std::uint64_t requireStamp) {
+    h = r.Value<MeshFileHeader>();
+    if (!r.ok || !std::equal(h.magic, h.magic + 4, kMeshMagic) || h.version != kMeshVersion)
+        return false;
+    if (requireStamp != 0 && h.sourceStamp != requireStamp)
+        return false;
+    return h.chunkCount >= 1 && h.indexCount >= h.baseIndexCount;
+}
+
+// Texture paths, bounds and counts shared by full and preview decodes.
+void FinishModel(const MeshFileHeader& h, const MeshMeta& meta, const std::string& textureDir, Model& model) {
+    model.texturePaths.resize(meta.textureNames.size());
+    for (size_t i = 0; i < meta.textureNames.size(); ++i)
+        model.texturePaths[i] = meta.textureNames[i].empty() ? std::string() : textureDir + "/" + meta.textureNames[i];
+
+    // Whole-mesh bounds even for the preview, so placement done against
+    // it still holds once the full mesh replaces it.
+    model.boundsMin = glm::vec3(h.posMin[0], h.posMin[1], h.posMin[2]);
+    model.boundsMax = glm::vec3(h.posMax[0], h.posMax[1], h.posMax[2]);
+    model.minY = model.boundsMin.y;
+    model.maxY = model.boundsMax.y;
+    model.boundsCenter = glm::vec3(h.boundsCenter[0], h.boundsCenter[1], h.boundsCenter[2]);
+    model.boundsRadius = h.boundsRadius;
+}
+
+// Decoded vertices live only in the interleaved buffer. It is zeroed,
+// which the tangent defaults in ReadChunk rely on.
+void ResizeVertexStreams(Model& model, size_t count) {
+    model.vertices.clear();
+    model.texCoords.clear();
+    model.normals.clear();
+    model.tangents.clear();
+    model.bitangents.clear();
+    model.interleaved.assign(count * kVertexFloats, 0.0f);
+}
+
+bool LoadMeshPreview(const std::string& path, Model& model, const std::string& textureDir, std::uint64_t requireStamp, bool& complete) {
+    std::vector<std::uint8_t> bytes;
+    if (!ReadFilePrefix(path, sizeof(MeshFileHeader), bytes)) return false;
+
+    const size_t previewBytes = MeshPreviewSize(bytes.data(), bytes.size());
+    if (previewBytes == 0 || !ReadFilePrefix(path, previewBytes, bytes)) return false;
+
+    MeshFileHeader h;
+    std::memcpy(&h, bytes.data(), sizeof(h));
+    if (!DecodeMeshPreview(bytes.data(), bytes.size(), model, textureDir, requireStamp, complete)) return false;
+
+    if (complete)
+        std::cout << "Loaded mesh " << path << " with " << VertexCount(model) << " vertices.\n";
+    else
+        std::cout << "Streaming mesh " << path << ": coarse level has " << VertexCount(model) << "/" << h.vertexCount
+            << " vertices, " << model.indexCount << "/" << h.baseIndexCount << " indices ("
+            << h.previewBytes / 1024 << " KB read).\n";
+    return true;
+}
+
+}
+
+void LzCompress(const std::uint8_t* src, size_t size, std::vector<std::uint8_t>& out) {
+    out.clear();
+    out.reserve(size / 2 + 16);
+
+    std::vector<std::uint32_t> table(size_t(1) << kHashBits, 0);
+    size_t anchor = 0;
+    size_t i = 0;
+    const size_t limit = size > kLastLiterals + kMinMatch ? size - kLastLiterals - kMinMatch : 0;
+
+    // Lookups skip ahead faster the longer nothing matches, so
+    // incompressible data passes through quickly.
+    size_t misses = 0;
+    while (i < limit) {
+        const std::uint32_t h = HashOf(Read32(src + i));
+        const size_t candidate = table[h];
+        table[h] = static_cast<std::uint32_t>(i);
+
+        if (candidate >= i || i - candidate > kMaxOffset || Read32(src + candidate) != Read32(src + i)) {
+            i += 1 + (misses++ >> 6);
+            continue;
+        }
+        misses = 0;
+
+        size_t len = kMinMatch;
+        const size_t maxLen = size - kLastLiterals - i;
+        while (len < maxLen && src[candidate + len] == src[i + len]) ++len;
+
+        EmitSequence(out, src + anchor, i - anchor, i - candidate, len);
+        i += len;
+        anchor = i;
+        if (i >= 2 && i - 2 < limit) table[HashOf(Read32(src + i - 2))] = static_cast<std::uint32_t>(i - 2);
+    }
+
+    EmitSequence(out, src + anchor, size - anchor, 0, 0);
+}
+
+bool LzDecompress(const std::uint8_t* src, size_t size, std::uint8_t* dst, size_t dstSize) {
+    const std::uint8_t* ip = src;
+    const std::uint8_t* const end = src + size;
+    std::uint8_t* op = dst;
+    std::uint8_t* const opEnd = dst + dstSize;
+
+    while (ip < end) {
+        const std::uint8_t token = *ip++;
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !GetLength(ip, end, literals)) return false;
+        if (static_cast<size_t>(end - ip) < literals || static_cast<size_t>(opEnd - op) < literals) return false;
+        std::memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+
+        if (ip == end) break;
+
+        if (end - ip < 2) return false;
+        const size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t len = token & 15;
+        if (len == 15 && !GetLength(ip, end, len)) return false;
+        len += kMinMatch;
+
+        if (offset == 0 || offset > static_cast<size_t>(op - dst) || static_cast<size_t>(opEnd - op) < len) return false;
+        const std::uint8_t* match = op - offset;
+        if (offset >= len) {
+            std::memcpy(op, match, len);
+            op += len;
+        }
+        else {
+            // Overlapping copy repeats the last `offset` bytes.
+            for (size_t k = 0; k < len; ++k) *op++ = match[k];
+        }
+    }
+
+    return op == opEnd;
+}
+
+
+bool DecodeMeshPreview(const std::uint8_t* data, size_t size, Model& model, const std::string& textureDir,
+    std::uint64_t requireStamp, bool& complete) {
+    ByteReader r{ data, data + size };
+    MeshFileHeader h;
+    MeshMeta meta;
+    if (!ReadHeader(r, h, requireStamp) || !ReadMeta(r, h, meta)) return false;
+
+    complete = h.chunkCount == 1;
+    if (complete) return DecodeMesh(data, size, model, textureDir, requireStamp);
+    if (h.chunkCount != meta.lods.size() + 1) return false;
+
+    const ChunkHeader chunk = r.Value<ChunkHeader>();
+    if (!r.ok || !ChunkFollows(chunk, h, 0, h.indexCount)) return false;
+
+    ResizeVertexStreams(model, chunk.vertexEnd);
+    model.indices.resize(chunk.indexEnd - chunk.indexBegin);
+    if (!ReadChunk(r, h, chunk, model.interleaved.data(), model.indices.data())) return false;
+
+    model.subMeshes = meta.lods.back().subMeshes;
+    for (SubMesh& sm : model.subMeshes) {
+        if (sm.indexOffset < chunk.indexBegin || sm.indexOffset + sm.indexCount > chunk.indexEnd) return false;
+        sm.indexOffset -= chunk.indexBegin;
+    }
+    model.lods.clear();
+    model.indexCount = static_cast<int>(model.indices.size());
+    model.streaming = true;
+    FinishModel(h, meta, textureDir, model);
+    return true;
+}
+
+size_t MeshPreviewSize(const std::uint8_t* data, size_t size) {
+    MeshFileHeader h;
+    if (size < sizeof(h)) return 0;
+    std::memcpy(&h, data, sizeof(h));
+    if (!std::equal(h.magic, h.magic + 4, kMeshMagic) || h.version != kMeshVersion || h.previewBytes < sizeof(h)) return 0;
+    return h.previewBytes;
+}
+
+void OrderVerticesForStreaming(Model& model) {
+    const size_t vertexCount = model.vertices.size();
+    const std::vector<IndexRange> ranges = LevelRanges(model);
+
+    const std::uint32_t unassigned = 0xFFFFFFFFu;
+    std::vector<std::uint32_t> remap(vertexCount, unassigned);
+    std::uint32_t next = 0;
+    for (size_t k = ranges.size(); k-- > 0;) {
+        for (std::uint32_t i = ranges[k].begin; i < ranges[k].end; ++i) {
+            const unsigned int v = model.indices[i];
+            if (v < vertexCount && remap[v] == unassigned) remap[v] = next++;
+        }
+    }
+    for (std::uint32_t& r : remap)
+        if (r == unassigned) r = next++;
+
+    auto Permute = [&](auto& stream) {
+        if (stream.size() != vertexCount) return;
+        auto source = stream;
+        for (size_t v = 0; v < vertexCount; ++v) stream[remap[v]] = source[v];
+        };
+    Permute(model.vertices);
+    Permute(model.texCoords);
+    Permute(model.normals);
+    Permute(model.tangents);
+    Permute(model.bitangents);
+
+    for (unsigned int& i : model.indices)
+        if (i < vertexCount) i = remap[i];
+}
+
+bool EncodeMesh(const Model& model, std::vector<std::uint8_t>& out, std::uint64_t sourceStamp) {
+    const size_t vertexCount = model.vertices.size();
+    const bool valid = model.texCoords.size() == vertexCount && model.normals.size() == vertexCount &&
+        std::all_of(model.indices.begin(), model.indices.end(), [&](unsigned int i) { return i < vertexCount; });
+    const std::vector<IndexRange> ranges = LevelRanges(model);
+    if (!valid || std::any_of(ranges.begin(), ranges.end(), [](const IndexRange& r) { return (r.end - r.begin) % 3 != 0; })) {
+        std::cerr << "Mesh: cannot encode " << model.name << " (inconsistent vertex or index data)\n";
+        return false;
+    }
+    const bool tangents = model.tangents.size() == vertexCount && model.bitangents.size() == vertexCount;
+
+    MeshFileHeader header{};
+    std::memcpy(header.magic, kMeshMagic, 4);
+    header.version = kMeshVersion;
+    header.sourceStamp = sourceStamp;
+    header.vertexCount = static_cast<std::uint32_t>(vertexCount);
+    header.indexCount = static_cast<std::uint32_t>(model.indices.size());
+    header.baseIndexCount = std::min(static_cast<std::uint32_t>(std::max(model.indexCount, 0)), header.indexCount);
+    header.flags = tangents ? kHasTangents : 0u;
+    header.chunkCount = static_cast<std::uint32_t>(ranges.size());
+
+    glm::vec3 lo(0.0f), hi(0.0f);
+    glm::vec2 uvLo(0.0f), uvHi(0.0f);
+    if (vertexCount > 0) {
+        lo = hi = model.vertices[0];
+        uvLo = uvHi = model.texCoords[0];
+    }
+    for (size_t v = 0; v < vertexCount; ++v) {
+        lo = glm::min(lo, model.vertices[v]);
+        hi = glm::max(hi, model.vertices[v]);
+        uvLo = glm::min(uvLo, model.texCoords[v]);
+        uvHi = glm::max(uvHi, model.texCoords[v]);
+    }
+    for (int c = 0; c < 3; ++c) {
+        header.posMin[c] = lo[c];
+        header.posMax[c] = hi[c];
+        header.boundsCenter[c] = (lo[c] + hi[c]) * 0.5f;
+    }
+    for (int c = 0; c < 2; ++c) {
+        header.uvMin[c] = uvLo[c];
+        header.uvMax[c] = uvHi[c];
+    }
+
+    // Radius of what the decoder will produce, as ComputeBounds would see it.
+    const PositionDequantizer dequantize(header);
+    const glm::vec3 center(header.boundsCenter[0], header.boundsCenter[1], header.boundsCenter[2]);
+    float r2 = 0.0f;
+    for (const glm::vec3& p : model.vertices) {
+        std::array<std::uint16_t, 3> q;
+        for (int c = 0; c < 3; ++c) q[c] = Quantize(p[c], lo[c], hi[c] - lo[c]);
+        const glm::vec3 d = dequantize(q.data()) - center;
+        r2 = std::max(r2, glm::dot(d, d));
+    }
+    header.boundsRadius = std::sqrt(r2);
+
+    out.clear();
+    ByteWriter w{ out };
+    w.Value(header);
+    WriteMeta(w, model);
+
+    std::uint32_t vertexBegin = 0;
+    for (size_t k = ranges.size(); k-- > 0;) {
+        std::uint32_t vertexEnd = vertexBegin;
+        for (std::uint32_t i = ranges[k].begin; i < ranges[k].end; ++i)
+            vertexEnd = std::max(vertexEnd, static_cast<std::uint32_t>(model.indices[i]) + 1);
+        if (k == 0) vertexEnd = header.vertexCount;
+
+        WriteChunk(w, model, header, { vertexBegin, vertexEnd, ranges[k].begin, ranges[k].end });
+        if (k + 1 == ranges.size()) header.previewBytes = static_cast<std::uint32_t>(out.size());
+        vertexBegin = vertexEnd;
+    }
+
+    std::memcpy(out.data(), &header, sizeof(header));
+    return true;
+}
+
+bool DecodeMesh(const std::uint8_t* data, size_t size, Model& model, const std::string& textureDir, std::uint64_t requireStamp) {
+    ByteReader r{ data, data + size };
+    MeshFileHeader h;
+    MeshMeta meta;
+    if (!ReadHeader(r, h, requireStamp) || !ReadMeta(r, h, meta)) return false;
+
+    ResizeVertexStreams(model, h.vertexCount);
+    model.indices.resize(h.indexCount);
+
+    std::uint32_t vertexBegin = 0;
+    std::uint32_t indexEnd = h.indexCount;
+    for (std::uint32_t k = 0; k < h.chunkCount; ++k) {
+        const ChunkHeader chunk = r.Value<ChunkHeader>();
+        if (!r.ok || !ChunkFollows(chunk, h, vertexBegin, indexEnd)) return false;
+        if (!ReadChunk(r, h, chunk, model.interleaved.data(), model.indices.data() + chunk.indexBegin)) return false;
+        vertexBegin = chunk.vertexEnd;
+        indexEnd = chunk.indexBegin;
+    }
+    if (vertexBegin != h.vertexCount || indexEnd != 0) return false;
+
+    model.subMeshes = std::move(meta.subMeshes);
+    model.lods = std::move(meta.lods);
+    model.indexCount = static_cast<int>(h.baseIndexCount);
+    model.streaming = false;
+    FinishModel(h, meta, textureDir, model);
+    return true;
+}
+
+bool SaveMeshFile(const std::string& path, const Model& model, std::uint64_t sourceStamp) {
+    std::vector<std::uint8_t> bytes;
+    if (!EncodeMesh(model, bytes, sourceStamp)) return false;
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(file);
+}
+
+bool LoadMeshFile(const std::string& path, Model& model, const std::string& textureDir, std::uint64_t requireStamp) {
+    std::vector<std::uint8_t> bytes;
+    if (!ReadFileBytes(path, bytes)) return false;
+    if (!DecodeMesh(bytes.data(), bytes.size(), model, textureDir, requireStamp)) return false;
+
+    std::cout << "Loaded mesh " << path << " with " << model.subMeshes.size()
+        << " materials, " << VertexCount(model)
+        << " vertices, " << model.indexCount << " indices.\n";
+    return true;
+}
+
+std::uint64_t SourceStamp(const std::string& path) {
+    std::error_code ec;
+    const std::uintmax_t size = std::filesystem::file_size(path, ec);
+    if (ec) return 0;
+    const auto time = std::filesystem::last_write_time(path, ec);
+    if (ec) return 0;
+
+    const std::uint64_t ticks = static_cast<std::uint64_t>(time.time_since_epoch().count());
+    const std::uint64_t stamp = static_cast<std::uint64_t>(size) * 0x9E3779B97F4A7C15ull ^ ticks;
+    return stamp ? stamp : 1;
+}
+
+bool ImportObjMesh(const std::string& objPath, Model& model) {
+    if (!LoadOBJModel(objPath, model, false)) return false;
+    GenerateLods(model);
+    OrderVerticesForStreaming(model);
+    return true;
+}
+
+bool MeshStream::Open(const std::string& objPath, Model& model, const std::string& cacheDir) {
+    m_path.clear();
+
+    const std::string directory = DirectoryOf(objPath);
+    const std::string fileName = FileNameOf(objPath);
+    const std::string meshName = fileName.substr(0, fileName.find_last_of('.')) + ".amsh";
+
+    auto TryFile = [&](const std::string& path, std::uint64_t stamp) {
+        bool complete = false;
+        if (!FileExists(path) || !LoadMeshPreview(path, model, directory, stamp, complete)) return false;
+        if (!complete) {
+            m_path = path;
+            m_textureDir = directory;
+            m_stamp = stamp;
+        }
+        return true;
+        };
+
+    // Cooked and shipped meshes don't need their OBJ alongside.
+    if (TryFile(CookedPath(objPath, ".amsh"), 0) || TryFile(directory + "/" + meshName, 0))
+        return true;
+
+    const std::uint64_t stamp = SourceStamp(objPath);
+    const std::string cached = cacheDir + "/" + meshName;
+    if (stamp != 0 && TryFile(cached, stamp))
+        return true;
+
+    if (!ImportObjMesh(objPath, model)) return false;
+
+    std::vector<std::uint8_t> bytes;
+    if (!EncodeMesh(model, bytes, stamp)) return true;
+
+    // Continue with the decoded copy so this run sees exactly what later
+    // cached runs will.
+    if (!DecodeMesh(bytes.data(), bytes.size(), model, directory)) {
+        std::cerr << "Mesh: round trip failed for " << objPath << "\n";
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(cacheDir, ec);
+    std::ofstream file(cached, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!file)
+        std::cerr << "Mesh: could not write cache " << cached << "\n";
+    return true;
+}
+
+bool MeshStream::Finish(Model& full) {
+    const std::string path = std::move(m_path);
+    m_path.clear();
+    return !path.empty() && LoadMeshFile(path, full, m_textureDir, m_stamp);
+}
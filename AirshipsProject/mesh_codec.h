@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Model;
+
+// Compressed mesh container (.amsh), used both as the load cache for OBJ
+// files and as a shippable replacement for them.
+//
+// Each vertex attribute is a separate stream: positions and UVs are
+// quantized to 16 bits over their bounds, normals/tangents/bitangents are
+// 16-bit octahedral pairs, and every component is delta coded against the
+// previous vertex. Triangles that share an edge with the one before them
+// (the common case in strip-ordered meshes) cost a 2-bit edge reference plus
+// one index. Streams are then split into byte planes and packed with a small
+// LZ77 codec, so decoding is a memcpy-speed LZ pass plus one prefix sum,
+// fused with the dequantization into the interleaved upload layout.
+//
+// Sub-meshes, the baked LOD ranges and the material texture file names are
+// stored too, so a decoded model skips both parsing and GenerateLods.
+//
+// The file is progressive: after a small header it holds the coarsest LOD
+// with just the vertices it uses, then each finer level adds its indices
+// and the vertices it is first to need. Reading only the head of the file
+// gives a drawable coarse model; see MeshStream.
+bool EncodeMesh(const Model& model, std::vector<std::uint8_t>& out, std::uint64_t sourceStamp = 0);
+// Fills only model.interleaved of the vertex data (see Model). textureDir is
+// prefixed to the stored texture names. A non-zero requireStamp rejects
+// files encoded from a different source.
+bool DecodeMesh(const std::uint8_t* data, size_t size, Model& model, const std::string& textureDir, std::uint64_t requireStamp = 0);
+
+// Only the coarsest level, from the first MeshPreviewSize bytes of an
+// encoded mesh; complete is set (and everything decoded) if the file has
+// no finer levels.
+bool DecodeMeshPreview(const std::uint8_t* data, size_t size, Model& model, const std::string& textureDir, std::uint64_t requireStamp,
+    bool& complete);
+// 0 if data doesn't start with a mesh header.
+size_t MeshPreviewSize(const std::uint8_t* data, size_t size);
+
+bool SaveMeshFile(const std::string& path, const Model& model, std::uint64_t sourceStamp = 0);
+bool LoadMeshFile(const std::string& path, Model& model, const std::string& textureDir, std::uint64_t requireStamp = 0);
+
+// Size and write time of a source file, 0 if missing.
+std::uint64_t SourceStamp(const std::string& path);
+
+// Renumbers vertices in order of first use, coarsest LOD first, so each
+// level's vertices form a prefix of the buffer. Encoding works without
+// it, but then the coarse chunk may span most of the vertices.
+void OrderVerticesForStreaming(Model& model);
+
+// LoadOBJModel without textures, GenerateLods and OrderVerticesForStreaming:
+// the model exactly as it gets encoded.
+bool ImportObjMesh(const std::string& objPath, Model& model);
+
+// Geometry for an OBJ path without touching GL, in up to two steps.
+class MeshStream {
+public:
+    // A cooked mesh (see cooked_assets.h) wins, then a shipped .amsh next
+    // to the OBJ, then a cache entry whose stamp
+    // matches the OBJ, else the OBJ is parsed (textures deferred), LODs are
+    // generated and the cache is written; every path yields the same
+    // decoded data, so caches keyed on the mesh (AO bakes) stay valid
+    // whichever one ran. From a file with LODs only the coarsest level is
+    // read, and model comes back with `streaming` set.
+    bool Open(const std::string& objPath, Model& model, const std::string& cacheDir = "cache");
+
+    // Finer levels still to come.
+    bool Pending() const { return !m_path.empty(); }
+
+    // Reads the whole file into a separate model that can replace the
+    // coarse one in a single swap.
+    bool Finish(Model& full);
+
+private:
+    std::string m_path;
+    std::string m_textureDir;
+    std::uint64_t m_stamp{ 0 };
+};
+
+// Byte-oriented LZ77 stage, exposed for the mesh tool's benchmark.
+void LzCompress(const std::uint8_t* src, size_t size, std::vector<std::uint8_t>& out);
+bool LzDecompress(const std::uint8_t* src, size_t size, std::uint8_t* dst, size_t dstSize);
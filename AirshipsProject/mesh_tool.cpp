@@ -0,0 +1,258 @@
+#include "mesh_tool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mesh_codec.h"
+#include "model.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::string DirectoryOf(const std::string& path) {
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+// Bytes the renderer ends up with: interleaved vertices plus indices.
+size_t DecodedBytes(const Model& model) {
+    return VertexCount(model) * kVertexFloats * sizeof(float) + model.indices.size() * sizeof(unsigned int);
+}
+
+struct RoundTripError {
+    float position{ 0.0f };
+    float texCoord{ 0.0f };
+    float normalDegrees{ 0.0f };
+    bool indicesMatch{ true };
+};
+
+bool SameTriangle(const unsigned int* a, const unsigned int* b) {
+    for (int r = 0; r < 3; ++r)
+        if (a[0] == b[r] && a[1] == b[(r + 1) % 3] && a[2] == b[(r + 2) % 3]) return true;
+    return false;
+}
+
+RoundTripError Compare(const Model& a, const Model& b) {
+    RoundTripError e;
+    if (VertexCount(a) != VertexCount(b) || a.indices.size() != b.indices.size() ||
+        a.subMeshes.size() != b.subMeshes.size() || a.lods.size() != b.lods.size()) {
+        e.indicesMatch = false;
+        return e;
+    }
+
+    for (size_t v = 0; v < VertexCount(a); ++v) {
+        const glm::vec3 dp = glm::abs(VertexPosition(a, v) - VertexPosition(b, v));
+        const glm::vec2 dt = glm::abs(VertexTexCoord(a, v) - VertexTexCoord(b, v));
+        e.position = std::max(e.position, std::max(dp.x, std::max(dp.y, dp.z)));
+        e.texCoord = std::max(e.texCoord, std::max(dt.x, dt.y));
+
+        const glm::vec3 na = VertexNormal(a, v);
+        const float la = glm::length(na);
+        if (la > 0.0f) {
+            const float c = glm::clamp(glm::dot(na / la, VertexNormal(b, v)), -1.0f, 1.0f);
+            e.normalDegrees = std::max(e.normalDegrees, glm::degrees(std::acos(c)));
+        }
+    }
+
+    // Triangles may come back rotated, never rewound.
+    for (size_t t = 0; t + 2 < a.indices.size() && e.indicesMatch; t += 3)
+        e.indicesMatch = SameTriangle(&a.indices[t], &b.indices[t]);
+    return e;
+}
+
+void PrintError(const RoundTripError& e) {
+    std::printf("  max error: position %.6g, uv %.6g, normal %.4f deg, triangles %s\n",
+        e.position, e.texCoord, e.normalDegrees, e.indicesMatch ? "identical" : "DIFFER");
+}
+
+bool WriteObj(const std::string& path, const Model& model) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+
+    const size_t count = VertexCount(model);
+    for (size_t i = 0; i < count; ++i) {
+        const glm::vec3 v = VertexPosition(model, i);
+        std::fprintf(f, "v %.7g %.7g %.7g\n", v.x, v.y, v.z);
+    }
+    // LoadOBJModel flips V on import.
+    for (size_t i = 0; i < count; ++i) {
+        const glm::vec2 t = VertexTexCoord(model, i);
+        std::fprintf(f, "vt %.7g %.7g\n", t.x, 1.0f - t.y);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const glm::vec3 n = VertexNormal(model, i);
+        std::fprintf(f, "vn %.6g %.6g %.6g\n", n.x, n.y, n.z);
+    }
+
+    for (size_t s = 0; s < model.subMeshes.size(); ++s) {
+        const SubMesh& sub = model.subMeshes[s];
+        std::fprintf(f, "g submesh%zu\n", s);
+        for (unsigned int i = 0; i + 2 < sub.indexCount; i += 3) {
+            const unsigned int* tri = &model.indices[sub.indexOffset + i];
+            std::fprintf(f, "f %u/%u/%u %u/%u/%u %u/%u/%u\n",
+                tri[0] + 1, tri[0] + 1, tri[0] + 1, tri[1] + 1, tri[1] + 1, tri[1] + 1, tri[2] + 1, tri[2] + 1, tri[2] + 1);
+        }
+    }
+
+    const bool ok = std::ferror(f) == 0;
+    std::fclose(f);
+    return ok;
+}
+
+int Encode(const std::string& in, const std::string& out) {
+    Model model;
+    if (!ImportObjMesh(in, model)) return 1;
+    if (!SaveMeshFile(out, model)) {
+        std::cerr << "Mesh: could not write " << out << "\n";
+        return 1;
+    }
+    std::cout << "Wrote " << out << "\n";
+    return 0;
+}
+
+int Decode(const std::string& in, const std::string& out) {
+    Model model;
+    if (!LoadMeshFile(in, model, DirectoryOf(in))) {
+        std::cerr << "Mesh: could not read " << in << "\n";
+        return 1;
+    }
+    if (!WriteObj(out, model)) {
+        std::cerr << "Mesh: could not write " << out << "\n";
+        return 1;
+    }
+    std::cout << "Wrote " << out << " (LOD 0 only, no materials)\n";
+    return 0;
+}
+
+int Verify(const std::string& objPath, const std::string& meshPath) {
+    Model source;
+    if (!ImportObjMesh(objPath, source)) return 1;
+
+    std::vector<std::uint8_t> bytes;
+    if (meshPath.empty()) {
+        if (!EncodeMesh(source, bytes)) return 1;
+    }
+    else {
+        FILE* f = std::fopen(meshPath.c_str(), "rb");
+        if (!f) {
+            std::cerr << "Mesh: could not read " << meshPath << "\n";
+            return 1;
+        }
+        std::fseek(f, 0, SEEK_END);
+        bytes.resize(static_cast<size_t>(std::max(std::ftell(f), 0L)));
+        std::fseek(f, 0, SEEK_SET);
+        const size_t got = std::fread(bytes.data(), 1, bytes.size(), f);
+        std::fclose(f);
+        if (got != bytes.size()) return 1;
+    }
+
+    Model decoded;
+    if (!DecodeMesh(bytes.data(), bytes.size(), decoded, DirectoryOf(objPath))) {
+        std::cerr << "Mesh: decode failed\n";
+        return 1;
+    }
+
+    const RoundTripError e = Compare(source, decoded);
+    PrintError(e);
+    return e.indicesMatch ? 0 : 1;
+}
+
+int Bench(const std::string& objPath, int runs) {
+    runs = std::max(runs, 1);
+
+    Clock::time_point start = Clock::now();
+    Model source;
+    if (!ImportObjMesh(objPath, source)) return 1;
+    const double parseSeconds = SecondsSince(start);
+
+    FILE* f = std::fopen(objPath.c_str(), "rb");
+    long objBytes = 0;
+    if (f) {
+        std::fseek(f, 0, SEEK_END);
+        objBytes = std::ftell(f);
+        std::fclose(f);
+    }
+
+    std::vector<std::uint8_t> bytes;
+    start = Clock::now();
+    if (!EncodeMesh(source, bytes)) return 1;
+    const double encodeSeconds = SecondsSince(start);
+
+    // Best of N, so the number reflects the codec rather than the first
+    // touch of freshly allocated vectors.
+    double decodeSeconds = 1e30;
+    Model decoded;
+    for (int i = 0; i < runs; ++i) {
+        start = Clock::now();
+        if (!DecodeMesh(bytes.data(), bytes.size(), decoded, DirectoryOf(objPath))) {
+            std::cerr << "Mesh: decode failed\n";
+            return 1;
+        }
+        decodeSeconds = std::min(decodeSeconds, SecondsSince(start));
+    }
+
+    // What the first frame waits for with progressive loading.
+    const size_t previewBytes = MeshPreviewSize(bytes.data(), bytes.size());
+    double previewSeconds = 1e30;
+    Model preview;
+    bool complete = false;
+    for (int i = 0; i < runs && previewBytes; ++i) {
+        start = Clock::now();
+        if (!DecodeMeshPreview(bytes.data(), previewBytes, preview, DirectoryOf(objPath), 0, complete)) {
+            std::cerr << "Mesh: preview decode failed\n";
+            return 1;
+        }
+        previewSeconds = std::min(previewSeconds, SecondsSince(start));
+    }
+
+    const double mb = DecodedBytes(source) / (1024.0 * 1024.0);
+    std::printf("%s: %zu vertices, %zu indices (%zu LOD levels), %.1f MB decoded\n",
+        objPath.c_str(), source.vertices.size(), source.indices.size(), source.lods.size(), mb);
+    std::printf("  OBJ   %8.2f MB  parse + LODs %8.1f ms  %8.1f MB/s\n",
+        objBytes / (1024.0 * 1024.0), parseSeconds * 1e3, mb / parseSeconds);
+    std::printf("  AMSH  %8.2f MB  encode       %8.1f ms\n", bytes.size() / (1024.0 * 1024.0), encodeSeconds * 1e3);
+    std::printf("                    decode       %8.1f ms  %8.1f MB/s  (%.1fx faster than OBJ)\n",
+        decodeSeconds * 1e3, mb / decodeSeconds, parseSeconds / decodeSeconds);
+    std::printf("  ratio %.2f:1 vs decoded, %.2f:1 vs OBJ\n",
+        DecodedBytes(source) / static_cast<double>(bytes.size()), objBytes / static_cast<double>(bytes.size()));
+    std::printf("  coarse %7.2f MB  decode       %8.1f ms  %zu vertices, %d indices%s\n",
+        previewBytes / (1024.0 * 1024.0), previewSeconds * 1e3, VertexCount(preview), preview.indexCount,
+        complete ? " (no LODs, whole mesh)" : "");
+    PrintError(Compare(source, decoded));
+    return 0;
+}
+
+void Usage() {
+    std::cerr << "usage: --mesh encode <in.obj> <out.amsh>\n"
+        "       --mesh decode <in.amsh> <out.obj>\n"
+        "       --mesh verify <in.obj> [in.amsh]\n"
+        "       --mesh bench <in.obj> [runs]\n";
+}
+
+}
+
+int RunMeshTool(int argc, char** argv) {
+    if (argc < 2) {
+        Usage();
+        return 2;
+    }
+
+    const std::string command = argv[0];
+    if (command == "encode" && argc == 3) return Encode(argv[1], argv[2]);
+    if (command == "decode" && argc == 3) return Decode(argv[1], argv[2]);
+    if (command == "verify") return Verify(argv[1], argc > 2 ? argv[2] : "");
+    if (command == "bench") return Bench(argv[1], argc > 2 ? std::atoi(argv[2]) : 5);
+
+    Usage();
+    return 2;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Command line front end for the .amsh mesh format, run as
+// `AirshipsProject --mesh <command> ...` before any window is created:
+//
+//   encode <in.obj> <out.amsh>   parse, build LODs and write a shippable mesh
+//   decode <in.amsh> <out.obj>   write LOD 0 back out as OBJ
+//   verify <in.obj> [in.amsh]    round trip and report the largest errors
+//   bench  <in.obj> [runs]       OBJ parse + LODs vs .amsh decode throughput,
+//                                and the coarse level progressive loads wait for
+//
+// Returns the process exit code.
+int RunMeshTool(int argc, char** argv);
@@ -0,0 +1,283 @@
+#include "minimap.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+#include "gl_debug.h"
+#include "shader_utils.h"
+#include "terrain.h"
+
+static const GLuint kHeightmapTextureUnit = 3;
+
+namespace {
+
+std::uint32_t PackColor(const glm::vec4& c) {
+    auto Byte = [](float v) { return static_cast<std::uint32_t>(glm::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); };
+    return Byte(c.x) | (Byte(c.y) << 8) | (Byte(c.z) << 16) | (Byte(c.w) << 24);
+}
+
+// Atlas rectangle of one tile, in uv.
+glm::vec4 TileRect(int tx, int ty) {
+    const float s = 1.0f / Minimap::kTiles;
+    return glm::vec4(tx * s, ty * s, (tx + 1) * s, (ty + 1) * s);
+}
+
+}
+
+Minimap::~Minimap() {
+    Shutdown();
+}
+
+bool Minimap::Initialize() {
+    m_tileProgram = CreateShaderProgramFromFiles("minimap_quad.vert", "minimap_tile.frag");
+    m_blitProgram = CreateShaderProgramFromFiles("minimap_quad.vert", "minimap_blit.frag");
+    m_spriteProgram = CreateShaderProgramFromFiles("minimap_sprite.vert", "minimap_sprite.frag");
+    for (GLuint* program : { &m_tileProgram, &m_blitProgram, &m_spriteProgram }) {
+        if (*program && *program != static_cast<GLuint>(-1)) continue;
+        std::cerr << "Minimap: shaders failed, minimap disabled\n";
+        *program = 0;
+        Shutdown();
+        return false;
+    }
+
+    m_uTileWorld = glGetUniformLocation(m_tileProgram, "u_tileWorld");
+    m_uTerrain = glGetUniformLocation(m_tileProgram, "u_terrain");
+    m_uHeightRange = glGetUniformLocation(m_tileProgram, "u_heightRange");
+    m_uSpriteMap = glGetUniformLocation(m_spriteProgram, "u_halfSize");
+    m_uSpriteRect = glGetUniformLocation(m_spriteProgram, "u_rect");
+    glUseProgram(m_tileProgram);
+    glUniform1i(glGetUniformLocation(m_tileProgram, "u_heightmap"), kHeightmapTextureUnit);
+    glUseProgram(m_blitProgram);
+    glUniform1i(glGetUniformLocation(m_blitProgram, "u_atlas"), 0);
+    glUseProgram(0);
+
+    const int atlasSize = kTiles * kTileSize;
+    glGenTextures(1, &m_atlas);
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlasSize, atlasSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    LabelGlObject(GL_TEXTURE, m_atlas, "minimap tiles");
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_atlas, 0);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Minimap: tile framebuffer incomplete (0x" << std::hex << status << std::dec << "), minimap disabled\n";
+        Shutdown();
+        return false;
+    }
+
+    // Quads come from gl_VertexID; the sprite VAOs only carry instances.
+    glGenVertexArrays(1, &m_quadVao);
+
+    auto MakeSpriteVao = [](GLuint& vao, GLuint& vbo) {
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Sprite), (void*)offsetof(Sprite, placement));
+        glVertexAttribDivisor(0, 1);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Sprite), (void*)offsetof(Sprite, color));
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Sprite), (void*)offsetof(Sprite, shape));
+        glVertexAttribDivisor(2, 1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        };
+    MakeSpriteVao(m_featureVao, m_featureVbo);
+    MakeSpriteVao(m_markerVao, m_markerVbo);
+    return true;
+}
+
+void Minimap::Shutdown() {
+    if (m_featureVbo) glDeleteBuffers(1, &m_featureVbo);
+    if (m_markerVbo) glDeleteBuffers(1, &m_markerVbo);
+    for (GLuint* vao : { &m_quadVao, &m_featureVao, &m_markerVao })
+        if (*vao) glDeleteVertexArrays(1, vao);
+    if (m_fbo) glDeleteFramebuffers(1, &m_fbo);
+    if (m_atlas) glDeleteTextures(1, &m_atlas);
+    for (GLuint* program : { &m_tileProgram, &m_blitProgram, &m_spriteProgram })
+        if (*program) glDeleteProgram(*program);
+    m_featureVbo = m_markerVbo = m_quadVao = m_featureVao = m_markerVao = 0;
+    m_fbo = m_atlas = m_tileProgram = m_blitProgram = m_spriteProgram = 0;
+    m_featureCapacity = m_markerCapacity = 0;
+}
+
+void Minimap::SetWorld(const Terrain* terrain, float halfSize) {
+    m_terrain = terrain;
+    m_halfSize = halfSize;
+    m_hasWorld = true;
+
+    m_heightMin = 0.0f;
+    m_heightMax = 1.0f;
+    if (m_terrain) {
+        m_terrain->HeightRange(glm::vec2(-halfSize), glm::vec2(halfSize), m_heightMin, m_heightMax);
+        m_heightMax = std::max(m_heightMax, m_heightMin + 0.01f);
+    }
+
+    m_features.clear();
+    m_featuresChanged = true;
+    std::fill(std::begin(m_dirty), std::end(m_dirty), true);
+}
+
+int Minimap::AddFeature(const glm::vec2& xz, float radius, const glm::vec4& color, MinimapShape shape) {
+    const Sprite s{ glm::vec4(xz.x, xz.y, radius, 0.0f), PackColor(color), static_cast<float>(shape) };
+    m_features.push_back(s);
+    m_featuresChanged = true;
+    DirtyFootprint(s);
+    return static_cast<int>(m_features.size()) - 1;
+}
+
+void Minimap::SetFeatureColor(int feature, const glm::vec4& color) {
+    if (feature < 0 || feature >= static_cast<int>(m_features.size())) return;
+    Sprite& s = m_features[feature];
+    const std::uint32_t packed = PackColor(color);
+    if (s.color == packed) return;
+    s.color = packed;
+    m_featuresChanged = true;
+    DirtyFootprint(s);
+}
+
+void Minimap::DirtyFootprint(const Sprite& s) {
+    // Same mapping as minimap_sprite.vert: +x right, -z up.
+    auto TileOf = [&](float uv) {
+        return std::clamp(static_cast<int>(std::floor(uv * kTiles)), 0, kTiles - 1);
+        };
+    const float scale = 0.5f / m_halfSize;
+    const float r = s.placement.z;
+    const int tx0 = TileOf((s.placement.x - r + m_halfSize) * scale);
+    const int tx1 = TileOf((s.placement.x + r + m_halfSize) * scale);
+    const int ty0 = TileOf((m_halfSize - s.placement.y - r) * scale);
+    const int ty1 = TileOf((m_halfSize - s.placement.y + r) * scale);
+    for (int ty = ty0; ty <= ty1; ++ty)
+        for (int tx = tx0; tx <= tx1; ++tx)
+            m_dirty[ty * kTiles + tx] = true;
+}
+
+int Minimap::DirtyTiles() const {
+    if (!Ready() || !m_hasWorld) return 0;
+    return static_cast<int>(std::count(std::begin(m_dirty), std::end(m_dirty), true));
+}
+
+void Minimap::UploadSprites(GLuint buffer, GLsizeiptr& capacity, const std::vector<Sprite>& sprites) {
+    const GLsizeiptr bytes = static_cast<GLsizeiptr>(sprites.size() * sizeof(Sprite));
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    capacity = std::max<GLsizeiptr>({ capacity, bytes, 1024 });
+    glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    if (bytes > 0) glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, sprites.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Minimap::DrawSprites(GLuint vao, GLsizei count, const glm::vec4& uvRect) {
+    if (count == 0) return;
+    glUseProgram(m_spriteProgram);
+    glUniform1f(m_uSpriteMap, m_halfSize);
+    glUniform4fv(m_uSpriteRect, 1, glm::value_ptr(uvRect));
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    glBindVertexArray(0);
+}
+
+void Minimap::UpdateTiles() {
+    if (DirtyTiles() == 0) return;
+
+    if (m_featuresChanged) {
+        UploadSprites(m_featureVbo, m_featureCapacity, m_features);
+        m_featuresChanged = false;
+    }
+
+    GLint savedViewport[4];
+    glGetIntegerv(GL_VIEWPORT, savedViewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glDisable(GL_DEPTH_TEST);
+
+    const glm::vec4 terrainParams = m_terrain ? m_terrain->HeightmapParams() : glm::vec4(0.0f);
+    if (m_terrain) m_terrain->BindHeightmap(kHeightmapTextureUnit);
+
+    for (int ty = 0; ty < kTiles; ++ty) {
+        for (int tx = 0; tx < kTiles; ++tx) {
+            if (!m_dirty[ty * kTiles + tx]) continue;
+            m_dirty[ty * kTiles + tx] = false;
+            m_tileRenders++;
+
+            glViewport(tx * kTileSize, ty * kTileSize, kTileSize, kTileSize);
+
+            // The tile's world rectangle; uv.y grows towards -z.
+            const glm::vec4 rect = TileRect(tx, ty);
+            const float size = m_halfSize * 2.0f;
+            const glm::vec4 world(-m_halfSize + rect.x * size, m_halfSize - rect.y * size,
+                -m_halfSize + rect.z * size, m_halfSize - rect.w * size);
+
+            glUseProgram(m_tileProgram);
+            glUniform4fv(m_uTileWorld, 1, glm::value_ptr(world));
+            glUniform4fv(m_uTerrain, 1, glm::value_ptr(terrainParams));
+            glUniform2f(m_uHeightRange, m_heightMin, m_heightMax);
+            glBindVertexArray(m_quadVao);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            glBindVertexArray(0);
+
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            DrawSprites(m_featureVao, static_cast<GLsizei>(m_features.size()), rect);
+            glDisable(GL_BLEND);
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+    glEnable(GL_DEPTH_TEST);
+
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Minimap::AddMarker(const glm::vec2& xz, float radius, const glm::vec2& forward, const glm::vec4& color, MinimapShape shape) {
+    const float heading = std::atan2(forward.x, forward.y);
+    m_markers.push_back(Sprite{ glm::vec4(xz.x, xz.y, radius, heading), PackColor(color), static_cast<float>(shape) });
+}
+
+void Minimap::Draw(int width, int height) {
+    if (!Ready() || !m_hasWorld) return;
+
+    GLint savedViewport[4];
+    glGetIntegerv(GL_VIEWPORT, savedViewport);
+    const int size = std::min({ screenSize, width - margin * 2, height - margin * 2 });
+    if (size <= 0) return;
+    // With the viewport on the map, clip space is the map: markers past
+    // its edge are clipped for free.
+    glViewport(width - margin - size, height - margin - size, size, size);
+    glDisable(GL_DEPTH_TEST);
+
+    glUseProgram(m_blitProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    glBindVertexArray(m_quadVao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+
+    if (!m_markers.empty()) {
+        UploadSprites(m_markerVbo, m_markerCapacity, m_markers);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        DrawSprites(m_markerVao, static_cast<GLsizei>(m_markers.size()), glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
+        glDisable(GL_BLEND);
+    }
+
+    glEnable(GL_DEPTH_TEST);
+    glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class Terrain;
+
+enum class MinimapShape : int { Disc = 0, Square = 1, Arrow = 2 };
+
+// Top-down map of the field in the screen's top-right corner.
+//
+// The static world (shaded heightmap plus house and decoration footprints)
+// is rendered into a kTiles x kTiles grid of tiles in one atlas texture.
+// SetWorld invalidates every tile; SetFeatureColor (a house getting its
+// delivery) invalidates only the tiles under that footprint. UpdateTiles
+// re-renders just the dirty ones, so a typical frame renders none.
+// Moving things are markers: refilled each frame and composited over the
+// atlas in one instanced draw.
+class Minimap {
+public:
+    static constexpr int kTiles = 4;
+    static constexpr int kTileSize = 128;
+
+    int screenSize{ 240 };
+    int margin{ 12 };
+
+    Minimap() = default;
+    ~Minimap();
+
+    Minimap(const Minimap&) = delete;
+    Minimap& operator=(const Minimap&) = delete;
+
+    bool Initialize();
+    void Shutdown();
+    bool Ready() const { return m_spriteProgram != 0; }
+
+    // Covers [-halfSize, halfSize] on x and z; clears the features.
+    void SetWorld(const Terrain* terrain, float halfSize);
+    int AddFeature(const glm::vec2& xz, float radius, const glm::vec4& color, MinimapShape shape);
+    void SetFeatureColor(int feature, const glm::vec4& color);
+
+    int DirtyTiles() const;
+    void UpdateTiles();
+    int TileRenders() const { return m_tileRenders; }
+
+    void ClearMarkers() { m_markers.clear(); }
+    // forward is the marker's heading on the ground plane (x, z).
+    void AddMarker(const glm::vec2& xz, float radius, const glm::vec2& forward, const glm::vec4& color, MinimapShape shape);
+
+    void Draw(int width, int height);
+
+private:
+    struct Sprite {
+        glm::vec4 placement;    // x, z, radius, heading (radians)
+        std::uint32_t color;
+        float shape;
+    };
+
+    void DirtyFootprint(const Sprite& s);
+    void UploadSprites(GLuint buffer, GLsizeiptr& capacity, const std::vector<Sprite>& sprites);
+    void DrawSprites(GLuint vao, GLsizei count, const glm::vec4& uvRect);
+
+    const Terrain* m_terrain{ nullptr };
+    bool m_hasWorld{ false };
+    float m_halfSize{ 1.0f };
+    float m_heightMin{ 0.0f }, m_heightMax{ 1.0f };
+
+    std::vector<Sprite> m_features;
+    std::vector<Sprite> m_markers;
+    bool m_featuresChanged{ false };
+    bool m_dirty[kTiles * kTiles]{};
+    int m_tileRenders{ 0 };
+
+    GLuint m_tileProgram{ 0 };
+    GLuint m_blitProgram{ 0 };
+    GLuint m_spriteProgram{ 0 };
+    GLuint m_atlas{ 0 };
+    GLuint m_fbo{ 0 };
+    GLuint m_quadVao{ 0 };
+    GLuint m_featureVao{ 0 }, m_featureVbo{ 0 };
+    GLuint m_markerVao{ 0 }, m_markerVbo{ 0 };
+    GLsizeiptr m_featureCapacity{ 0 }, m_markerCapacity{ 0 };
+
+    int m_uTileWorld{ -1 }, m_uTerrain{ -1 }, m_uHeightRange{ -1 };
+    int m_uSpriteMap{ -1 }, m_uSpriteRect{ -1 };
+};
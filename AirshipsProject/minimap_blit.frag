@@ -0,0 +1,16 @@
+#version 330 core
+
+// The tile atlas covers the whole field; a dark frame marks the edge.
+
+in vec2 v_uv;
+
+uniform sampler2D u_atlas;
+
+out vec4 FragColor;
+
+void main()
+{
+    vec2 edge = min(v_uv, 1.0 - v_uv);
+    float frame = step(min(edge.x, edge.y), 0.01);
+    FragColor = vec4(mix(texture(u_atlas, v_uv).rgb, vec3(0.05, 0.07, 0.1), frame), 1.0);
+}
@@ -0,0 +1,27 @@
+#version 330 core
+
+// Disc, square or arrow (pointing along +local y) with a dark outline.
+
+in vec2 v_local;
+in vec4 v_color;
+flat in int v_shape;
+
+out vec4 FragColor;
+
+void main()
+{
+    float d;
+    if (v_shape == 0)
+        d = length(v_local) - 1.0;
+    else if (v_shape == 1)
+        d = max(abs(v_local.x), abs(v_local.y)) - 1.0;
+    else
+        d = max(abs(v_local.x) * 1.8 + v_local.y - 1.0, -v_local.y - 0.7);
+
+    float w = max(fwidth(d), 1e-4);
+    float alpha = 1.0 - smoothstep(-w, w, d);
+    if (alpha <= 0.0)
+        discard;
+    float outline = smoothstep(-0.3 - w, -0.3 + w, d);
+    FragColor = vec4(mix(v_color.rgb, v_color.rgb * 0.25, outline), v_color.a * alpha);
+}
@@ -0,0 +1,31 @@
+#version 330 core
+
+// Instanced map sprites: world xz maps to atlas uv with +x right and -z up,
+// then u_rect (a tile, or the whole map) is stretched over the viewport.
+
+layout(location = 0) in vec4 aPlacement;    // x, z, radius, heading
+layout(location = 1) in vec4 aColor;
+layout(location = 2) in float aShape;
+
+uniform float u_halfSize;
+uniform vec4 u_rect;
+
+out vec2 v_local;
+out vec4 v_color;
+flat out int v_shape;
+
+void main()
+{
+    v_local = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+
+    vec2 forward = vec2(sin(aPlacement.w), cos(aPlacement.w));
+    vec2 right = vec2(-forward.y, forward.x);
+    vec2 xz = aPlacement.xy + (right * v_local.x + forward * v_local.y) * aPlacement.z;
+
+    vec2 uv = vec2(xz.x + u_halfSize, u_halfSize - xz.y) / (2.0 * u_halfSize);
+    vec2 clip = (uv - u_rect.xy) / (u_rect.zw - u_rect.xy) * 2.0 - 1.0;
+    gl_Position = vec4(clip, 0.0, 1.0);
+
+    v_color = aColor;
+    v_shape = int(aShape + 0.5);
+}
@@ -0,0 +1,41 @@
+#version 330 core
+
+// One minimap tile of ground: height tint, hillshade and contour lines.
+
+in vec2 v_uv;
+
+uniform sampler2D u_heightmap;
+uniform vec4 u_terrain;         // origin x, origin z, size, texels; size 0 = flat
+uniform vec4 u_tileWorld;       // x, z at uv 0 and x, z at uv 1
+uniform vec2 u_heightRange;
+
+out vec4 FragColor;
+
+float HeightAt(vec2 xz)
+{
+    if (u_terrain.z <= 0.0) return 0.0;
+    vec2 uv = clamp((xz - u_terrain.xy) / u_terrain.z, 0.0, 1.0);
+    uv = (uv * (u_terrain.w - 1.0) + 0.5) / u_terrain.w;
+    return texture(u_heightmap, uv).r;
+}
+
+void main()
+{
+    vec2 xz = mix(u_tileWorld.xy, u_tileWorld.zw, v_uv);
+    float h = HeightAt(xz);
+
+    float e = u_terrain.z > 0.0 ? u_terrain.z / u_terrain.w : 1.0;
+    float dx = HeightAt(xz + vec2(e, 0.0)) - HeightAt(xz - vec2(e, 0.0));
+    float dz = HeightAt(xz + vec2(0.0, e)) - HeightAt(xz - vec2(0.0, e));
+    vec3 n = normalize(vec3(-dx, 2.0 * e, -dz));
+    float shade = clamp(dot(n, normalize(vec3(-0.6, 1.0, -0.6))), 0.0, 1.0);
+
+    float t = clamp((h - u_heightRange.x) / (u_heightRange.y - u_heightRange.x), 0.0, 1.0);
+    vec3 color = mix(vec3(0.30, 0.50, 0.24), vec3(0.62, 0.58, 0.42), t);
+    color *= 0.55 + 0.6 * shade;
+
+    float contour = abs(fract(h) - 0.5);
+    color *= mix(0.8, 1.0, smoothstep(0.0, 0.05, 0.5 - contour));
+
+    FragColor = vec4(color, 1.0);
+}
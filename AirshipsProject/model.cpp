@@ -1,10 +1,14 @@
 #include "model.h"
 #include <fstream>
 #include <cmath>
+#include <algorithm>
+#include <unordered_map>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "gl_resources.h"
+
 void ComputeTangents(Model& model)
 {
     model.tangents.assign(model.vertices.size(), glm::vec3(0.0f));
@@ -77,23 +81,118 @@ void ComputeTangents(Model& model)
     }
 }
 
-static void ComputeBoundsY(Model& model)
+void ComputeBounds(Model& model)
 {
     if (model.vertices.empty()) {
         model.minY = model.maxY = 0.0f;
+        model.boundsCenter = glm::vec3(0.0f);
+        model.boundsRadius = 0.0f;
+        model.boundsMin = model.boundsMax = glm::vec3(0.0f);
         return;
     }
 
-    float minY = model.vertices[0].y;
-    float maxY = model.vertices[0].y;
+    glm::vec3 lo = model.vertices[0];
+    glm::vec3 hi = model.vertices[0];
 
     for (const auto& v : model.vertices) {
-        minY = std::min(minY, v.y);
-        maxY = std::max(maxY, v.y);
+        lo = glm::min(lo, v);
+        hi = glm::max(hi, v);
     }
 
-    model.minY = minY;
-    model.maxY = maxY;
+    model.minY = lo.y;
+    model.maxY = hi.y;
+    model.boundsMin = lo;
+    model.boundsMax = hi;
+
+    model.boundsCenter = (lo + hi) * 0.5f;
+    float r2 = 0.0f;
+    for (const auto& v : model.vertices) {
+        glm::vec3 d = v - model.boundsCenter;
+        r2 = std::max(r2, glm::dot(d, d));
+    }
+    model.boundsRadius = std::sqrt(r2);
+}
+
+// Vertex clustering: every vertex snaps to the first vertex of its grid cell
+// (per submesh, so UVs stay within one texture) and triangles that collapse
+// are dropped. Coarse levels reuse the LOD 0 vertex buffer and only append
+// index ranges, so one VBO/VAO serves every level.
+void GenerateLods(Model& model)
+{
+    model.lods.clear();
+    if (model.vertices.empty() || model.boundsRadius <= 0.0f)
+        return;
+
+    struct Level { int cells; float distanceFactor; };
+    static const Level levels[] = { { 40, 12.0f }, { 14, 30.0f } };
+
+    const glm::vec3 lo = model.boundsCenter - glm::vec3(model.boundsRadius);
+    size_t previousTriangles = model.indices.size() / 3;
+
+    for (const Level& level : levels)
+    {
+        const float cellSize = (2.0f * model.boundsRadius) / level.cells;
+
+        MeshLod lod;
+        lod.distanceFactor = level.distanceFactor;
+
+        std::vector<unsigned int> lodIndices;
+        std::unordered_map<unsigned long long, unsigned int> representative;
+
+        for (size_t s = 0; s < model.subMeshes.size(); ++s)
+        {
+            const SubMesh& src = model.subMeshes[s];
+            representative.clear();
+
+            auto Remap = [&](unsigned int v) {
+                glm::ivec3 c = glm::ivec3((model.vertices[v] - lo) / cellSize);
+                unsigned long long key =
+                    (static_cast<unsigned long long>(c.x & 0xFFFF) << 32) |
+                    (static_cast<unsigned long long>(c.y & 0xFFFF) << 16) |
+                    static_cast<unsigned long long>(c.z & 0xFFFF);
+                return representative.emplace(key, v).first->second;
+                };
+
+            SubMesh dst;
+            dst.indexOffset = static_cast<unsigned int>(model.indices.size() + lodIndices.size());
+            dst.texture = src.texture;
+
+            for (unsigned int i = 0; i + 2 < src.indexCount; i += 3)
+            {
+                unsigned int a = Remap(model.indices[src.indexOffset + i + 0]);
+                unsigned int b = Remap(model.indices[src.indexOffset + i + 1]);
+                unsigned int c = Remap(model.indices[src.indexOffset + i + 2]);
+                if (a == b || b == c || a == c)
+                    continue;
+                lodIndices.insert(lodIndices.end(), { a, b, c });
+            }
+
+            dst.indexCount = static_cast<unsigned int>(model.indices.size() + lodIndices.size()) - dst.indexOffset;
+            lod.subMeshes.push_back(dst);
+        }
+
+        // Not worth a level if it barely removes anything.
+        size_t triangles = lodIndices.size() / 3;
+        if (triangles * 4 > previousTriangles * 3)
+            continue;
+
+        model.indices.insert(model.indices.end(), lodIndices.begin(), lodIndices.end());
+        model.lods.push_back(std::move(lod));
+        previousTriangles = triangles;
+    }
+}
+
+const std::vector<SubMesh>& GetLodSubMeshes(const Model& model, int lod)
+{
+    if (lod <= 0 || model.lods.empty())
+        return model.subMeshes;
+    size_t i = std::min(static_cast<size_t>(lod - 1), model.lods.size() - 1);
+    return model.lods[i].subMeshes;
+}
+
+bool ModelComplete(const Model& model)
+{
+    return model.vao != 0 && !model.streaming;
 }
 
 static std::string GetDirectoryFromPath(const std::string& path)
@@ -111,6 +210,32 @@ static std::string ExtractFileName(const std::string& path)
     return path;
 }
 
+// Same search as LoadMaterialTexture, but only checks that the file is
+// there so the decode and upload can happen elsewhere.
+static std::string ResolveMaterialTexture(aiMaterial* material, const std::string& directory, const std::string& objBaseName)
+{
+    aiString texPathAI;
+
+    if (material->GetTextureCount(aiTextureType_DIFFUSE) > 0 &&
+        material->GetTexture(aiTextureType_DIFFUSE, 0, &texPathAI) == AI_SUCCESS)
+    {
+        std::string fullPath = directory + "/" + ExtractFileName(texPathAI.C_Str());
+        if (FileExists(fullPath))
+            return fullPath;
+    }
+
+    static const char* exts[] = { ".png", ".jpg", ".jpeg", ".bmp", ".tga" };
+
+    for (const char* ext : exts)
+    {
+        std::string fallback = directory + "/" + objBaseName + ext;
+        if (FileExists(fallback))
+            return fallback;
+    }
+
+    return "";
+}
+
 static GLuint LoadMaterialTexture(aiMaterial* material, const std::string& directory, const std::string& objBaseName)
 {
     aiString texPathAI;
@@ -144,7 +269,7 @@ static GLuint LoadMaterialTexture(aiMaterial* material, const std::string& direc
 }
 
 
-bool LoadOBJModel(const std::string& filename, Model& model)
+bool LoadOBJModel(const std::string& filename, Model& model, bool loadTextures)
 {
     Assimp::Importer importer;
     const aiScene* scene = importer.ReadFile(
@@ -168,6 +293,7 @@ bool LoadOBJModel(const std::string& filename, Model& model)
     model.bitangents.clear();
     model.indices.clear();
     model.subMeshes.clear();
+    model.texturePaths.clear();
 
     std::string directory = GetDirectoryFromPath(filename);
     std::string fileOnly = filename.substr(filename.find_last_of("/\\") + 1);
@@ -215,14 +341,20 @@ bool LoadOBJModel(const std::string& filename, Model& model)
         sub.indexCount = model.indices.size() - sub.indexOffset;
 
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-        sub.texture = LoadMaterialTexture(material, directory, baseName);
+        if (loadTextures) {
+            sub.texture = LoadMaterialTexture(material, directory, baseName);
+        }
+        else {
+            sub.texture = 0;
+            model.texturePaths.push_back(ResolveMaterialTexture(material, directory, baseName));
+        }
 
         model.subMeshes.push_back(sub);
     }
 
     model.indexCount = model.indices.size();
     ComputeTangents(model);
-    ComputeBoundsY(model);
+    ComputeBounds(model);
 
     std::cout << "Loaded OBJ with " << model.subMeshes.size()
         << " materials, " << model.vertices.size()
@@ -243,45 +375,29 @@ GLuint LoadTextureFromFile(const std::string& filename)
         return 0;
     }
 
-    GLuint tex = 0;
-    glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
-
-    glTexImage2D(
-        GL_TEXTURE_2D,
-        0,
-        GL_RGBA,
-        img.getSize().x,
-        img.getSize().y,
-        0,
-        GL_RGBA,
-        GL_UNSIGNED_BYTE,
-        img.getPixelsPtr()
-    );
-
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
+    GLuint tex = CreateTextureFromImage(img);
     std::cout << "Loaded texture: " << filename << std::endl;
 
     return tex;
 }
 
-bool InitializeModelGL(Model& model, const std::string& texFile)
+GLuint CreateTextureFromImage(const sf::Image& img)
 {
-    glGenVertexArrays(1, &model.vao);
-    glGenBuffers(1, &model.vbo);
-    glGenBuffers(1, &model.ebo);
+    TextureLevel level;
+    level.width = static_cast<GLsizei>(img.getSize().x);
+    level.height = static_cast<GLsizei>(img.getSize().y);
+    level.data = img.getPixelsPtr();
 
-    glBindVertexArray(model.vao);
+    return CreateTexture2D(GL_RGBA8, &level, 1, true);
+}
+
+std::vector<float> BuildInterleavedVertices(const Model& model)
+{
+    if (!model.interleaved.empty())
+        return model.interleaved;
 
     std::vector<float> vert;
-    vert.reserve(model.vertices.size() * 14);
+    vert.reserve(model.vertices.size() * kVertexFloats);
 
     for (size_t i = 0; i < model.vertices.size(); i++)
     {
@@ -309,11 +425,95 @@ bool InitializeModelGL(Model& model, const std::string& texFile)
         vert.push_back(b.z);
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, model.vbo);
-    glBufferData(GL_ARRAY_BUFFER, vert.size() * sizeof(float), vert.data(), GL_STATIC_DRAW);
+    return vert;
+}
+
+size_t VertexCount(const Model& model)
+{
+    return model.interleaved.empty() ? model.vertices.size() : model.interleaved.size() / kVertexFloats;
+}
+
+static glm::vec3 InterleavedVec3(const Model& model, size_t v, size_t offset)
+{
+    const float* f = &model.interleaved[v * kVertexFloats + offset];
+    return glm::vec3(f[0], f[1], f[2]);
+}
+
+glm::vec3 VertexPosition(const Model& model, size_t v)
+{
+    return model.interleaved.empty() ? model.vertices[v] : InterleavedVec3(model, v, 0);
+}
+
+glm::vec2 VertexTexCoord(const Model& model, size_t v)
+{
+    if (!model.interleaved.empty())
+        return glm::vec2(model.interleaved[v * kVertexFloats + 3], model.interleaved[v * kVertexFloats + 4]);
+    return (v < model.texCoords.size()) ? model.texCoords[v] : glm::vec2(0.0f);
+}
+
+// Decoded directions are left unnormalized (game.vert normalizes anyway).
+glm::vec3 VertexNormal(const Model& model, size_t v)
+{
+    if (!model.interleaved.empty())
+        return glm::normalize(InterleavedVec3(model, v, 5));
+    return (v < model.normals.size()) ? model.normals[v] : glm::vec3(0, 0, 1);
+}
+
+glm::vec3 VertexTangent(const Model& model, size_t v)
+{
+    if (!model.interleaved.empty())
+        return glm::normalize(InterleavedVec3(model, v, 8));
+    return (v < model.tangents.size()) ? model.tangents[v] : glm::vec3(1, 0, 0);
+}
+
+glm::vec3 VertexBitangent(const Model& model, size_t v)
+{
+    if (!model.interleaved.empty())
+        return glm::normalize(InterleavedVec3(model, v, 11));
+    return (v < model.bitangents.size()) ? model.bitangents[v] : glm::vec3(0, 1, 0);
+}
+
+bool UploadModelBuffers(Model& model)
+{
+    // Decoded meshes are uploaded straight from their interleaved buffer.
+    std::vector<float> built;
+    if (model.interleaved.empty())
+        built = BuildInterleavedVertices(model);
+    const std::vector<float>& vert = model.interleaved.empty() ? built : model.interleaved;
+
+    // May run on the upload context, which has no VAO to hold an element
+    // array binding; CreateStaticBuffer never needs one.
+    model.vbo = CreateStaticBuffer(vert.size() * sizeof(float), vert.data());
+    model.ebo = CreateStaticBuffer(model.indices.size() * sizeof(unsigned int), model.indices.data());
+    return model.vbo != 0 && model.ebo != 0;
+}
+
+GLuint CreateVertexArray(GLuint vbo, GLuint ebo)
+{
+    GLuint vao = 0;
+
+    // Interleaved position, uv, normal, tangent, bitangent in binding 0.
+    if (UsingDsa()) {
+        static const GLint sizes[5] = { 3, 2, 3, 3, 3 };
+        glCreateVertexArrays(1, &vao);
+        glVertexArrayVertexBuffer(vao, 0, vbo, 0, 14 * sizeof(float));
+        glVertexArrayElementBuffer(vao, ebo);
+
+        GLuint offset = 0;
+        for (GLuint i = 0; i < 5; ++i) {
+            glEnableVertexArrayAttrib(vao, i);
+            glVertexArrayAttribFormat(vao, i, sizes[i], GL_FLOAT, GL_FALSE, offset * sizeof(float));
+            glVertexArrayAttribBinding(vao, i, 0);
+            offset += sizes[i];
+        }
+        return vao;
+    }
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model.ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, model.indices.size() * sizeof(unsigned int), model.indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
@@ -331,6 +531,20 @@ bool InitializeModelGL(Model& model, const std::string& texFile)
     glEnableVertexAttribArray(4);
 
     glBindVertexArray(0);
+    return vao;
+}
+
+void SetupModelVertexArray(Model& model)
+{
+    model.vao = CreateVertexArray(model.vbo, model.ebo);
+}
+
+bool InitializeModelGL(Model& model, const std::string& texFile)
+{
+    if (!UploadModelBuffers(model))
+        return false;
+
+    SetupModelVertexArray(model);
     return true;
 }
 
@@ -349,10 +563,15 @@ void DestroyModelGL(Model& model)
 }
 
 void DrawModel(const Model& model)
+{
+    DrawModel(model, 0);
+}
+
+void DrawModel(const Model& model, int lod)
 {
     glBindVertexArray(model.vao);
 
-    for (const SubMesh& sm : model.subMeshes)
+    for (const SubMesh& sm : GetLodSubMeshes(model, lod))
     {
         glBindTexture(GL_TEXTURE_2D, sm.texture);
         glDrawElements(
@@ -17,6 +17,15 @@ struct SubMesh {
     GLuint texture = 0;
 };
 
+struct MeshLod {
+    std::vector<SubMesh> subMeshes;
+    float distanceFactor = 0.0f;
+};
+
+// Floats per vertex in the upload layout: position, uv, normal, tangent,
+// bitangent (see CreateVertexArray).
+constexpr size_t kVertexFloats = 14;
+
 struct Model {
     std::vector<glm::vec3> vertices;
     std::vector<glm::vec2> texCoords;
@@ -25,7 +34,17 @@ struct Model {
     std::vector<glm::vec3> bitangents;
     std::vector<unsigned int> indices;
 
+    // Vertices already in the upload layout. DecodeMesh writes only this and
+    // leaves the streams above empty; CPU code that may see either reads
+    // vertices through VertexCount/VertexPosition/... below.
+    std::vector<float> interleaved;
+
     std::vector<SubMesh> subMeshes;
+    std::vector<MeshLod> lods;
+
+    // Per sub-mesh diffuse texture file when LoadOBJModel deferred
+    // texture loading; empty if none was found.
+    std::vector<std::string> texturePaths;
 
     GLuint vao = 0;
     GLuint vbo = 0;
@@ -34,13 +53,41 @@ struct Model {
     int indexCount = 0;
     std::string name;
 
+    // Only the coarsest level is loaded so far (no LODs); the full mesh
+    // replaces it once it has streamed in.
+    bool streaming = false;
+
     float minY = 0.0f;
     float maxY = 0.0f;
+
+    glm::vec3 boundsCenter{ 0.0f };
+    float boundsRadius = 0.0f;
+    glm::vec3 boundsMin{ 0.0f };
+    glm::vec3 boundsMax{ 0.0f };
 };
 
-bool LoadOBJModel(const std::string& filename, Model& model);
+bool FileExists(const std::string& filename);
+bool LoadOBJModel(const std::string& filename, Model& model, bool loadTextures = true);
 GLuint LoadTextureFromFile(const std::string& filename);
+GLuint CreateTextureFromImage(const sf::Image& image);
 bool InitializeModelGL(Model& model, const std::string& textureFile = "");
+std::vector<float> BuildInterleavedVertices(const Model& model);
+size_t VertexCount(const Model& model);
+glm::vec3 VertexPosition(const Model& model, size_t v);
+glm::vec2 VertexTexCoord(const Model& model, size_t v);
+// Unit length; missing streams give the same defaults as the upload.
+glm::vec3 VertexNormal(const Model& model, size_t v);
+glm::vec3 VertexTangent(const Model& model, size_t v);
+glm::vec3 VertexBitangent(const Model& model, size_t v);
+bool UploadModelBuffers(Model& model);
+void SetupModelVertexArray(Model& model);
+GLuint CreateVertexArray(GLuint vbo, GLuint ebo);
 void DestroyModelGL(Model& model);
 void DrawModel(const Model& model);
+void DrawModel(const Model& model, int lod);
 void ComputeTangents(Model& model);
+void ComputeBounds(Model& model);
+void GenerateLods(Model& model);
+const std::vector<SubMesh>& GetLodSubMeshes(const Model& model, int lod);
+// Uploaded and at full detail.
+bool ModelComplete(const Model& model);
@@ -0,0 +1,316 @@
+#include "particles.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+#include "shader_utils.h"
+#include "terrain.h"
+
+static const GLuint kHeightmapTextureUnit = 3;
+
+namespace {
+
+std::uint32_t Hash(std::uint32_t x) {
+    x ^= x >> 16; x *= 0x7feb352dU;
+    x ^= x >> 15; x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+float Rand(std::uint32_t& state) {
+    state = Hash(state + 0x9e3779b9U);
+    return static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+}
+
+glm::vec3 Rand3(std::uint32_t& state) {
+    float x = Rand(state);
+    float y = Rand(state);
+    float z = Rand(state);
+    return { x, y, z };
+}
+
+void SetupParticleAttribs(GLuint vao, GLuint vbo, GLuint divisor) {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+    const GLsizei stride = sizeof(Particle);
+    for (GLuint i = 0; i < 3; ++i) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, stride, (void*)(i * 4 * sizeof(float)));
+        glVertexAttribDivisor(i, divisor);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+}
+
+float ParticleSpawnChance(const ParticleEmitter& emitter, float dt) {
+    if (!emitter.active || emitter.count == 0) return 0.0f;
+    return std::min(1.0f, emitter.rate * dt / static_cast<float>(emitter.count));
+}
+
+void SimulateParticlesCpu(std::vector<Particle>& particles, const std::vector<ParticleEmitter>& emitters, const ParticleStep& step) {
+    const float dt = step.dt;
+    const glm::vec3 wind = step.wind;
+    const std::uint32_t frameHash = Hash(step.frame);
+
+    std::vector<float> chance(emitters.size());
+    for (size_t i = 0; i < emitters.size(); ++i) chance[i] = ParticleSpawnChance(emitters[i], dt);
+
+    for (Particle& p : particles) {
+        const ParticleKind kind = static_cast<ParticleKind>(static_cast<int>(p.kind));
+        std::uint32_t state = Hash(static_cast<std::uint32_t>(p.seed) ^ frameHash);
+
+        if (p.age < p.life) {
+            p.age += dt;
+
+            if (kind == ParticleKind::Trail) {
+                p.velocity += (glm::vec3(0.0f, -1.0f, 0.0f) + wind * 0.6f) * dt;
+                p.velocity *= std::max(0.0f, 1.0f - 2.0f * dt);
+                p.size += 0.5f * dt;
+            }
+            else if (kind == ParticleKind::Rain) {
+                p.velocity += wind * (0.5f * dt);
+            }
+            else {
+                p.velocity += (glm::vec3(0.0f, 0.4f, 0.0f) + wind * 0.8f) * dt;
+                p.velocity *= std::max(0.0f, 1.0f - 0.8f * dt);
+                p.size += 0.9f * dt;
+            }
+
+            p.position += p.velocity * dt;
+
+            const float ground = step.terrain ? step.terrain->HeightAt(p.position.x, p.position.z) : 0.0f;
+            if (kind == ParticleKind::Rain && p.position.y < ground)
+                p.age = p.life;
+            continue;
+        }
+
+        const size_t e = static_cast<size_t>(p.emitter);
+        if (e >= emitters.size() || chance[e] <= 0.0f || !(Rand(state) < chance[e])) continue;
+
+        const glm::vec3 ep = emitters[e].position;
+        const glm::vec3 ev = emitters[e].velocity;
+        p.age = 0.0f;
+
+        if (kind == ParticleKind::Trail) {
+            p.position = ep + (Rand3(state) - 0.5f) * 0.3f;
+            p.velocity = ev * 0.25f + (Rand3(state) - 0.5f) * 0.8f;
+            p.life = 0.6f + 0.6f * Rand(state);
+            p.size = 0.18f;
+        }
+        else if (kind == ParticleKind::Rain) {
+            float a = Rand(state) * 6.2831853f;
+            float r = std::sqrt(Rand(state)) * 6.5f;
+            p.position = ep + glm::vec3(std::cos(a) * r, -1.0f, std::sin(a) * r);
+            p.velocity = ev + glm::vec3(0.0f, -14.0f - 4.0f * Rand(state), 0.0f);
+            p.life = 3.0f;
+            p.size = 0.03f;
+        }
+        else {
+            p.position = ep + (Rand3(state) - 0.5f) * 0.6f;
+            p.velocity = ev * 0.15f + glm::vec3(0.0f, 0.6f, 0.0f) + (Rand3(state) - 0.5f) * 0.5f;
+            p.life = 2.0f + 1.5f * Rand(state);
+            p.size = 0.45f;
+        }
+    }
+}
+
+ParticleSystem::~ParticleSystem() {
+    Shutdown();
+}
+
+bool ParticleSystem::Initialize() {
+    m_renderProgram = CreateShaderProgramFromFiles("particles.vert", "particles.frag");
+    if (!m_renderProgram || m_renderProgram == static_cast<GLuint>(-1)) {
+        std::cerr << "Particles: render shaders failed, particles disabled\n";
+        m_renderProgram = 0;
+        return false;
+    }
+    m_uView = glGetUniformLocation(m_renderProgram, "u_view");
+    m_uProj = glGetUniformLocation(m_renderProgram, "u_projection");
+
+    m_updateProgram = CreateTransformFeedbackProgramFromFile("particles_update.vert", { "tfPosAge", "tfVelLife", "tfParams" });
+    if (m_updateProgram) {
+        m_uDt = glGetUniformLocation(m_updateProgram, "u_dt");
+        m_uFrame = glGetUniformLocation(m_updateProgram, "u_frame");
+        m_uWind = glGetUniformLocation(m_updateProgram, "u_wind");
+        m_uEmitterPos = glGetUniformLocation(m_updateProgram, "u_emitterPos");
+        m_uEmitterVel = glGetUniformLocation(m_updateProgram, "u_emitterVel");
+        m_uTerrain = glGetUniformLocation(m_updateProgram, "u_terrain");
+        glUseProgram(m_updateProgram);
+        glUniform1i(glGetUniformLocation(m_updateProgram, "u_heightmap"), kHeightmapTextureUnit);
+        glUseProgram(0);
+        m_useGpu = true;
+        std::cout << "Particles: transform feedback simulation\n";
+    }
+    else {
+        std::cerr << "Particles: transform feedback shader failed, using CPU simulation\n";
+    }
+    return true;
+}
+
+void ParticleSystem::Shutdown() {
+    DestroyBuffers();
+    if (m_updateProgram) glDeleteProgram(m_updateProgram);
+    if (m_renderProgram) glDeleteProgram(m_renderProgram);
+    m_updateProgram = m_renderProgram = 0;
+    m_useGpu = false;
+}
+
+void ParticleSystem::DestroyBuffers() {
+    for (int i = 0; i < 2; ++i) {
+        if (m_updateVao[i]) glDeleteVertexArrays(1, &m_updateVao[i]);
+        if (m_renderVao[i]) glDeleteVertexArrays(1, &m_renderVao[i]);
+        if (m_buffers[i]) glDeleteBuffers(1, &m_buffers[i]);
+        m_updateVao[i] = m_renderVao[i] = m_buffers[i] = 0;
+    }
+    m_capacity = 0;
+}
+
+void ParticleSystem::ClearEmitters() {
+    m_emitters.clear();
+}
+
+int ParticleSystem::AddEmitter(ParticleKind kind, unsigned int count, float rate) {
+    if (static_cast<int>(m_emitters.size()) >= kMaxEmitters) return -1;
+
+    ParticleEmitter e;
+    e.kind = kind;
+    e.first = m_emitters.empty() ? 0 : m_emitters.back().first + m_emitters.back().count;
+    e.count = count;
+    e.rate = rate;
+    m_emitters.push_back(e);
+    return static_cast<int>(m_emitters.size()) - 1;
+}
+
+void ParticleSystem::SetEmitter(int handle, const glm::vec3& position, const glm::vec3& velocity, bool active) {
+    if (handle < 0 || handle >= static_cast<int>(m_emitters.size())) return;
+    ParticleEmitter& e = m_emitters[handle];
+    e.position = position;
+    e.velocity = velocity;
+    e.active = active;
+}
+
+void ParticleSystem::Build() {
+    if (!m_renderProgram) return;
+    DestroyBuffers();
+
+    m_cpu.clear();
+    for (size_t i = 0; i < m_emitters.size(); ++i) {
+        const ParticleEmitter& e = m_emitters[i];
+        for (unsigned int s = 0; s < e.count; ++s) {
+            Particle p;
+            p.age = 1.0f;
+            p.emitter = static_cast<float>(i);
+            p.seed = static_cast<float>(e.first + s);
+            p.kind = static_cast<float>(static_cast<int>(e.kind));
+            m_cpu.push_back(p);
+        }
+    }
+    m_capacity = m_cpu.size();
+    if (m_capacity == 0) return;
+
+    glGenBuffers(2, m_buffers);
+    glGenVertexArrays(2, m_updateVao);
+    glGenVertexArrays(2, m_renderVao);
+    for (int i = 0; i < 2; ++i) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffers[i]);
+        glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(Particle), m_cpu.data(), GL_DYNAMIC_COPY);
+        SetupParticleAttribs(m_updateVao[i], m_buffers[i], 0);
+        SetupParticleAttribs(m_renderVao[i], m_buffers[i], 1);
+    }
+    m_current = 0;
+
+    std::cout << "Particles: " << m_capacity << " slots in " << m_emitters.size() << " emitters\n";
+}
+
+void ParticleSystem::SetUseGpu(bool gpu) {
+    if (gpu && !m_updateProgram) return;
+    if (gpu == m_useGpu) return;
+
+    // The GPU owns the live state while it simulates; pull it back so the
+    // CPU path continues from the same frame.
+    if (!gpu && m_capacity) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffers[m_current]);
+        glGetBufferSubData(GL_ARRAY_BUFFER, 0, m_capacity * sizeof(Particle), m_cpu.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    m_useGpu = gpu;
+}
+
+void ParticleSystem::Update(float dt) {
+    if (!m_capacity) return;
+
+    ParticleStep step;
+    step.dt = dt;
+    step.frame = m_frame++;
+    step.wind = wind;
+    step.terrain = m_terrain;
+
+    if (!m_useGpu) {
+        SimulateParticlesCpu(m_cpu, m_emitters, step);
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffers[m_current]);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, m_capacity * sizeof(Particle), m_cpu.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
+    }
+
+    glm::vec4 pos[kMaxEmitters];
+    glm::vec4 vel[kMaxEmitters];
+    for (size_t i = 0; i < m_emitters.size(); ++i) {
+        pos[i] = glm::vec4(m_emitters[i].position, ParticleSpawnChance(m_emitters[i], dt));
+        vel[i] = glm::vec4(m_emitters[i].velocity, 0.0f);
+    }
+
+    const GLsizei emitterCount = static_cast<GLsizei>(m_emitters.size());
+    const int next = 1 - m_current;
+
+    glUseProgram(m_updateProgram);
+    glUniform1f(m_uDt, step.dt);
+    glUniform1ui(m_uFrame, step.frame);
+    glUniform3fv(m_uWind, 1, glm::value_ptr(step.wind));
+    glUniform4fv(m_uEmitterPos, emitterCount, glm::value_ptr(pos[0]));
+    glUniform4fv(m_uEmitterVel, emitterCount, glm::value_ptr(vel[0]));
+    glUniform4fv(m_uTerrain, 1, glm::value_ptr(m_terrain ? m_terrain->HeightmapParams() : glm::vec4(0.0f)));
+    if (m_terrain) m_terrain->BindHeightmap(kHeightmapTextureUnit);
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(m_updateVao[m_current]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_buffers[next]);
+
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(m_capacity));
+    glEndTransformFeedback();
+
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    m_current = next;
+}
+
+void ParticleSystem::Draw(const glm::mat4& view, const glm::mat4& proj) {
+    if (!m_capacity) return;
+
+    glUseProgram(m_renderProgram);
+    glUniformMatrix4fv(m_uView, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(m_uProj, 1, GL_FALSE, glm::value_ptr(proj));
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glDepthMask(GL_FALSE);
+
+    glBindVertexArray(m_renderVao[m_current]);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(m_capacity));
+    glBindVertexArray(0);
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
@@ -0,0 +1,15 @@
+#version 330 core
+
+in vec2 v_uv;
+in vec4 v_color;
+
+out vec4 FragColor;
+
+void main()
+{
+    float falloff = max(0.0, 1.0 - dot(v_uv, v_uv));
+    float a = v_color.a * falloff;
+
+    // Additive, premultiplied: order independent, so no sorting is needed.
+    FragColor = vec4(v_color.rgb * a, a);
+}
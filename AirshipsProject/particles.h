@@ -0,0 +1,104 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class Terrain;
+
+enum class ParticleKind {
+    Trail = 0,
+    Rain = 1,
+    Smoke = 2,
+};
+
+// Vertex layout shared by particles_update.vert (transform feedback) and
+// particles.vert (instanced billboards). A slot is dead while age >= life.
+struct Particle {
+    glm::vec3 position{ 0.0f };
+    float age{ 0.0f };
+    glm::vec3 velocity{ 0.0f };
+    float life{ 0.0f };
+    float size{ 0.0f };
+    float emitter{ 0.0f };
+    float seed{ 0.0f };
+    float kind{ 0.0f };
+};
+
+// Each emitter owns a fixed range of slots; dead slots respawn at the
+// emitter with a per-frame chance derived from its rate.
+struct ParticleEmitter {
+    ParticleKind kind{ ParticleKind::Trail };
+    unsigned int first{ 0 };
+    unsigned int count{ 0 };
+    float rate{ 0.0f };
+
+    glm::vec3 position{ 0.0f };
+    glm::vec3 velocity{ 0.0f };
+    bool active{ false };
+};
+
+struct ParticleStep {
+    float dt{ 0.0f };
+    std::uint32_t frame{ 0 };
+    glm::vec3 wind{ 0.0f };
+    const Terrain* terrain{ nullptr };  // rain dies on it; null is flat y = 0
+};
+
+// CPU reference of particles_update.vert; both paths use the same hash so
+// a headless run can be compared against the GPU result slot by slot.
+void SimulateParticlesCpu(std::vector<Particle>& particles, const std::vector<ParticleEmitter>& emitters, const ParticleStep& step);
+float ParticleSpawnChance(const ParticleEmitter& emitter, float dt);
+
+class ParticleSystem {
+public:
+    static constexpr int kMaxEmitters = 64;
+
+    ParticleSystem() = default;
+    ~ParticleSystem();
+
+    ParticleSystem(const ParticleSystem&) = delete;
+    ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+    bool Initialize();
+    void Shutdown();
+
+    void ClearEmitters();
+    int AddEmitter(ParticleKind kind, unsigned int count, float rate);
+    void SetEmitter(int handle, const glm::vec3& position, const glm::vec3& velocity, bool active);
+    void Build();
+    void SetTerrain(const Terrain* terrain) { m_terrain = terrain; }
+
+    void Update(float dt);
+    void Draw(const glm::mat4& view, const glm::mat4& proj);
+
+    void SetUseGpu(bool gpu);
+    bool UsingGpu() const { return m_useGpu; }
+    bool GpuAvailable() const { return m_updateProgram != 0; }
+    size_t Capacity() const { return m_capacity; }
+
+    glm::vec3 wind{ 1.2f, 0.0f, 0.4f };
+
+private:
+    void DestroyBuffers();
+
+    std::vector<ParticleEmitter> m_emitters;
+    const Terrain* m_terrain{ nullptr };
+    std::vector<Particle> m_cpu;
+    size_t m_capacity{ 0 };
+
+    GLuint m_updateProgram{ 0 };
+    GLuint m_renderProgram{ 0 };
+
+    GLuint m_buffers[2]{ 0, 0 };
+    GLuint m_updateVao[2]{ 0, 0 };
+    GLuint m_renderVao[2]{ 0, 0 };
+    int m_current{ 0 };
+
+    bool m_useGpu{ false };
+    std::uint32_t m_frame{ 0 };
+
+    int m_uDt{ -1 }, m_uFrame{ -1 }, m_uWind{ -1 }, m_uEmitterPos{ -1 }, m_uEmitterVel{ -1 }, m_uTerrain{ -1 };
+    int m_uView{ -1 }, m_uProj{ -1 };
+};
@@ -0,0 +1,54 @@
+#version 330 core
+
+// Instanced camera-facing quads, one instance per particle slot. Rain is
+// stretched along its velocity instead of facing the camera fully.
+
+layout(location = 0) in vec4 aPosAge;
+layout(location = 1) in vec4 aVelLife;
+layout(location = 2) in vec4 aParams;   // size, emitter, seed, kind
+
+uniform mat4 u_view;
+uniform mat4 u_projection;
+
+out vec2 v_uv;
+out vec4 v_color;
+
+void main()
+{
+    float age = aPosAge.w;
+    float life = aVelLife.w;
+
+    if (age >= life) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        v_uv = vec2(0.0);
+        v_color = vec4(0.0);
+        return;
+    }
+
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    v_uv = corner;
+
+    vec3 camRight = vec3(u_view[0][0], u_view[1][0], u_view[2][0]);
+    vec3 camUp = vec3(u_view[0][1], u_view[1][1], u_view[2][1]);
+
+    float t = age / life;
+    float size = aParams.x;
+    int kind = int(aParams.w);
+
+    vec3 right = camRight * size;
+    vec3 up = camUp * size;
+
+    if (kind == 1) {
+        up = normalize(aVelLife.xyz) * 0.35;
+        v_color = vec4(0.55, 0.65, 0.85, 0.35);
+    }
+    else if (kind == 0) {
+        v_color = vec4(1.0, 0.8, 0.45, 0.6 * (1.0 - t));
+    }
+    else {
+        v_color = vec4(0.55, 0.55, 0.6, 0.22 * (1.0 - t) * smoothstep(0.0, 0.1, t));
+    }
+
+    vec3 world = aPosAge.xyz + right * corner.x + up * corner.y;
+    gl_Position = u_projection * u_view * vec4(world, 1.0);
+}
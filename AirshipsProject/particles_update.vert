@@ -0,0 +1,122 @@
+#version 330 core
+
+// Transform feedback pass: one vertex per particle slot, no rasterization.
+// Keep in step with SimulateParticlesCpu in particles.cpp.
+
+layout(location = 0) in vec4 aPosAge;
+layout(location = 1) in vec4 aVelLife;
+layout(location = 2) in vec4 aParams;   // size, emitter, seed, kind
+
+uniform float u_dt;
+uniform uint u_frame;
+uniform vec3 u_wind;
+uniform vec4 u_emitterPos[64];          // xyz, spawn chance this frame
+uniform vec4 u_emitterVel[64];
+uniform sampler2D u_heightmap;
+uniform vec4 u_terrain;                 // origin x, origin z, size, texels; size 0 = flat
+
+out vec4 tfPosAge;
+out vec4 tfVelLife;
+out vec4 tfParams;
+
+const int KIND_TRAIL = 0;
+const int KIND_RAIN = 1;
+const int KIND_SMOKE = 2;
+
+uint Hash(uint x)
+{
+    x ^= x >> 16; x *= 0x7feb352du;
+    x ^= x >> 15; x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+float Rand(inout uint state)
+{
+    state = Hash(state + 0x9e3779b9u);
+    return float(state >> 8) * (1.0 / 16777216.0);
+}
+
+vec3 Rand3(inout uint state)
+{
+    float x = Rand(state);
+    float y = Rand(state);
+    float z = Rand(state);
+    return vec3(x, y, z);
+}
+
+float GroundHeight(vec2 xz)
+{
+    if (u_terrain.z <= 0.0) return 0.0;
+    vec2 uv = clamp((xz - u_terrain.xy) / u_terrain.z, 0.0, 1.0);
+    uv = (uv * (u_terrain.w - 1.0) + 0.5) / u_terrain.w;
+    return texture(u_heightmap, uv).r;
+}
+
+void main()
+{
+    vec3 pos = aPosAge.xyz;
+    float age = aPosAge.w;
+    vec3 vel = aVelLife.xyz;
+    float life = aVelLife.w;
+    float size = aParams.x;
+    int emitter = int(aParams.y);
+    int kind = int(aParams.w);
+
+    uint state = Hash(uint(aParams.z) ^ Hash(u_frame));
+
+    if (age < life) {
+        age += u_dt;
+
+        if (kind == KIND_TRAIL) {
+            vel += (vec3(0.0, -1.0, 0.0) + u_wind * 0.6) * u_dt;
+            vel *= max(0.0, 1.0 - 2.0 * u_dt);
+            size += 0.5 * u_dt;
+        }
+        else if (kind == KIND_RAIN) {
+            vel += u_wind * (0.5 * u_dt);
+        }
+        else {
+            vel += (vec3(0.0, 0.4, 0.0) + u_wind * 0.8) * u_dt;
+            vel *= max(0.0, 1.0 - 0.8 * u_dt);
+            size += 0.9 * u_dt;
+        }
+
+        pos += vel * u_dt;
+
+        if (kind == KIND_RAIN && pos.y < GroundHeight(pos.xz))
+            age = life;
+    }
+    else {
+        vec4 e = u_emitterPos[emitter];
+        if (e.w > 0.0 && Rand(state) < e.w) {
+            vec3 ev = u_emitterVel[emitter].xyz;
+            age = 0.0;
+
+            if (kind == KIND_TRAIL) {
+                pos = e.xyz + (Rand3(state) - 0.5) * 0.3;
+                vel = ev * 0.25 + (Rand3(state) - 0.5) * 0.8;
+                life = 0.6 + 0.6 * Rand(state);
+                size = 0.18;
+            }
+            else if (kind == KIND_RAIN) {
+                float a = Rand(state) * 6.2831853;
+                float r = sqrt(Rand(state)) * 6.5;
+                pos = e.xyz + vec3(cos(a) * r, -1.0, sin(a) * r);
+                vel = ev + vec3(0.0, -14.0 - 4.0 * Rand(state), 0.0);
+                life = 3.0;
+                size = 0.03;
+            }
+            else {
+                pos = e.xyz + (Rand3(state) - 0.5) * 0.6;
+                vel = ev * 0.15 + vec3(0.0, 0.6, 0.0) + (Rand3(state) - 0.5) * 0.5;
+                life = 2.0 + 1.5 * Rand(state);
+                size = 0.45;
+            }
+        }
+    }
+
+    tfPosAge = vec4(pos, age);
+    tfVelLife = vec4(vel, life);
+    tfParams = vec4(size, aParams.yzw);
+}
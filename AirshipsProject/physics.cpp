@@ -0,0 +1,437 @@
+#include "physics.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "terrain.h"
+
+namespace {
+
+glm::vec3 Corner(int i) {
+    return glm::vec3((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+}
+
+// Corners of box A that sit inside box B. The normal is B's face of least
+// penetration, pointing out of B. Edge-edge overlaps are missed, which is
+// fine for resting crates but not for thin or fast shapes.
+template <class Emit>
+void CornerContacts(const glm::vec3& posA, const glm::mat3& rotA, const glm::vec3& heA,
+    const glm::vec3& posB, const glm::mat3& rotB, const glm::vec3& heB, Emit&& emit) {
+    const glm::mat3 invB = glm::transpose(rotB);
+    for (int i = 0; i < 8; ++i) {
+        const glm::vec3 world = posA + rotA * (Corner(i) * heA);
+        const glm::vec3 local = invB * (world - posB);
+        const glm::vec3 depth = heB - glm::abs(local);
+        if (depth.x < 0.0f || depth.y < 0.0f || depth.z < 0.0f) continue;
+
+        int axis = 0;
+        if (depth.y < depth[axis]) axis = 1;
+        if (depth.z < depth[axis]) axis = 2;
+
+        glm::vec3 n(0.0f);
+        n[axis] = local[axis] < 0.0f ? -1.0f : 1.0f;
+        emit(world, rotB * n, depth[axis], i);
+    }
+}
+
+void SetOwner(std::vector<int>& owner, int proxy, int value) {
+    if (proxy >= static_cast<int>(owner.size())) owner.resize(proxy + 1, -1);
+    owner[proxy] = value;
+}
+
+glm::vec3 Perpendicular(const glm::vec3& n) {
+    return std::abs(n.x) > 0.57735f ? glm::normalize(glm::vec3(n.y, -n.x, 0.0f)) : glm::normalize(glm::vec3(0.0f, n.z, -n.y));
+}
+
+}
+
+glm::vec3 EulerXYZDegrees(const glm::quat& q) {
+    const glm::mat3 m = glm::mat3_cast(q);
+    const float sy = glm::clamp(m[2][0], -1.0f, 1.0f);
+    float x, z;
+    const float y = std::asin(sy);
+    if (std::abs(sy) < 0.9999f) {
+        x = std::atan2(-m[2][1], m[2][2]);
+        z = std::atan2(-m[1][0], m[0][0]);
+    }
+    else {
+        // Gimbal lock: fold the roll into X.
+        x = std::atan2(m[0][1], m[1][1]);
+        z = 0.0f;
+    }
+    return glm::degrees(glm::vec3(x, y, z));
+}
+
+void RigidBodyWorld::SetScene(SpatialHashGrid* broadphase, const Terrain* terrain) {
+    m_broadphase = broadphase;
+    m_terrain = terrain;
+}
+
+void RigidBodyWorld::Clear() {
+    if (m_broadphase) {
+        for (const RigidBody& b : m_bodies) m_broadphase->Remove(b.proxy);
+        for (const StaticBox& s : m_statics) m_broadphase->Remove(s.proxy);
+    }
+    m_bodies.clear();
+    m_statics.clear();
+    m_proxyOwner.clear();
+    m_awake.clear();
+    m_moved.clear();
+    m_solverSlot.clear();
+    m_movedStamp.clear();
+    m_island.clear();
+    m_islandMin.clear();
+    m_contacts.clear();
+    m_warmStart.clear();
+    m_accumulator = 0.0f;
+}
+
+int RigidBodyWorld::AddStaticBox(const glm::mat4& transform, const glm::vec3& localMin, const glm::vec3& localMax, std::uint32_t tag) {
+    StaticBox s;
+    glm::vec3 scale(glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])));
+    s.rotation = glm::mat3(glm::vec3(transform[0]) / scale.x, glm::vec3(transform[1]) / scale.y, glm::vec3(transform[2]) / scale.z);
+    s.center = glm::vec3(transform * glm::vec4((localMin + localMax) * 0.5f, 1.0f));
+    s.halfExtents = (localMax - localMin) * 0.5f * scale;
+    s.tag = tag;
+
+    const int index = static_cast<int>(m_statics.size());
+    if (m_broadphase) {
+        glm::vec3 extent = glm::abs(s.rotation[0]) * s.halfExtents.x + glm::abs(s.rotation[1]) * s.halfExtents.y + glm::abs(s.rotation[2]) * s.halfExtents.z;
+        s.proxy = m_broadphase->Insert({ s.center - extent, s.center + extent }, tag);
+        SetOwner(m_proxyOwner, s.proxy, -2 - index);
+    }
+    m_statics.push_back(s);
+    return index;
+}
+
+int RigidBodyWorld::AddBox(const glm::vec3& position, const glm::quat& orientation, const glm::vec3& halfExtents, float mass, std::uint32_t tag) {
+    RigidBody b;
+    b.position = position;
+    b.orientation = orientation;
+    b.halfExtents = halfExtents;
+    b.invMass = mass > 0.0f ? 1.0f / mass : 0.0f;
+
+    const glm::vec3 h2 = halfExtents * halfExtents;
+    const glm::vec3 inertia = mass / 3.0f * glm::vec3(h2.y + h2.z, h2.x + h2.z, h2.x + h2.y);
+    b.invInertia = mass > 0.0f ? 1.0f / inertia : glm::vec3(0.0f);
+    b.tag = tag;
+    b.awake = true;
+
+    const int index = static_cast<int>(m_bodies.size());
+    if (m_broadphase) {
+        b.proxy = m_broadphase->Insert(BodyBounds(b), tag);
+        SetOwner(m_proxyOwner, b.proxy, index);
+    }
+    m_bodies.push_back(b);
+    m_awake.push_back(index);
+    m_solverSlot.push_back(-1);
+    m_movedStamp.push_back(0);
+    m_island.push_back(index);
+    m_islandMin.push_back(0.0f);
+    return index;
+}
+
+void RigidBodyWorld::ResetBody(int body, const glm::vec3& position, const glm::quat& orientation, const glm::vec3& velocity) {
+    RigidBody& b = m_bodies[body];
+    WakeArea(BodyBounds(b));
+
+    b.position = position;
+    b.orientation = orientation;
+    b.linearVelocity = velocity;
+    b.angularVelocity = glm::vec3(0.0f);
+    b.touchedTag = 0;
+    Wake(body);
+    if (m_broadphase) m_broadphase->Move(b.proxy, BodyBounds(b));
+}
+
+void RigidBodyWorld::Wake(int body) {
+    RigidBody& b = m_bodies[body];
+    b.sleepTimer = 0.0f;
+    if (b.awake) return;
+    b.awake = true;
+    m_awake.push_back(body);
+}
+
+void RigidBodyWorld::WakeArea(const Aabb& box) {
+    if (!m_broadphase) return;
+
+    std::vector<int> hits;
+    m_broadphase->Query({ box.min - 0.05f, box.max + 0.05f }, [&](int proxy, std::uint32_t) {
+        if (proxy < static_cast<int>(m_proxyOwner.size()) && m_proxyOwner[proxy] >= 0) hits.push_back(m_proxyOwner[proxy]);
+        });
+    for (int b : hits) Wake(b);
+}
+
+Aabb RigidBodyWorld::BodyBounds(const RigidBody& b) const {
+    const glm::mat3 r = glm::mat3_cast(b.orientation);
+    const glm::vec3 extent = glm::abs(r[0]) * b.halfExtents.x + glm::abs(r[1]) * b.halfExtents.y + glm::abs(r[2]) * b.halfExtents.z;
+    return { b.position - extent, b.position + extent };
+}
+
+int RigidBodyWorld::Find(int body) {
+    while (m_island[body] != body) {
+        m_island[body] = m_island[m_island[body]];
+        body = m_island[body];
+    }
+    return body;
+}
+
+void RigidBodyWorld::Union(int a, int b) {
+    a = Find(a);
+    b = Find(b);
+    if (a != b) m_island[std::max(a, b)] = std::min(a, b);
+}
+
+void RigidBodyWorld::Step(float dt) {
+    m_moved.clear();
+    if (++m_stamp == 0) {
+        std::fill(m_movedStamp.begin(), m_movedStamp.end(), 0u);
+        m_stamp = 1;
+    }
+    for (int b : m_awake) m_bodies[b].touchedTag = 0;
+
+    m_accumulator = std::min(m_accumulator + dt, fixedStep * maxSubsteps);
+    m_lastContacts = 0;
+    while (m_accumulator >= fixedStep) {
+        SubStep(fixedStep);
+        m_accumulator -= fixedStep;
+    }
+}
+
+void RigidBodyWorld::SubStep(float h) {
+    if (m_awake.empty()) return;
+
+    // Only bodies awake now are solved; anything woken during collision
+    // acts as static until the next substep.
+    const size_t solved = m_awake.size();
+    m_invInertiaWorld.resize(solved);
+    for (size_t k = 0; k < solved; ++k) {
+        const int i = m_awake[k];
+        RigidBody& b = m_bodies[i];
+        m_solverSlot[i] = static_cast<int>(k);
+        m_island[i] = i;
+
+        b.linearVelocity += gravity * h;
+        b.linearVelocity /= 1.0f + h * 0.05f;
+        b.angularVelocity /= 1.0f + h * 0.5f;
+
+        const glm::mat3 r = glm::mat3_cast(b.orientation);
+        const glm::mat3 scaled(r[0] * b.invInertia.x, r[1] * b.invInertia.y, r[2] * b.invInertia.z);
+        m_invInertiaWorld[k] = scaled * glm::transpose(r);
+
+        if (m_movedStamp[i] != m_stamp) {
+            m_movedStamp[i] = m_stamp;
+            m_moved.push_back(i);
+        }
+    }
+
+    m_contacts.clear();
+    for (size_t k = 0; k < solved; ++k) Collide(m_awake[k]);
+    m_lastContacts += static_cast<int>(m_contacts.size());
+
+    for (Contact& c : m_contacts) Prepare(c, h);
+    for (int it = 0; it < iterations; ++it)
+        for (Contact& c : m_contacts) Solve(c);
+
+    m_warmStart.clear();
+    for (const Contact& c : m_contacts) m_warmStart[c.key] = glm::vec3(c.jn, c.jt[0], c.jt[1]);
+
+    for (size_t k = 0; k < solved; ++k) {
+        const int i = m_awake[k];
+        RigidBody& b = m_bodies[i];
+        b.position += b.linearVelocity * h;
+
+        const glm::quat spin(0.0f, b.angularVelocity.x, b.angularVelocity.y, b.angularVelocity.z);
+        b.orientation = glm::normalize(b.orientation + spin * b.orientation * (0.5f * h));
+
+        if (m_broadphase) m_broadphase->Move(b.proxy, BodyBounds(b));
+    }
+
+    UpdateSleep(h);
+    for (size_t k = 0; k < solved; ++k) m_solverSlot[m_awake[k]] = -1;
+
+    // Drop sleepers; bodies woken during collision stay at the tail.
+    m_awake.erase(std::remove_if(m_awake.begin(), m_awake.end(), [&](int i) { return !m_bodies[i].awake; }), m_awake.end());
+}
+
+void RigidBodyWorld::Collide(int a) {
+    RigidBody& body = m_bodies[a];
+    const glm::mat3 rotA = glm::mat3_cast(body.orientation);
+
+    // Feature keys: the other shape (ground 0, statics 1 + index, bodies
+    // 2^26 + index), which box's corner it is, and the corner index.
+    auto Emit = [&](int b, const glm::vec3& point, const glm::vec3& normal, float depth, std::uint32_t feature) {
+        Contact c;
+        c.key = (static_cast<std::uint64_t>(a) << 32) | feature;
+        c.a = a;
+        c.b = b;
+        c.point = point;
+        c.normal = normal;
+        c.depth = depth;
+        m_contacts.push_back(c);
+        };
+
+    // Ground: every corner below the terrain pushes out along its normal.
+    for (int i = 0; i < 8; ++i) {
+        const glm::vec3 corner = body.position + rotA * (Corner(i) * body.halfExtents);
+        const float ground = m_terrain ? m_terrain->HeightAt(corner.x, corner.z) : 0.0f;
+        if (corner.y >= ground) continue;
+
+        const glm::vec3 n = m_terrain ? m_terrain->NormalAt(corner.x, corner.z) : glm::vec3(0.0f, 1.0f, 0.0f);
+        Emit(-1, corner, n, (ground - corner.y) * n.y, static_cast<std::uint32_t>(i));
+    }
+
+    if (!m_broadphase) return;
+
+    const Aabb bounds = BodyBounds(body);
+    const float speed2 = glm::dot(body.linearVelocity, body.linearVelocity);
+
+    m_broadphase->Query({ bounds.min - 0.02f, bounds.max + 0.02f }, [&](int proxy, std::uint32_t) {
+        if (proxy >= static_cast<int>(m_proxyOwner.size())) return;
+        const int owner = m_proxyOwner[proxy];
+        if (owner == -1 || owner == a) return;
+
+        if (owner <= -2) {
+            const int index = -2 - owner;
+            const StaticBox& s = m_statics[index];
+            const std::uint32_t other = static_cast<std::uint32_t>(1 + index) << 5;
+            bool touched = false;
+            auto Hit = [&](const glm::vec3& p, const glm::vec3& n, float d, std::uint32_t feature) {
+                touched = true;
+                Emit(-1, p, n, d, other | feature);
+                };
+            CornerContacts(body.position, rotA, body.halfExtents, s.center, s.rotation, s.halfExtents,
+                [&](const glm::vec3& p, const glm::vec3& n, float d, int corner) { Hit(p, n, d, corner); });
+            CornerContacts(s.center, s.rotation, s.halfExtents, body.position, rotA, body.halfExtents,
+                [&](const glm::vec3& p, const glm::vec3& n, float d, int corner) { Hit(p, -n, d, 16 | corner); });
+            if (touched) body.touchedTag = s.tag;
+            return;
+        }
+
+        const int b = owner;
+        const bool dynamic = m_solverSlot[b] >= 0;
+        if (dynamic && b < a) return;
+
+        const RigidBody& other = m_bodies[b];
+        const glm::mat3 rotB = glm::mat3_cast(other.orientation);
+        const size_t before = m_contacts.size();
+        const int pairB = dynamic ? b : -1;
+        const std::uint32_t id = ((1u << 26) + static_cast<std::uint32_t>(b)) << 5;
+
+        CornerContacts(body.position, rotA, body.halfExtents, other.position, rotB, other.halfExtents,
+            [&](const glm::vec3& p, const glm::vec3& n, float d, int corner) { Emit(pairB, p, n, d, id | corner); });
+        CornerContacts(other.position, rotB, other.halfExtents, body.position, rotA, body.halfExtents,
+            [&](const glm::vec3& p, const glm::vec3& n, float d, int corner) { Emit(pairB, p, -n, d, id | 16 | corner); });
+
+        if (m_contacts.size() == before) return;
+        if (dynamic) Union(a, b);
+        else if (speed2 > wakeSpeed * wakeSpeed) Wake(b);
+        });
+}
+
+void RigidBodyWorld::Prepare(Contact& c, float h) {
+    const RigidBody& A = m_bodies[c.a];
+    const glm::mat3& invIA = m_invInertiaWorld[m_solverSlot[c.a]];
+    c.rA = c.point - A.position;
+
+    float invMassSum = A.invMass;
+    glm::vec3 vRel = A.linearVelocity + glm::cross(A.angularVelocity, c.rA);
+
+    auto Angular = [&](const glm::vec3& axis) {
+        float k = glm::dot(axis, glm::cross(invIA * glm::cross(c.rA, axis), c.rA));
+        if (c.b >= 0) {
+            const glm::mat3& invIB = m_invInertiaWorld[m_solverSlot[c.b]];
+            k += glm::dot(axis, glm::cross(invIB * glm::cross(c.rB, axis), c.rB));
+        }
+        return k;
+        };
+
+    if (c.b >= 0) {
+        const RigidBody& B = m_bodies[c.b];
+        c.rB = c.point - B.position;
+        invMassSum += B.invMass;
+        vRel -= B.linearVelocity + glm::cross(B.angularVelocity, c.rB);
+    }
+
+    c.massN = 1.0f / (invMassSum + Angular(c.normal));
+    c.tangent[0] = Perpendicular(c.normal);
+    c.tangent[1] = glm::cross(c.normal, c.tangent[0]);
+    for (int k = 0; k < 2; ++k) c.massT[k] = 1.0f / (invMassSum + Angular(c.tangent[k]));
+
+    const float vn = glm::dot(vRel, c.normal);
+    c.bias = baumgarte / h * std::max(c.depth - slop, 0.0f);
+    if (vn < -1.0f) c.bias = std::max(c.bias, -restitution * vn);
+
+    auto warm = m_warmStart.find(c.key);
+    if (warm != m_warmStart.end()) {
+        c.jn = warm->second.x;
+        c.jt[0] = warm->second.y;
+        c.jt[1] = warm->second.z;
+        const glm::vec3 impulse = c.normal * c.jn + c.tangent[0] * c.jt[0] + c.tangent[1] * c.jt[1];
+        ApplyImpulse(c.a, c.rA, impulse);
+        if (c.b >= 0) ApplyImpulse(c.b, c.rB, -impulse);
+    }
+}
+
+void RigidBodyWorld::ApplyImpulse(int body, const glm::vec3& r, const glm::vec3& impulse) {
+    RigidBody& b = m_bodies[body];
+    b.linearVelocity += impulse * b.invMass;
+    b.angularVelocity += m_invInertiaWorld[m_solverSlot[body]] * glm::cross(r, impulse);
+}
+
+void RigidBodyWorld::Solve(Contact& c) {
+    auto RelativeVelocity = [&]() {
+        const RigidBody& A = m_bodies[c.a];
+        glm::vec3 v = A.linearVelocity + glm::cross(A.angularVelocity, c.rA);
+        if (c.b >= 0) {
+            const RigidBody& B = m_bodies[c.b];
+            v -= B.linearVelocity + glm::cross(B.angularVelocity, c.rB);
+        }
+        return v;
+        };
+
+    auto Apply = [&](const glm::vec3& impulse) {
+        ApplyImpulse(c.a, c.rA, impulse);
+        if (c.b >= 0) ApplyImpulse(c.b, c.rB, -impulse);
+        };
+
+    glm::vec3 v = RelativeVelocity();
+    const float jn = std::max(c.jn + c.massN * (c.bias - glm::dot(v, c.normal)), 0.0f);
+    Apply(c.normal * (jn - c.jn));
+    c.jn = jn;
+
+    const float maxFriction = friction * c.jn;
+    for (int k = 0; k < 2; ++k) {
+        v = RelativeVelocity();
+        const float jt = glm::clamp(c.jt[k] - c.massT[k] * glm::dot(v, c.tangent[k]), -maxFriction, maxFriction);
+        Apply(c.tangent[k] * (jt - c.jt[k]));
+        c.jt[k] = jt;
+    }
+}
+
+// An island sleeps only when every body in it has been slow for sleepTime.
+void RigidBodyWorld::UpdateSleep(float h) {
+    const size_t solved = m_invInertiaWorld.size();
+    for (size_t k = 0; k < solved; ++k) m_islandMin[Find(m_awake[k])] = sleepTime;
+
+    for (size_t k = 0; k < solved; ++k) {
+        const int i = m_awake[k];
+        RigidBody& b = m_bodies[i];
+        const bool slow = glm::dot(b.linearVelocity, b.linearVelocity) < sleepLinear * sleepLinear &&
+            glm::dot(b.angularVelocity, b.angularVelocity) < sleepAngular * sleepAngular;
+        b.sleepTimer = slow ? b.sleepTimer + h : 0.0f;
+
+        const int root = Find(i);
+        m_islandMin[root] = std::min(m_islandMin[root], b.sleepTimer);
+    }
+
+    for (size_t k = 0; k < solved; ++k) {
+        const int i = m_awake[k];
+        if (m_islandMin[Find(i)] < sleepTime) continue;
+
+        RigidBody& b = m_bodies[i];
+        b.awake = false;
+        b.linearVelocity = glm::vec3(0.0f);
+        b.angularVelocity = glm::vec3(0.0f);
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "broadphase.h"
+
+class Terrain;
+
+struct RigidBody {
+    glm::vec3 position{ 0.0f };
+    glm::quat orientation{ 1.0f, 0.0f, 0.0f, 0.0f };
+    glm::vec3 linearVelocity{ 0.0f };
+    glm::vec3 angularVelocity{ 0.0f };
+
+    glm::vec3 halfExtents{ 0.5f };
+    float invMass{ 1.0f };
+    glm::vec3 invInertia{ 0.0f };   // body space, diagonal
+
+    float sleepTimer{ 0.0f };
+    bool awake{ false };
+    int proxy{ -1 };
+    std::uint32_t tag{ 0 };
+    std::uint32_t touchedTag{ 0 };  // static box touched during the last Step, 0 if none
+};
+
+// Euler angles (degrees) for the X * Y * Z rotation order MakeModelMatrix uses.
+glm::vec3 EulerXYZDegrees(const glm::quat& q);
+
+// Small box-only rigid body solver: corner contacts against the terrain,
+// static boxes and other bodies, sequential impulses with friction, and
+// island sleeping. Impulses are warm-started from the previous substep by
+// contact feature (body, other shape, corner). Only awake bodies are integrated or collided, so a
+// settled pile costs nothing until something lands on it. Bodies and
+// static boxes live in a broadphase shared with the rest of the scene.
+class RigidBodyWorld {
+public:
+    glm::vec3 gravity{ 0.0f, -9.81f, 0.0f };
+    float fixedStep{ 1.0f / 60.0f };
+    int maxSubsteps{ 4 };
+    int iterations{ 8 };
+
+    float friction{ 0.6f };
+    float restitution{ 0.15f };
+    float slop{ 0.01f };
+    float baumgarte{ 0.2f };
+
+    float sleepLinear{ 0.12f };
+    float sleepAngular{ 0.25f };
+    float sleepTime{ 0.5f };
+    float wakeSpeed{ 1.0f };
+
+    void SetScene(SpatialHashGrid* broadphase, const Terrain* terrain);
+    void Clear();
+
+    int AddStaticBox(const glm::mat4& transform, const glm::vec3& localMin, const glm::vec3& localMax, std::uint32_t tag);
+    int AddBox(const glm::vec3& position, const glm::quat& orientation, const glm::vec3& halfExtents, float mass, std::uint32_t tag);
+
+    // Reuses a body slot; whatever rested on it at the old spot wakes up.
+    void ResetBody(int body, const glm::vec3& position, const glm::quat& orientation, const glm::vec3& velocity);
+    void Wake(int body);
+
+    void Step(float dt);
+
+    RigidBody& Body(int index) { return m_bodies[index]; }
+    const RigidBody& Body(int index) const { return m_bodies[index]; }
+    int BodyCount() const { return static_cast<int>(m_bodies.size()); }
+
+    const std::vector<int>& AwakeBodies() const { return m_awake; }
+    // Bodies integrated during the last Step, including ones that fell asleep.
+    const std::vector<int>& MovedBodies() const { return m_moved; }
+    int LastContactCount() const { return m_lastContacts; }
+
+private:
+    struct StaticBox {
+        glm::vec3 center{ 0.0f };
+        glm::mat3 rotation{ 1.0f };
+        glm::vec3 halfExtents{ 0.0f };
+        std::uint32_t tag{ 0 };
+        int proxy{ -1 };
+    };
+
+    struct Contact {
+        int a{ -1 };
+        int b{ -1 };                // -1 for statics, terrain and sleeping bodies
+        glm::vec3 point{ 0.0f };
+        glm::vec3 normal{ 0.0f };   // from b toward a
+        float depth{ 0.0f };
+        std::uint64_t key{ 0 };
+
+        glm::vec3 rA{ 0.0f }, rB{ 0.0f };
+        glm::vec3 tangent[2];
+        float massN{ 0.0f };
+        float massT[2]{};
+        float bias{ 0.0f };
+        float jn{ 0.0f };
+        float jt[2]{};
+    };
+
+    void SubStep(float h);
+    void Collide(int a);
+    void Prepare(Contact& c, float h);
+    void Solve(Contact& c);
+    void ApplyImpulse(int body, const glm::vec3& r, const glm::vec3& impulse);
+    void UpdateSleep(float h);
+    void WakeArea(const Aabb& box);
+    Aabb BodyBounds(const RigidBody& b) const;
+
+    int Find(int body);
+    void Union(int a, int b);
+
+    SpatialHashGrid* m_broadphase{ nullptr };
+    const Terrain* m_terrain{ nullptr };
+
+    std::vector<RigidBody> m_bodies;
+    std::vector<StaticBox> m_statics;
+    std::vector<int> m_proxyOwner;          // proxy -> body, -2 - static, -1 not ours
+
+    std::vector<int> m_awake;
+    std::vector<int> m_moved;
+    std::vector<int> m_solverSlot;          // body -> index into m_awake this substep, -1 if not solved
+    std::vector<std::uint32_t> m_movedStamp;
+    std::uint32_t m_stamp{ 0 };
+    std::vector<glm::mat3> m_invInertiaWorld;
+    std::vector<int> m_island;
+    std::vector<float> m_islandMin;
+    std::vector<Contact> m_contacts;
+    std::unordered_map<std::uint64_t, glm::vec3> m_warmStart;   // key -> normal, tangent impulses
+
+    float m_accumulator{ 0.0f };
+    int m_lastContacts{ 0 };
+};
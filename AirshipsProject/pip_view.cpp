@@ -0,0 +1,117 @@
+#include "pip_view.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include "gl_debug.h"
+#include "gl_resources.h"
+
+PipView::~PipView() {
+    Shutdown();
+}
+
+void PipView::ConfigureFromEnvironment() {
+    if (const char* env = std::getenv("AIRSHIP_PIP_INTERVAL"))
+        interval = std::max(1, std::atoi(env));
+    if (const char* env = std::getenv("AIRSHIP_PIP_RESOLUTION"))
+        resolution = std::clamp(static_cast<float>(std::atof(env)), 0.1f, 1.0f);
+}
+
+void PipView::Shutdown() {
+    if (m_fbo) glDeleteFramebuffers(1, &m_fbo);
+    if (m_color) glDeleteTextures(1, &m_color);
+    if (m_depth) glDeleteTextures(1, &m_depth);
+    m_fbo = m_color = m_depth = 0;
+    m_width = m_height = 0;
+    m_valid = false;
+}
+
+bool PipView::NextFrame() {
+    if (!enabled) {
+        m_valid = false;
+        return false;
+    }
+    const bool due = !m_valid || m_frame % std::max(1, interval) == 0;
+    m_frame++;
+    return due;
+}
+
+void PipView::ScreenRect(int windowWidth, int windowHeight, int& x, int& y, int& w, int& h) const {
+    w = std::max(1, static_cast<int>(windowWidth * size));
+    h = std::max(1, static_cast<int>(windowHeight * size));
+    x = windowWidth - margin - w;
+    y = margin;
+}
+
+bool PipView::Begin(int windowWidth, int windowHeight) {
+    int x, y, w, h;
+    ScreenRect(windowWidth, windowHeight, x, y, w, h);
+    w = std::max(1, static_cast<int>(w * resolution));
+    h = std::max(1, static_cast<int>(h * resolution));
+
+    if (w != m_width || h != m_height) {
+        Shutdown();
+        m_color = CreateRenderTexture(GL_RGBA8, w, h);
+        m_depth = CreateRenderTexture(GL_DEPTH24_STENCIL8, w, h);
+        glGenFramebuffers(1, &m_fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_color, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depth, 0);
+        const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "PiP: framebuffer incomplete (0x" << std::hex << status << std::dec << "), view disabled\n";
+            Shutdown();
+            enabled = false;
+            return false;
+        }
+        m_width = w;
+        m_height = h;
+        LabelGlObject(GL_TEXTURE, m_color, "pip color");
+        LabelGlObject(GL_TEXTURE, m_depth, "pip depth");
+    }
+
+    glGetIntegerv(GL_VIEWPORT, m_savedViewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, m_width, m_height);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    return true;
+}
+
+void PipView::End(bool reusedCulling) {
+    // Depth is only needed while drawing.
+    if (GLEW_VERSION_4_3) {
+        const GLenum discard = GL_DEPTH_STENCIL_ATTACHMENT;
+        glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, &discard);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(m_savedViewport[0], m_savedViewport[1], m_savedViewport[2], m_savedViewport[3]);
+
+    m_valid = true;
+    m_renders++;
+    if (reusedCulling) m_reuses++;
+}
+
+void PipView::Composite(int windowWidth, int windowHeight) const {
+    if (!enabled || !m_valid) return;
+
+    int x, y, w, h;
+    ScreenRect(windowWidth, windowHeight, x, y, w, h);
+
+    // A dark frame, then the image scaled up into it.
+    GLfloat savedClear[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, savedClear);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(x - 2, y - 2, w + 4, h + 4);
+    glClearColor(0.05f, 0.07f, 0.1f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glDisable(GL_SCISSOR_TEST);
+    glClearColor(savedClear[0], savedClear[1], savedClear[2], savedClear[3]);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+    glBlitFramebuffer(0, 0, m_width, m_height, x, y, x + w, y + h, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <GL/glew.h>
+
+// Offscreen target for a secondary camera shown in the bottom-right corner.
+//
+// The view is re-rendered every `interval` frames at `resolution` times its
+// on-screen size; in between, the last image is blitted again, so a frame
+// without a refresh costs one small blit. Drawing the view itself is the
+// caller's job between Begin and End.
+class PipView {
+public:
+    bool enabled{ false };
+    int interval{ 2 };
+    float size{ 0.3f };         // fraction of the window
+    float resolution{ 0.5f };   // rendered pixels per screen pixel
+    int margin{ 12 };
+
+    PipView() = default;
+    ~PipView();
+
+    PipView(const PipView&) = delete;
+    PipView& operator=(const PipView&) = delete;
+
+    // AIRSHIP_PIP_INTERVAL (frames per refresh), AIRSHIP_PIP_RESOLUTION.
+    void ConfigureFromEnvironment();
+    void Shutdown();
+
+    // Call once per frame; true when this frame should re-render the view.
+    bool NextFrame();
+
+    // Sizes the target for the window, binds it and clears it.
+    bool Begin(int windowWidth, int windowHeight);
+    void End(bool reusedCulling);
+
+    // Blits the last rendered image into the window's corner.
+    void Composite(int windowWidth, int windowHeight) const;
+
+    int Renders() const { return m_renders; }
+    int CullReuses() const { return m_reuses; }
+
+private:
+    void ScreenRect(int windowWidth, int windowHeight, int& x, int& y, int& w, int& h) const;
+
+    GLuint m_fbo{ 0 };
+    GLuint m_color{ 0 };
+    GLuint m_depth{ 0 };
+    int m_width{ 0 }, m_height{ 0 };
+    GLint m_savedViewport[4]{};
+
+    bool m_valid{ false };
+    int m_frame{ 0 };
+    int m_renders{ 0 };
+    int m_reuses{ 0 };
+};
@@ -0,0 +1,476 @@
+#include "render_graph.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <queue>
+
+#include "gl_debug.h"
+#include "gl_resources.h"
+
+namespace {
+
+// A pooled texture no frame has used for this long (a resize, a debug view
+// switched off) is released.
+const int kPoolIdleFrames = 120;
+
+bool IsDepthFormat(GLenum format) {
+    switch (format) {
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F:
+    case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH32F_STENCIL8:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool HasStencil(GLenum format) {
+    return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+std::size_t BytesPerPixel(GLenum format) {
+    switch (format) {
+    case GL_R8: return 1;
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16: return 2;
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_DEPTH32F_STENCIL8: return 8;
+    case GL_RGBA32F: return 16;
+    default: return 4;
+    }
+}
+
+bool CanInvalidate() {
+    return GLEW_VERSION_4_3;
+}
+
+void AddUnique(std::vector<int>& v, int x) {
+    if (std::find(v.begin(), v.end(), x) == v.end()) v.push_back(x);
+}
+
+double Megabytes(std::size_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+}
+
+RgResource RenderGraph::Builder::Create(const char* name, const RgTextureDesc& desc) {
+    const RgResource handle = m_graph.CreateTexture(name, desc);
+    Write(handle);
+    return handle;
+}
+
+void RenderGraph::Builder::Read(RgResource r) {
+    if (r == kRgNone) return;
+    AddUnique(m_graph.m_passes[m_pass].reads, r);
+    AddUnique(m_graph.m_resources[r].readers, m_pass);
+}
+
+void RenderGraph::Builder::Write(RgResource r) {
+    if (r == kRgNone) return;
+    AddUnique(m_graph.m_passes[m_pass].writes, r);
+    AddUnique(m_graph.m_resources[r].writers, m_pass);
+}
+
+void RenderGraph::Builder::SideEffect() {
+    m_graph.m_passes[m_pass].sideEffect = true;
+}
+
+RenderGraph::~RenderGraph() {
+    Shutdown();
+}
+
+void RenderGraph::Shutdown() {
+    Reset();
+    for (auto& [key, fbo] : m_framebuffers) glDeleteFramebuffers(1, &fbo);
+    m_framebuffers.clear();
+    for (Physical& p : m_pool) glDeleteTextures(1, &p.texture);
+    m_pool.clear();
+}
+
+void RenderGraph::Reset() {
+    m_resources.clear();
+    m_passes.clear();
+    m_order.clear();
+}
+
+RgResource RenderGraph::ImportBackbuffer(const char* name, GLbitfield buffer, int width, int height, const glm::vec4& clearColor) {
+    Resource r;
+    r.name = name;
+    r.kind = Kind::Backbuffer;
+    r.desc.width = width;
+    r.desc.height = height;
+    r.desc.clearColor = clearColor;
+    r.backbuffer = buffer;
+    m_resources.push_back(r);
+    return static_cast<RgResource>(m_resources.size()) - 1;
+}
+
+RgResource RenderGraph::CreateTexture(const char* name, const RgTextureDesc& desc) {
+    Resource r;
+    r.name = name;
+    r.kind = Kind::Transient;
+    r.desc = desc;
+    m_resources.push_back(r);
+    return static_cast<RgResource>(m_resources.size()) - 1;
+}
+
+RgResource RenderGraph::Import(const char* name) {
+    Resource r;
+    r.name = name;
+    r.kind = Kind::Imported;
+    m_resources.push_back(r);
+    return static_cast<RgResource>(m_resources.size()) - 1;
+}
+
+void RenderGraph::AddPass(const char* name, const std::function<void(Builder&)>& setup, std::function<void()> execute) {
+    Pass p;
+    p.name = name;
+    p.execute = std::move(execute);
+    m_passes.push_back(std::move(p));
+
+    Builder builder(*this, static_cast<int>(m_passes.size()) - 1);
+    if (setup) setup(builder);
+}
+
+// Walks back from the passes whose results leave the frame. A pass needs
+// the writers declared before it of everything it reads or writes (it reads
+// or draws on top of their output).
+void RenderGraph::Cull() {
+    std::vector<int> work;
+    for (int i = 0; i < static_cast<int>(m_passes.size()); ++i) {
+        Pass& p = m_passes[i];
+        p.alive = p.sideEffect;
+        for (RgResource r : p.writes)
+            if (m_resources[r].kind != Kind::Transient) p.alive = true;
+        if (p.alive) work.push_back(i);
+    }
+
+    while (!work.empty()) {
+        const int i = work.back();
+        work.pop_back();
+        const Pass& p = m_passes[i];
+
+        auto Need = [&](RgResource r, bool onlyEarlier) {
+            for (int w : m_resources[r].writers) {
+                if (onlyEarlier && w >= i) continue;
+                if (!m_passes[w].alive) {
+                    m_passes[w].alive = true;
+                    work.push_back(w);
+                }
+            }
+            };
+
+        for (RgResource r : p.reads) Need(r, true);
+        for (RgResource r : p.writes) Need(r, true);
+    }
+
+    for (const Pass& p : m_passes)
+        if (!p.alive) m_stats.culled++;
+}
+
+// Accesses to a resource keep their declaration order: a writer runs after
+// the previous writer and the readers declared in between, a pass that only
+// reads it runs after the writers declared before it.
+bool RenderGraph::Order() {
+    const int n = static_cast<int>(m_passes.size());
+    std::vector<std::vector<int>> next(n);
+    std::vector<int> indegree(n, 0);
+    auto Edge = [&](int from, int to) {
+        next[from].push_back(to);
+        indegree[to]++;
+        };
+
+    for (const Resource& r : m_resources) {
+        auto PureReader = [&](int p) {
+            return m_passes[p].alive && std::find(r.writers.begin(), r.writers.end(), p) == r.writers.end();
+            };
+
+        int prev = -1;
+        for (int w : r.writers) {
+            if (!m_passes[w].alive) continue;
+            if (prev >= 0) Edge(prev, w);
+            for (int rd : r.readers)
+                if (rd > prev && rd < w && PureReader(rd)) Edge(rd, w);
+            prev = w;
+        }
+        for (int rd : r.readers) {
+            if (!PureReader(rd)) continue;
+            int last = -1;
+            for (int w : r.writers)
+                if (w < rd && m_passes[w].alive) last = w;
+            if (last >= 0) Edge(last, rd);
+        }
+    }
+
+    std::priority_queue<int, std::vector<int>, std::greater<int>> ready;
+    int alive = 0;
+    for (int i = 0; i < n; ++i) {
+        if (!m_passes[i].alive) continue;
+        alive++;
+        if (indegree[i] == 0) ready.push(i);
+    }
+
+    m_order.clear();
+    while (!ready.empty()) {
+        const int i = ready.top();
+        ready.pop();
+        m_order.push_back(i);
+        for (int j : next[i])
+            if (--indegree[j] == 0) ready.push(j);
+    }
+
+    if (static_cast<int>(m_order.size()) == alive) return true;
+
+    m_order.clear();
+    for (int i = 0; i < n; ++i)
+        if (m_passes[i].alive) m_order.push_back(i);
+    return false;
+}
+
+void RenderGraph::Allocate() {
+    for (int step = 0; step < static_cast<int>(m_order.size()); ++step) {
+        const Pass& p = m_passes[m_order[step]];
+        for (const auto* list : { &p.reads, &p.writes }) {
+            for (RgResource r : *list) {
+                Resource& res = m_resources[r];
+                if (res.firstUse < 0 || step < res.firstUse) res.firstUse = step;
+                res.lastUse = std::max(res.lastUse, step);
+            }
+        }
+    }
+
+    std::vector<RgResource> transients;
+    for (int i = 0; i < static_cast<int>(m_resources.size()); ++i) {
+        const Resource& res = m_resources[i];
+        if (res.kind == Kind::Transient && res.firstUse >= 0) transients.push_back(i);
+    }
+    std::sort(transients.begin(), transients.end(), [&](RgResource a, RgResource b) {
+        return m_resources[a].firstUse < m_resources[b].firstUse;
+        });
+
+    for (Physical& p : m_pool) p.busyUntil = -1;
+    std::vector<bool> used(m_pool.size(), false);
+
+    for (RgResource r : transients) {
+        Resource& res = m_resources[r];
+        const std::size_t bytes = static_cast<std::size_t>(res.desc.width) * res.desc.height * BytesPerPixel(res.desc.format);
+        m_stats.transients++;
+        m_stats.naiveBytes += bytes;
+
+        int pick = -1;
+        for (int i = 0; i < static_cast<int>(m_pool.size()); ++i) {
+            const Physical& p = m_pool[i];
+            if (p.width == res.desc.width && p.height == res.desc.height && p.format == res.desc.format && p.busyUntil < res.firstUse) {
+                pick = i;
+                if (used[i]) break; // prefer a texture this frame already pays for
+            }
+        }
+
+        if (pick < 0) {
+            Physical p;
+            p.texture = CreateRenderTexture(res.desc.format, res.desc.width, res.desc.height);
+            p.width = res.desc.width;
+            p.height = res.desc.height;
+            p.format = res.desc.format;
+            p.bytes = bytes;
+            LabelGlObject(GL_TEXTURE, p.texture, std::string("rg ") + res.name);
+            m_pool.push_back(p);
+            used.push_back(false);
+            pick = static_cast<int>(m_pool.size()) - 1;
+        }
+
+        m_pool[pick].busyUntil = res.lastUse;
+        used[pick] = true;
+        res.physical = pick;
+    }
+
+    for (int i = static_cast<int>(m_pool.size()) - 1; i >= 0; --i) {
+        Physical& p = m_pool[i];
+        p.idleFrames = used[i] ? 0 : p.idleFrames + 1;
+        if (used[i]) {
+            m_stats.textures++;
+            m_stats.allocatedBytes += p.bytes;
+        }
+        if (p.idleFrames < kPoolIdleFrames) continue;
+
+        for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();) {
+            if (std::find(it->first.begin(), it->first.end(), p.texture) != it->first.end()) {
+                glDeleteFramebuffers(1, &it->second);
+                it = m_framebuffers.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+        glDeleteTextures(1, &p.texture);
+        // Only idle entries go, and resources of this frame point at used
+        // ones, so their indices are shifted rather than lost.
+        for (Resource& res : m_resources)
+            if (res.physical > i) res.physical--;
+        m_pool.erase(m_pool.begin() + i);
+    }
+
+    for (const Physical& p : m_pool) m_stats.pooledBytes += p.bytes;
+}
+
+GLuint RenderGraph::Framebuffer(const std::vector<RgResource>& attachments) {
+    std::vector<GLuint> key;
+    for (RgResource r : attachments) key.push_back(Texture(r));
+
+    auto it = m_framebuffers.find(key);
+    if (it != m_framebuffers.end()) return it->second;
+
+    GLuint fbo = 0;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    std::vector<GLenum> drawBuffers;
+    for (RgResource r : attachments) {
+        const GLenum format = m_resources[r].desc.format;
+        GLenum attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(drawBuffers.size());
+        if (IsDepthFormat(format))
+            attachment = HasStencil(format) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        else
+            drawBuffers.push_back(attachment);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, Texture(r), 0);
+    }
+    if (drawBuffers.empty()) {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    else {
+        glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+    }
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "Render graph: incomplete framebuffer for " << m_resources[attachments[0]].name << "\n";
+
+    m_framebuffers[key] = fbo;
+    return fbo;
+}
+
+void RenderGraph::BindTargets(const Pass& pass, int step) {
+    std::vector<RgResource> transients;
+    std::vector<RgResource> backbuffer;
+    for (RgResource r : pass.writes) {
+        if (m_resources[r].kind == Kind::Transient) transients.push_back(r);
+        else if (m_resources[r].kind == Kind::Backbuffer) backbuffer.push_back(r);
+    }
+
+    if (transients.empty()) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (backbuffer.empty()) return;
+
+        const Resource& first = m_resources[backbuffer[0]];
+        glViewport(0, 0, first.desc.width, first.desc.height);
+
+        GLbitfield clear = 0;
+        for (RgResource r : backbuffer) {
+            const Resource& res = m_resources[r];
+            if (res.firstUse != step) continue;
+            clear |= res.backbuffer;
+            if (res.backbuffer & GL_COLOR_BUFFER_BIT)
+                glClearColor(res.desc.clearColor.x, res.desc.clearColor.y, res.desc.clearColor.z, res.desc.clearColor.w);
+            if (res.backbuffer & GL_DEPTH_BUFFER_BIT) clear |= GL_STENCIL_BUFFER_BIT;
+        }
+        if (clear) glClear(clear);
+        return;
+    }
+
+    if (!backbuffer.empty())
+        std::cerr << "Render graph: pass " << pass.name << " mixes the backbuffer with offscreen targets\n";
+
+    glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer(transients));
+    const Resource& first = m_resources[transients[0]];
+    glViewport(0, 0, first.desc.width, first.desc.height);
+
+    std::vector<GLenum> discard;
+    GLint colorIndex = 0;
+    for (RgResource r : transients) {
+        const Resource& res = m_resources[r];
+        const bool depth = IsDepthFormat(res.desc.format);
+        const GLint index = depth ? 0 : colorIndex++;
+        if (res.firstUse != step) continue;
+
+        if (!res.desc.clear) {
+            discard.push_back(depth ? (HasStencil(res.desc.format) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT) : GL_COLOR_ATTACHMENT0 + index);
+        }
+        else if (depth) {
+            if (HasStencil(res.desc.format)) glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+            else {
+                const GLfloat one = 1.0f;
+                glClearBufferfv(GL_DEPTH, 0, &one);
+            }
+        }
+        else {
+            glClearBufferfv(GL_COLOR, index, glm::value_ptr(res.desc.clearColor));
+        }
+    }
+    if (!discard.empty() && CanInvalidate())
+        glInvalidateFramebuffer(GL_FRAMEBUFFER, static_cast<GLsizei>(discard.size()), discard.data());
+}
+
+// Nothing reads these contents again this frame, and the next user of the
+// texture clears or invalidates it first, so tilers can skip the store.
+void RenderGraph::Retire(const Pass& pass, int step) {
+    if (!CanInvalidate()) return;
+
+    for (const auto* list : { &pass.reads, &pass.writes }) {
+        for (RgResource r : *list) {
+            const Resource& res = m_resources[r];
+            if (res.lastUse != step) continue;
+
+            if (res.kind == Kind::Transient) {
+                glInvalidateTexImage(Texture(r), 0);
+            }
+            else if (res.kind == Kind::Backbuffer && (res.backbuffer & GL_DEPTH_BUFFER_BIT)) {
+                const GLenum depthStencil[] = { GL_DEPTH, GL_STENCIL };
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                glInvalidateFramebuffer(GL_FRAMEBUFFER, 2, depthStencil);
+            }
+        }
+    }
+}
+
+void RenderGraph::Execute() {
+    m_stats = Stats{};
+    m_stats.passes = static_cast<int>(m_passes.size());
+
+    Cull();
+    if (!Order())
+        std::cerr << "Render graph: dependency cycle, running passes in declaration order\n";
+    Allocate();
+
+    for (int step = 0; step < static_cast<int>(m_order.size()); ++step) {
+        const Pass& p = m_passes[m_order[step]];
+        GlDebugGroup group(p.name);
+        BindTargets(p, step);
+        if (p.execute) p.execute();
+        Retire(p, step);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+GLuint RenderGraph::Texture(RgResource r) const {
+    if (r == kRgNone) return 0;
+    const int physical = m_resources[r].physical;
+    return physical >= 0 ? m_pool[physical].texture : 0;
+}
+
+void RenderGraph::PrintStats() const {
+    std::printf("Render graph: %d passes (%d culled), %d transient targets in %d textures\n",
+        m_stats.passes, m_stats.culled, m_stats.transients, m_stats.textures);
+    std::printf("  transient memory %.1f MB, %.1f MB without aliasing (%.1f MB saved), pool %.1f MB\n",
+        Megabytes(m_stats.allocatedBytes), Megabytes(m_stats.naiveBytes),
+        Megabytes(m_stats.naiveBytes - m_stats.allocatedBytes), Megabytes(m_stats.pooledBytes));
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <vector>
+
+// Per-frame description of the render passes and what they touch.
+//
+// Each frame Game::Render calls Reset, imports the long-lived resources,
+// adds passes (the setup callback runs immediately and declares reads and
+// writes, the execute callback runs later) and then Execute, which:
+//   - culls passes nothing kept alive reads from; a pass is kept when it
+//     writes an imported resource or calls SideEffect,
+//   - orders the survivors by their dependencies (accesses to one resource
+//     keep their declaration order), declaration order breaking ties,
+//   - gives each transient texture a pooled texture, shared with any other
+//     transient of the same size and format whose lifetime ended earlier,
+//   - binds the pass's attachments, clears or invalidates a target on its
+//     first write and invalidates it after its last use.
+//
+// GL has no placement of textures into shared memory, so aliasing here is
+// reuse of the same texture object; the pool keeps them across frames.
+using RgResource = int;
+inline constexpr RgResource kRgNone = -1;
+
+struct RgTextureDesc {
+    int width{ 0 };
+    int height{ 0 };
+    GLenum format{ GL_RGBA8 };
+    // Without a clear the first writer must cover every pixel; the old
+    // contents are invalidated instead.
+    bool clear{ true };
+    glm::vec4 clearColor{ 0.0f };
+};
+
+class RenderGraph {
+public:
+    class Builder {
+    public:
+        // Transient texture, attached as a render target of this pass.
+        RgResource Create(const char* name, const RgTextureDesc& desc);
+        void Read(RgResource r);
+        // Transients and the backbuffer become attachments; imported
+        // resources are written however the pass likes (images, SSBOs, its
+        // own framebuffer).
+        void Write(RgResource r);
+        void SideEffect();
+
+    private:
+        friend class RenderGraph;
+        Builder(RenderGraph& graph, int pass) : m_graph(graph), m_pass(pass) {}
+
+        RenderGraph& m_graph;
+        int m_pass;
+    };
+
+    struct Stats {
+        int passes{ 0 };
+        int culled{ 0 };
+        int transients{ 0 };
+        int textures{ 0 };
+        std::size_t naiveBytes{ 0 };
+        std::size_t allocatedBytes{ 0 };
+        std::size_t pooledBytes{ 0 };
+    };
+
+    RenderGraph() = default;
+    ~RenderGraph();
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    void Shutdown();
+    void Reset();
+
+    // The window's color or depth (with stencil); the first writer clears it.
+    // The backbuffer color survives the frame, its depth is invalidated
+    // after the last pass that uses it.
+    RgResource ImportBackbuffer(const char* name, GLbitfield buffer, int width, int height, const glm::vec4& clearColor = glm::vec4(0.0f));
+    // Transient texture declared ahead of its writer, so a pass added
+    // earlier can read what a later-added pass produces.
+    RgResource CreateTexture(const char* name, const RgTextureDesc& desc);
+    // State that outlives the frame (shadow maps, cull results, Hi-Z); only
+    // used for ordering and culling, the owning module binds it.
+    RgResource Import(const char* name);
+
+    void AddPass(const char* name, const std::function<void(Builder&)>& setup, std::function<void()> execute);
+
+    void Execute();
+
+    // Valid inside execute callbacks.
+    GLuint Texture(RgResource r) const;
+
+    const Stats& LastStats() const { return m_stats; }
+    void PrintStats() const;
+
+private:
+    enum class Kind { Transient, Backbuffer, Imported };
+
+    struct Resource {
+        const char* name{ nullptr };
+        Kind kind{ Kind::Transient };
+        RgTextureDesc desc;
+        GLbitfield backbuffer{ 0 };
+        std::vector<int> writers;
+        std::vector<int> readers;
+        int firstUse{ -1 };
+        int lastUse{ -1 };
+        int physical{ -1 };
+    };
+
+    struct Pass {
+        const char* name{ nullptr };
+        std::function<void()> execute;
+        std::vector<RgResource> reads;
+        std::vector<RgResource> writes;
+        bool sideEffect{ false };
+        bool alive{ false };
+    };
+
+    struct Physical {
+        GLuint texture{ 0 };
+        int width{ 0 }, height{ 0 };
+        GLenum format{ 0 };
+        std::size_t bytes{ 0 };
+        int busyUntil{ -1 };
+        int idleFrames{ 0 };
+    };
+
+    void Cull();
+    bool Order();
+    void Allocate();
+    void BindTargets(const Pass& pass, int step);
+    void Retire(const Pass& pass, int step);
+    GLuint Framebuffer(const std::vector<RgResource>& attachments);
+
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    std::vector<int> m_order;
+
+    std::vector<Physical> m_pool;
+    // Keyed by the attached textures, in attachment order.
+    std::map<std::vector<GLuint>, GLuint> m_framebuffers;
+
+    Stats m_stats;
+};
@@ -1,5 +1,8 @@
 #include "shader_utils.h"
 
+#include "cooked_assets.h"
+#include "gl_debug.h"
+
 GLuint CompileShader(GLenum type, const char* source)
 {
     GLuint shader = glCreateShader(type);
@@ -22,6 +25,12 @@ std::string LoadShaderFromFile(const std::string& filename)
 {
     std::ifstream file(filename);
     if (!file.is_open()) {
+        // Shipped builds carry the sources in the cooked bundle; loose
+        // files still win so shaders can be edited without re-cooking.
+        if (const std::string* packed = ShaderPack().Find(filename)) {
+            std::cout << "Loaded shader from: " << kCookedDir << "/shaders.pack:" << filename << std::endl;
+            return *packed;
+        }
         std::cout << "Failed to open shader file: " << filename << std::endl;
         return "";
     }
@@ -34,7 +43,51 @@ std::string LoadShaderFromFile(const std::string& filename)
     return buffer.str();
 }
 
+std::string InjectDefines(const std::string& source, const std::string& defines)
+{
+    // Editors may save a UTF-8 BOM, which GLSL rejects ahead of #version.
+    const size_t start = (source.compare(0, 3, "\xEF\xBB\xBF") == 0) ? 3 : 0;
+    if (defines.empty())
+        return source.substr(start);
+
+    // #defines must follow the #version line, which has to stay first.
+    size_t lineEnd = start;
+    if (source.compare(start, 8, "#version") == 0) {
+        lineEnd = source.find('\n', start);
+        lineEnd = (lineEnd == std::string::npos) ? source.size() : lineEnd + 1;
+    }
+    return source.substr(start, lineEnd - start) + defines + "\n" + source.substr(lineEnd);
+}
+
+static GLuint LinkProgram(GLuint a, GLuint b, const std::vector<const char*>* varyings = nullptr)
+{
+    GLuint shaderProgram = glCreateProgram();
+    glAttachShader(shaderProgram, a);
+    if (b) glAttachShader(shaderProgram, b);
+    if (varyings)
+        glTransformFeedbackVaryings(shaderProgram, static_cast<GLsizei>(varyings->size()), varyings->data(), GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(shaderProgram);
+
+    GLint success;
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+        std::cout << "Shader program linking failed: " << infoLog << std::endl;
+        return 0;
+    }
+
+    glDeleteShader(a);
+    if (b) glDeleteShader(b);
+    return shaderProgram;
+}
+
 GLuint CreateShaderProgramFromFiles(const std::string& vertexShaderFile, const std::string& fragmentShaderFile)
+{
+    return CreateShaderProgramFromFiles(vertexShaderFile, fragmentShaderFile, "");
+}
+
+GLuint CreateShaderProgramFromFiles(const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const std::string& defines)
 {
     std::string vertexShaderSource = LoadShaderFromFile(vertexShaderFile);
     std::string fragmentShaderSource = LoadShaderFromFile(fragmentShaderFile);
@@ -44,6 +97,9 @@ GLuint CreateShaderProgramFromFiles(const std::string& vertexShaderFile, const s
         return -1;
     }
 
+    vertexShaderSource = InjectDefines(vertexShaderSource, defines);
+    fragmentShaderSource = InjectDefines(fragmentShaderSource, defines);
+
     GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, vertexShaderSource.c_str());
     GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentShaderSource.c_str());
 
@@ -51,23 +107,42 @@ GLuint CreateShaderProgramFromFiles(const std::string& vertexShaderFile, const s
         return 0;
     }
 
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    GLint success;
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "Shader program linking failed: " << infoLog << std::endl;
+    GLuint shaderProgram = LinkProgram(vertexShader, fragmentShader);
+    if (!shaderProgram)
         return 0;
-    }
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    if (g_glDebugEnabled)
+        LabelGlObject(GL_PROGRAM, shaderProgram, vertexShaderFile + " + " + fragmentShaderFile + (defines.empty() ? "" : " [" + defines + "]"));
 
     std::cout << "Shader program created successfully" << std::endl;
     return shaderProgram;
-}
\ No newline at end of file
+}
+
+GLuint CreateComputeProgramFromFile(const std::string& computeShaderFile, const std::string& defines)
+{
+    std::string source = LoadShaderFromFile(computeShaderFile);
+    if (source.empty())
+        return 0;
+
+    GLuint computeShader = CompileShader(GL_COMPUTE_SHADER, InjectDefines(source, defines).c_str());
+    if (!computeShader)
+        return 0;
+
+    GLuint program = LinkProgram(computeShader, 0);
+    if (program && g_glDebugEnabled)
+        LabelGlObject(GL_PROGRAM, program, computeShaderFile + (defines.empty() ? "" : " [" + defines + "]"));
+    return program;
+}
+
+GLuint CreateTransformFeedbackProgramFromFile(const std::string& vertexShaderFile, const std::vector<const char*>& varyings, const std::string& defines)
+{
+    std::string source = LoadShaderFromFile(vertexShaderFile);
+    if (source.empty())
+        return 0;
+
+    GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, InjectDefines(source, defines).c_str());
+    if (!vertexShader)
+        return 0;
+
+    return LinkProgram(vertexShader, 0, &varyings);
+}
@@ -4,7 +4,12 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <vector>
 
 GLuint CompileShader(GLenum type, const char* source);
 std::string LoadShaderFromFile(const std::string& filename);
+std::string InjectDefines(const std::string& source, const std::string& defines);
 GLuint CreateShaderProgramFromFiles(const std::string& vertexShaderFile, const std::string& fragmentShaderFile);
+GLuint CreateShaderProgramFromFiles(const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const std::string& defines);
+GLuint CreateComputeProgramFromFile(const std::string& computeShaderFile, const std::string& defines = "");
+GLuint CreateTransformFeedbackProgramFromFile(const std::string& vertexShaderFile, const std::vector<const char*>& varyings, const std::string& defines = "");
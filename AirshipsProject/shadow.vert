@@ -0,0 +1,13 @@
+#version 330 core
+
+// Depth-only caster pass for one shadow cascade (shadows.h).
+
+layout(location = 0) in vec3 aPos;
+
+uniform mat4 u_lightViewProj;
+uniform mat4 u_model;
+
+void main()
+{
+    gl_Position = u_lightViewProj * u_model * vec4(aPos, 1.0);
+}
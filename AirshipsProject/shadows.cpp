@@ -0,0 +1,248 @@
+#include "shadows.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+
+#include "gl_debug.h"
+#include "shader_utils.h"
+
+// 0-3 are taken by the material, AO buffer and heightmap; 7 by Hi-Z.
+static const GLuint kStaticTextureUnit = 4;
+static const GLuint kDynamicTextureUnit = 5;
+
+ShadowCascades::~ShadowCascades() {
+    Shutdown();
+}
+
+bool ShadowCascades::Initialize() {
+    m_program = CreateShaderProgramFromFiles("shadow.vert", "shadow.frag");
+    if (!m_program || m_program == static_cast<GLuint>(-1)) {
+        std::cerr << "Shadows: shaders failed, shadows disabled\n";
+        m_program = 0;
+        return false;
+    }
+
+    m_uLightViewProj = glGetUniformLocation(m_program, "u_lightViewProj");
+    m_uModel = glGetUniformLocation(m_program, "u_model");
+
+    const float border[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    for (GLuint* tex : { &m_static, &m_dynamic }) {
+        glGenTextures(1, tex);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, *tex);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, kCascades, 0,
+            GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    LabelGlObject(GL_TEXTURE, m_static, "shadow cascades (static)");
+    LabelGlObject(GL_TEXTURE, m_dynamic, "shadow cascades (dynamic)");
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_static, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Shadows: depth framebuffer incomplete, shadows disabled\n";
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        Shutdown();
+        return false;
+    }
+
+    // RenderDynamic only clears layers that had casters, so all start clear.
+    for (GLuint tex : { m_static, m_dynamic }) {
+        for (int i = 0; i < kCascades; ++i) {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, tex, 0, i);
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    InvalidateStatic();
+    std::cout << "Shadows: " << kCascades << " cascades at " << resolution << "x" << resolution
+        << ", static layer cached\n";
+    return true;
+}
+
+void ShadowCascades::Shutdown() {
+    if (m_program) glDeleteProgram(m_program);
+    if (m_fbo) glDeleteFramebuffers(1, &m_fbo);
+    if (m_static) glDeleteTextures(1, &m_static);
+    if (m_dynamic) glDeleteTextures(1, &m_dynamic);
+    m_program = m_fbo = m_static = m_dynamic = 0;
+}
+
+void ShadowCascades::SetSceneBounds(const glm::vec3& lo, const glm::vec3& hi) {
+    m_sceneLo = lo;
+    m_sceneHi = hi;
+    InvalidateStatic();
+}
+
+void ShadowCascades::Update(const glm::mat4& view, float fovYRadians, float aspect, float nearZ, const glm::vec3& lightDir) {
+    const glm::vec3 L = glm::normalize(lightDir);
+    const glm::vec3 up = (std::abs(L.y) > 0.99f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    const glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), L, up);
+
+    // Depth covers the whole scene box, so casters between the sun and a
+    // cascade land in it even when they are off screen.
+    float zMin = FLT_MAX;
+    float zMax = -FLT_MAX;
+    for (int i = 0; i < 8; ++i) {
+        const glm::vec3 corner((i & 1) ? m_sceneHi.x : m_sceneLo.x, (i & 2) ? m_sceneHi.y : m_sceneLo.y, (i & 4) ? m_sceneHi.z : m_sceneLo.z);
+        const float z = (lightView * glm::vec4(corner, 1.0f)).z;
+        zMin = std::min(zMin, z);
+        zMax = std::max(zMax, z);
+    }
+
+    const glm::mat4 invView = glm::inverse(view);
+    const float tanY = std::tan(fovYRadians * 0.5f);
+    const float tanX = tanY * aspect;
+
+    float splitNear = nearZ;
+    for (int i = 0; i < kCascades; ++i) {
+        const float t = static_cast<float>(i + 1) / kCascades;
+        const float logSplit = nearZ * std::pow(maxDistance / nearZ, t);
+        const float linSplit = nearZ + (maxDistance - nearZ) * t;
+        const float splitFar = glm::mix(linSplit, logSplit, splitLambda);
+
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for (int c = 0; c < 8; ++c) {
+            const float d = (c & 4) ? splitFar : splitNear;
+            const glm::vec4 p(((c & 1) ? 1.0f : -1.0f) * tanX * d, ((c & 2) ? 1.0f : -1.0f) * tanY * d, -d, 1.0f);
+            corners[c] = glm::vec3(invView * p);
+            center += corners[c] * 0.125f;
+        }
+        float radius = 0.0f;
+        for (const glm::vec3& c : corners) radius = std::max(radius, glm::distance(c, center));
+        radius = std::ceil(radius);
+
+        // The sphere center is moved in whole steps, each a multiple of a
+        // texel so cached texels keep their world position.
+        const float half = radius * (1.0f + 2.0f * snapFraction);
+        const float texel = 2.0f * half / resolution;
+        const float step = std::max(texel, std::floor(2.0f * radius * snapFraction / texel) * texel);
+        const glm::vec3 lc = glm::vec3(lightView * glm::vec4(center, 1.0f));
+        const glm::vec2 snapped = (glm::floor(glm::vec2(lc) / step) + 0.5f) * step;
+
+        const glm::mat4 proj = glm::ortho(snapped.x - half, snapped.x + half, snapped.y - half, snapped.y + half,
+            -zMax - 1.0f, -zMin + 1.0f);
+        const glm::mat4 viewProj = proj * lightView;
+
+        Cascade& cascade = m_cascades[i];
+        if (viewProj != cascade.viewProj) {
+            cascade.viewProj = viewProj;
+            cascade.bounds = Frustum::FromViewProj(viewProj);
+            cascade.texelWorld = texel;
+            m_staticDirty |= 1 << i;
+        }
+        splitNear = splitFar;
+    }
+}
+
+void ShadowCascades::BeginPasses() {
+    glGetIntegerv(GL_VIEWPORT, m_savedViewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, resolution, resolution);
+    glUseProgram(m_program);
+
+    // Depth clamp keeps casters outside the depth range instead of clipping
+    // them; the slope bias covers most acne, game.frag's normal offset the rest.
+    glEnable(GL_DEPTH_CLAMP);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+}
+
+void ShadowCascades::SetTarget(GLuint texture, int cascade, bool clear) {
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, cascade);
+    if (clear) glClear(GL_DEPTH_BUFFER_BIT);
+    glUniformMatrix4fv(m_uLightViewProj, 1, GL_FALSE, glm::value_ptr(m_cascades[cascade].viewProj));
+}
+
+void ShadowCascades::EndPasses() {
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_DEPTH_CLAMP);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(m_savedViewport[0], m_savedViewport[1], m_savedViewport[2], m_savedViewport[3]);
+}
+
+// Far cascades spread a texel over more ground, so they take coarser LODs.
+int ShadowCascades::DrawCasters(const std::vector<ShadowCaster>& casters, int cascade) const {
+    const Frustum& bounds = m_cascades[cascade].bounds;
+    int drawn = 0;
+    for (const ShadowCaster& c : casters) {
+        if (!bounds.Intersects(c.sphere)) continue;
+        glUniformMatrix4fv(m_uModel, 1, GL_FALSE, glm::value_ptr(c.transform));
+        DrawModel(*c.model, cascade);
+        drawn++;
+    }
+    return drawn;
+}
+
+void ShadowCascades::RenderStatic(const std::vector<ShadowCaster>& casters) {
+    if (!m_program || !m_staticDirty) return;
+
+    BeginPasses();
+    for (int i = 0; i < kCascades; ++i) {
+        if (!(m_staticDirty & (1 << i))) continue;
+        SetTarget(m_static, i, true);
+        DrawCasters(casters, i);
+        m_staticRenders++;
+    }
+    EndPasses();
+    m_staticDirty = 0;
+}
+
+void ShadowCascades::RenderDynamic(const std::vector<ShadowCaster>& casters) {
+    m_lastDynamicCasters = 0;
+    if (!m_program) return;
+
+    BeginPasses();
+    for (int i = 0; i < kCascades; ++i) {
+        Cascade& cascade = m_cascades[i];
+        // A layer that was left empty is still clear.
+        SetTarget(m_dynamic, i, cascade.dynamicCasters > 0);
+        cascade.dynamicCasters = DrawCasters(casters, i);
+        m_lastDynamicCasters += cascade.dynamicCasters;
+    }
+    EndPasses();
+}
+
+void ShadowCascades::BindTextures() const {
+    glActiveTexture(GL_TEXTURE0 + kStaticTextureUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_static);
+    glActiveTexture(GL_TEXTURE0 + kDynamicTextureUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_dynamic);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void ShadowCascades::ApplyUniforms(GLuint program, bool enabled) const {
+    auto Loc = [&](const char* name) { return glGetUniformLocation(program, name); };
+
+    // Set even when disabled: two sampler types on one unit fail validation.
+    glUniform1i(Loc("u_shadowStatic"), kStaticTextureUnit);
+    glUniform1i(Loc("u_shadowDynamic"), kDynamicTextureUnit);
+    glUniform1i(Loc("u_shadowsEnabled"), (enabled && m_program) ? 1 : 0);
+    if (!enabled || !m_program) return;
+
+    glm::mat4 matrices[kCascades];
+    float texels[kCascades];
+    for (int i = 0; i < kCascades; ++i) {
+        matrices[i] = m_cascades[i].viewProj;
+        texels[i] = m_cascades[i].texelWorld;
+    }
+    glUniformMatrix4fv(Loc("u_shadowMatrix"), kCascades, GL_FALSE, glm::value_ptr(matrices[0]));
+    glUniform1fv(Loc("u_shadowTexel"), kCascades, texels);
+}
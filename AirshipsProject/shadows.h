@@ -0,0 +1,91 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "culling.h"
+#include "model.h"
+
+struct ShadowCaster {
+    const Model* model = nullptr;
+    glm::mat4 transform{ 1.0f };
+    BoundingSphere sphere{};
+};
+
+// Cascaded sun shadows split into two depth layers per cascade. The static
+// layer holds houses, decorations and the tree and is only re-rendered when
+// its cascade moves, the light turns or the static scene changes. The
+// dynamic layer is redrawn every frame with just the moving casters and is
+// only cleared where it had any. game.frag takes the darker of the two.
+//
+// Cascades are fitted to bounding spheres of the view frustum slices (so
+// their size doesn't change as the camera turns) and move in coarse steps
+// of snapFraction of their width, with the extent widened by one step so
+// the slice stays covered in between.
+class ShadowCascades {
+public:
+    static constexpr int kCascades = 3;
+
+    int resolution{ 2048 };
+    float maxDistance{ 150.0f };
+    float splitLambda{ 0.7f };
+    float snapFraction{ 0.125f };
+
+    ShadowCascades() = default;
+    ~ShadowCascades();
+
+    ShadowCascades(const ShadowCascades&) = delete;
+    ShadowCascades& operator=(const ShadowCascades&) = delete;
+
+    bool Initialize();
+    void Shutdown();
+    bool Ready() const { return m_program != 0; }
+
+    // Everything that can cast, for the light-space depth range.
+    void SetSceneBounds(const glm::vec3& lo, const glm::vec3& hi);
+    void InvalidateStatic() { m_staticDirty = (1 << kCascades) - 1; }
+
+    bool StaticDirty() const { return m_staticDirty != 0; }
+
+    void Update(const glm::mat4& view, float fovYRadians, float aspect, float nearZ, const glm::vec3& lightDir);
+    // Only the cascades marked dirty are redrawn; the list can be skipped
+    // entirely while StaticDirty() is false.
+    void RenderStatic(const std::vector<ShadowCaster>& casters);
+    void RenderDynamic(const std::vector<ShadowCaster>& casters);
+
+    // Binds both layers to their texture units; ApplyUniforms then points
+    // the current program (one using game.frag) at them.
+    void BindTextures() const;
+    void ApplyUniforms(GLuint program, bool enabled) const;
+
+    int StaticRenders() const { return m_staticRenders; }
+    int LastDynamicCasters() const { return m_lastDynamicCasters; }
+
+private:
+    struct Cascade {
+        glm::mat4 viewProj{ 1.0f };
+        Frustum bounds{};
+        float texelWorld{ 0.0f };
+        int dynamicCasters{ 0 };
+    };
+
+    void BeginPasses();
+    void SetTarget(GLuint texture, int cascade, bool clear);
+    void EndPasses();
+    int DrawCasters(const std::vector<ShadowCaster>& casters, int cascade) const;
+
+    GLuint m_program{ 0 };
+    GLuint m_fbo{ 0 };
+    GLuint m_static{ 0 };
+    GLuint m_dynamic{ 0 };
+    int m_uLightViewProj{ -1 }, m_uModel{ -1 };
+
+    Cascade m_cascades[kCascades];
+    glm::vec3 m_sceneLo{ -100.0f };
+    glm::vec3 m_sceneHi{ 100.0f };
+    int m_staticDirty{ (1 << kCascades) - 1 };
+    int m_staticRenders{ 0 };
+    int m_lastDynamicCasters{ 0 };
+    GLint m_savedViewport[4]{};
+};
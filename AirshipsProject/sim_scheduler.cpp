@@ -0,0 +1,122 @@
+#include "sim_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+float MsSince(Clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+}
+
+int SimScheduler::AddSystem(const std::string& name, float budgetMs, UpdateFn update) {
+    System s;
+    s.name = name;
+    s.budgetMs = budgetMs;
+    s.update = std::move(update);
+    m_systems.push_back(std::move(s));
+    return static_cast<int>(m_systems.size()) - 1;
+}
+
+void SimScheduler::Resize(int system, int count) {
+    m_systems[system].objects.resize(static_cast<size_t>(std::max(count, 0)));
+}
+
+void SimScheduler::SetBounds(int system, int object, const glm::vec3& center, float radius) {
+    Object& o = m_systems[system].objects[object];
+    o.center = center;
+    o.radius = radius;
+}
+
+void SimScheduler::SetActive(int system, int object, bool active) {
+    Object& o = m_systems[system].objects[object];
+    if (o.active == active) return;
+
+    o.active = active;
+    o.pending = 0.0f;
+    o.framesSince = 0;
+}
+
+void SimScheduler::AddJob(const std::string& name, JobFn job) {
+    m_jobs.push_back({ name, std::move(job) });
+}
+
+void SimScheduler::ClearJobs() {
+    m_jobs.clear();
+}
+
+int SimScheduler::IntervalFor(const Object& o, const glm::vec3& focus, const Frustum& frustum) const {
+    const float dist = std::max(glm::distance(o.center, focus) - o.radius, 0.0f);
+    const float t = glm::clamp((dist - nearDistance) / std::max(farDistance - nearDistance, 1e-3f), 0.0f, 1.0f);
+    int interval = 1 + static_cast<int>(t * (maxInterval - 1) + 0.5f);
+
+    BoundingSphere sphere;
+    sphere.center = o.center;
+    sphere.radius = o.radius;
+    if (!frustum.Intersects(sphere)) interval *= 2;
+
+    return std::min(interval, maxInterval);
+}
+
+void SimScheduler::Run(float dt, const glm::vec3& focus, const Frustum& frustum) {
+    const Clock::time_point frameStart = Clock::now();
+
+    for (System& s : m_systems) {
+        const Clock::time_point start = Clock::now();
+        SimSystemStats& stats = s.stats;
+        stats = SimSystemStats{};
+        stats.objects = static_cast<int>(s.objects.size());
+
+        // Most overdue first; interval-1 objects win ties so near, visible
+        // things are the last to be deferred.
+        m_due.clear();
+        for (size_t i = 0; i < s.objects.size(); ++i) {
+            Object& o = s.objects[i];
+            if (!o.active) continue;
+
+            o.pending += dt;
+            if (o.framesSince < 0xffff) o.framesSince++;
+            o.interval = static_cast<std::uint8_t>(IntervalFor(o, focus, frustum));
+            stats.maxLagFrames = std::max(stats.maxLagFrames, static_cast<int>(o.framesSince));
+
+            if (o.framesSince >= o.interval) {
+                const float priority = static_cast<float>(o.framesSince) / o.interval + (o.interval == 1 ? 0.5f : 0.0f);
+                m_due.emplace_back(-priority, static_cast<int>(i));
+            }
+        }
+        std::sort(m_due.begin(), m_due.end());
+        stats.due = static_cast<int>(m_due.size());
+
+        for (size_t k = 0; k < m_due.size(); ++k) {
+            if (k > 0 && MsSince(start) >= s.budgetMs) {
+                stats.deferred = static_cast<int>(m_due.size() - k);
+                break;
+            }
+
+            Object& o = s.objects[m_due[k].second];
+            const float step = o.pending;
+            o.pending = 0.0f;
+            o.framesSince = 0;
+            s.update(m_due[k].second, step);
+            stats.updated++;
+        }
+
+        stats.ms = MsSince(start);
+    }
+
+    // Jobs always get a small slice so they finish even on a heavy frame.
+    const Clock::time_point jobStart = Clock::now();
+    const float budget = std::max(frameBudgetMs - MsSince(frameStart), minJobMs);
+    while (!m_jobs.empty()) {
+        const float left = budget - MsSince(jobStart);
+        if (left <= 0.0f) break;
+        if (!m_jobs.front().run(left)) break;
+        m_jobs.pop_front();
+    }
+    m_lastJobMs = MsSince(jobStart);
+    m_lastTotalMs = MsSince(frameStart);
+}
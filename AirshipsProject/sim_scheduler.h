@@ -0,0 +1,94 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "culling.h"
+
+struct SimSystemStats {
+    int objects{ 0 };
+    int due{ 0 };
+    int updated{ 0 };
+    int deferred{ 0 };      // due but past the budget, first in line next frame
+    int maxLagFrames{ 0 };  // oldest update among active objects
+    float ms{ 0.0f };
+};
+
+// Level-of-detail scheduler for per-object simulation. Objects report a
+// bounding sphere; near, visible ones update every frame and the rest
+// every 2..maxInterval frames by distance (doubled off-screen), with the
+// skipped time folded into the dt of their next update. Each system runs
+// its due objects most-overdue first until its budget is spent and defers
+// the rest. Between updates callers extrapolate with Staleness().
+//
+// Sliced jobs are long one-off tasks (e.g. a large spawn) that run a
+// piece per frame inside whatever frame budget the systems left over.
+class SimScheduler {
+public:
+    using UpdateFn = std::function<void(int object, float dt)>;
+    using JobFn = std::function<bool(float budgetMs)>;      // true when finished
+
+    float nearDistance{ 30.0f };
+    float farDistance{ 120.0f };
+    int maxInterval{ 8 };
+    float frameBudgetMs{ 4.0f };
+    float minJobMs{ 0.5f };
+
+    int AddSystem(const std::string& name, float budgetMs, UpdateFn update);
+
+    // New objects start active and due, with no bounds; shrinking drops the tail.
+    void Resize(int system, int count);
+    void SetBounds(int system, int object, const glm::vec3& center, float radius);
+    // Inactive objects never come due and accumulate no time.
+    void SetActive(int system, int object, bool active);
+
+    void AddJob(const std::string& name, JobFn job);
+    void ClearJobs();
+
+    void Run(float dt, const glm::vec3& focus, const Frustum& frustum);
+
+    // Seconds since the object last ran, for extrapolating between updates.
+    float Staleness(int system, int object) const { return m_systems[system].objects[object].pending; }
+
+    int SystemCount() const { return static_cast<int>(m_systems.size()); }
+    const std::string& Name(int system) const { return m_systems[system].name; }
+    const SimSystemStats& Stats(int system) const { return m_systems[system].stats; }
+    int PendingJobs() const { return static_cast<int>(m_jobs.size()); }
+    float LastJobMs() const { return m_lastJobMs; }
+    float LastTotalMs() const { return m_lastTotalMs; }
+
+private:
+    struct Object {
+        glm::vec3 center{ 0.0f };
+        float radius{ 0.0f };
+        float pending{ 0.0f };
+        std::uint16_t framesSince{ 0xfffe };    // new objects are due at once
+        std::uint8_t interval{ 1 };
+        bool active{ true };
+    };
+
+    struct System {
+        std::string name;
+        float budgetMs{ 1.0f };
+        UpdateFn update;
+        std::vector<Object> objects;
+        SimSystemStats stats;
+    };
+
+    struct Job {
+        std::string name;
+        JobFn run;
+    };
+
+    int IntervalFor(const Object& o, const glm::vec3& focus, const Frustum& frustum) const;
+
+    std::vector<System> m_systems;
+    std::deque<Job> m_jobs;     // a running job may queue another
+    std::vector<std::pair<float, int>> m_due;
+    float m_lastJobMs{ 0.0f };
+    float m_lastTotalMs{ 0.0f };
+};
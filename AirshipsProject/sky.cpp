@@ -0,0 +1,432 @@
+#include "sky.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "gl_debug.h"
+#include "job_pool.h"
+#include "shader_utils.h"
+
+// 0-5 are taken by the material, AO buffer, heightmap and shadows; 7 by
+// Hi-Z. The LUT builds and the sky pass use 0 and 1, which every draw
+// rebinds.
+static const GLuint kAerialTextureUnit = 6;
+
+namespace {
+
+// Must match sky_luts.comp and sky.frag. Distances in km.
+const float kPi = 3.14159265f;
+const float kGroundRadius = 6360.0f;
+const float kTopRadius = 6460.0f;
+const glm::vec3 kRayleighScattering(5.802e-3f, 13.558e-3f, 33.1e-3f);
+const float kRayleighHeight = 8.0f;
+const float kMieScattering = 3.996e-3f;
+const float kMieExtinction = 4.44e-3f;
+const float kMieHeight = 1.2f;
+const glm::vec3 kOzoneAbsorption(0.650e-3f, 1.881e-3f, 0.085e-3f);
+const float kGroundAlbedo = 0.3f;
+
+const int kTransmittanceSteps = 40;
+const int kMultiScatterDirections = 8; // per axis
+const int kMultiScatterSteps = 20;
+
+const char kSkyMagic[4] = { 'S', 'K', 'Y', '1' };
+// Bump when the constants above or the integration change.
+const std::uint64_t kSkyCacheVersion = 1;
+
+struct Medium {
+    glm::vec3 scattering;
+    glm::vec3 extinction;
+};
+
+Medium SampleMedium(float altitude) {
+    const float rayleigh = std::exp(-altitude / kRayleighHeight);
+    const float mie = std::exp(-altitude / kMieHeight);
+    const float ozone = std::max(0.0f, 1.0f - std::abs(altitude - 25.0f) / 15.0f);
+
+    Medium m;
+    m.scattering = kRayleighScattering * rayleigh + glm::vec3(kMieScattering * mie);
+    m.extinction = kRayleighScattering * rayleigh + glm::vec3(kMieExtinction * mie) + kOzoneAbsorption * ozone;
+    return m;
+}
+
+// Nearest hit in front of the origin, or -1.
+float RaySphere(const glm::vec3& o, const glm::vec3& d, float radius) {
+    const float b = glm::dot(o, d);
+    const float c = glm::dot(o, o) - radius * radius;
+    const float disc = b * b - c;
+    if (disc < 0.0f) return -1.0f;
+    const float s = std::sqrt(disc);
+    if (-b - s > 0.0f) return -b - s;
+    if (-b + s > 0.0f) return -b + s;
+    return -1.0f;
+}
+
+// Bruneton's parameterization: u follows the distance to the top of the
+// atmosphere, v the height, so the horizon gets most of the resolution.
+glm::vec2 TransmittanceUv(float r, float mu) {
+    const float H = std::sqrt(kTopRadius * kTopRadius - kGroundRadius * kGroundRadius);
+    const float rho = std::sqrt(std::max(0.0f, r * r - kGroundRadius * kGroundRadius));
+    const float disc = r * r * (mu * mu - 1.0f) + kTopRadius * kTopRadius;
+    const float d = std::max(0.0f, -r * mu + std::sqrt(std::max(disc, 0.0f)));
+    const float dMin = kTopRadius - r;
+    const float dMax = rho + H;
+    return glm::vec2((d - dMin) / (dMax - dMin), rho / H);
+}
+
+void TransmittanceParams(const glm::vec2& uv, float& r, float& mu) {
+    const float H = std::sqrt(kTopRadius * kTopRadius - kGroundRadius * kGroundRadius);
+    const float rho = H * uv.y;
+    r = std::sqrt(rho * rho + kGroundRadius * kGroundRadius);
+    const float dMin = kTopRadius - r;
+    const float dMax = rho + H;
+    const float d = dMin + uv.x * (dMax - dMin);
+    mu = d <= 0.0f ? 1.0f : (H * H - rho * rho - d * d) / (2.0f * r * d);
+    mu = glm::clamp(mu, -1.0f, 1.0f);
+}
+
+glm::vec3 SampleTable(const std::vector<float>& data, int width, int height, const glm::vec2& uv) {
+    const float x = glm::clamp(uv.x * width - 0.5f, 0.0f, width - 1.0f);
+    const float y = glm::clamp(uv.y * height - 0.5f, 0.0f, height - 1.0f);
+    const int x0 = static_cast<int>(x), y0 = static_cast<int>(y);
+    const int x1 = std::min(x0 + 1, width - 1), y1 = std::min(y0 + 1, height - 1);
+    const float fx = x - x0, fy = y - y0;
+
+    auto At = [&](int tx, int ty) {
+        const float* p = &data[(static_cast<size_t>(ty) * width + tx) * 4];
+        return glm::vec3(p[0], p[1], p[2]);
+        };
+    return glm::mix(glm::mix(At(x0, y0), At(x1, y0), fx), glm::mix(At(x0, y1), At(x1, y1), fx), fy);
+}
+
+glm::vec3 ComputeTransmittance(float r, float mu) {
+    const glm::vec3 origin(0.0f, r, 0.0f);
+    const glm::vec3 dir(std::sqrt(std::max(0.0f, 1.0f - mu * mu)), mu, 0.0f);
+    const float length = std::max(0.0f, RaySphere(origin, dir, kTopRadius));
+
+    const float dt = length / kTransmittanceSteps;
+    glm::vec3 depth(0.0f);
+    for (int i = 0; i < kTransmittanceSteps; ++i) {
+        const glm::vec3 p = origin + dir * ((i + 0.5f) * dt);
+        depth += SampleMedium(glm::length(p) - kGroundRadius).extinction * dt;
+    }
+    return glm::exp(-depth);
+}
+
+// Second-order scattering from an isotropic sphere of directions, summed as
+// a geometric series (Hillaire's psi_ms): light scattered any number of
+// further times, for unit sun illuminance.
+glm::vec3 ComputeMultiScatter(const std::vector<float>& transmittance, float r, float muS) {
+    const glm::vec3 origin(0.0f, r, 0.0f);
+    const glm::vec3 sun(std::sqrt(std::max(0.0f, 1.0f - muS * muS)), muS, 0.0f);
+    const float isotropic = 1.0f / (4.0f * kPi);
+
+    auto SunTransmittance = [&](const glm::vec3& p) {
+        const float rp = glm::length(p);
+        const glm::vec3 up = p / rp;
+        if (RaySphere(p, sun, kGroundRadius) > 0.0f) return glm::vec3(0.0f);
+        return SampleTable(transmittance, Sky::kTransmittanceWidth, Sky::kTransmittanceHeight, TransmittanceUv(rp, glm::dot(up, sun)));
+        };
+
+    glm::vec3 luminance(0.0f);
+    glm::vec3 transfer(0.0f);
+    for (int i = 0; i < kMultiScatterDirections; ++i) {
+        for (int j = 0; j < kMultiScatterDirections; ++j) {
+            const float cosTheta = 1.0f - 2.0f * (i + 0.5f) / kMultiScatterDirections;
+            const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+            const float phi = 2.0f * kPi * (j + 0.5f) / kMultiScatterDirections;
+            const glm::vec3 dir(sinTheta * std::cos(phi), cosTheta, sinTheta * std::sin(phi));
+
+            const float tBottom = RaySphere(origin, dir, kGroundRadius);
+            const float tTop = RaySphere(origin, dir, kTopRadius);
+            const float tMax = tBottom > 0.0f ? tBottom : std::max(tTop, 0.0f);
+            const float dt = tMax / kMultiScatterSteps;
+
+            glm::vec3 L(0.0f), f(0.0f), T(1.0f);
+            for (int s = 0; s < kMultiScatterSteps; ++s) {
+                const glm::vec3 p = origin + dir * ((s + 0.5f) * dt);
+                const Medium m = SampleMedium(glm::length(p) - kGroundRadius);
+                const glm::vec3 stepT = glm::exp(-m.extinction * dt);
+                const glm::vec3 integral = (glm::vec3(1.0f) - stepT) / m.extinction;
+
+                L += T * m.scattering * isotropic * SunTransmittance(p) * integral;
+                f += T * m.scattering * integral;
+                T *= stepT;
+            }
+
+            if (tBottom > 0.0f) {
+                // Lifted off the surface so the shadow test doesn't hit it.
+                const glm::vec3 up = glm::normalize(origin + dir * tBottom);
+                const glm::vec3 p = up * (kGroundRadius + 0.01f);
+                const float cosSun = std::max(glm::dot(up, sun), 0.0f);
+                L += T * SunTransmittance(p) * cosSun * kGroundAlbedo / kPi;
+            }
+
+            luminance += L;
+            transfer += f * isotropic;
+        }
+    }
+
+    const float count = static_cast<float>(kMultiScatterDirections * kMultiScatterDirections);
+    // Directions are equal-area, so the mean times 4 pi is the sphere integral.
+    luminance *= 4.0f * kPi * isotropic / count;
+    transfer *= 4.0f * kPi / count;
+    return luminance / (glm::vec3(1.0f) - transfer);
+}
+
+std::uint64_t CacheKey() {
+    std::uint64_t key = kSkyCacheVersion;
+    for (int v : { Sky::kTransmittanceWidth, Sky::kTransmittanceHeight, Sky::kMultiScatterSize })
+        key = key * 1099511628211ull + static_cast<std::uint64_t>(v);
+    return key;
+}
+
+bool LoadSkyCache(const std::string& path, std::vector<float>& transmittance, std::vector<float>& multiScatter) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    char magic[4];
+    std::uint64_t key = 0;
+    file.read(magic, 4);
+    file.read(reinterpret_cast<char*>(&key), sizeof(key));
+    if (!file || !std::equal(magic, magic + 4, kSkyMagic) || key != CacheKey()) return false;
+
+    file.read(reinterpret_cast<char*>(transmittance.data()), transmittance.size() * sizeof(float));
+    file.read(reinterpret_cast<char*>(multiScatter.data()), multiScatter.size() * sizeof(float));
+    return static_cast<bool>(file);
+}
+
+bool SaveSkyCache(const std::string& path, const std::vector<float>& transmittance, const std::vector<float>& multiScatter) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    const std::uint64_t key = CacheKey();
+    file.write(kSkyMagic, 4);
+    file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    file.write(reinterpret_cast<const char*>(transmittance.data()), transmittance.size() * sizeof(float));
+    file.write(reinterpret_cast<const char*>(multiScatter.data()), multiScatter.size() * sizeof(float));
+    return static_cast<bool>(file);
+}
+
+GLuint CreateLutTexture(GLenum target, int width, int height, int depth, const float* data) {
+    GLuint tex = 0;
+    glGenTextures(1, &tex);
+    glBindTexture(target, tex);
+    if (target == GL_TEXTURE_3D) {
+        glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA16F, width, height, depth);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    }
+    else {
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, width, height);
+        if (data) glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_FLOAT, data);
+    }
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(target, 0);
+    return tex;
+}
+
+}
+
+Sky::~Sky() {
+    Shutdown();
+}
+
+bool Sky::BuildCpuLuts(JobPool& jobs, const std::string& cacheDir) {
+    m_transmittanceData.assign(static_cast<size_t>(kTransmittanceWidth) * kTransmittanceHeight * 4, 1.0f);
+    m_multiScatterData.assign(static_cast<size_t>(kMultiScatterSize) * kMultiScatterSize * 4, 0.0f);
+
+    const std::string path = cacheDir + "/sky_luts.bin";
+    if (LoadSkyCache(path, m_transmittanceData, m_multiScatterData)) {
+        std::cout << "Sky: loaded " << path << "\n";
+        return true;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    jobs.ParallelFor(kTransmittanceHeight, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            for (int x = 0; x < kTransmittanceWidth; ++x) {
+                float r = 0.0f, mu = 0.0f;
+                TransmittanceParams(glm::vec2((x + 0.5f) / kTransmittanceWidth, (y + 0.5f) / kTransmittanceHeight), r, mu);
+                const glm::vec3 t = ComputeTransmittance(r, mu);
+                float* out = &m_transmittanceData[(static_cast<size_t>(y) * kTransmittanceWidth + x) * 4];
+                out[0] = t.x; out[1] = t.y; out[2] = t.z;
+            }
+        }
+        });
+
+    jobs.ParallelFor(kMultiScatterSize, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const float r = kGroundRadius + (y + 0.5f) / kMultiScatterSize * (kTopRadius - kGroundRadius);
+            for (int x = 0; x < kMultiScatterSize; ++x) {
+                const float muS = (x + 0.5f) / kMultiScatterSize * 2.0f - 1.0f;
+                const glm::vec3 ms = ComputeMultiScatter(m_transmittanceData, r, muS);
+                float* out = &m_multiScatterData[(static_cast<size_t>(y) * kMultiScatterSize + x) * 4];
+                out[0] = ms.x; out[1] = ms.y; out[2] = ms.z;
+            }
+        }
+        });
+
+    const float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Sky: built transmittance and multi-scattering tables in " << seconds << " s on "
+        << jobs.ThreadCount() << " threads\n";
+
+    std::error_code ec;
+    std::filesystem::create_directories(cacheDir, ec);
+    if (!SaveSkyCache(path, m_transmittanceData, m_multiScatterData))
+        std::cerr << "Sky: could not write cache " << path << "\n";
+    return true;
+}
+
+bool Sky::Initialize(JobPool& jobs, const std::string& cacheDir) {
+    m_skyViewProgram = CreateComputeProgramFromFile("sky_luts.comp", "#define SKY_VIEW");
+    m_aerialProgram = CreateComputeProgramFromFile("sky_luts.comp");
+    m_drawProgram = CreateShaderProgramFromFiles("sky.vert", "sky.frag");
+    for (GLuint* program : { &m_skyViewProgram, &m_aerialProgram, &m_drawProgram }) {
+        if (*program && *program != static_cast<GLuint>(-1)) continue;
+        std::cerr << "Sky: shaders failed, keeping the black clear\n";
+        *program = 0;
+        Shutdown();
+        return false;
+    }
+
+    BuildCpuLuts(jobs, cacheDir);
+
+    m_transmittance = CreateLutTexture(GL_TEXTURE_2D, kTransmittanceWidth, kTransmittanceHeight, 1, m_transmittanceData.data());
+    m_multiScatter = CreateLutTexture(GL_TEXTURE_2D, kMultiScatterSize, kMultiScatterSize, 1, m_multiScatterData.data());
+    m_skyView = CreateLutTexture(GL_TEXTURE_2D, kSkyViewWidth, kSkyViewHeight, 1, nullptr);
+    m_aerial = CreateLutTexture(GL_TEXTURE_3D, kAerialSize, kAerialSize, kAerialSize, nullptr);
+    LabelGlObject(GL_TEXTURE, m_transmittance, "sky transmittance");
+    LabelGlObject(GL_TEXTURE, m_multiScatter, "sky multi-scatter");
+    LabelGlObject(GL_TEXTURE, m_skyView, "sky view");
+    LabelGlObject(GL_TEXTURE, m_aerial, "sky aerial perspective");
+
+    glGenVertexArrays(1, &m_vao);
+
+    m_uInvViewProj = glGetUniformLocation(m_drawProgram, "u_invViewProj");
+    m_uViewPos = glGetUniformLocation(m_drawProgram, "u_viewPos");
+    m_uSunDir = glGetUniformLocation(m_drawProgram, "u_sunDir");
+
+    glUseProgram(m_drawProgram);
+    glUniform1i(glGetUniformLocation(m_drawProgram, "u_skyView"), 0);
+    glUniform1i(glGetUniformLocation(m_drawProgram, "u_transmittance"), 1);
+    glUniform1f(glGetUniformLocation(m_drawProgram, "u_observerRadius"), kGroundRadius + observerAltitudeKm);
+    glUniform1f(glGetUniformLocation(m_drawProgram, "u_exposure"), exposure);
+
+    for (GLuint program : { m_skyViewProgram, m_aerialProgram }) {
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program, "u_transmittance"), 0);
+        glUniform1i(glGetUniformLocation(program, "u_multiScatter"), 1);
+        glUniform1f(glGetUniformLocation(program, "u_observerRadius"), kGroundRadius + observerAltitudeKm);
+        glUniform1f(glGetUniformLocation(program, "u_aerialMaxKm"), aerialDistance * worldUnitKm);
+    }
+    glUseProgram(0);
+
+    m_lutsValid = false;
+    return true;
+}
+
+void Sky::Shutdown() {
+    for (GLuint* tex : { &m_transmittance, &m_multiScatter, &m_skyView, &m_aerial }) {
+        if (*tex) glDeleteTextures(1, tex);
+        *tex = 0;
+    }
+    for (GLuint* program : { &m_skyViewProgram, &m_aerialProgram, &m_drawProgram }) {
+        if (*program) glDeleteProgram(*program);
+        *program = 0;
+    }
+    if (m_vao) glDeleteVertexArrays(1, &m_vao);
+    m_vao = 0;
+    m_lutsValid = false;
+}
+
+bool Sky::NeedsUpdate(const glm::vec3& sunDir) const {
+    return Ready() && (!m_lutsValid || glm::dot(glm::normalize(sunDir), m_sunDir) < 0.99999f);
+}
+
+void Sky::UpdateLuts(const glm::vec3& sunDir) {
+    if (!Ready()) return;
+    m_sunDir = glm::normalize(sunDir);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_transmittance);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_multiScatter);
+    glActiveTexture(GL_TEXTURE0);
+
+    // Both tables are built in a frame where the sun lies in the x-y plane;
+    // lookups measure azimuth from the sun, so only its elevation matters.
+    glUseProgram(m_skyViewProgram);
+    glUniform1f(glGetUniformLocation(m_skyViewProgram, "u_sunElevationSin"), m_sunDir.y);
+    glBindImageTexture(0, m_skyView, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glDispatchCompute((kSkyViewWidth + 7) / 8, (kSkyViewHeight + 7) / 8, 1);
+
+    glUseProgram(m_aerialProgram);
+    glUniform1f(glGetUniformLocation(m_aerialProgram, "u_sunElevationSin"), m_sunDir.y);
+    glBindImageTexture(0, m_aerial, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glDispatchCompute((kAerialSize + 7) / 8, (kAerialSize + 7) / 8, kAerialSize);
+
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    glUseProgram(0);
+
+    m_lutsValid = true;
+    m_lutUpdates++;
+}
+
+void Sky::Draw(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& viewPos) {
+    if (!Ready()) return;
+
+    const glm::mat4 invViewProj = glm::inverse(proj * view);
+    glUseProgram(m_drawProgram);
+    glUniformMatrix4fv(m_uInvViewProj, 1, GL_FALSE, glm::value_ptr(invViewProj));
+    glUniform3fv(m_uViewPos, 1, glm::value_ptr(viewPos));
+    glUniform3fv(m_uSunDir, 1, glm::value_ptr(m_sunDir));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_skyView);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_transmittance);
+    glActiveTexture(GL_TEXTURE0);
+
+    // A full-screen triangle on the far plane: only pixels the scene left
+    // at the cleared depth pass the test.
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_FALSE);
+    glBindVertexArray(m_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+}
+
+void Sky::BindTextures() const {
+    glActiveTexture(GL_TEXTURE0 + kAerialTextureUnit);
+    glBindTexture(GL_TEXTURE_3D, m_aerial);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void Sky::ApplyUniforms(GLuint program, bool enabled) const {
+    auto Loc = [&](const char* name) { return glGetUniformLocation(program, name); };
+
+    // Set even when disabled, like the shadow samplers: left at unit 0 the
+    // 3D sampler would clash with u_diffuse.
+    glUniform1i(Loc("u_aerialLut"), kAerialTextureUnit);
+    const bool on = enabled && Ready() && m_lutsValid;
+    glUniform1i(Loc("u_skyEnabled"), on ? 1 : 0);
+    if (!on) return;
+
+    glUniform1f(Loc("u_aerialDistance"), aerialDistance);
+    glUniform1f(Loc("u_skyExposure"), exposure);
+    glUniform3fv(Loc("u_sunDir"), 1, glm::value_ptr(m_sunDir));
+}
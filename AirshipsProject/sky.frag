@@ -0,0 +1,58 @@
+#version 330 core
+
+// Sky behind the scene from the sky-view LUT, plus the sun disk dimmed by
+// the transmittance LUT. Lookups mirror sky_luts.comp.
+
+in vec2 v_ndc;
+
+uniform sampler2D u_skyView;
+uniform sampler2D u_transmittance;
+uniform mat4 u_invViewProj;
+uniform vec3 u_viewPos;
+uniform vec3 u_sunDir;
+uniform float u_observerRadius;
+uniform float u_exposure;
+
+out vec4 FragColor;
+
+const float PI = 3.14159265;
+const float kGroundRadius = 6360.0;
+const float kTopRadius = 6460.0;
+// About twice the real sun, so it reads at this resolution.
+const float kSunCosRadius = 0.99996;
+const float kSunRadiance = 40.0;
+
+vec2 SkyViewUv(vec3 dir)
+{
+    vec2 h = dir.xz;
+    vec2 s = u_sunDir.xz;
+    float cosAzimuth = (dot(h, h) > 1e-8 && dot(s, s) > 1e-8) ? dot(normalize(h), normalize(s)) : 1.0;
+    float azimuth = acos(clamp(cosAzimuth, -1.0, 1.0)) / PI;
+
+    float elevation = asin(clamp(dir.y, -1.0, 1.0));
+    float l = sign(elevation) * sqrt(abs(elevation) / (0.5 * PI));
+    return vec2(azimuth, 0.5 + 0.5 * l);
+}
+
+vec2 TransmittanceUv(float r, float mu)
+{
+    float H = sqrt(kTopRadius * kTopRadius - kGroundRadius * kGroundRadius);
+    float rho = sqrt(max(0.0, r * r - kGroundRadius * kGroundRadius));
+    float disc = r * r * (mu * mu - 1.0) + kTopRadius * kTopRadius;
+    float d = max(0.0, -r * mu + sqrt(max(disc, 0.0)));
+    float dMin = kTopRadius - r;
+    float dMax = rho + H;
+    return vec2((d - dMin) / (dMax - dMin), rho / H);
+}
+
+void main()
+{
+    vec4 far = u_invViewProj * vec4(v_ndc, 1.0, 1.0);
+    vec3 dir = normalize(far.xyz / far.w - u_viewPos);
+
+    vec3 radiance = texture(u_skyView, SkyViewUv(dir)).rgb;
+    if (dot(dir, u_sunDir) > kSunCosRadius && dir.y > 0.0)
+        radiance += kSunRadiance * texture(u_transmittance, TransmittanceUv(u_observerRadius, dir.y)).rgb;
+
+    FragColor = vec4(vec3(1.0) - exp(-radiance * u_exposure), 1.0);
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+class JobPool;
+
+// Physically based sky and aerial perspective from lookup tables, after
+// Hillaire's "scalable and production ready sky" (2020), Earth atmosphere.
+//
+//   transmittance   256x64, (height, sun zenith)   CPU once, cached
+//   multi-scatter    32x32, (height, sun zenith)   CPU once, cached
+//   sky-view       192x108, (azimuth, elevation)   GPU when the sun moves
+//   aerial       32x32x32, (azimuth, elevation, distance)
+//                                                  GPU when the sun moves
+//
+// The observer sits at a fixed altitude (the field spans a few hundred
+// metres of height at most), which makes both GPU tables depend on the sun
+// alone. The sky pass then costs one sky-view fetch per pixel plus a
+// transmittance fetch inside the sun disk; game.frag applies aerial
+// perspective with one 3D fetch.
+class Sky {
+public:
+    static constexpr int kTransmittanceWidth = 256;
+    static constexpr int kTransmittanceHeight = 64;
+    static constexpr int kMultiScatterSize = 32;
+    static constexpr int kSkyViewWidth = 192;
+    static constexpr int kSkyViewHeight = 108;
+    static constexpr int kAerialSize = 32;
+
+    // One world unit is 20 m, so the 300-unit view distance spans 6 km of
+    // air: enough for distant hills to haze over.
+    float worldUnitKm{ 0.02f };
+    float aerialDistance{ 300.0f };
+    float observerAltitudeKm{ 0.3f };
+    float exposure{ 20.0f };
+
+    Sky() = default;
+    ~Sky();
+
+    Sky(const Sky&) = delete;
+    Sky& operator=(const Sky&) = delete;
+
+    // Builds (or loads) the CPU tables on the pool's threads; needs GL 4.3
+    // compute for the rest.
+    bool Initialize(JobPool& jobs, const std::string& cacheDir = "cache");
+    void Shutdown();
+    bool Ready() const { return m_drawProgram != 0; }
+
+    // sunDir points towards the sun.
+    bool NeedsUpdate(const glm::vec3& sunDir) const;
+    void UpdateLuts(const glm::vec3& sunDir);
+    int LutUpdates() const { return m_lutUpdates; }
+
+    // Fills pixels the scene left at the far plane.
+    void Draw(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& viewPos);
+
+    // Binds the aerial LUT to its texture unit; ApplyUniforms points the
+    // current program (one using game.frag) at it.
+    void BindTextures() const;
+    void ApplyUniforms(GLuint program, bool enabled) const;
+
+private:
+    bool BuildCpuLuts(JobPool& jobs, const std::string& cacheDir);
+
+    std::vector<float> m_transmittanceData;
+    std::vector<float> m_multiScatterData;
+
+    GLuint m_transmittance{ 0 };
+    GLuint m_multiScatter{ 0 };
+    GLuint m_skyView{ 0 };
+    GLuint m_aerial{ 0 };
+    GLuint m_vao{ 0 };
+
+    GLuint m_skyViewProgram{ 0 };
+    GLuint m_aerialProgram{ 0 };
+    GLuint m_drawProgram{ 0 };
+
+    glm::vec3 m_sunDir{ 0.0f };
+    bool m_lutsValid{ false };
+    int m_lutUpdates{ 0 };
+
+    int m_uInvViewProj{ -1 }, m_uViewPos{ -1 }, m_uSunDir{ -1 };
+};
@@ -0,0 +1,306 @@
+#include "static_batch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <utility>
+
+#include "gl_resources.h"
+
+StaticBatcher::~StaticBatcher() {
+    Destroy();
+}
+
+static float LodFactor(const Model& model, int lod) {
+    if (lod <= 0 || model.lods.empty()) return 0.0f;
+    size_t i = std::min(static_cast<size_t>(lod - 1), model.lods.size() - 1);
+    return model.lods[i].distanceFactor;
+}
+
+// Copies the vertices referenced by one submesh range into the merged
+// stream in world space; remap is sized to the model and reset afterwards.
+// The sway stream keeps what game.vert needs from object space: height
+// and how far the instance scales it.
+static void AppendRange(StaticBatchCell& cell, const StaticBatchSource& src, const SubMesh& sm,
+    std::vector<int>& remap, std::vector<unsigned int>& touched) {
+    const Model& m = *src.model;
+    const glm::mat3 linear(src.transform);
+    const glm::mat3 normalM = glm::transpose(glm::inverse(linear));
+    const float swayScale = glm::length(linear[0]);
+
+    for (unsigned int i = 0; i < sm.indexCount; ++i) {
+        unsigned int v = m.indices[sm.indexOffset + i];
+        if (remap[v] < 0) {
+            remap[v] = static_cast<int>(cell.vertices.size() / kVertexFloats);
+            touched.push_back(v);
+
+            glm::vec3 local = VertexPosition(m, v);
+            glm::vec3 p = glm::vec3(src.transform * glm::vec4(local, 1.0f));
+            glm::vec2 uv = VertexTexCoord(m, v);
+            glm::vec3 n = glm::normalize(normalM * VertexNormal(m, v));
+            glm::vec3 t = glm::normalize(linear * VertexTangent(m, v));
+            glm::vec3 b = glm::normalize(linear * VertexBitangent(m, v));
+
+            cell.vertices.insert(cell.vertices.end(), {
+                p.x, p.y, p.z, uv.x, uv.y,
+                n.x, n.y, n.z, t.x, t.y, t.z, b.x, b.y, b.z });
+            cell.sway.push_back({ local.y, swayScale });
+            cell.ao.push_back(src.ao ? src.ao[v] : 255);
+        }
+        cell.indices.push_back(static_cast<unsigned int>(remap[v]));
+    }
+
+    for (unsigned int v : touched) remap[v] = -1;
+    touched.clear();
+}
+
+static void FillCell(StaticBatchCell& cell, const std::vector<StaticBatchSource>& sources,
+    const std::vector<size_t>& members, const std::vector<BoundingSphere>& spheres, bool includeLod0, int lodCount) {
+    cell.hasLod0 = includeLod0;
+    cell.lodCount = lodCount;
+
+    glm::vec3 lo(1e30f), hi(-1e30f);
+    for (size_t i : members) {
+        lo = glm::min(lo, spheres[i].center - glm::vec3(spheres[i].radius));
+        hi = glm::max(hi, spheres[i].center + glm::vec3(spheres[i].radius));
+        cell.tags.push_back(sources[i].tag);
+    }
+    cell.bounds.center = (lo + hi) * 0.5f;
+    for (size_t i : members) {
+        float r = glm::distance(cell.bounds.center, spheres[i].center) + spheres[i].radius;
+        cell.bounds.radius = std::max(cell.bounds.radius, r);
+    }
+
+    // A cell switches to LOD l only once every member would have.
+    for (int l = 1; l < lodCount; ++l) {
+        for (size_t i : members)
+            cell.lodDistances[l] = std::max(cell.lodDistances[l], LodFactor(*sources[i].model, l) * spheres[i].radius);
+    }
+
+    for (size_t i : members) {
+        for (const SubMesh& sm : sources[i].model->subMeshes) {
+            auto it = std::find_if(cell.batches.begin(), cell.batches.end(), [&](const StaticBatch& b) {
+                return b.texture == sm.texture && b.swayStrength == sources[i].swayStrength;
+                });
+            if (it == cell.batches.end()) {
+                StaticBatch b;
+                b.texture = sm.texture;
+                b.swayStrength = sources[i].swayStrength;
+                cell.batches.push_back(b);
+            }
+        }
+    }
+
+    std::vector<int> remap;
+    std::vector<unsigned int> touched;
+
+    for (StaticBatch& batch : cell.batches) {
+        for (int l = includeLod0 ? 0 : 1; l < lodCount; ++l) {
+            StaticBatchRange& range = batch.lods[l];
+            range.indexOffset = static_cast<unsigned int>(cell.indices.size());
+
+            for (size_t i : members) {
+                const StaticBatchSource& src = sources[i];
+                if (src.swayStrength != batch.swayStrength) continue;
+
+                const std::vector<SubMesh>& subs = GetLodSubMeshes(*src.model, l);
+                for (size_t s = 0; s < subs.size(); ++s) {
+                    if (src.model->subMeshes[s].texture != batch.texture) continue;
+                    if (remap.size() < VertexCount(*src.model))
+                        remap.resize(VertexCount(*src.model), -1);
+                    AppendRange(cell, src, subs[s], remap, touched);
+                }
+            }
+
+            range.indexCount = static_cast<unsigned int>(cell.indices.size()) - range.indexOffset;
+        }
+    }
+
+    cell.vertexCount = cell.vertices.size() / kVertexFloats;
+    cell.indexCount = cell.indices.size();
+}
+
+glm::ivec2 StaticBatcher::CellOf(const StaticBatchSource& src) const {
+    const BoundingSphere s = ComputeWorldSphere(*src.model, src.transform, src.scale, src.swayStrength);
+    return { static_cast<int>(std::floor(s.center.x / cellSize)), static_cast<int>(std::floor(s.center.z / cellSize)) };
+}
+
+std::shared_ptr<StaticBatchSet> StaticBatcher::BuildSet(const std::vector<StaticBatchSource>& sources) const {
+    auto set = std::make_shared<StaticBatchSet>();
+
+    size_t lod0Vertices = 0;
+    int lodCount = 1;
+    for (const auto& src : sources) {
+        lod0Vertices += VertexCount(*src.model);
+        lodCount = std::max(lodCount, static_cast<int>(src.model->lods.size()) + 1);
+    }
+    set->lodCount = std::min(lodCount, StaticBatch::kMaxLods);
+    set->includeLod0 = lod0Vertices <= maxLod0Vertices;
+
+    std::map<std::pair<int, int>, std::vector<size_t>> buckets;
+    std::vector<BoundingSphere> spheres(sources.size());
+    for (size_t i = 0; i < sources.size(); ++i) {
+        const auto& src = sources[i];
+        spheres[i] = ComputeWorldSphere(*src.model, src.transform, src.scale, src.swayStrength);
+        int cx = static_cast<int>(std::floor(spheres[i].center.x / cellSize));
+        int cz = static_cast<int>(std::floor(spheres[i].center.z / cellSize));
+        buckets[{ cx, cz }].push_back(i);
+    }
+
+    for (const auto& [coord, members] : buckets) {
+        StaticBatchCell cell;
+        cell.coord = { coord.first, coord.second };
+        FillCell(cell, sources, members, spheres, set->includeLod0, set->lodCount);
+        set->vertexCount += cell.vertexCount;
+        set->indexCount += cell.indexCount;
+        set->cells.push_back(std::move(cell));
+    }
+
+    set->batched.assign(sources.empty() ? 0 : 1 + std::max_element(sources.begin(), sources.end(),
+        [](const StaticBatchSource& a, const StaticBatchSource& b) { return a.tag < b.tag; })->tag, false);
+    for (const auto& src : sources) {
+        if (src.tag >= 0) set->batched[src.tag] = true;
+    }
+
+    std::cout << "Static batches: " << set->cells.size() << " cells, " << set->vertexCount << " vertices, "
+        << set->indexCount / 3 << " triangles" << (set->includeLod0 ? "" : " (LOD 0 over budget, drawn per instance)") << "\n";
+    return set;
+}
+
+StaticBatchCell StaticBatcher::BuildCell(const std::vector<StaticBatchSource>& sources, glm::ivec2 coord,
+    bool includeLod0, int lodCount) const {
+    StaticBatchCell cell;
+    cell.coord = coord;
+
+    std::vector<size_t> members;
+    std::vector<BoundingSphere> spheres(sources.size());
+    for (size_t i = 0; i < sources.size(); ++i) {
+        const auto& src = sources[i];
+        spheres[i] = ComputeWorldSphere(*src.model, src.transform, src.scale, src.swayStrength);
+        if (static_cast<int>(std::floor(spheres[i].center.x / cellSize)) == coord.x &&
+            static_cast<int>(std::floor(spheres[i].center.z / cellSize)) == coord.y)
+            members.push_back(i);
+    }
+
+    if (!members.empty())
+        FillCell(cell, sources, members, spheres, includeLod0, lodCount);
+    return cell;
+}
+
+bool StaticBatcher::UploadSet(StaticBatchSet& set) {
+    bool ok = true;
+    for (StaticBatchCell& cell : set.cells)
+        ok = UploadCell(cell) && ok;
+    return ok;
+}
+
+bool StaticBatcher::UploadCell(StaticBatchCell& cell) {
+    // An emptied cell only needs to drop what it replaces.
+    if (cell.vertices.empty()) return true;
+
+    cell.vbo = CreateStaticBuffer(cell.vertices.size() * sizeof(float), cell.vertices.data());
+    cell.ebo = CreateStaticBuffer(cell.indices.size() * sizeof(unsigned int), cell.indices.data());
+    cell.swayBuffer = CreateStaticBuffer(cell.sway.size() * sizeof(glm::vec2), cell.sway.data());
+
+    // Batched vertices are indexed directly, so gl_VertexID addresses the
+    // cell's AO stream with a base of 0.
+    bool anyAo = std::any_of(cell.ao.begin(), cell.ao.end(), [](std::uint8_t a) { return a != 255; });
+    if (anyAo)
+        cell.aoBuffer = CreateStaticBuffer(cell.ao.size(), cell.ao.data());
+
+    std::vector<float>().swap(cell.vertices);
+    std::vector<unsigned int>().swap(cell.indices);
+    std::vector<glm::vec2>().swap(cell.sway);
+    std::vector<std::uint8_t>().swap(cell.ao);
+    return cell.vbo != 0 && cell.ebo != 0 && cell.swayBuffer != 0;
+}
+
+void StaticBatcher::CreateCellVertexArray(StaticBatchCell& cell) {
+    cell.vao = CreateVertexArray(cell.vbo, cell.ebo);
+
+    if (UsingDsa()) {
+        glVertexArrayVertexBuffer(cell.vao, 1, cell.swayBuffer, 0, sizeof(glm::vec2));
+        glEnableVertexArrayAttrib(cell.vao, kStaticBatchSwayAttrib);
+        glVertexArrayAttribFormat(cell.vao, kStaticBatchSwayAttrib, 2, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayAttribBinding(cell.vao, kStaticBatchSwayAttrib, 1);
+    }
+    else {
+        glBindVertexArray(cell.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, cell.swayBuffer);
+        glVertexAttribPointer(kStaticBatchSwayAttrib, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+        glEnableVertexAttribArray(kStaticBatchSwayAttrib);
+        glBindVertexArray(0);
+    }
+
+    if (cell.aoBuffer)
+        cell.aoTexture = CreateBufferTexture(GL_R8, cell.aoBuffer);
+}
+
+void StaticBatcher::Publish(std::shared_ptr<StaticBatchSet> set) {
+    for (StaticBatchCell& cell : set->cells)
+        CreateCellVertexArray(cell);
+    if (m_current) DestroySet(*m_current);
+    m_current = std::move(set);
+}
+
+void StaticBatcher::PublishCell(StaticBatchCell cell, const std::vector<int>& unbatched) {
+    if (!m_current) {
+        DestroyCell(cell);
+        return;
+    }
+    StaticBatchSet& set = *m_current;
+
+    auto it = std::find_if(set.cells.begin(), set.cells.end(), [&](const StaticBatchCell& c) {
+        return c.coord == cell.coord;
+        });
+    if (it != set.cells.end()) {
+        set.vertexCount -= it->vertexCount;
+        set.indexCount -= it->indexCount;
+        DestroyCell(*it);
+        set.cells.erase(it);
+    }
+
+    if (cell.vbo) {
+        CreateCellVertexArray(cell);
+        set.vertexCount += cell.vertexCount;
+        set.indexCount += cell.indexCount;
+        set.cells.push_back(std::move(cell));
+    }
+
+    for (int tag : unbatched) {
+        if (tag >= 0 && tag < static_cast<int>(set.batched.size())) set.batched[tag] = false;
+    }
+}
+
+void StaticBatcher::Destroy() {
+    if (m_current) DestroySet(*m_current);
+    m_current.reset();
+}
+
+void StaticBatcher::DestroyCell(StaticBatchCell& cell) {
+    if (cell.vao) glDeleteVertexArrays(1, &cell.vao);
+    if (cell.vbo) glDeleteBuffers(1, &cell.vbo);
+    if (cell.ebo) glDeleteBuffers(1, &cell.ebo);
+    if (cell.swayBuffer) glDeleteBuffers(1, &cell.swayBuffer);
+    if (cell.aoTexture) glDeleteTextures(1, &cell.aoTexture);
+    if (cell.aoBuffer) glDeleteBuffers(1, &cell.aoBuffer);
+    cell.vao = cell.vbo = cell.ebo = cell.swayBuffer = 0;
+    cell.aoBuffer = cell.aoTexture = 0;
+}
+
+void StaticBatcher::DestroySet(StaticBatchSet& set) {
+    for (StaticBatchCell& cell : set.cells)
+        DestroyCell(cell);
+    set.cells.clear();
+}
+
+int StaticBatcher::SelectCellLod(const StaticBatchCell& cell, const glm::vec3& viewPos) const {
+    const float d = std::max(0.0f, glm::distance(viewPos, cell.bounds.center) - cell.bounds.radius);
+
+    int lod = 0;
+    for (int l = 1; l < cell.lodCount; ++l) {
+        if (d > cell.lodDistances[l]) lod = l;
+    }
+    return lod;
+}
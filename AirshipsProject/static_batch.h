@@ -0,0 +1,116 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "culling.h"
+#include "model.h"
+
+struct StaticBatchSource {
+    const Model* model = nullptr;
+    glm::mat4 transform{ 1.0f };
+    glm::vec3 scale{ 1.0f };
+    float swayStrength = 0.0f;
+    int tag = -1;
+    const std::uint8_t* ao = nullptr;
+};
+
+struct StaticBatchRange {
+    unsigned int indexOffset = 0;
+    unsigned int indexCount = 0;
+};
+
+// One draw: everything in a cell sharing a texture and sway setting,
+// pre-transformed to world space, with one index range per LOD.
+struct StaticBatch {
+    static constexpr int kMaxLods = 4;
+
+    GLuint texture = 0;
+    float swayStrength = 0.0f;
+    StaticBatchRange lods[kMaxLods];
+};
+
+// Vertex attribute carrying (object-space height, scale) per batched
+// vertex: game.vert's sway is defined in object space, which the world
+// space positions no longer are.
+constexpr GLuint kStaticBatchSwayAttrib = 11;
+
+// A cell owns its geometry, so a change to one instance (a house being
+// delivered) rebuilds only the cell it sits in.
+struct StaticBatchCell {
+    glm::ivec2 coord{ 0 };
+    BoundingSphere bounds{};
+    float lodDistances[StaticBatch::kMaxLods] = {};
+    int lodCount = 1;
+    bool hasLod0 = false;
+
+    std::vector<StaticBatch> batches;
+    std::vector<int> tags;
+
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+    GLuint swayBuffer = 0;
+    GLuint aoBuffer = 0;
+    GLuint aoTexture = 0;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<glm::vec2> sway;
+    std::vector<std::uint8_t> ao;
+};
+
+struct StaticBatchSet {
+    std::vector<StaticBatchCell> cells;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    std::vector<bool> batched;
+
+    // Decided over the whole set; rebuilt cells keep them.
+    bool includeLod0 = true;
+    int lodCount = 1;
+};
+
+// Merges static instances into per-cell VBO/EBOs grouped by spatial cell
+// and material. Full-detail geometry is only merged while it fits
+// maxLod0Vertices; cells without it draw their instances individually
+// when close enough to need LOD 0.
+class StaticBatcher {
+public:
+    float cellSize{ 30.0f };
+    size_t maxLod0Vertices{ 1000000 };
+
+    ~StaticBatcher();
+
+    std::shared_ptr<StaticBatchSet> BuildSet(const std::vector<StaticBatchSource>& sources) const;
+    // The cell at coord from the sources that fall into it; the LOD layout
+    // comes from the set it will join.
+    StaticBatchCell BuildCell(const std::vector<StaticBatchSource>& sources, glm::ivec2 coord, bool includeLod0, int lodCount) const;
+    glm::ivec2 CellOf(const StaticBatchSource& src) const;
+
+    static bool UploadSet(StaticBatchSet& set);
+    static bool UploadCell(StaticBatchCell& cell);
+    static void DestroyCell(StaticBatchCell& cell);
+
+    void Publish(std::shared_ptr<StaticBatchSet> set);
+    // Replaces the current set's cell at the same coord (or drops it when
+    // the rebuilt cell is empty); `unbatched` tags are drawn individually
+    // from now on.
+    void PublishCell(StaticBatchCell cell, const std::vector<int>& unbatched);
+    void Destroy();
+
+    int SelectCellLod(const StaticBatchCell& cell, const glm::vec3& viewPos) const;
+
+    const StaticBatchSet* Current() const { return m_current.get(); }
+
+private:
+    static void CreateCellVertexArray(StaticBatchCell& cell);
+    static void DestroySet(StaticBatchSet& set);
+
+    std::shared_ptr<StaticBatchSet> m_current;
+};
@@ -0,0 +1,347 @@
+#include "terrain.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "shader_utils.h"
+
+static const GLuint kHeightmapTextureUnit = 3;
+
+namespace {
+
+std::uint32_t Hash(std::uint32_t x) {
+    x ^= x >> 16; x *= 0x7feb352dU;
+    x ^= x >> 15; x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+float Lattice(int x, int z, std::uint32_t seed) {
+    std::uint32_t h = Hash(static_cast<std::uint32_t>(x) * 73856093U ^ static_cast<std::uint32_t>(z) * 19349663U ^ seed);
+    return static_cast<float>(h >> 8) * (1.0f / 16777216.0f);
+}
+
+float ValueNoise(float x, float z, std::uint32_t seed) {
+    int ix = static_cast<int>(std::floor(x));
+    int iz = static_cast<int>(std::floor(z));
+    float fx = x - ix;
+    float fz = z - iz;
+    fx = fx * fx * (3.0f - 2.0f * fx);
+    fz = fz * fz * (3.0f - 2.0f * fz);
+
+    float a = Lattice(ix, iz, seed);
+    float b = Lattice(ix + 1, iz, seed);
+    float c = Lattice(ix, iz + 1, seed);
+    float d = Lattice(ix + 1, iz + 1, seed);
+    return glm::mix(glm::mix(a, b, fx), glm::mix(c, d, fx), fz);
+}
+
+float AabbDistance(const glm::vec3& lo, const glm::vec3& hi, const glm::vec3& p) {
+    return glm::length(glm::max(glm::max(lo - p, p - hi), glm::vec3(0.0f)));
+}
+
+}
+
+Terrain::~Terrain() {
+    Shutdown();
+}
+
+bool Terrain::InitializeGL() {
+    m_program = CreateShaderProgramFromFiles("terrain.vert", "game.frag");
+    if (!m_program || m_program == static_cast<GLuint>(-1)) {
+        std::cerr << "Terrain: shaders failed\n";
+        m_program = 0;
+        return false;
+    }
+
+    m_uView = glGetUniformLocation(m_program, "u_view");
+    m_uProj = glGetUniformLocation(m_program, "u_projection");
+    m_uViewPos = glGetUniformLocation(m_program, "u_viewPos");
+    m_uNode = glGetUniformLocation(m_program, "u_node");
+    m_uMorph = glGetUniformLocation(m_program, "u_morph");
+    m_uGridSize = glGetUniformLocation(m_program, "u_gridSize");
+    m_uTerrain = glGetUniformLocation(m_program, "u_terrain");
+    m_uUvScale = glGetUniformLocation(m_program, "u_uvScale");
+
+    glUseProgram(m_program);
+    glUniform1i(glGetUniformLocation(m_program, "u_diffuse"), 0);
+    glUniform1i(glGetUniformLocation(m_program, "u_normalMap"), 1);
+    glUniform1i(glGetUniformLocation(m_program, "u_heightmap"), kHeightmapTextureUnit);
+    glUniform1i(glGetUniformLocation(m_program, "u_useNormalMap"), 0);
+    glUniform1f(glGetUniformLocation(m_program, "u_emissionStrength"), 0.0f);
+    glUniform3f(glGetUniformLocation(m_program, "u_tint"), 1.0f, 1.0f, 1.0f);
+    glUniform1f(m_uGridSize, static_cast<float>(gridSize));
+    glUseProgram(0);
+
+    // Shared grid over [0,1]^2. Indices are grouped by quadrant so a node
+    // can be drawn whole (one range) or one quadrant at a time.
+    std::vector<float> verts;
+    for (int z = 0; z <= gridSize; ++z) {
+        for (int x = 0; x <= gridSize; ++x) {
+            verts.push_back(static_cast<float>(x) / gridSize);
+            verts.push_back(static_cast<float>(z) / gridSize);
+        }
+    }
+
+    std::vector<unsigned int> indices;
+    const int half = gridSize / 2;
+    for (int q = 0; q < 4; ++q) {
+        const int x0 = (q & 1) * half;
+        const int z0 = (q >> 1) * half;
+        for (int z = z0; z < z0 + half; ++z) {
+            for (int x = x0; x < x0 + half; ++x) {
+                unsigned int i0 = z * (gridSize + 1) + x;
+                unsigned int i1 = i0 + 1;
+                unsigned int i2 = i0 + (gridSize + 1);
+                unsigned int i3 = i2 + 1;
+                indices.insert(indices.end(), { i0, i2, i1, i1, i2, i3 });
+            }
+        }
+    }
+    m_indexCount = static_cast<GLsizei>(indices.size());
+
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_vbo);
+    glGenBuffers(1, &m_ebo);
+
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenTextures(1, &m_heightTex);
+    return true;
+}
+
+void Terrain::Shutdown() {
+    if (m_program) glDeleteProgram(m_program);
+    if (m_vao) glDeleteVertexArrays(1, &m_vao);
+    if (m_vbo) glDeleteBuffers(1, &m_vbo);
+    if (m_ebo) glDeleteBuffers(1, &m_ebo);
+    if (m_heightTex) glDeleteTextures(1, &m_heightTex);
+    m_program = m_vao = m_vbo = m_ebo = m_heightTex = 0;
+}
+
+void Terrain::Generate(float halfSize, std::uint64_t seed) {
+    m_origin = -halfSize;
+    m_size = 2.0f * halfSize;
+
+    const std::uint32_t s = static_cast<std::uint32_t>(seed ^ (seed >> 32));
+    const float texel = m_size / (resolution - 1);
+
+    m_heights.assign(static_cast<size_t>(resolution) * resolution, 0.0f);
+    for (int z = 0; z < resolution; ++z) {
+        for (int x = 0; x < resolution; ++x) {
+            float wx = m_origin + x * texel;
+            float wz = m_origin + z * texel;
+
+            float h = 0.0f, amp = 0.5f, freq = 1.0f / 40.0f;
+            for (int o = 0; o < 5; ++o) {
+                h += amp * ValueNoise(wx * freq, wz * freq, s + o * 1013U);
+                amp *= 0.5f;
+                freq *= 2.0f;
+            }
+
+            // Keep the spawn area around the tree flat.
+            float r = std::sqrt(wx * wx + wz * wz);
+            h *= glm::smoothstep(flatRadius, flatRadius * 2.0f, r);
+
+            m_heights[static_cast<size_t>(z) * resolution + x] = h * amplitude;
+        }
+    }
+
+    m_nodes.clear();
+    BuildNode(glm::vec2(m_origin), m_size, kLodLevels - 1);
+
+    for (int l = 0; l < kLodLevels; ++l)
+        m_ranges[l] = lodRange0 * static_cast<float>(1 << l);
+
+    if (m_heightTex) {
+        glBindTexture(GL_TEXTURE_2D, m_heightTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, resolution, resolution, 0, GL_RED, GL_FLOAT, m_heights.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+}
+
+int Terrain::BuildNode(const glm::vec2& origin, float size, int level) {
+    int index = static_cast<int>(m_nodes.size());
+    m_nodes.push_back({});
+
+    Node node;
+    node.origin = origin;
+    node.size = size;
+    node.level = level;
+    HeightRange(origin, origin + glm::vec2(size), node.minH, node.maxH);
+
+    if (level > 0) {
+        const float half = size * 0.5f;
+        for (int c = 0; c < 4; ++c)
+            node.children[c] = BuildNode(origin + glm::vec2((c & 1) * half, (c >> 1) * half), half, level - 1);
+    }
+
+    m_nodes[index] = node;
+    return index;
+}
+
+float Terrain::Texel(int x, int z) const {
+    x = std::clamp(x, 0, resolution - 1);
+    z = std::clamp(z, 0, resolution - 1);
+    return m_heights[static_cast<size_t>(z) * resolution + x];
+}
+
+float Terrain::HeightAt(float x, float z) const {
+    if (m_heights.empty()) return 0.0f;
+
+    float fx = glm::clamp((x - m_origin) / m_size, 0.0f, 1.0f) * (resolution - 1);
+    float fz = glm::clamp((z - m_origin) / m_size, 0.0f, 1.0f) * (resolution - 1);
+    int ix = static_cast<int>(std::floor(fx));
+    int iz = static_cast<int>(std::floor(fz));
+    float tx = fx - ix;
+    float tz = fz - iz;
+
+    float a = Texel(ix, iz);
+    float b = Texel(ix + 1, iz);
+    float c = Texel(ix, iz + 1);
+    float d = Texel(ix + 1, iz + 1);
+    return glm::mix(glm::mix(a, b, tx), glm::mix(c, d, tx), tz);
+}
+
+glm::vec3 Terrain::NormalAt(float x, float z) const {
+    if (m_heights.empty()) return glm::vec3(0.0f, 1.0f, 0.0f);
+
+    const float e = m_size / (resolution - 1);
+    float dx = HeightAt(x + e, z) - HeightAt(x - e, z);
+    float dz = HeightAt(x, z + e) - HeightAt(x, z - e);
+    return glm::normalize(glm::vec3(-dx, 2.0f * e, -dz));
+}
+
+float Terrain::MinHeightAround(float x, float z, float radius) const {
+    float h = HeightAt(x, z);
+    for (int i = 0; i < 8; ++i) {
+        float a = i * 0.78539816f;
+        h = std::min(h, HeightAt(x + std::cos(a) * radius, z + std::sin(a) * radius));
+    }
+    return h;
+}
+
+void Terrain::HeightRange(const glm::vec2& lo, const glm::vec2& hi, float& outMin, float& outMax) const {
+    outMin = outMax = 0.0f;
+    if (m_heights.empty()) return;
+
+    const float scale = (resolution - 1) / m_size;
+    int x0 = static_cast<int>(std::floor((lo.x - m_origin) * scale));
+    int x1 = static_cast<int>(std::ceil((hi.x - m_origin) * scale));
+    int z0 = static_cast<int>(std::floor((lo.y - m_origin) * scale));
+    int z1 = static_cast<int>(std::ceil((hi.y - m_origin) * scale));
+
+    outMin = 1e30f;
+    outMax = -1e30f;
+    for (int z = z0; z <= z1; ++z) {
+        for (int x = x0; x <= x1; ++x) {
+            float h = Texel(x, z);
+            outMin = std::min(outMin, h);
+            outMax = std::max(outMax, h);
+        }
+    }
+}
+
+std::vector<TriangleBvh::Triangle> Terrain::BuildTriangles(int step) const {
+    std::vector<TriangleBvh::Triangle> tris;
+    if (m_heights.empty()) return tris;
+
+    const float texel = m_size / (resolution - 1);
+    auto P = [&](int x, int z) {
+        x = std::min(x, resolution - 1);
+        z = std::min(z, resolution - 1);
+        return glm::vec3(m_origin + x * texel, Texel(x, z), m_origin + z * texel);
+        };
+
+    for (int z = 0; z < resolution - 1; z += step) {
+        for (int x = 0; x < resolution - 1; x += step) {
+            glm::vec3 a = P(x, z), b = P(x + step, z), c = P(x, z + step), d = P(x + step, z + step);
+            tris.push_back({ a, c, b });
+            tris.push_back({ b, c, d });
+        }
+    }
+    return tris;
+}
+
+void Terrain::BindHeightmap(GLuint unit) const {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, m_heightTex);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// Classic CDLOD selection: a node is drawn at its own LOD when the camera is
+// outside the next finer range; otherwise children that are in range recurse
+// and the remaining quadrants are drawn at this node's LOD.
+bool Terrain::SelectNode(int index, int lod, const Frustum& frustum, const glm::vec3& viewPos) {
+    const Node& node = m_nodes[index];
+    const glm::vec3 lo(node.origin.x, node.minH, node.origin.y);
+    const glm::vec3 hi(node.origin.x + node.size, node.maxH, node.origin.y + node.size);
+
+    if (AabbDistance(lo, hi, viewPos) > m_ranges[lod]) return false;
+
+    BoundingSphere sphere{ (lo + hi) * 0.5f, glm::length(hi - lo) * 0.5f };
+    if (!frustum.Intersects(sphere)) return true;
+
+    if (lod == 0 || AabbDistance(lo, hi, viewPos) > m_ranges[lod - 1]) {
+        m_selected.push_back({ node.origin, node.size, lod, -1 });
+        return true;
+    }
+
+    for (int c = 0; c < 4; ++c) {
+        if (!SelectNode(node.children[c], lod - 1, frustum, viewPos))
+            m_selected.push_back({ node.origin, node.size, lod, c });
+    }
+    return true;
+}
+
+void Terrain::Draw(const glm::mat4& view, const glm::mat4& proj, const Frustum& frustum, const glm::vec3& viewPos, GLuint texture) {
+    m_lastNodes = 0;
+    if (!m_program || m_nodes.empty()) return;
+
+    m_selected.clear();
+    SelectNode(0, kLodLevels - 1, frustum, viewPos);
+
+    glUseProgram(m_program);
+    glUniformMatrix4fv(m_uView, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(m_uProj, 1, GL_FALSE, glm::value_ptr(proj));
+    glUniform3fv(m_uViewPos, 1, glm::value_ptr(viewPos));
+    glUniform4fv(m_uTerrain, 1, glm::value_ptr(HeightmapParams()));
+    glUniform1f(m_uUvScale, uvScale);
+
+    BindHeightmap(kHeightmapTextureUnit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glBindVertexArray(m_vao);
+    for (const Selected& s : m_selected) {
+        const float lower = (s.lod > 0) ? m_ranges[s.lod - 1] : 0.0f;
+        const float end = m_ranges[s.lod];
+        glUniform2f(m_uMorph, lower + (end - lower) * morphRatio, end);
+
+        GLsizei count = m_indexCount;
+        size_t first = 0;
+        if (s.quadrant >= 0) {
+            count = m_indexCount / 4;
+            first = static_cast<size_t>(s.quadrant) * count;
+        }
+
+        glUniform4f(m_uNode, s.origin.x, s.origin.y, s.size, 0.0f);
+        glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, (void*)(first * sizeof(unsigned int)));
+        m_lastNodes++;
+    }
+    glBindVertexArray(0);
+}
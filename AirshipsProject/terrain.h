@@ -0,0 +1,90 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "bvh.h"
+#include "culling.h"
+
+// Heightmap terrain drawn with CDLOD: one shared grid mesh is placed per
+// selected quadtree node and displaced in terrain.vert, morphing toward the
+// next coarser grid near the end of each LOD range so levels meet without
+// cracks or popping. Heights are also queryable on the CPU.
+class Terrain {
+public:
+    static constexpr int kLodLevels = 4;
+
+    int resolution{ 257 };
+    int gridSize{ 32 };
+    float amplitude{ 5.0f };
+    float flatRadius{ 12.0f };
+    float uvScale{ 50.0f / 120.0f };
+    float lodRange0{ 25.0f };
+    float morphRatio{ 0.7f };
+
+    Terrain() = default;
+    ~Terrain();
+
+    Terrain(const Terrain&) = delete;
+    Terrain& operator=(const Terrain&) = delete;
+
+    bool InitializeGL();
+    void Shutdown();
+    GLuint Program() const { return m_program; }
+
+    void Generate(float halfSize, std::uint64_t seed);
+
+    float HeightAt(float x, float z) const;
+    glm::vec3 NormalAt(float x, float z) const;
+    float MinHeightAround(float x, float z, float radius) const;
+    void HeightRange(const glm::vec2& lo, const glm::vec2& hi, float& outMin, float& outMax) const;
+    std::vector<TriangleBvh::Triangle> BuildTriangles(int step) const;
+
+    void BindHeightmap(GLuint unit) const;
+    glm::vec4 HeightmapParams() const { return glm::vec4(m_origin, m_origin, m_size, static_cast<float>(resolution)); }
+
+    void Draw(const glm::mat4& view, const glm::mat4& proj, const Frustum& frustum, const glm::vec3& viewPos, GLuint texture);
+    int LastNodeCount() const { return m_lastNodes; }
+
+private:
+    struct Node {
+        glm::vec2 origin{ 0.0f };
+        float size{ 0.0f };
+        int level{ 0 };
+        float minH{ 0.0f };
+        float maxH{ 0.0f };
+        int children[4]{ -1, -1, -1, -1 };
+    };
+
+    struct Selected {
+        glm::vec2 origin;
+        float size;
+        int lod;
+        int quadrant;   // -1 draws the whole node
+    };
+
+    int BuildNode(const glm::vec2& origin, float size, int level);
+    bool SelectNode(int index, int lod, const Frustum& frustum, const glm::vec3& viewPos);
+    float Texel(int x, int z) const;
+
+    std::vector<float> m_heights;
+    std::vector<Node> m_nodes;
+    std::vector<Selected> m_selected;
+    float m_ranges[kLodLevels]{};
+
+    float m_origin{ 0.0f };
+    float m_size{ 0.0f };
+
+    GLuint m_program{ 0 };
+    GLuint m_vao{ 0 };
+    GLuint m_vbo{ 0 };
+    GLuint m_ebo{ 0 };
+    GLuint m_heightTex{ 0 };
+    GLsizei m_indexCount{ 0 };
+    int m_lastNodes{ 0 };
+
+    int m_uView{ -1 }, m_uProj{ -1 }, m_uViewPos{ -1 }, m_uNode{ -1 }, m_uMorph{ -1 };
+    int m_uGridSize{ -1 }, m_uTerrain{ -1 }, m_uUvScale{ -1 };
+};
@@ -0,0 +1,65 @@
+#version 330 core
+
+// CDLOD terrain: the shared [0,1]^2 grid is placed over one quadtree node
+// and displaced by the heightmap. Near the end of a LOD range, odd grid
+// vertices slide onto the next coarser grid so neighbouring levels meet.
+
+layout(location = 0) in vec2 aGrid;
+
+uniform mat4 u_view;
+uniform mat4 u_projection;
+uniform vec3 u_viewPos;
+
+uniform vec4 u_node;            // origin x, origin z, size, unused
+uniform vec2 u_morph;           // morph start, end distance
+uniform float u_gridSize;
+uniform vec4 u_terrain;         // origin x, origin z, size, texels per side
+uniform float u_uvScale;
+
+uniform sampler2D u_heightmap;
+
+out VS_OUT {
+    vec2 uv;
+    vec3 worldPos;
+    vec3 normal;
+    mat3 TBN;
+    float ao;
+} vs_out;
+
+float Height(vec2 xz)
+{
+    vec2 uv = clamp((xz - u_terrain.xy) / u_terrain.z, 0.0, 1.0);
+    uv = (uv * (u_terrain.w - 1.0) + 0.5) / u_terrain.w;
+    return texture(u_heightmap, uv).r;
+}
+
+void main()
+{
+    vec2 xz = u_node.xy + aGrid * u_node.z;
+    float d = distance(vec3(xz.x, Height(xz), xz.y), u_viewPos);
+    float k = clamp((d - u_morph.x) / (u_morph.y - u_morph.x), 0.0, 1.0);
+
+    vec2 frac = fract(aGrid * u_gridSize * 0.5) * 2.0 / u_gridSize;
+    xz = u_node.xy + (aGrid - frac * k) * u_node.z;
+
+    vec3 world = vec3(xz.x, Height(xz), xz.y);
+
+    float e = u_terrain.z / (u_terrain.w - 1.0);
+    float hL = Height(xz - vec2(e, 0.0));
+    float hR = Height(xz + vec2(e, 0.0));
+    float hD = Height(xz - vec2(0.0, e));
+    float hU = Height(xz + vec2(0.0, e));
+
+    vec3 N = normalize(vec3(hL - hR, 2.0 * e, hD - hU));
+    vec3 T = normalize(vec3(2.0 * e, hR - hL, 0.0));
+    T = normalize(T - N * dot(N, T));
+    vec3 B = normalize(cross(N, T));
+
+    vs_out.uv = world.xz * u_uvScale;
+    vs_out.worldPos = world;
+    vs_out.normal = N;
+    vs_out.TBN = mat3(T, B, N);
+    vs_out.ao = 1.0;
+
+    gl_Position = u_projection * u_view * vec4(world, 1.0);
+}
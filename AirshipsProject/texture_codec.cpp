@@ -0,0 +1,294 @@
+#include "texture_codec.h"
+
+#include <SFML/Graphics.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "gl_resources.h"
+
+namespace {
+
+const char kTextureMagic[4] = { 'A', 'T', 'E', 'X' };
+const std::uint32_t kTextureVersion = 1;
+
+struct TextureFileHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t format;
+    std::uint32_t levelCount;
+};
+
+struct LevelHeader {
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t size;
+};
+
+using Block = std::uint8_t[16][4];
+
+// 2x2 box filter; odd edges reuse the last row/column.
+std::vector<std::uint8_t> Downsample(const std::vector<std::uint8_t>& src, std::uint32_t w, std::uint32_t h,
+    std::uint32_t& outW, std::uint32_t& outH) {
+    outW = std::max(w / 2, 1u);
+    outH = std::max(h / 2, 1u);
+    std::vector<std::uint8_t> dst(static_cast<size_t>(outW) * outH * 4);
+
+    for (std::uint32_t y = 0; y < outH; ++y) {
+        const std::uint32_t y0 = std::min(y * 2, h - 1);
+        const std::uint32_t y1 = std::min(y * 2 + 1, h - 1);
+        for (std::uint32_t x = 0; x < outW; ++x) {
+            const std::uint32_t x0 = std::min(x * 2, w - 1);
+            const std::uint32_t x1 = std::min(x * 2 + 1, w - 1);
+            for (int c = 0; c < 4; ++c) {
+                const unsigned int sum = src[(y0 * w + x0) * 4 + c] + src[(y0 * w + x1) * 4 + c] +
+                    src[(y1 * w + x0) * 4 + c] + src[(y1 * w + x1) * 4 + c];
+                dst[(static_cast<size_t>(y) * outW + x) * 4 + c] = static_cast<std::uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+    return dst;
+}
+
+void FetchBlock(const std::vector<std::uint8_t>& px, std::uint32_t w, std::uint32_t h, std::uint32_t bx, std::uint32_t by, Block out) {
+    for (std::uint32_t y = 0; y < 4; ++y) {
+        const std::uint32_t sy = std::min(by * 4 + y, h - 1);
+        for (std::uint32_t x = 0; x < 4; ++x) {
+            const std::uint32_t sx = std::min(bx * 4 + x, w - 1);
+            std::memcpy(out[y * 4 + x], &px[(static_cast<size_t>(sy) * w + sx) * 4], 4);
+        }
+    }
+}
+
+std::uint16_t To565(const float c[3]) {
+    auto Q = [](float v, int max) { return static_cast<std::uint16_t>(std::clamp(static_cast<int>(v * max / 255.0f + 0.5f), 0, max)); };
+    return static_cast<std::uint16_t>((Q(c[0], 31) << 11) | (Q(c[1], 63) << 5) | Q(c[2], 31));
+}
+
+void From565(std::uint16_t v, int out[3]) {
+    const int r = (v >> 11) & 31;
+    const int g = (v >> 5) & 63;
+    const int b = v & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+// Endpoints from the bounding box, flipped per channel to follow the
+// colours' main diagonal and inset a little, then nearest-palette indices.
+// Always 4-colour mode (c0 > c1), which BC3 requires anyway.
+void EncodeColorBlock(const Block px, std::uint8_t out[8]) {
+    float lo[3] = { 255.0f, 255.0f, 255.0f };
+    float hi[3] = { 0.0f, 0.0f, 0.0f };
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            lo[c] = std::min(lo[c], static_cast<float>(px[i][c]));
+            hi[c] = std::max(hi[c], static_cast<float>(px[i][c]));
+            mean[c] += px[i][c] / 16.0f;
+        }
+    }
+
+    for (int c = 1; c < 3; ++c) {
+        float cov = 0.0f;
+        for (int i = 0; i < 16; ++i) cov += (px[i][0] - mean[0]) * (px[i][c] - mean[c]);
+        if (cov < 0.0f) std::swap(lo[c], hi[c]);
+    }
+    for (int c = 0; c < 3; ++c) {
+        const float inset = (hi[c] - lo[c]) / 16.0f;
+        hi[c] -= inset;
+        lo[c] += inset;
+    }
+
+    std::uint16_t c0 = To565(hi);
+    std::uint16_t c1 = To565(lo);
+    if (c0 < c1) std::swap(c0, c1);
+
+    out[0] = static_cast<std::uint8_t>(c0 & 0xFF);
+    out[1] = static_cast<std::uint8_t>(c0 >> 8);
+    out[2] = static_cast<std::uint8_t>(c1 & 0xFF);
+    out[3] = static_cast<std::uint8_t>(c1 >> 8);
+
+    std::uint32_t indices = 0;
+    if (c0 != c1) {
+        int palette[4][3];
+        From565(c0, palette[0]);
+        From565(c1, palette[1]);
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (int i = 0; i < 16; ++i) {
+            int best = 0;
+            int bestError = 1 << 30;
+            for (int k = 0; k < 4; ++k) {
+                int error = 0;
+                for (int c = 0; c < 3; ++c) {
+                    const int d = px[i][c] - palette[k][c];
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    best = k;
+                }
+            }
+            indices |= static_cast<std::uint32_t>(best) << (2 * i);
+        }
+    }
+    std::memcpy(out + 4, &indices, 4);
+}
+
+// 8-value interpolated alpha between the block's max and min.
+void EncodeAlphaBlock(const Block px, std::uint8_t out[8]) {
+    int a0 = 0;
+    int a1 = 255;
+    for (int i = 0; i < 16; ++i) {
+        a0 = std::max(a0, static_cast<int>(px[i][3]));
+        a1 = std::min(a1, static_cast<int>(px[i][3]));
+    }
+    out[0] = static_cast<std::uint8_t>(a0);
+    out[1] = static_cast<std::uint8_t>(a1);
+
+    std::uint64_t indices = 0;
+    if (a0 != a1) {
+        int palette[8] = { a0, a1 };
+        for (int k = 2; k < 8; ++k) palette[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+
+        for (int i = 0; i < 16; ++i) {
+            int best = 0;
+            for (int k = 1; k < 8; ++k)
+                if (std::abs(px[i][3] - palette[k]) < std::abs(px[i][3] - palette[best])) best = k;
+            indices |= static_cast<std::uint64_t>(best) << (3 * i);
+        }
+    }
+    for (int b = 0; b < 6; ++b) out[2 + b] = static_cast<std::uint8_t>(indices >> (8 * b));
+}
+
+std::vector<std::uint8_t> CompressLevel(const std::vector<std::uint8_t>& px, std::uint32_t w, std::uint32_t h, bool alpha) {
+    const std::uint32_t bw = (w + 3) / 4;
+    const std::uint32_t bh = (h + 3) / 4;
+    const size_t blockBytes = alpha ? 16 : 8;
+    std::vector<std::uint8_t> out(static_cast<size_t>(bw) * bh * blockBytes);
+
+    Block block;
+    std::uint8_t* dst = out.data();
+    for (std::uint32_t by = 0; by < bh; ++by) {
+        for (std::uint32_t bx = 0; bx < bw; ++bx) {
+            FetchBlock(px, w, h, bx, by, block);
+            if (alpha) {
+                EncodeAlphaBlock(block, dst);
+                dst += 8;
+            }
+            EncodeColorBlock(block, dst);
+            dst += 8;
+        }
+    }
+    return out;
+}
+
+size_t ExpectedLevelSize(CookedTextureFormat format, std::uint32_t w, std::uint32_t h) {
+    const size_t blocks = static_cast<size_t>((w + 3) / 4) * ((h + 3) / 4);
+    switch (format) {
+    case CookedTextureFormat::Bc1: return blocks * 8;
+    case CookedTextureFormat::Bc3: return blocks * 16;
+    default: return static_cast<size_t>(w) * h * 4;
+    }
+}
+
+}
+
+void CookTexture(const sf::Image& image, bool lossless, CookedTexture& out) {
+    std::uint32_t w = image.getSize().x;
+    std::uint32_t h = image.getSize().y;
+    const std::uint8_t* pixels = image.getPixelsPtr();
+    std::vector<std::uint8_t> level(pixels, pixels + static_cast<size_t>(w) * h * 4);
+
+    bool opaque = true;
+    for (size_t i = 3; i < level.size() && opaque; i += 4) opaque = level[i] == 255;
+
+    out.format = lossless ? CookedTextureFormat::Rgba8 : (opaque ? CookedTextureFormat::Bc1 : CookedTextureFormat::Bc3);
+    out.levels.clear();
+
+    for (;;) {
+        CookedTexture::Level l;
+        l.width = w;
+        l.height = h;
+        l.data = lossless ? level : CompressLevel(level, w, h, !opaque);
+        out.levels.push_back(std::move(l));
+
+        if (w == 1 && h == 1) break;
+        level = Downsample(level, w, h, w, h);
+    }
+}
+
+bool SaveCookedTexture(const std::string& path, const CookedTexture& tex) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    TextureFileHeader header{};
+    std::memcpy(header.magic, kTextureMagic, 4);
+    header.version = kTextureVersion;
+    header.format = static_cast<std::uint32_t>(tex.format);
+    header.levelCount = static_cast<std::uint32_t>(tex.levels.size());
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (const CookedTexture::Level& l : tex.levels) {
+        const LevelHeader lh{ l.width, l.height, static_cast<std::uint32_t>(l.data.size()) };
+        file.write(reinterpret_cast<const char*>(&lh), sizeof(lh));
+        file.write(reinterpret_cast<const char*>(l.data.data()), static_cast<std::streamsize>(l.data.size()));
+    }
+    return static_cast<bool>(file);
+}
+
+bool LoadCookedTexture(const std::string& path, CookedTexture& tex) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    TextureFileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || !std::equal(header.magic, header.magic + 4, kTextureMagic) || header.version != kTextureVersion ||
+        header.format > static_cast<std::uint32_t>(CookedTextureFormat::Bc3) || header.levelCount == 0 || header.levelCount > 32)
+        return false;
+
+    tex.format = static_cast<CookedTextureFormat>(header.format);
+    tex.levels.resize(header.levelCount);
+    for (CookedTexture::Level& l : tex.levels) {
+        LevelHeader lh{};
+        file.read(reinterpret_cast<char*>(&lh), sizeof(lh));
+        if (!file || lh.width == 0 || lh.height == 0 || lh.width > 16384 || lh.height > 16384 ||
+            lh.size != ExpectedLevelSize(tex.format, lh.width, lh.height))
+            return false;
+
+        l.width = lh.width;
+        l.height = lh.height;
+        l.data.resize(lh.size);
+        if (!file.read(reinterpret_cast<char*>(l.data.data()), lh.size)) return false;
+    }
+    return true;
+}
+
+bool CookedTexturesSupported() {
+    return GLEW_EXT_texture_compression_s3tc != 0;
+}
+
+GLuint CreateTextureFromCooked(const CookedTexture& tex) {
+    if (tex.levels.empty()) return 0;
+    if (tex.format != CookedTextureFormat::Rgba8 && !CookedTexturesSupported()) return 0;
+
+    GLenum internal = GL_RGBA8;
+    if (tex.format == CookedTextureFormat::Bc1) internal = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    if (tex.format == CookedTextureFormat::Bc3) internal = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    const bool compressed = tex.format != CookedTextureFormat::Rgba8;
+
+    std::vector<TextureLevel> levels(tex.levels.size());
+    for (size_t i = 0; i < levels.size(); ++i) {
+        const CookedTexture::Level& l = tex.levels[i];
+        levels[i].width = static_cast<GLsizei>(l.width);
+        levels[i].height = static_cast<GLsizei>(l.height);
+        levels[i].data = l.data.data();
+        levels[i].compressedSize = compressed ? static_cast<GLsizei>(l.data.size()) : 0;
+    }
+    return CreateTexture2D(internal, levels.data(), static_cast<int>(levels.size()), false);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sf {
+class Image;
+}
+
+enum class CookedTextureFormat : std::uint32_t {
+    Rgba8 = 0,
+    Bc1 = 1,
+    Bc3 = 2,
+};
+
+// A texture with its whole mip chain built offline (.atex), so loading is
+// a file read and one upload per level with no decode or glGenerateMipmap.
+struct CookedTexture {
+    struct Level {
+        std::uint32_t width{ 0 };
+        std::uint32_t height{ 0 };
+        std::vector<std::uint8_t> data;
+    };
+
+    CookedTextureFormat format{ CookedTextureFormat::Rgba8 };
+    std::vector<Level> levels;
+};
+
+// Box-filtered mips, then BC1 if every pixel is opaque or BC3 if not.
+// lossless keeps RGBA8 (normal maps, where block artifacts show).
+void CookTexture(const sf::Image& image, bool lossless, CookedTexture& out);
+
+bool SaveCookedTexture(const std::string& path, const CookedTexture& tex);
+bool LoadCookedTexture(const std::string& path, CookedTexture& tex);
+
+// S3TC is an extension in GL 3.3/4.3; without it callers fall back to the
+// source image.
+bool CookedTexturesSupported();
+
+// Same sampling state as CreateTextureFromImage. Needs a GL context.
+GLuint CreateTextureFromCooked(const CookedTexture& tex);
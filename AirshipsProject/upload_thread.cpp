@@ -0,0 +1,140 @@
+#include "upload_thread.h"
+
+#include <iostream>
+
+#include "gl_debug.h"
+
+UploadThread::~UploadThread() {
+    Stop();
+}
+
+bool UploadThread::Start() {
+    if (m_running) return true;
+
+    m_stop = false;
+    m_contextReady = false;
+    m_contextFailed = false;
+    m_thread = std::thread(&UploadThread::ThreadMain, this);
+
+    // Wait until the worker either has its context current or gave up,
+    // so callers know whether jobs will really run off-thread.
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [&] { return m_contextReady || m_contextFailed; });
+    }
+
+    if (m_contextFailed) {
+        m_thread.join();
+        std::cerr << "Upload thread: shared GL context unavailable, uploading on render thread\n";
+        return false;
+    }
+
+    m_running = true;
+    return true;
+}
+
+void UploadThread::Stop() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+    m_running = false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.clear();
+    for (auto& c : m_completed) {
+        if (c.fence) glDeleteSync(c.fence);
+    }
+    m_completed.clear();
+    m_inFlight = 0;
+}
+
+void UploadThread::Enqueue(Job job, Publish publish) {
+    if (!m_running) {
+        bool ok = job();
+        if (publish) publish(ok);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back({ std::move(job), std::move(publish) });
+        ++m_inFlight;
+    }
+    m_cv.notify_one();
+}
+
+int UploadThread::Poll() {
+    std::vector<Completed> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_completed.size();) {
+            Completed& c = m_completed[i];
+            GLenum status = c.fence ? glClientWaitSync(c.fence, 0, 0) : GL_ALREADY_SIGNALED;
+            if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+                if (c.fence) glDeleteSync(c.fence);
+                ready.push_back(std::move(c));
+                m_completed.erase(m_completed.begin() + i);
+                --m_inFlight;
+            }
+            else {
+                ++i;
+            }
+        }
+    }
+
+    for (auto& c : ready) {
+        if (c.publish) c.publish(c.ok);
+    }
+    return static_cast<int>(ready.size());
+}
+
+bool UploadThread::Idle() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_inFlight == 0;
+}
+
+void UploadThread::ThreadMain() {
+    // sf::Context shares its objects with every other SFML context,
+    // including the window's, and becomes current on this thread.
+    sf::Context context;
+    if (!context.setActive(true)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_contextFailed = true;
+        m_cv.notify_all();
+        return;
+    }
+
+    AttachGlDebugContext("upload");
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_contextReady = true;
+    }
+    m_cv.notify_all();
+
+    for (;;) {
+        Pending p;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [&] { return m_stop || !m_queue.empty(); });
+            if (m_stop) break;
+            p = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        bool ok = p.job();
+
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_completed.push_back({ fence, std::move(p.publish), ok });
+    }
+
+    glFinish();
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <SFML/Graphics.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Owns a second GL context (shared with the window's) on its own thread.
+// Jobs run there and issue their glBufferData/glTexImage2D calls; once the
+// GPU has consumed them (fence signaled) the publish callback runs on the
+// render thread, which is the only place that may touch VAOs or scene state.
+class UploadThread {
+public:
+    using Job = std::function<bool()>;
+    using Publish = std::function<void(bool ok)>;
+
+    UploadThread() = default;
+    ~UploadThread();
+
+    UploadThread(const UploadThread&) = delete;
+    UploadThread& operator=(const UploadThread&) = delete;
+
+    bool Start();
+    void Stop();
+
+    void Enqueue(Job job, Publish publish);
+    int Poll();
+
+    bool Running() const { return m_running; }
+    bool Idle() const;
+
+private:
+    struct Pending {
+        Job job;
+        Publish publish;
+    };
+
+    struct Completed {
+        GLsync fence{ nullptr };
+        Publish publish;
+        bool ok{ false };
+    };
+
+    void ThreadMain();
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{ false };
+
+    bool m_stop{ false };
+    bool m_contextReady{ false };
+    bool m_contextFailed{ false };
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Pending> m_queue;
+    std::vector<Completed> m_completed;
+    int m_inFlight{ 0 };
+};
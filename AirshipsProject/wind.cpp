@@ -0,0 +1,347 @@
+#include "wind.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "job_pool.h"
+#include "terrain.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WIND_USE_SSE 1
+#else
+#define WIND_USE_SSE 0
+#endif
+
+namespace {
+
+// Trilinear lookup in cell-centre grid coordinates, clamped to the edges.
+// Cells are padded to four floats so each corner is one SSE load and the
+// three axis lerps run on all components at once.
+glm::vec3 SampleCells(const std::vector<glm::vec4>& cells, const glm::ivec3& dims, glm::vec3 g) {
+    g = glm::clamp(g, glm::vec3(0.0f), glm::vec3(dims - 1));
+    const glm::ivec3 i0 = glm::min(glm::ivec3(g), glm::max(dims - 2, glm::ivec3(0)));
+    const glm::vec3 f = glm::min(g - glm::vec3(i0), glm::vec3(1.0f));
+
+    const int sx = dims.x > 1 ? 1 : 0;
+    const int sy = dims.y > 1 ? dims.x : 0;
+    const int sz = dims.z > 1 ? dims.x * dims.y : 0;
+    const glm::vec4* c = &cells[(static_cast<size_t>(i0.z) * dims.y + i0.y) * dims.x + i0.x];
+
+#if WIND_USE_SSE
+    auto Load = [&](int o) { return _mm_loadu_ps(&c[o].x); };
+    auto Lerp = [](__m128 a, __m128 b, __m128 t) { return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)); };
+
+    const __m128 fx = _mm_set1_ps(f.x);
+    const __m128 fy = _mm_set1_ps(f.y);
+    const __m128 fz = _mm_set1_ps(f.z);
+
+    __m128 x00 = Lerp(Load(0), Load(sx), fx);
+    __m128 x10 = Lerp(Load(sy), Load(sy + sx), fx);
+    __m128 x01 = Lerp(Load(sz), Load(sz + sx), fx);
+    __m128 x11 = Lerp(Load(sz + sy), Load(sz + sy + sx), fx);
+    __m128 r = Lerp(Lerp(x00, x10, fy), Lerp(x01, x11, fy), fz);
+
+    alignas(16) float out[4];
+    _mm_store_ps(out, r);
+    return glm::vec3(out[0], out[1], out[2]);
+#else
+    glm::vec4 x00 = glm::mix(c[0], c[sx], f.x);
+    glm::vec4 x10 = glm::mix(c[sy], c[sy + sx], f.x);
+    glm::vec4 x01 = glm::mix(c[sz], c[sz + sx], f.x);
+    glm::vec4 x11 = glm::mix(c[sz + sy], c[sz + sy + sx], f.x);
+    return glm::vec3(glm::mix(glm::mix(x00, x10, f.y), glm::mix(x01, x11, f.y), f.z));
+#endif
+}
+
+}
+
+WindField::~WindField() {
+    Stop();
+}
+
+void WindField::Start(JobPool& pool, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    Stop();
+
+    dims = glm::max(dims, glm::ivec3(2));
+    m_pool = &pool;
+    m_min = boundsMin;
+    m_max = boundsMax;
+    m_cell = (boundsMax - boundsMin) / glm::vec3(dims);
+    m_cellCount = static_cast<size_t>(dims.x) * dims.y * dims.z;
+
+    m_velocity.assign(m_cellCount, glm::vec4(0.0f));
+    m_scratch.assign(m_cellCount, glm::vec4(0.0f));
+    m_pressure.assign(m_cellCount, 0.0f);
+    m_pressureScratch.assign(m_cellCount, 0.0f);
+    m_divergence.assign(m_cellCount, 0.0f);
+    m_solid.assign(m_cellCount, 0);
+    Reset(nullptr, 0);
+
+    m_stop = false;
+    m_thread = std::thread(&WindField::ThreadMain, this);
+}
+
+void WindField::Stop() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+    m_requested = m_running = m_ready = m_inFlight = false;
+}
+
+void WindField::WaitIdle(std::unique_lock<std::mutex>& lock) {
+    m_cv.wait(lock, [&] { return !m_requested && !m_running; });
+    m_ready = false;
+    m_inFlight = false;
+}
+
+void WindField::Reset(const Terrain* terrain, std::uint64_t seed) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    WaitIdle(lock);
+
+    m_rng.seed(static_cast<std::uint32_t>(seed ^ (seed >> 32)) ^ 0x57a1du);
+    m_simTime = 0.0f;
+    m_accumulator = 0.0f;
+
+    for (int z = 0; z < dims.z; ++z) {
+        for (int y = 0; y < dims.y; ++y) {
+            for (int x = 0; x < dims.x; ++x) {
+                const int i = Index(x, y, z);
+                const glm::vec3 c = CellCenter(x, y, z);
+                m_solid[i] = (terrain && c.y < terrain->HeightAt(c.x, c.z)) ? 1 : 0;
+                m_velocity[i] = m_solid[i] ? glm::vec4(0.0f) : glm::vec4(Profile(c.y), 0.0f);
+            }
+        }
+    }
+    std::fill(m_pressure.begin(), m_pressure.end(), 0.0f);
+    m_front = m_velocity;
+    m_published = m_velocity;
+
+    for (auto& g : m_gusts) RespawnGust(g, true);
+}
+
+void WindField::Update(float dt) {
+    if (!m_thread.joinable()) return;
+
+    m_accumulator += dt;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_ready) {
+        m_front.swap(m_published);
+        m_ready = false;
+        m_inFlight = false;
+        m_lastStepMs = m_stepMs;
+    }
+
+    if (!m_inFlight && m_accumulator >= stepInterval) {
+        // A long hitch is not replayed in full; the field just catches up.
+        m_stepDt = std::min(m_accumulator, stepInterval * 4.0f);
+        m_accumulator = 0.0f;
+        m_requested = true;
+        m_inFlight = true;
+        m_cv.notify_all();
+    }
+}
+
+glm::vec3 WindField::Sample(const glm::vec3& p) const {
+    if (m_front.empty()) return glm::vec3(0.0f);
+    return SampleCells(m_front, dims, ToGrid(p));
+}
+
+void WindField::ThreadMain() {
+    for (;;) {
+        float dt = 0.0f;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [&] { return m_stop || m_requested; });
+            if (m_stop) return;
+            m_requested = false;
+            m_running = true;
+            dt = m_stepDt;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        Step(dt);
+        m_published = m_velocity;
+        float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stepMs = ms;
+            m_running = false;
+            m_ready = true;
+        }
+        m_cv.notify_all();
+    }
+}
+
+// Power-law boundary layer that slowly veers over time.
+glm::vec3 WindField::Profile(float y) const {
+    const float h = glm::clamp(y, 0.5f, m_max.y) / referenceHeight;
+    const float speed = std::min(std::pow(h, 0.2f), 1.3f);
+
+    const float a = 0.35f * std::sin(m_simTime * 0.03f);
+    const float ca = std::cos(a), sa = std::sin(a);
+    return glm::vec3(prevailing.x * ca - prevailing.z * sa, prevailing.y, prevailing.x * sa + prevailing.z * ca) * speed;
+}
+
+glm::vec3 WindField::CellCenter(int x, int y, int z) const {
+    return m_min + (glm::vec3(x, y, z) + 0.5f) * m_cell;
+}
+
+glm::vec3 WindField::ToGrid(const glm::vec3& p) const {
+    return (p - m_min) / m_cell - 0.5f;
+}
+
+void WindField::RespawnGust(Gust& g, bool anywhere) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const glm::vec3 extent = m_max - m_min;
+
+    const float y = m_min.y + extent.y * glm::mix(0.1f, 0.7f, unit(m_rng));
+    const glm::vec3 base = Profile(y);
+    const glm::vec2 dir = glm::length(glm::vec2(base.x, base.z)) > 1e-4f ? glm::normalize(glm::vec2(base.x, base.z)) : glm::vec2(1.0f, 0.0f);
+
+    if (anywhere) {
+        g.position = m_min + extent * glm::vec3(unit(m_rng), 0.0f, unit(m_rng));
+    }
+    else {
+        // Enter from the upwind side so gusts sweep across the whole area.
+        const glm::vec2 center = glm::vec2(m_min.x + m_max.x, m_min.z + m_max.z) * 0.5f;
+        const float reach = 0.5f * std::max(extent.x, extent.z);
+        const glm::vec2 side(-dir.y, dir.x);
+        const glm::vec2 p = center - dir * (reach + gustRadius) + side * (reach * (unit(m_rng) * 2.0f - 1.0f));
+        g.position = glm::vec3(p.x, 0.0f, p.y);
+    }
+    g.position.y = y;
+
+    const float turn = (unit(m_rng) * 2.0f - 1.0f) * 0.6f;
+    const glm::vec2 d(dir.x * std::cos(turn) - dir.y * std::sin(turn), dir.x * std::sin(turn) + dir.y * std::cos(turn));
+    g.direction = glm::vec3(d.x, (unit(m_rng) - 0.5f) * 0.3f, d.y);
+    g.strength = gustStrength * glm::mix(0.5f, 1.0f, unit(m_rng));
+}
+
+void WindField::Step(float dt) {
+    m_simTime += dt;
+
+    const int nx = dims.x, ny = dims.y, nz = dims.z;
+    const float relax = 1.0f - std::exp(-relaxRate * dt);
+    const float invR2 = 1.0f / (gustRadius * gustRadius);
+    const glm::vec3 inv2h = 0.5f / m_cell;
+    const glm::vec3 invH2 = 1.0f / (m_cell * m_cell);
+    const float diag = 2.0f * (invH2.x + invH2.y + invH2.z);
+
+    // Forcing and semi-Lagrangian advection.
+    m_pool->ParallelFor(nz, [&](int z0, int z1) {
+        for (int z = z0; z < z1; ++z) {
+            for (int y = 0; y < ny; ++y) {
+                for (int x = 0; x < nx; ++x) {
+                    const int i = Index(x, y, z);
+                    if (m_solid[i]) {
+                        m_scratch[i] = glm::vec4(0.0f);
+                        continue;
+                    }
+
+                    const glm::vec3 p = CellCenter(x, y, z);
+                    glm::vec3 v = SampleCells(m_velocity, dims, ToGrid(p - glm::vec3(m_velocity[i]) * dt));
+                    v += (Profile(p.y) - v) * relax;
+
+                    for (const Gust& g : m_gusts) {
+                        glm::vec3 d = p - g.position;
+                        v += g.direction * (g.strength * std::exp(-glm::dot(d, d) * invR2) * dt);
+                    }
+                    m_scratch[i] = glm::vec4(v, 0.0f);
+                }
+            }
+        }
+        });
+    m_velocity.swap(m_scratch);
+
+    // Out-of-range neighbours mirror the centre (no flux through the sides
+    // or floor); solid neighbours are still air.
+    auto Vel = [&](int x, int y, int z, int center) -> glm::vec3 {
+        if (x < 0 || y < 0 || z < 0 || x >= nx || y >= ny || z >= nz) return glm::vec3(m_velocity[center]);
+        const int j = Index(x, y, z);
+        return m_solid[j] ? glm::vec3(0.0f) : glm::vec3(m_velocity[j]);
+        };
+    // The top is open (p = 0) so air can leave over hills.
+    auto Pressure = [&](const std::vector<float>& p, int x, int y, int z, int center) -> float {
+        if (y >= ny) return 0.0f;
+        if (x < 0 || y < 0 || z < 0 || x >= nx || z >= nz) return p[center];
+        const int j = Index(x, y, z);
+        return m_solid[j] ? p[center] : p[j];
+        };
+
+    m_pool->ParallelFor(nz, [&](int z0, int z1) {
+        for (int z = z0; z < z1; ++z) {
+            for (int y = 0; y < ny; ++y) {
+                for (int x = 0; x < nx; ++x) {
+                    const int i = Index(x, y, z);
+                    if (m_solid[i]) {
+                        m_divergence[i] = 0.0f;
+                        continue;
+                    }
+                    m_divergence[i] =
+                        (Vel(x + 1, y, z, i).x - Vel(x - 1, y, z, i).x) * inv2h.x +
+                        (Vel(x, y + 1, z, i).y - Vel(x, y - 1, z, i).y) * inv2h.y +
+                        (Vel(x, y, z + 1, i).z - Vel(x, y, z - 1, i).z) * inv2h.z;
+                }
+            }
+        }
+        });
+
+    // Jacobi iterations, warm-started from the previous step's pressure.
+    for (int iter = 0; iter < pressureIterations; ++iter) {
+        const std::vector<float>& p = m_pressure;
+        m_pool->ParallelFor(nz, [&](int z0, int z1) {
+            for (int z = z0; z < z1; ++z) {
+                for (int y = 0; y < ny; ++y) {
+                    for (int x = 0; x < nx; ++x) {
+                        const int i = Index(x, y, z);
+                        if (m_solid[i]) {
+                            m_pressureScratch[i] = 0.0f;
+                            continue;
+                        }
+                        const float sum =
+                            (Pressure(p, x - 1, y, z, i) + Pressure(p, x + 1, y, z, i)) * invH2.x +
+                            (Pressure(p, x, y - 1, z, i) + Pressure(p, x, y + 1, z, i)) * invH2.y +
+                            (Pressure(p, x, y, z - 1, i) + Pressure(p, x, y, z + 1, i)) * invH2.z;
+                        m_pressureScratch[i] = (sum - m_divergence[i]) / diag;
+                    }
+                }
+            }
+            });
+        m_pressure.swap(m_pressureScratch);
+    }
+
+    m_pool->ParallelFor(nz, [&](int z0, int z1) {
+        const std::vector<float>& p = m_pressure;
+        for (int z = z0; z < z1; ++z) {
+            for (int y = 0; y < ny; ++y) {
+                for (int x = 0; x < nx; ++x) {
+                    const int i = Index(x, y, z);
+                    if (m_solid[i]) continue;
+                    glm::vec3 grad(
+                        (Pressure(p, x + 1, y, z, i) - Pressure(p, x - 1, y, z, i)) * inv2h.x,
+                        (Pressure(p, x, y + 1, z, i) - Pressure(p, x, y - 1, z, i)) * inv2h.y,
+                        (Pressure(p, x, y, z + 1, i) - Pressure(p, x, y, z - 1, i)) * inv2h.z);
+                    m_velocity[i] -= glm::vec4(grad, 0.0f);
+                }
+            }
+        }
+        });
+
+    // Gusts ride the prevailing flow and re-enter upwind once they leave.
+    for (Gust& g : m_gusts) {
+        g.position += Profile(g.position.y) * dt;
+        const float margin = gustRadius * 1.5f;
+        if (g.position.x < m_min.x - margin || g.position.x > m_max.x + margin ||
+            g.position.z < m_min.z - margin || g.position.z > m_max.z + margin)
+            RespawnGust(g, false);
+    }
+}
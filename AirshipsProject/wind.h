@@ -0,0 +1,105 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+class JobPool;
+class Terrain;
+
+// Coarse 3D wind over the play area, solved as a small stable-fluids grid:
+// relax toward a prevailing height profile, add drifting gusts,
+// semi-Lagrangian advection, then a Jacobi pressure projection. A
+// background thread steps it at stepInterval using the shared JobPool
+// (one z-slab range per worker); the render thread only swaps in finished
+// steps and samples the published copy, so cost is fixed by dims.
+class WindField {
+public:
+    static constexpr int kGusts = 4;
+
+    glm::ivec3 dims{ 32, 10, 32 };
+    float stepInterval{ 1.0f / 15.0f };
+    int pressureIterations{ 16 };
+
+    glm::vec3 prevailing{ 3.5f, 0.0f, 1.2f };   // at referenceHeight
+    float referenceHeight{ 20.0f };
+    float relaxRate{ 0.3f };
+    float gustStrength{ 5.0f };
+    float gustRadius{ 9.0f };
+
+    WindField() = default;
+    ~WindField();
+
+    WindField(const WindField&) = delete;
+    WindField& operator=(const WindField&) = delete;
+
+    void Start(JobPool& pool, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+    void Stop();
+
+    // Waits for any step in flight, then rebuilds the solid mask from the
+    // terrain and restarts from the calm prevailing profile.
+    void Reset(const Terrain* terrain, std::uint64_t seed);
+
+    // Render thread, once per frame.
+    void Update(float dt);
+
+    glm::vec3 Sample(const glm::vec3& p) const;
+
+    float LastStepMs() const { return m_lastStepMs; }
+
+private:
+    struct Gust {
+        glm::vec3 position{ 0.0f };
+        glm::vec3 direction{ 0.0f };
+        float strength{ 0.0f };
+    };
+
+    void ThreadMain();
+    void Step(float dt);
+    void WaitIdle(std::unique_lock<std::mutex>& lock);
+
+    glm::vec3 Profile(float y) const;
+    glm::vec3 CellCenter(int x, int y, int z) const;
+    glm::vec3 ToGrid(const glm::vec3& p) const;
+    int Index(int x, int y, int z) const { return (z * dims.y + y) * dims.x + x; }
+    void RespawnGust(Gust& g, bool anywhere);
+
+    JobPool* m_pool{ nullptr };
+    glm::vec3 m_min{ 0.0f };
+    glm::vec3 m_max{ 0.0f };
+    glm::vec3 m_cell{ 1.0f };
+    size_t m_cellCount{ 0 };
+
+    // Simulation state, touched only by the step thread while a step runs.
+    std::vector<glm::vec4> m_velocity;
+    std::vector<glm::vec4> m_scratch;
+    std::vector<float> m_pressure;
+    std::vector<float> m_pressureScratch;
+    std::vector<float> m_divergence;
+    std::vector<std::uint8_t> m_solid;
+    Gust m_gusts[kGusts];
+    std::mt19937 m_rng;
+    float m_simTime{ 0.0f };
+
+    // m_published is filled by the step thread and swapped into m_front by
+    // the render thread; m_ready under m_mutex hands it over.
+    std::vector<glm::vec4> m_front;
+    std::vector<glm::vec4> m_published;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop{ false };
+    bool m_requested{ false };
+    bool m_running{ false };
+    bool m_ready{ false };
+    bool m_inFlight{ false };
+    float m_stepDt{ 0.0f };
+    float m_stepMs{ 0.0f };
+    float m_accumulator{ 0.0f };
+    float m_lastStepMs{ 0.0f };
+};